@@ -37,6 +37,16 @@
 #include "web_views.h"     
 #include "web_utils.h"     
 #include "settings_manager.h"
+#include "capture_task.h"
+#include "sd_writer.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "photo_journal.h"
+#include "thumbnails.h"
+#include "retention.h"
+#include "file_stream.h"
+#include "stream_broadcaster.h"
+#include "snapshot_cache.h"
 
 void setup() {
   // Start seriële communicatie
@@ -68,20 +78,63 @@ void setup() {
   // SD-kaart initialiseren met herhaalde pogingen
   initSDCard();
   
+  // Foto-index laden (of eenmalig opbouwen voor kaarten van oudere firmware)
+  initPhotoIndex();
+  
+  // Foto-opslag: één bestand per foto of segmenten per dag
+  initPhotoStore();
+  
+  // Laatst opgeslagen foto's controleren na een eventuele stroomuitval
+  recoverPhotoJournal();
+  
   // WiFi verbinding opzetten
   setupWiFi();
   
   // NTP tijd synchroniseren
   setupTimeSync();
   
+  // Start de bestandsstreamer (grote, dubbel gebufferde SD-naar-client overdracht)
+  if (!startFileStreamer()) {
+    Serial.println("Bestandsstreamer niet actief, bestanden worden in kleine blokken verstuurd");
+  }
+  
+  // Momentopnamecache: gelijktijdige /snapshot verzoeken delen één opname
+  initSnapshotCache();
+  
+  // Start de livestreambron (gedeelde camerabeelden voor meerdere kijkers)
+  if (!startStreamBroadcaster()) {
+    Serial.println("Livestream-taak niet actief, één kijker tegelijk");
+  }
+  
   // Start webserver
   startWebServer();
   
+  // Start de SD-schrijver die foto's buiten de capture-taak opslaat
+  if (!startSdWriter()) {
+    Serial.println("SD-schrijver niet actief, foto's worden synchroon opgeslagen");
+  }
+  
+  // Start de miniaturentaak (verkleinde kopieën voor de galerij)
+  if (!startThumbnailTask()) {
+    Serial.println("Miniaturentaak niet actief, galerij toont originele foto's");
+  }
+  
+  // Start het bewaarbeleid (oudste dagen verwijderen en uitdunnen op de achtergrond)
+  if (!startRetentionTask()) {
+    Serial.println("Retentietaak niet actief, oude foto's worden niet automatisch opgeruimd");
+  }
+  
+  // Start de capture-taak die het opnameschema los van de webserver uitvoert
+  if (!startCaptureTask()) {
+    Serial.println("Capture-taak kon niet starten");
+  }
+  
   Serial.println("Setup voltooid. Timelapse actief.");
 }
 
 void loop() {
-  // Als tijd gesynchroniseerd is, controleer tijd voor foto's maken
+  // Foto's worden door de capture-taak gemaakt (zie capture_task.cpp),
+  // loop() verzorgt alleen de tijdsynchronisatie en de webserver
   if (timeInitialized) {
     // Dagelijks de tijd synchroniseren
     unsigned long currentTime = millis();
@@ -89,22 +142,6 @@ void loop() {
       syncTimeNTP();
       lastNTPSync = currentTime;
     }
-    
-    // Controleer of het tijd is voor een nieuwe foto
-    if (sdCardAvailable && isDay()) {
-      if (currentTime - lastPhotoTime > (photoInterval * 60 * 1000)) {
-        // Maak een dagmap als die nog niet bestaat
-        if (createDayFolder()) {
-          // Maak en sla een foto op
-          if (takeSavePhoto()) {
-            Serial.println("Foto succesvol gemaakt en opgeslagen");
-          } else {
-            Serial.println("Fout bij maken of opslaan van foto");
-          }
-        }
-        lastPhotoTime = currentTime;
-      }
-    }
   }
   
   // Afhandelen van webserver verzoeken
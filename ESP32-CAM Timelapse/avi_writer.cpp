@@ -0,0 +1,422 @@
+#include "avi_writer.h"
+#include "photo_index.h"
+#include "thumbnails.h"
+#include "file_stream.h"
+#include "card_usage.h"
+#include "web_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Dagvideo als MJPEG in een AVI-container. Elke opgeslagen foto wordt als
+// '00dc'-chunk achter de vorige geplakt, zonder opnieuw te coderen. De header
+// (eerste 224 bytes, binnen één sector) is het commitpunt: pas als een frame
+// en zijn indexregel geschreven zijn, wordt de header met het nieuwe aantal
+// frames herschreven. Valt de stroom tijdens een frame uit, dan telt dat
+// frame gewoon niet mee en wordt het bij de volgende foto overschreven.
+// De idx1-regels staan tot het afsluiten van de dag in een apart bestand;
+// /video/ levert ook een nog open dag direct als complete AVI af.
+
+#define AVI_HEADER_SIZE  224        // Tot en met de 'movi' fourcc
+#define AVI_MOVI_OFFSET  220        // Positie van 'movi'; idx1-offsets zijn hiertoe relatief
+#define AVI_INDEX_ENTRY  16
+#define AVIF_HASINDEX    0x10
+#define AVIIF_KEYFRAME   0x10
+
+// Toestand van een dagvideo, zoals in de header opgeslagen
+struct AviInfo {
+  uint32_t frames;
+  uint32_t width;
+  uint32_t height;
+  uint32_t moviSize;         // Grootte van de 'movi' LIST (inclusief de fourcc)
+  uint32_t maxFrameSize;
+  bool finalized;            // idx1 staat achter de frames
+};
+
+// Een deel van de AVI zoals die naar de client gaat
+struct AviSegment {
+  const uint8_t* data;       // Uit het geheugen, of
+  File* file;                // uit een bestand vanaf offset
+  uint32_t offset;
+  uint32_t length;
+};
+
+static SemaphoreHandle_t aviLock = NULL;
+static char lastDay[16] = "";
+
+static void lockAvi() {
+  if (!aviLock) aviLock = xSemaphoreCreateMutex();
+  if (aviLock) xSemaphoreTake(aviLock, portMAX_DELAY);
+}
+
+static void unlockAvi() {
+  if (aviLock) xSemaphoreGive(aviLock);
+}
+
+static String aviPath(const String& dayName) {
+  return "/timelapse/" + dayName + "/" + AVI_FILE;
+}
+
+static String aviIndexPath(const String& dayName) {
+  return "/timelapse/" + dayName + "/" + AVI_INDEX_FILE;
+}
+
+// Little-endian velden
+static void put16(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putFourCC(uint8_t* p, const char* fourcc) {
+  memcpy(p, fourcc, 4);
+}
+
+// Bouw de RIFF/AVI header voor een MJPEG-stream
+static void buildAviHeader(uint8_t* h, const AviInfo& info, uint32_t fps) {
+  uint32_t indexSize = info.finalized ? 8 + info.frames * AVI_INDEX_ENTRY : 0;
+  memset(h, 0, AVI_HEADER_SIZE);
+
+  putFourCC(h + 0, "RIFF");
+  put32(h + 4, AVI_MOVI_OFFSET - 8 + info.moviSize + indexSize);
+  putFourCC(h + 8, "AVI ");
+  putFourCC(h + 12, "LIST");
+  put32(h + 16, 192);
+  putFourCC(h + 20, "hdrl");
+
+  // Hoofdheader (avih)
+  putFourCC(h + 24, "avih");
+  put32(h + 28, 56);
+  put32(h + 32, 1000000 / fps);              // Microseconden per frame
+  put32(h + 36, info.maxFrameSize * fps);    // Maximale bytes per seconde
+  put32(h + 44, info.finalized ? AVIF_HASINDEX : 0);
+  put32(h + 48, info.frames);
+  put32(h + 56, 1);                          // Aantal streams
+  put32(h + 60, info.maxFrameSize);          // Aanbevolen buffergrootte
+  put32(h + 64, info.width);
+  put32(h + 68, info.height);
+
+  // Streamheader (strh)
+  putFourCC(h + 88, "LIST");
+  put32(h + 92, 116);
+  putFourCC(h + 96, "strl");
+  putFourCC(h + 100, "strh");
+  put32(h + 104, 56);
+  putFourCC(h + 108, "vids");
+  putFourCC(h + 112, "MJPG");
+  put32(h + 128, 1);                         // Scale
+  put32(h + 132, fps);                       // Rate
+  put32(h + 140, info.frames);               // Lengte in frames
+  put32(h + 144, info.maxFrameSize);
+  put32(h + 148, 0xFFFFFFFF);                // Standaardkwaliteit
+  put16(h + 160, info.width);
+  put16(h + 162, info.height);
+
+  // Beeldformaat (strf)
+  putFourCC(h + 164, "strf");
+  put32(h + 168, 40);
+  put32(h + 172, 40);
+  put32(h + 176, info.width);
+  put32(h + 180, info.height);
+  put16(h + 184, 1);                         // Planes
+  put16(h + 186, 24);                        // Bits per pixel
+  putFourCC(h + 188, "MJPG");
+  put32(h + 192, info.width * info.height * 3);
+
+  putFourCC(h + 212, "LIST");
+  put32(h + 216, info.moviSize);
+  putFourCC(h + 220, "movi");
+}
+
+// Lees de toestand uit de header van een bestaande dagvideo
+static bool readAviInfo(File& file, AviInfo& info) {
+  uint8_t h[AVI_HEADER_SIZE];
+  file.seek(0);
+  if (file.read(h, sizeof(h)) != sizeof(h) || memcmp(h, "RIFF", 4) != 0 ||
+      memcmp(h + 8, "AVI ", 4) != 0 || memcmp(h + 220, "movi", 4) != 0) {
+    return false;
+  }
+  info.frames = get32(h + 48);
+  info.width = get32(h + 64);
+  info.height = get32(h + 68);
+  info.moviSize = get32(h + 216);
+  info.maxFrameSize = get32(h + 60);
+  info.finalized = (get32(h + 44) & AVIF_HASINDEX) != 0;
+  return info.moviSize >= 4;
+}
+
+// Schrijf de header; dit maakt de voorgaande schrijfacties definitief
+static bool writeAviHeader(File& file, const AviInfo& info) {
+  uint8_t h[AVI_HEADER_SIZE];
+  buildAviHeader(h, info, AVI_DEFAULT_FPS);
+  file.seek(0);
+  return file.write(h, sizeof(h)) == sizeof(h);
+}
+
+// Sluit een dag af: idx1 achter de frames zetten. Alleen met aviLock.
+static bool finalizeLocked(const String& dayName) {
+  String path = aviPath(dayName);
+  if (!SD_MMC.exists(path)) return false;
+
+  File file = SD_MMC.open(path, "r+");
+  AviInfo info;
+  if (!file || !readAviInfo(file, info)) {
+    if (file) file.close();
+    return false;
+  }
+  if (info.finalized || info.frames == 0) {
+    file.close();
+    return true;
+  }
+
+  File index = SD_MMC.open(aviIndexPath(dayName), FILE_READ);
+  uint32_t indexSize = info.frames * AVI_INDEX_ENTRY;
+  if (!index || index.size() < indexSize) {
+    if (index) index.close();
+    file.close();
+    Serial.println("AVI-index onvolledig: " + dayName);
+    return false;
+  }
+
+  uint8_t buffer[512];
+  put32(buffer, 0);
+  putFourCC(buffer, "idx1");
+  put32(buffer + 4, indexSize);
+  file.seek(AVI_MOVI_OFFSET + info.moviSize);
+  bool ok = file.write(buffer, 8) == 8;
+  for (uint32_t copied = 0; copied < indexSize && ok; ) {
+    size_t n = index.read(buffer, min((uint32_t)sizeof(buffer), indexSize - copied));
+    ok = n > 0 && file.write(buffer, n) == n;
+    copied += n;
+  }
+  index.close();
+
+  if (ok) {
+    info.finalized = true;
+    ok = writeAviHeader(file, info);
+  }
+  file.close();
+  Serial.printf("Dagvideo %s afgesloten: %u frames\n", dayName.c_str(), info.frames);
+  return ok;
+}
+
+// Sluit na een herstart de laatste eerdere dagen af die nog open staan
+static void finalizeEarlierDays(const char* dayName) {
+  int dayCount = 0;
+  File summaries = openDaySummaries(dayCount);
+  DayIndexSummary summary;
+  for (int i = dayCount - 1; i >= 0 && i >= dayCount - 3 && summaries; i--) {
+    if (readDaySummary(summaries, i, summary) && strcmp(summary.name, dayName) != 0) {
+      finalizeLocked(summary.name);
+    }
+  }
+  if (summaries) summaries.close();
+}
+
+// Plak een opgeslagen foto als frame achter de dagvideo
+bool aviAppendFrame(const char* dayName, const uint8_t* buf, size_t len) {
+#if AVI_RECORDING
+  if (!sdCardAvailable || !buf || len == 0) return false;
+
+  lockAvi();
+
+  // Nieuwe dag: de vorige dagvideo krijgt zijn index
+  if (lastDay[0] == '\0') {
+    finalizeEarlierDays(dayName);
+  } else if (strcmp(lastDay, dayName) != 0) {
+    finalizeLocked(lastDay);
+  }
+  strncpy(lastDay, dayName, sizeof(lastDay) - 1);
+
+  String path = aviPath(dayName);
+  AviInfo info = {};
+  File file;
+  if (SD_MMC.exists(path)) {
+    file = SD_MMC.open(path, "r+");
+    if (file && !readAviInfo(file, info)) {
+      // Onbruikbare header: opnieuw beginnen
+      file.close();
+      file = File();
+    }
+  }
+  if (!file) {
+    uint16_t width = 0, height = 0;
+    jpegDimensions(buf, len, width, height);
+    info = {};
+    info.width = width;
+    info.height = height;
+    info.moviSize = 4;
+    file = SD_MMC.open(path, FILE_WRITE);
+    if (!file || !writeAviHeader(file, info)) {
+      if (file) file.close();
+      unlockAvi();
+      Serial.println("Dagvideo aanmaken mislukt: " + path);
+      return false;
+    }
+  }
+
+  // Frame als '00dc'-chunk, op een even positie
+  uint32_t chunkOffset = AVI_MOVI_OFFSET + info.moviSize;
+  uint8_t chunkHeader[8];
+  putFourCC(chunkHeader, "00dc");
+  put32(chunkHeader + 4, len);
+  uint8_t pad = 0;
+  file.seek(chunkOffset);
+  bool ok = file.write(chunkHeader, 8) == 8 && file.write(buf, len) == len &&
+            ((len & 1) == 0 || file.write(&pad, 1) == 1);
+
+  // Indexregel op de plek van dit frame (een eerder half geschreven regel wordt overschreven)
+  if (ok) {
+    String indexPath = aviIndexPath(dayName);
+    File index = SD_MMC.exists(indexPath) ? SD_MMC.open(indexPath, "r+") : SD_MMC.open(indexPath, FILE_WRITE);
+    uint8_t entry[AVI_INDEX_ENTRY];
+    putFourCC(entry, "00dc");
+    put32(entry + 4, AVIIF_KEYFRAME);
+    put32(entry + 8, chunkOffset - AVI_MOVI_OFFSET);
+    put32(entry + 12, len);
+    ok = index && index.seek(info.frames * AVI_INDEX_ENTRY) && index.write(entry, sizeof(entry)) == sizeof(entry);
+    if (index) index.close();
+  }
+
+  // Header als laatste: nu telt het frame mee
+  if (ok) {
+    info.frames++;
+    info.moviSize += 8 + len + (len & 1);
+    cardUsageAdd(8 + len + (len & 1) + AVI_INDEX_ENTRY, false);
+    info.maxFrameSize = max(info.maxFrameSize, (uint32_t)len);
+    info.finalized = false;
+    ok = writeAviHeader(file, info);
+  }
+  file.close();
+  unlockAvi();
+
+  if (!ok) {
+    Serial.println("Frame toevoegen aan dagvideo mislukt: " + path);
+  }
+  return ok;
+#else
+  return false;
+#endif
+}
+
+// Sluit de dagvideo van een dag af (idx1 schrijven)
+bool aviFinalizeDay(const String& dayName) {
+  lockAvi();
+  bool ok = finalizeLocked(dayName);
+  unlockAvi();
+  return ok;
+}
+
+// Stuur de delen binnen [start, start + length) van de AVI
+static size_t sendSegments(WiFiClient& client, AviSegment* segments, int count, uint32_t start, uint32_t length) {
+  uint32_t position = 0;
+  uint32_t end = start + length;
+  size_t sent = 0;
+
+  for (int i = 0; i < count; i++) {
+    AviSegment& segment = segments[i];
+    uint32_t segmentEnd = position + segment.length;
+    if (segmentEnd > start && position < end) {
+      uint32_t from = max(start, position) - position;
+      uint32_t to = min(end, segmentEnd) - position;
+      size_t written;
+      if (segment.data) {
+        written = client.write(segment.data + from, to - from);
+      } else {
+        written = segment.file->seek(segment.offset + from) ? streamFile(client, *segment.file, to - from) : 0;
+      }
+      sent += written;
+      if (written < to - from) break;
+    }
+    position = segmentEnd;
+  }
+  return sent;
+}
+
+// Stuur de dagvideo als complete AVI. Een nog open dag krijgt zijn idx1 uit
+// het indexbestand; de header wordt met de gevraagde afspeelsnelheid opgebouwd.
+void sendDayVideo(WiFiClient& client, HttpRequest& request, const String& dayName, uint32_t fps) {
+  fps = constrain(fps, (uint32_t)1, (uint32_t)AVI_MAX_FPS);
+
+  // Momentopname van de toestand; latere frames komen achter deze grens
+  lockAvi();
+  File file;
+  File index;
+  AviInfo info = {};
+  bool ok = sdCardAvailable && SD_MMC.exists(aviPath(dayName));
+  if (ok) {
+    file = SD_MMC.open(aviPath(dayName), FILE_READ);
+    ok = file && readAviInfo(file, info) && info.frames > 0;
+  }
+  uint32_t indexOffset = 0;
+  if (ok) {
+    if (info.finalized) {
+      index = SD_MMC.open(aviPath(dayName), FILE_READ);
+      indexOffset = AVI_MOVI_OFFSET + info.moviSize + 8;
+    } else {
+      index = SD_MMC.open(aviIndexPath(dayName), FILE_READ);
+    }
+    ok = index;
+  }
+  unlockAvi();
+
+  if (!ok) {
+    if (file) file.close();
+    if (index) index.close();
+    sendHttpError(client, request, 404);
+    return;
+  }
+
+  AviInfo served = info;
+  served.finalized = true;
+  uint8_t header[AVI_HEADER_SIZE];
+  buildAviHeader(header, served, fps);
+  uint8_t indexHeader[8];
+  putFourCC(indexHeader, "idx1");
+  put32(indexHeader + 4, info.frames * AVI_INDEX_ENTRY);
+
+  AviSegment segments[] = {
+    { header, NULL, 0, AVI_HEADER_SIZE },
+    { NULL, &file, AVI_HEADER_SIZE, info.moviSize - 4 },
+    { indexHeader, NULL, 0, sizeof(indexHeader) },
+    { NULL, &index, indexOffset, info.frames * AVI_INDEX_ENTRY },
+  };
+  uint32_t totalSize = AVI_HEADER_SIZE + info.moviSize - 4 + sizeof(indexHeader) + info.frames * AVI_INDEX_ENTRY;
+
+  char etagBuf[40];
+  snprintf(etagBuf, sizeof(etagBuf), "\"avi-%x-%x-%x\"", info.frames, info.moviSize, fps);
+  String etag = etagBuf;
+
+  size_t start = 0;
+  size_t length = totalSize;
+  RangeResult range = parseRangeHeader(request, totalSize, etag, "", start, length);
+  if (range == RANGE_UNSATISFIABLE) {
+    file.close();
+    index.close();
+    sendHttpResponse(client, request, 416, "", 0, "Content-Range: bytes */" + String(totalSize) + "\r\n");
+    return;
+  }
+
+  String headers = "Accept-Ranges: bytes\r\nETag: " + etag + "\r\nCache-Control: no-cache\r\n"
+                   "Content-Disposition: attachment; filename=\"" + dayName + ".avi\"\r\n";
+  if (range == RANGE_OK) {
+    headers += "Content-Range: bytes " + String((unsigned long)start) + "-" +
+               String((unsigned long)(start + length - 1)) + "/" + String(totalSize) + "\r\n";
+  }
+  sendHttpResponse(client, request, range == RANGE_OK ? 206 : 200, "video/x-msvideo", length, headers);
+
+  if (sendSegments(client, segments, sizeof(segments) / sizeof(segments[0]), start, length) < length) {
+    request.keepAlive = false;
+  }
+  file.close();
+  index.close();
+}
\ No newline at end of file
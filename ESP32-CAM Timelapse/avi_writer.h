@@ -0,0 +1,21 @@
+#ifndef AVI_WRITER_H
+#define AVI_WRITER_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "http_parser.h"
+
+// Per dag een MJPEG-video naast de foto's: /timelapse/<dag>/timelapse.avi,
+// met de indexregels (idx1) in een apart bestand tot de dag wordt afgesloten
+#define AVI_RECORDING   1                  // 0: geen video bijhouden
+#define AVI_FILE        "timelapse.avi"
+#define AVI_INDEX_FILE  "timelapse.avx"
+#define AVI_DEFAULT_FPS 10                 // Afspeelsnelheid in beelden per seconde
+#define AVI_MAX_FPS     60
+
+// Functies voor de dagvideo
+bool aviAppendFrame(const char* dayName, const uint8_t* buf, size_t len);
+bool aviFinalizeDay(const String& dayName);
+void sendDayVideo(WiFiClient& client, HttpRequest& request, const String& dayName, uint32_t fps);
+
+#endif // AVI_WRITER_H
\ No newline at end of file
@@ -1,4 +1,20 @@
 #include "camera.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "photo_journal.h"
+#include "thumbnails.h"
+#include "avi_writer.h"
+#include "luminance.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Alle opnames lopen via cameraGetFrame(). De timelapse en momentopnamen
+// gebruiken de volledige instellingen; de livestream kan om een kleinere
+// framegrootte of lagere kwaliteit vragen. Het slot zorgt dat wisselen en
+// het ophalen van het frame niet door elkaar lopen.
+static SemaphoreHandle_t cameraLock = NULL;
+static framesize_t captureFrameSize = FRAMESIZE_UXGA;
+static CameraProfile currentProfile = { FRAMESIZE_UXGA, 10 };
 
 // Initialiseer de camera met de juiste instellingen
 bool initCamera() {
@@ -42,16 +58,122 @@ bool initCamera() {
     return false;
   }
   
+  captureFrameSize = config.frame_size;
+  currentProfile.frameSize = config.frame_size;
+  currentProfile.quality = config.jpeg_quality;
+  cameraLock = xSemaphoreCreateMutex();
+  
   // Camera instellingen aanpassen voor betere kwaliteit
   updateCameraSettings();
   
   return true;
 }
 
-// Update camera instellingen met actuele waardes
+// Instellingen voor timelapse-opnames
+CameraProfile cameraCaptureProfile() {
+  CameraProfile profile = { captureFrameSize, jpegQuality };
+  return profile;
+}
+
+// Haal een frame met de gevraagde instellingen (NULL: die van de timelapse).
+// Na een wissel worden eerst CAMERA_SWITCH_DISCARD oude frames weggegooid.
+camera_fb_t * cameraGetFrame(const CameraProfile * profile) {
+  CameraProfile wanted = profile ? *profile : cameraCaptureProfile();
+  if (cameraLock) xSemaphoreTake(cameraLock, portMAX_DELAY);
+  
+  if (wanted.frameSize != currentProfile.frameSize || wanted.quality != currentProfile.quality) {
+    sensor_t * s = esp_camera_sensor_get();
+    if (wanted.frameSize != currentProfile.frameSize) s->set_framesize(s, wanted.frameSize);
+    if (wanted.quality != currentProfile.quality) s->set_quality(s, wanted.quality);
+    currentProfile = wanted;
+    for (int i = 0; i < CAMERA_SWITCH_DISCARD; i++) {
+      camera_fb_t * stale = esp_camera_fb_get();
+      if (stale) esp_camera_fb_return(stale);
+    }
+  }
+  camera_fb_t * fb = esp_camera_fb_get();
+  
+  if (cameraLock) xSemaphoreGive(cameraLock);
+  return fb;
+}
+
+// Wissel onder het cameraslot naar een profiel en gooi 'discard' oude frames weg
+static void switchProfile(const CameraProfile& wanted, int discard) {
+  sensor_t * s = esp_camera_sensor_get();
+  if (wanted.frameSize != currentProfile.frameSize) s->set_framesize(s, wanted.frameSize);
+  if (wanted.quality != currentProfile.quality) s->set_quality(s, wanted.quality);
+  currentProfile = wanted;
+  for (int i = 0; i < discard; i++) {
+    camera_fb_t * stale = esp_camera_fb_get();
+    if (stale) esp_camera_fb_return(stale);
+  }
+}
+
+// Haal een frame voor de timelapse nadat de belichting is ingeregeld. Oude
+// framebuffers worden weggegooid; daarna worden kleine frames opgehaald tot
+// de luminantie CAMERA_SETTLE_STABLE keer binnen de tolerantie blijft of de
+// time-out verloopt. Pas dan wordt naar het opnameprofiel gewisseld en het
+// eerste verse frame teruggegeven.
+camera_fb_t * cameraGetSettledFrame(CameraSettleInfo * info) {
+  CameraSettleInfo result = { 0, 0, 0, 0, false };
+  unsigned long start = millis();
+  
+#if CAMERA_SETTLE
+  CameraProfile settleProfile = { CAMERA_SETTLE_FRAMESIZE, CAMERA_SETTLE_QUALITY };
+  if (cameraLock) xSemaphoreTake(cameraLock, portMAX_DELAY);
+  
+  switchProfile(settleProfile, CAMERA_STALE_FRAMES);
+  
+  camera_fb_t * fb = NULL;
+  int previous = -1;
+  int stable = 0;
+  for (;;) {
+    if (fb) esp_camera_fb_return(fb);
+    fb = esp_camera_fb_get();
+    if (!fb) break;
+    result.frames++;
+    
+    LuminanceStats stats;
+    if (!jpegLuminance(fb->buf, fb->len, stats)) break;
+    int luma = stats.mean;
+    result.luma = stats.mean;
+    if (previous >= 0 && abs(luma - previous) <= CAMERA_SETTLE_TOLERANCE) {
+      if (++stable >= CAMERA_SETTLE_STABLE) {
+        result.converged = true;
+        break;
+      }
+    } else {
+      stable = 0;
+    }
+    previous = luma;
+    if (millis() - start >= CAMERA_SETTLE_TIMEOUT_MS) break;
+  }
+  if (fb) esp_camera_fb_return(fb);
+  
+  // Laatste frame met de volledige instellingen; de buffers bevatten nog
+  // kleine frames, die gaan weg
+  unsigned long finalStart = millis();
+  switchProfile(cameraCaptureProfile(), CAMERA_STALE_FRAMES);
+  fb = esp_camera_fb_get();
+  result.finalMs = millis() - finalStart;
+  
+  if (cameraLock) xSemaphoreGive(cameraLock);
+#else
+  camera_fb_t * fb = cameraGetFrame();
+#endif
+  
+  result.settleMs = millis() - start;
+  if (info) *info = result;
+  return fb;
+}
+
+// Update camera instellingen met actuele waardes. Wordt ook vanuit de
+// webserver aangeroepen; het slot voorkomt dat dit door een opname heen loopt.
 void updateCameraSettings() {
+  if (cameraLock) xSemaphoreTake(cameraLock, portMAX_DELAY);
   sensor_t * s = esp_camera_sensor_get();
   s->set_quality(s, jpegQuality);
+  currentProfile.quality = jpegQuality;
   s->set_brightness(s, 0);
   s->set_contrast(s, 0);
   s->set_saturation(s, 0);
@@ -69,6 +191,7 @@ void updateCameraSettings() {
   s->set_raw_gma(s, 1);
   s->set_lenc(s, 1);
   s->set_dcw(s, 1);
+  if (cameraLock) xSemaphoreGive(cameraLock);
 }
 
 // Maak een foto en sla deze op de SD-kaart op
@@ -77,12 +200,10 @@ bool takeSavePhoto() {
   
   // Huidige tijd ophalen voor de bestandsnaam
   time_t now;
-  struct tm timeinfo;
   time(&now);
-  localtime_r(&now, &timeinfo);
   
-  // Foto maken
-  camera_fb_t * fb = esp_camera_fb_get();
+  // Foto maken nadat de belichting is ingeregeld
+  camera_fb_t * fb = cameraGetSettledFrame(NULL);
   if (!fb) {
     Serial.println("Foto maken mislukt");
     return false;
@@ -93,35 +214,69 @@ bool takeSavePhoto() {
   // delay(100);
   // digitalWrite(FLASH_LED_PIN, LOW);
   
-  // Bestandsnaam maken met timestamp: HH-MM-SS.jpg
-  sprintf(filePath, "%s/%02d-%02d-%04d_%02d-%02d-%02d.jpg", 
-          folderPath, 
-          timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900,
-          timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  bool saved = savePhotoFrame(fb, now);
+  esp_camera_fb_return(fb);
+  
+  return saved;
+}
+
+// Sla een eerder gemaakte foto op in de huidige dagmap.
+// De framebuffer blijft van de aanroeper en wordt hier niet vrijgegeven.
+bool savePhotoFrame(camera_fb_t * fb, time_t timestamp, char * savedPath, size_t pathSize) {
+  if (!fb) return false;
+  return savePhotoBuffer(fb->buf, fb->len, timestamp, savedPath, pathSize);
+}
+
+// Sla JPEG-data op in de dagmap van de opnametijd, met die tijd als
+// bestandsnaam. Dag en naam komen alleen uit timestamp (geen gedeelde
+// buffers), zodat opslaan in de SD-schrijver en de webserver elkaar niet
+// raakt. Een tweede foto in dezelfde seconde (handmatig tijdens een geplande
+// opname) krijgt een eigen naam met _1, _2, ...; de eerste blijft staan.
+// Met savedPath wordt het pad van de opgeslagen foto teruggegeven.
+bool savePhotoBuffer(const uint8_t * buf, size_t len, time_t timestamp, char * savedPath, size_t pathSize) {
+  if (!sdCardAvailable || !buf) return false;
   
-  Serial.printf("Foto opslaan als: %s\n", filePath);
+  struct tm timeinfo;
+  localtime_r(&timestamp, &timeinfo);
   
-  // Bestand openen en schrijven
-  File file = SD_MMC.open(filePath, FILE_WRITE);
-  if (!file) {
-    Serial.println("Bestand openen mislukt");
-    esp_camera_fb_return(fb);
-    return false;
+  // Dagmap DD-MM-YYYY en bestandsnaam DD-MM-YYYY_HH-MM-SS.jpg
+  char dayName[DAY_NAME_SIZE];
+  char fileName[32];
+  snprintf(dayName, sizeof(dayName), "%02d-%02d-%04d",
+           timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+  int duplicate = 0;
+  for (;;) {
+    photoFileName(timestamp, duplicate, fileName, sizeof(fileName));
+    bool taken = indexPhotoNameTaken(dayName, fileName) ||
+                 (!segmentStorage && SD_MMC.exists("/timelapse/" + String(dayName) + "/" + fileName));
+    if (!taken) break;
+    if (++duplicate > PHOTO_MAX_DUPLICATES) {
+      Serial.println("Te veel foto's in dezelfde seconde");
+      return false;
+    }
   }
   
-  // Foto naar bestand schrijven
-  if (file.write(fb->buf, fb->len)) {
-    Serial.printf("Bestand opgeslagen: %s (%u bytes)\n", filePath, fb->len);
-  } else {
-    Serial.println("Schrijven naar bestand mislukt");
-    file.close();
-    esp_camera_fb_return(fb);
+  Serial.printf("Foto opslaan als: /timelapse/%s/%s\n", dayName, fileName);
+  
+  // Als los bestand of in het segment van de dag
+  uint32_t offset = 0;
+  // Segmentfoto's hebben hun eigen trailerrecord; het journaal is alleen
+  // voor losse bestanden
+  if (!segmentStorage) journalPhoto(dayName, fileName, timestamp, len);
+  if (!storePhotoData(dayName, fileName, timestamp, buf, len, offset)) {
     return false;
   }
+  Serial.printf("Bestand opgeslagen: /timelapse/%s/%s (%u bytes)\n", dayName, fileName, (unsigned)len);
+  if (savedPath) snprintf(savedPath, pathSize, "/timelapse/%s/%s", dayName, fileName);
   
-  // Bestand sluiten en buffer vrijgeven
-  file.close();
-  esp_camera_fb_return(fb);
+  // Foto met zijn helderheidshistogram toevoegen aan de index van de dag en
+  // de miniatuur op de achtergrond laten maken; de foto komt ook als frame in
+  // de dagvideo
+  LuminanceStats luminance;
+  jpegLuminance(buf, len, luminance);
+  indexAddPhoto(dayName, fileName, timestamp, len, offset, &luminance);
+  queueThumbnail(dayName, fileName);
+  aviAppendFrame(dayName, buf, len);
   
   return true;
 }
\ No newline at end of file
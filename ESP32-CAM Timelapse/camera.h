@@ -3,9 +3,48 @@
 
 #include "config.h"
 
+// Frames weggooien na het wisselen van framegrootte of kwaliteit; die zijn
+// mogelijk nog met de oude instellingen gemaakt
+#define CAMERA_SWITCH_DISCARD 1
+
+// Belichting laten inregelen voor een timelapse-opname. Na een pauze zijn
+// de frames in de buffers oud en zijn AEC/AWB nog niet stabiel; de gemiddelde
+// helderheid van opeenvolgende frames (jpegLuminance) wordt vergeleken tot
+// die niet meer verandert, of tot de time-out verloopt. Dat gebeurt op kleine
+// frames (zoals het proefbeeld van de veranderingsdetectie): AEC/AWB regelen
+// op de sensor en blijven staan bij het wisselen, en een UXGA-frame ontleden
+// kost te veel tijd onder het cameraslot. Alleen het laatste frame is groot.
+#define CAMERA_SETTLE            1     // 0: eerste frame direct gebruiken
+#define CAMERA_SETTLE_FRAMESIZE  FRAMESIZE_QQVGA  // 160x120
+#define CAMERA_SETTLE_QUALITY    20
+#define CAMERA_STALE_FRAMES      2     // Oude framebuffers weggooien (fb_count)
+#define CAMERA_SETTLE_TOLERANCE  3     // Max. verschil in gemiddelde luminantie (0-255)
+#define CAMERA_SETTLE_STABLE     2     // Zoveel frames achter elkaar binnen de tolerantie
+#define CAMERA_SETTLE_TIMEOUT_MS 2000  // Daarna het laatste frame gebruiken
+
+// Framegrootte en JPEG-kwaliteit voor een opname
+struct CameraProfile {
+  framesize_t frameSize;
+  int quality;
+};
+
+// Resultaat van het inregelen voor een opname
+struct CameraSettleInfo {
+  uint32_t settleMs;         // Tijd vanaf het eerste weggegooide frame
+  uint32_t finalMs;          // Waarvan wisselen naar het opnameprofiel en het laatste frame
+  uint16_t frames;           // Bekeken frames (zonder de oude buffers)
+  uint8_t luma;              // Gemiddelde luminantie van het gebruikte frame
+  bool converged;            // false: time-out of luminantie niet te bepalen
+};
+
 // Functies voor camerabeheer
 bool initCamera();
+camera_fb_t * cameraGetFrame(const CameraProfile * profile = NULL);
+CameraProfile cameraCaptureProfile();
+camera_fb_t * cameraGetSettledFrame(CameraSettleInfo * info);
 bool takeSavePhoto();
+bool savePhotoFrame(camera_fb_t * fb, time_t timestamp, char * savedPath = NULL, size_t pathSize = 0);
+bool savePhotoBuffer(const uint8_t * buf, size_t len, time_t timestamp, char * savedPath = NULL, size_t pathSize = 0);
 void updateCameraSettings();
 
 #endif // CAMERA_H
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "capture_task.h"
+#include "camera.h"
+#include "sd_card.h"
+#include "sd_writer.h"
+#include "time_manager.h"
+#include "settings_manager.h"
+#include "luminance.h"
+
+// De capture-taak bezit de camera en bewaakt het opnameschema, los van de
+// webserver in loop(). Gemaakte frames gaan naar de SD-schrijver, zodat een
+// trage download of SD-kaart het schema niet laat verlopen.
+// In de modus "bij verandering" vervangt een proefschema het vaste raster.
+
+#define CAPTURE_TASK_STACK    4096
+#define CAPTURE_TASK_PRIORITY 2
+#define CAPTURE_TASK_CORE     0
+#define SCHEDULED_SUBMIT_WAIT 0      // ms wachten op een vrij poolslot (gepland)
+#define MANUAL_SUBMIT_WAIT    5000   // ms wachten op een vrij poolslot (handmatig)
+
+static TaskHandle_t captureTaskHandle = NULL;
+
+// Handmatige opname: verzoek en resultaat
+static SemaphoreHandle_t manualLock = NULL;
+static SemaphoreHandle_t manualDone = NULL;
+static volatile bool manualRequested = false;
+static volatile bool manualResult = false;
+static char manualPath[64];              // Pad van de handmatige foto, gezet door de SD-schrijver
+
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static CaptureStats stats = {};
+
+// Referentie voor het opnemen bij verandering: raster van het proefbeeld
+// dat bij de laatst opgeslagen foto is gemaakt, en het moment daarvan.
+// Proefbeelden worden alleen met proefbeelden vergeleken; rasters van
+// verschillende framegroottes verschillen door de blokindeling al enkele
+// niveaus.
+static uint8_t referenceGrid[LUMA_GRID_CELLS];
+static bool hasReference = false;
+static unsigned long lastSavedMs = 0;
+
+// Interval uit de instellingen in milliseconden
+static unsigned long photoIntervalMs() {
+  return (unsigned long)photoInterval * 60UL * 1000UL;
+}
+
+// Registreer de afwijking tussen geplande en werkelijke opnametijd
+static void recordJitter(long jitterMs) {
+  portENTER_CRITICAL(&statsMux);
+  stats.captured++;
+  stats.lastJitterMs = jitterMs;
+  long absJitter = jitterMs < 0 ? -jitterMs : jitterMs;
+  if (absJitter > stats.maxJitterMs) stats.maxJitterMs = absJitter;
+  stats.totalJitterMs += absJitter;
+  portEXIT_CRITICAL(&statsMux);
+}
+
+// Registreer het inregelen en, voor geplande opnames, de belichting per dag
+static void recordSettle(const CameraSettleInfo& info, time_t timestamp, bool manual) {
+  struct tm timeinfo;
+  localtime_r(&timestamp, &timeinfo);
+  char day[DAY_NAME_SIZE];
+  snprintf(day, sizeof(day), "%02d-%02d-%04d",
+           timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+
+  portENTER_CRITICAL(&statsMux);
+  stats.settled++;
+  if (!info.converged) stats.settleTimeouts++;
+  stats.lastSettleMs = info.settleMs;
+  if (info.settleMs > stats.maxSettleMs) stats.maxSettleMs = info.settleMs;
+  stats.totalSettleMs += info.settleMs;
+  stats.lastFinalMs = info.finalMs;
+  if (info.finalMs > stats.maxFinalMs) stats.maxFinalMs = info.finalMs;
+  stats.lastLuma = info.luma;
+
+  if (!manual && info.frames > 0) {
+    // Nieuwe dag: resultaat van de vorige dag bewaren
+    if (strcmp(stats.exposureDay, day) != 0) {
+      if (stats.exposureSamples > 0) {
+        strcpy(stats.previousExposureDay, stats.exposureDay);
+        stats.previousExposureSamples = stats.exposureSamples;
+        stats.previousExposureStdDev = stats.exposureSamples > 1 ?
+          sqrtf(stats.exposureM2 / (stats.exposureSamples - 1)) : 0;
+      }
+      strcpy(stats.exposureDay, day);
+      stats.exposureSamples = 0;
+      stats.exposureMean = 0;
+      stats.exposureM2 = 0;
+    }
+    stats.exposureSamples++;
+    float delta = info.luma - stats.exposureMean;
+    stats.exposureMean += delta / stats.exposureSamples;
+    stats.exposureM2 += delta * (info.luma - stats.exposureMean);
+  }
+  portEXIT_CRITICAL(&statsMux);
+}
+
+// Maak een frame en geef het door aan de SD-schrijver
+static bool captureAndSubmit(unsigned long plannedMs, bool manual, uint32_t * frameBytes = NULL) {
+  CameraSettleInfo settle;
+  camera_fb_t * fb = cameraGetSettledFrame(&settle);
+  unsigned long actualMs = millis();
+  time_t timestamp;
+  time(&timestamp);
+
+  if (!fb) {
+    Serial.println("Foto maken mislukt");
+    portENTER_CRITICAL(&statsMux);
+    stats.failed++;
+    portEXIT_CRITICAL(&statsMux);
+    return false;
+  }
+
+  recordSettle(settle, timestamp, manual);
+  Serial.printf("Belichting: %u ms ingeregeld (laatste frame %u ms), %u frames, luminantie %u%s\n",
+                settle.settleMs, settle.finalMs, settle.frames, settle.luma,
+                settle.converged ? "" : " (time-out)");
+
+  if (!manual) {
+    // De jitter meet het moment van het gebruikte frame, dus inclusief inregelen
+    long jitterMs = (long)(actualMs - plannedMs);
+    recordJitter(jitterMs);
+    Serial.printf("Opname-jitter: %ld ms\n", jitterMs);
+  }
+
+  // De schrijver kopieert het frame, dus de buffer gaat direct terug
+  bool submitted = submitPhoto(fb, timestamp,
+                               manual ? MANUAL_SUBMIT_WAIT : SCHEDULED_SUBMIT_WAIT,
+                               manual ? manualDone : NULL,
+                               manual ? &manualResult : NULL,
+                               manual ? manualPath : NULL, sizeof(manualPath));
+  if (frameBytes) *frameBytes = fb->len;
+  esp_camera_fb_return(fb);
+  return submitted;
+}
+
+// Maak een proefbeeld en bepaal het luminantieraster ervan
+static bool probeGrid(uint8_t * grid) {
+  CameraProfile probe = { CHANGE_PROBE_FRAMESIZE, CHANGE_PROBE_QUALITY };
+  unsigned long start = millis();
+  camera_fb_t * fb = cameraGetFrame(&probe);
+  bool ok = fb && jpegLuminanceGrid(fb->buf, fb->len, grid);
+  if (fb) esp_camera_fb_return(fb);
+  uint32_t probeMs = millis() - start;
+
+  portENTER_CRITICAL(&statsMux);
+  stats.probes++;
+  if (!ok) stats.probeFailures++;
+  stats.lastProbeMs = probeMs;
+  if (probeMs > stats.maxProbeMs) stats.maxProbeMs = probeMs;
+  stats.totalProbeMs += probeMs;
+  portEXIT_CRITICAL(&statsMux);
+  return ok;
+}
+
+// Eén stap van het opnemen bij verandering: op het proefmoment een foto als
+// er genoeg is veranderd of het maximale interval is verstreken
+static void changeModeStep(unsigned long& nextProbe) {
+  unsigned long now = millis();
+  long untilProbe = (long)(nextProbe - now);
+  if (untilProbe > 0) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(untilProbe, 1000L)));
+    return;
+  }
+  // Geen inhaalslag na een achterstand
+  nextProbe = now + CHANGE_PROBE_INTERVAL_MS;
+
+  if (!timeInitialized || !sdCardAvailable || !isDay()) {
+    return;
+  }
+
+  portENTER_CRITICAL(&statsMux);
+  stats.fixedEquivalent += (float)CHANGE_PROBE_INTERVAL_MS / photoIntervalMs();
+  portEXIT_CRITICAL(&statsMux);
+
+  // Binnen het minimale interval hoeft er niet eens gekeken te worden
+  unsigned long sinceSaved = now - lastSavedMs;
+  if (sinceSaved < CHANGE_MIN_INTERVAL_MS) return;
+  bool idle = !hasReference || sinceSaved >= photoIntervalMs() * CHANGE_MAX_INTERVAL_FACTOR;
+
+  // Ook bij een foto na het maximale interval een proefbeeld: dat wordt de
+  // nieuwe referentie
+  uint8_t grid[LUMA_GRID_CELLS];
+  bool probed = probeGrid(grid);
+  if (!idle) {
+    if (!probed) return;
+    uint8_t difference = luminanceGridDifference(grid, referenceGrid);
+    portENTER_CRITICAL(&statsMux);
+    stats.lastDifference = difference;
+    portEXIT_CRITICAL(&statsMux);
+    if (difference < CHANGE_THRESHOLD) return;
+    Serial.printf("Verandering gedetecteerd: verschil %u\n", difference);
+  }
+
+  uint32_t frameBytes = 0;
+  if (captureAndSubmit(now, false, &frameBytes)) {
+    // Zonder proefbeeld volgende keer opnieuw een referentie maken
+    hasReference = probed;
+    memcpy(referenceGrid, grid, sizeof(referenceGrid));
+    lastSavedMs = now;
+    portENTER_CRITICAL(&statsMux);
+    if (idle) {
+      stats.idleCaptures++;
+    } else {
+      stats.changeCaptures++;
+    }
+    stats.changeBytes += frameBytes;
+    portEXIT_CRITICAL(&statsMux);
+  }
+}
+
+// Capture-taak: plant opnames op een vast raster van photoInterval, of
+// maakt ze bij verandering
+static void captureTask(void*) {
+  unsigned long interval = photoIntervalMs();
+  unsigned long lastPlanned = millis();
+  unsigned long nextPlanned = lastPlanned + interval;
+  int mode = captureMode;
+  unsigned long nextProbe = millis();
+  lastSavedMs = millis() - CHANGE_MIN_INTERVAL_MS;  // Eerste foto direct
+
+  for (;;) {
+    // Handmatige opname heeft voorrang
+    if (manualRequested) {
+      manualRequested = false;
+      if (!captureAndSubmit(millis(), true)) {
+        manualResult = false;
+        xSemaphoreGive(manualDone);
+      }
+      continue;
+    }
+
+    // Modus gewijzigd via de instellingen: het nieuwe schema begint nu
+    if (captureMode != mode) {
+      mode = captureMode;
+      lastPlanned = millis();
+      nextPlanned = lastPlanned + interval;
+      nextProbe = millis();
+      lastSavedMs = millis() - CHANGE_MIN_INTERVAL_MS;
+      hasReference = false;
+    }
+    if (mode == CAPTURE_MODE_CHANGE) {
+      changeModeStep(nextProbe);
+      continue;
+    }
+
+    // Interval gewijzigd via de instellingen: schema opnieuw baseren
+    if (photoIntervalMs() != interval) {
+      interval = photoIntervalMs();
+      nextPlanned = lastPlanned + interval;
+      // Nieuw raster ligt al in het verleden: het begint nu
+      if ((long)(millis() - nextPlanned) > 0) {
+        nextPlanned = millis();
+      }
+    }
+
+    unsigned long now = millis();
+    long untilNext = (long)(nextPlanned - now);
+    if (untilNext > 0) {
+      // Slapen tot de volgende opname, maar maximaal 1 seconde zodat
+      // gewijzigde instellingen snel worden opgepikt
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(untilNext, 1000L)));
+      continue;
+    }
+
+    unsigned long planned = nextPlanned;
+    lastPlanned = planned;
+    nextPlanned += interval;
+
+    // Meer dan een interval achter (bijv. camera hing): momenten overslaan
+    if ((long)(now - nextPlanned) >= 0) {
+      uint32_t missed = (now - planned) / interval;
+      portENTER_CRITICAL(&statsMux);
+      stats.skipped += missed;
+      portEXIT_CRITICAL(&statsMux);
+      planned += missed * interval;
+      lastPlanned = planned;
+      nextPlanned = planned + interval;
+    }
+
+    if (timeInitialized && sdCardAvailable && isDay()) {
+      captureAndSubmit(planned, false);
+    }
+  }
+}
+
+// Start de capture-taak
+bool startCaptureTask() {
+  manualLock = xSemaphoreCreateMutex();
+  manualDone = xSemaphoreCreateBinary();
+  if (!manualLock || !manualDone) {
+    Serial.println("Capture-taak: geheugen voor semaforen ontbreekt");
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, NULL,
+                              CAPTURE_TASK_PRIORITY, &captureTaskHandle, CAPTURE_TASK_CORE) != pdPASS) {
+    Serial.println("Capture-taak starten mislukt");
+    return false;
+  }
+
+  Serial.println("Capture-taak gestart");
+  return true;
+}
+
+// Laat de capture-taak direct een foto maken en wacht tot die is opgeslagen;
+// savedPath krijgt het pad van die foto
+bool captureManualPhoto(String* savedPath, unsigned long timeoutMs) {
+  if (!captureTaskHandle) return false;
+
+  if (xSemaphoreTake(manualLock, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+    return false;
+  }
+
+  // Eventueel achtergebleven signaal van een verlopen verzoek wissen
+  xSemaphoreTake(manualDone, 0);
+  manualPath[0] = '\0';
+  manualRequested = true;
+  xTaskNotifyGive(captureTaskHandle);
+
+  bool result = false;
+  if (xSemaphoreTake(manualDone, pdMS_TO_TICKS(timeoutMs)) == pdTRUE) {
+    result = manualResult;
+    if (result && savedPath) *savedPath = manualPath;
+  }
+
+  xSemaphoreGive(manualLock);
+  return result;
+}
+
+// Standaardafwijking van de luminantie over de geplande opnames van vandaag
+float captureExposureStdDev(const CaptureStats& stats) {
+  if (stats.exposureSamples < 2) return 0;
+  return sqrtf(stats.exposureM2 / (stats.exposureSamples - 1));
+}
+
+// Geschat aantal foto's dat het opnemen bij verandering heeft bespaard ten
+// opzichte van een vast interval (negatief: er zijn meer foto's gemaakt)
+int32_t captureFramesSaved(const CaptureStats& stats) {
+  return (int32_t)(stats.fixedEquivalent + 0.5f) - (int32_t)(stats.changeCaptures + stats.idleCaptures);
+}
+
+// Kopie van de statistieken voor weergave
+CaptureStats getCaptureStats() {
+  portENTER_CRITICAL(&statsMux);
+  CaptureStats copy = stats;
+  portEXIT_CRITICAL(&statsMux);
+  return copy;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef CAPTURE_TASK_H
+#define CAPTURE_TASK_H
+
+#include "config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+// Opnemen bij verandering (captureMode == CAPTURE_MODE_CHANGE): de camera
+// maakt regelmatig een klein proefbeeld en vergelijkt het luminantieraster
+// daarvan met dat van de laatst opgeslagen foto
+#define CHANGE_PROBE_INTERVAL_MS   30000            // Tijd tussen proefbeelden
+#define CHANGE_PROBE_FRAMESIZE     FRAMESIZE_QQVGA  // 160x120
+#define CHANGE_PROBE_QUALITY       20
+#define CHANGE_THRESHOLD           4                // Verschil (luminantieniveaus) voor een nieuwe foto
+#define CHANGE_MIN_INTERVAL_MS     60000            // Nooit vaker dan dit een foto
+#define CHANGE_MAX_INTERVAL_FACTOR 4                // Na photoInterval x dit toch een foto
+
+// Statistieken van de opnameplanning
+struct CaptureStats {
+  uint32_t captured;         // Geplande opnames die gemaakt zijn
+  uint32_t failed;           // Camera gaf geen frame
+  uint32_t skipped;          // Geplande momenten overgeslagen door achterstand
+  long lastJitterMs;        // Werkelijk - gepland voor de laatste opname
+  long maxJitterMs;
+  uint64_t totalJitterMs;    // Voor het gemiddelde
+  uint32_t settled;          // Opnames met inregelen van de belichting
+  uint32_t settleTimeouts;   // Niet stabiel binnen CAMERA_SETTLE_TIMEOUT_MS
+  uint32_t lastSettleMs;
+  uint32_t maxSettleMs;
+  uint64_t totalSettleMs;    // Voor het gemiddelde
+  uint32_t lastFinalMs;      // Deel daarvan: wisselen naar het opnameprofiel en het laatste frame
+  uint32_t maxFinalMs;
+  uint8_t lastLuma;          // Gemiddelde luminantie van de laatste opname
+  // Spreiding van de belichting over de geplande opnames van een dag
+  char exposureDay[DAY_NAME_SIZE]; // DD-MM-YYYY
+  uint32_t exposureSamples;
+  float exposureMean;
+  float exposureM2;          // Som van kwadratische afwijkingen (Welford)
+  char previousExposureDay[DAY_NAME_SIZE];
+  uint32_t previousExposureSamples;
+  float previousExposureStdDev;
+  // Opnemen bij verandering
+  uint32_t probes;           // Gemaakte proefbeelden
+  uint32_t probeFailures;
+  uint32_t lastProbeMs;      // Proefbeeld plus raster, inclusief wisselen van framegrootte
+  uint32_t maxProbeMs;
+  uint64_t totalProbeMs;
+  uint8_t lastDifference;
+  uint32_t changeCaptures;   // Foto's door verandering
+  uint32_t idleCaptures;     // Foto's omdat het maximale interval verstreek
+  uint64_t changeBytes;      // Grootte van die foto's samen
+  float fixedEquivalent;     // Foto's die een vast interval in dezelfde tijd had gemaakt
+};
+
+// Functies voor de capture-taak
+bool startCaptureTask();
+bool captureManualPhoto(String* savedPath = NULL, unsigned long timeoutMs = 10000);
+CaptureStats getCaptureStats();
+float captureExposureStdDev(const CaptureStats& stats);
+int32_t captureFramesSaved(const CaptureStats& stats);
+
+#endif // CAPTURE_TASK_H
\ No newline at end of file
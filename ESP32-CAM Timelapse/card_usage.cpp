@@ -0,0 +1,181 @@
+#include "card_usage.h"
+#include "freertos/FreeRTOS.h"
+
+// Bijhouden van het kaartgebruik zonder de kaart te doorlopen. De eerste
+// opvraag van de vrije ruimte laat FatFs de FAT doorlopen als de FSInfo-sector
+// niet klopt (seconden op een grote kaart); cardUsageSeed() doet die één keer
+// aan het begin van de retentietaak, los van de klok en het beleid, zodat
+// setup() er niet op wacht. Daarna telt elk nieuw of verwijderd
+// bestand mee, afgerond op de standaard clustergrootte voor de kaartgrootte.
+// Metadata (mappen, indexbestanden) telt niet mee; dat verschil verdwijnt bij
+// de correctie van de retentietaak.
+
+static portMUX_TYPE usageMux = portMUX_INITIALIZER_UNLOCKED;
+static CardStatus status = {};
+
+// Laatste foto-schrijfacties; doorvoer in KB/s, 0 = mislukt
+static uint32_t latencySamples[CARD_LATENCY_SAMPLES];
+static uint32_t rateSamples[CARD_LATENCY_SAMPLES];
+static uint32_t sampleCount = 0;
+
+// Ruimte die een bestand van 'bytes' op de kaart inneemt
+static uint64_t clusterRound(uint64_t bytes) {
+  uint32_t cluster = status.clusterBytes > 0 ? status.clusterBytes : CARD_SMALL_CLUSTER;
+  return (bytes + cluster - 1) / cluster * cluster;
+}
+
+// Insertion sort: hooguit CARD_LATENCY_SAMPLES waarden
+static void sortSamples(uint32_t* values, uint32_t count) {
+  for (uint32_t i = 1; i < count; i++) {
+    uint32_t value = values[i];
+    int32_t j = i - 1;
+    while (j >= 0 && values[j] > value) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = value;
+  }
+}
+
+static uint32_t percentileOf(const uint32_t* sorted, uint32_t count, uint32_t p) {
+  if (count == 0) return 0;
+  return sorted[(count - 1) * p / 100];
+}
+
+// Mediane doorvoer van de geslaagde schrijfacties in een kopie van de samples
+static uint32_t medianRate(uint32_t* rates, uint32_t count) {
+  sortSamples(rates, count);
+  uint32_t failed = 0;
+  while (failed < count && rates[failed] == 0) failed++;
+  return percentileOf(rates + failed, count - failed, 50);
+}
+
+// Een bestand (of bij wholeFile = false: een aangroei) is geschreven
+void cardUsageAdd(uint64_t bytes, bool wholeFile) {
+  portENTER_CRITICAL(&usageMux);
+  uint64_t used = wholeFile ? clusterRound(bytes) : bytes;
+  status.usedBytes += used;
+  status.bytesAdded += used;
+  if (wholeFile) status.filesAdded++;
+  portEXIT_CRITICAL(&usageMux);
+}
+
+// Een bestand van 'bytes' is verwijderd
+void cardUsageRemove(uint64_t bytes) {
+  portENTER_CRITICAL(&usageMux);
+  uint64_t freed = min(clusterRound(bytes), status.usedBytes);
+  status.usedBytes -= freed;
+  status.bytesRemoved += freed;
+  status.filesRemoved++;
+  portEXIT_CRITICAL(&usageMux);
+}
+
+// Gebruik volgens FatFs: de eerste keer vullen, daarna corrigeren
+void cardUsageResync(uint64_t cardBytes, uint64_t usedBytes, uint32_t elapsedMs) {
+  portENTER_CRITICAL(&usageMux);
+  bool seeding = !status.seeded;
+  if (seeding) {
+    status.seeded = true;
+    status.seedMs = elapsedMs;
+    status.clusterBytes = cardBytes > 32ULL * 1024 * 1024 * 1024 ? CARD_LARGE_CLUSTER : CARD_SMALL_CLUSTER;
+  } else {
+    status.lastDriftBytes = (int64_t)usedBytes - (int64_t)status.usedBytes;
+    status.resyncs++;
+  }
+  status.cardBytes = cardBytes;
+  status.usedBytes = usedBytes;
+  portEXIT_CRITICAL(&usageMux);
+
+  if (seeding) {
+    Serial.printf("Kaartgebruik: %llu van %llu MB (%u ms)\n", (unsigned long long)(usedBytes >> 20),
+                  (unsigned long long)(cardBytes >> 20), elapsedMs);
+  }
+}
+
+// Vul het gebruik één keer uit FatFs; doet niets als dat al gebeurd is
+void cardUsageSeed() {
+  if (!sdCardAvailable) return;
+  portENTER_CRITICAL(&usageMux);
+  bool seeded = status.seeded;
+  portEXIT_CRITICAL(&usageMux);
+  if (seeded) return;
+
+  unsigned long start = millis();
+  uint64_t cardBytes = SD_MMC.totalBytes();
+  uint64_t usedBytes = SD_MMC.usedBytes();
+  cardUsageResync(cardBytes, usedBytes, millis() - start);
+}
+
+// Duur en resultaat van het schrijven van een foto van 'bytes'
+void cardWriteTimed(uint32_t bytes, uint32_t elapsedMs, bool ok) {
+  uint32_t rate = ok ? (uint32_t)((uint64_t)bytes * 1000 / max(elapsedMs, (uint32_t)1) / 1024) : 0;
+  if (ok && rate == 0) rate = 1;
+
+  uint32_t rates[CARD_LATENCY_SAMPLES];
+  bool baselineReady = false;
+  portENTER_CRITICAL(&usageMux);
+  status.writes++;
+  if (!ok) status.failedWrites++;
+  latencySamples[sampleCount % CARD_LATENCY_SAMPLES] = elapsedMs;
+  rateSamples[sampleCount % CARD_LATENCY_SAMPLES] = rate;
+  sampleCount++;
+  if (ok && elapsedMs > status.maxMs) status.maxMs = elapsedMs;
+  if (sampleCount == CARD_BASELINE_WRITES) {
+    memcpy(rates, rateSamples, sizeof(uint32_t) * CARD_BASELINE_WRITES);
+    baselineReady = true;
+  }
+  portEXIT_CRITICAL(&usageMux);
+
+  // Referentie eenmalig, buiten de kritieke sectie berekend
+  if (baselineReady) {
+    uint32_t baseline = medianRate(rates, CARD_BASELINE_WRITES);
+    portENTER_CRITICAL(&usageMux);
+    status.baselineKBps = baseline;
+    portEXIT_CRITICAL(&usageMux);
+    Serial.printf("Kaart: referentiedoorvoer %u KB/s\n", baseline);
+  }
+}
+
+// Kopie van het gebruik en de gezondheid, met percentielen van de laatste schrijfacties
+CardStatus getCardStatus() {
+  uint32_t latencies[CARD_LATENCY_SAMPLES];
+  uint32_t rates[CARD_LATENCY_SAMPLES];
+  uint32_t count;
+
+  portENTER_CRITICAL(&usageMux);
+  CardStatus copy = status;
+  count = sampleCount < CARD_LATENCY_SAMPLES ? sampleCount : CARD_LATENCY_SAMPLES;
+  memcpy(latencies, latencySamples, count * sizeof(uint32_t));
+  memcpy(rates, rateSamples, count * sizeof(uint32_t));
+  portEXIT_CRITICAL(&usageMux);
+
+  copy.recentFailures = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (rates[i] == 0) copy.recentFailures++;
+  }
+  sortSamples(latencies, count);
+  copy.p50Ms = percentileOf(latencies, count, 50);
+  copy.p95Ms = percentileOf(latencies, count, 95);
+  copy.recentKBps = medianRate(rates, count);
+
+  if (copy.recentFailures > 0) {
+    copy.health = CARD_HEALTH_FAILING;
+  } else if (copy.baselineKBps == 0) {
+    copy.health = CARD_HEALTH_UNKNOWN;
+  } else if (copy.recentKBps * CARD_SLOW_FACTOR < copy.baselineKBps) {
+    copy.health = CARD_HEALTH_SLOW;
+  } else {
+    copy.health = CARD_HEALTH_OK;
+  }
+  return copy;
+}
+
+// Naam van een gezondheidstoestand voor weergave en JSON
+const char* cardHealthName(uint8_t health) {
+  switch (health) {
+    case CARD_HEALTH_OK: return "goed";
+    case CARD_HEALTH_SLOW: return "trager";
+    case CARD_HEALTH_FAILING: return "schrijffouten";
+    default: return "onbekend";
+  }
+}
\ No newline at end of file
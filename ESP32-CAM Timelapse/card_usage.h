@@ -0,0 +1,54 @@
+#ifndef CARD_USAGE_H
+#define CARD_USAGE_H
+
+#include "config.h"
+
+// Gebruik en gezondheid van de SD-kaart, in het geheugen bijgehouden. Het
+// gebruik wordt één keer gevuld uit FatFs en daarna bij elk geschreven of
+// verwijderd bestand bijgewerkt; de retentietaak corrigeert het elke minuut.
+// De schrijfsnelheid van foto's wordt vergeleken met die na het opstarten.
+#define CARD_LATENCY_SAMPLES  32       // Laatste foto-schrijfacties voor percentielen
+#define CARD_BASELINE_WRITES  32       // Eerste schrijfacties na opstarten als referentie
+#define CARD_SLOW_FACTOR      3        // Trager: mediane doorvoer onder 1/3 van de referentie
+#define CARD_SMALL_CLUSTER    32768    // Standaard clustergrootte tot en met 32 GB (FAT32)
+#define CARD_LARGE_CLUSTER    131072   // Standaard clustergrootte boven 32 GB (exFAT)
+
+// Gezondheid van de kaart
+#define CARD_HEALTH_UNKNOWN 0          // Nog te weinig schrijfacties
+#define CARD_HEALTH_OK      1
+#define CARD_HEALTH_SLOW    2          // Doorvoer flink lager dan na het opstarten
+#define CARD_HEALTH_FAILING 3          // Mislukte schrijfacties in het recente venster
+
+struct CardStatus {
+  bool seeded;               // Gebruik bekend (eerste opvraag bij FatFs gedaan)
+  uint64_t cardBytes;
+  uint64_t usedBytes;
+  uint32_t seedMs;           // Duur van de eerste opvraag (kan de FAT doorlopen)
+  uint32_t clusterBytes;     // Aangenomen clustergrootte voor afronden
+  uint64_t bytesAdded;       // Sinds het opstarten, afgerond op clusters
+  uint64_t bytesRemoved;
+  uint32_t filesAdded;
+  uint32_t filesRemoved;
+  uint32_t resyncs;
+  int64_t lastDriftBytes;    // FatFs min eigen telling bij de laatste correctie
+  uint32_t writes;           // Foto-schrijfacties
+  uint32_t failedWrites;
+  uint32_t recentFailures;   // Mislukt binnen de laatste CARD_LATENCY_SAMPLES
+  uint32_t p50Ms;
+  uint32_t p95Ms;
+  uint32_t maxMs;
+  uint32_t baselineKBps;     // Mediane doorvoer van de eerste schrijfacties
+  uint32_t recentKBps;       // Mediane doorvoer van de laatste schrijfacties
+  uint8_t health;            // CARD_HEALTH_*
+};
+
+// Functies voor het kaartgebruik
+void cardUsageSeed();
+void cardUsageAdd(uint64_t bytes, bool wholeFile = true);
+void cardUsageRemove(uint64_t bytes);
+void cardUsageResync(uint64_t cardBytes, uint64_t usedBytes, uint32_t elapsedMs);
+void cardWriteTimed(uint32_t bytes, uint32_t elapsedMs, bool ok);
+CardStatus getCardStatus();
+const char* cardHealthName(uint8_t health);
+
+#endif // CARD_USAGE_H
\ No newline at end of file
@@ -4,6 +4,4 @@
 bool sdCardAvailable = false;
 bool timeInitialized = false;
 unsigned long lastPhotoTime = 0;
-unsigned long lastNTPSync = 0;
-char filePath[100];
-char folderPath[50];
\ No newline at end of file
+unsigned long lastNTPSync = 0;
\ No newline at end of file
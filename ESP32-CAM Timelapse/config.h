@@ -44,10 +44,11 @@ extern int photoInterval;    // Tijd tussen foto's in minuten
 extern int dayStartHour;     // Start tijdstip voor foto's (8:00)
 extern int dayEndHour;       // Eind tijdstip voor foto's (20:00)
 extern int jpegQuality;      // JPEG kwaliteit (0-63, lagere waarde = hogere kwaliteit)
-
-// Buffer voor bestandspaden
-extern char filePath[100];
-extern char folderPath[50];
+extern int captureMode;      // CAPTURE_MODE_INTERVAL of CAPTURE_MODE_CHANGE
+extern int retentionMaxMB;   // Maximaal kaartgebruik in MB (0 = kaart min reserve)
+extern int retentionMaxDays; // Maximaal aantal dagen (0 = geen maximum)
+extern int thinAfterDays;    // Dagen ouder dan dit uitdunnen (0 = niet uitdunnen)
+extern int thinKeepEvery;    // Bij uitdunnen elke N-de foto bewaren
 
 // Status variabelen
 extern bool sdCardAvailable;
@@ -57,7 +58,13 @@ extern unsigned long lastNTPSync;
 
 // Constanten
 #define NTP_SYNC_INTERVAL 86400000  // Eén keer per dag tijd synchroniseren
+#define DAY_NAME_SIZE 36            // Dagnaam DD-MM-YYYY; ruim voor "%02d-%02d-%04d" met elke int-waarde
 #define SETTINGS_CHECKSUM 0xABCD1234
+#define RETENTION_SETTINGS_CHECKSUM 0x52455431
+
+// Opnamemodus
+#define CAPTURE_MODE_INTERVAL 0     // Vast interval
+#define CAPTURE_MODE_CHANGE   1     // Bij verandering, met het interval als basis
 
 // Structuur voor het opslaan van instellingen
 struct TimelapseSavedSettings {
@@ -65,6 +72,17 @@ struct TimelapseSavedSettings {
   int dayStartHour;
   int dayEndHour;
   int jpegQuality;
+  int captureMode;           // Stond bij oudere firmware op de plaats van checksum
+  uint32_t checksum;
+};
+
+// Bewaarbeleid, in de EEPROM direct achter TimelapseSavedSettings (oudere
+// firmware liet dit deel leeg, de checksum klopt dan niet)
+struct RetentionSavedSettings {
+  int maxMB;
+  int maxDays;
+  int thinAfterDays;
+  int thinKeepEvery;
   uint32_t checksum;
 };
 
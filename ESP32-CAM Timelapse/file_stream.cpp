@@ -0,0 +1,292 @@
+#include "file_stream.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// Bestandsstreamer voor alle routes die bestanden van de SD-kaart sturen.
+// Elke stream krijgt twee grote buffers: terwijl het ene blok naar de client
+// gaat, leest de leestaak het volgende blok van de kaart. Na het eerste blok
+// beginnen alle leesacties op een sectorgrens, zodat FATFS hele sectoren
+// rechtstreeks in de buffer kan lezen. De buffers worden pas bij de eerste
+// stream op een slot gereserveerd. Alleen de eerste FILE_STREAM_DMA_SLOTS
+// slots krijgen DMA-geschikt intern geheugen (snelst, de SDMMC-driver leest
+// er direct in); intern geheugen is krap, dus de overige slots gebruiken
+// PSRAM, waar de driver per sector via een eigen bouncebuffer leest. Vrije
+// slots worden vooraan teruggezet, zodat een enkele stream steeds hetzelfde
+// slot hergebruikt en de andere alleen bij gelijktijdige streams nodig zijn.
+
+#define READER_TASK_STACK    4096
+#define READER_TASK_PRIORITY 2
+#define READER_TASK_CORE     0
+
+// Buffers en leesresultaten van één stream
+struct StreamSlot {
+  uint8_t* buffers[2];
+  size_t results[2];
+  SemaphoreHandle_t readDone;
+};
+
+// Een leesopdracht voor de leestaak: uit een open bestand, of met path een
+// bestand (vanaf offset) dat de leestaak zelf opent en sluit
+struct ReadJob {
+  File* file;
+  const char* path;
+  uint32_t offset;
+  uint8_t* buffer;
+  size_t length;
+  size_t* result;
+  SemaphoreHandle_t done;
+};
+
+static StreamSlot slots[FILE_STREAM_SLOTS];
+static QueueHandle_t freeSlots = NULL;
+static QueueHandle_t readQueue = NULL;
+
+static portMUX_TYPE streamMux = portMUX_INITIALIZER_UNLOCKED;
+static FileStreamStats stats = {};
+
+// Lees length bytes vanaf offset uit het bestand op path
+static size_t readFileAt(const char* path, uint32_t offset, uint8_t* buffer, size_t length) {
+  File file = SD_MMC.open(path, FILE_READ);
+  if (!file) return 0;
+  size_t bytesRead = offset == 0 || file.seek(offset) ? file.read(buffer, length) : 0;
+  file.close();
+  return bytesRead;
+}
+
+// Leestaak: voert leesopdrachten uit terwijl de worker het vorige blok verstuurt
+static void readerTask(void*) {
+  ReadJob job;
+
+  for (;;) {
+    if (xQueueReceive(readQueue, &job, portMAX_DELAY) == pdPASS) {
+      if (job.path) {
+        *job.result = readFileAt(job.path, job.offset, job.buffer, job.length);
+      } else {
+        *job.result = job.file->read(job.buffer, job.length);
+      }
+      xSemaphoreGive(job.done);
+    }
+  }
+}
+
+// Buffer voor een stream: intern DMA-geheugen of PSRAM, met de ander als
+// terugval; internal geeft terug waar de buffer staat
+static uint8_t* allocateStreamBuffer(bool& internal) {
+  uint8_t* buffer = NULL;
+  if (!internal && psramFound()) {
+    buffer = (uint8_t*)ps_malloc(FILE_STREAM_CHUNK);
+  }
+  if (!buffer) {
+    buffer = (uint8_t*)heap_caps_malloc(FILE_STREAM_CHUNK, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    internal = buffer != NULL;
+  }
+  if (!buffer && psramFound()) {
+    buffer = (uint8_t*)ps_malloc(FILE_STREAM_CHUNK);
+    internal = false;
+  }
+  return buffer;
+}
+
+// Reserveer de buffers van een slot bij de eerste stream; false als er geen
+// geheugen is (de stream gaat dan via de stackbuffer)
+static bool allocateSlotBuffers(uint8_t index) {
+  StreamSlot& slot = slots[index];
+  if (slot.buffers[0] && slot.buffers[1]) return true;
+
+  bool internal = true;
+  for (uint8_t i = 0; i < 2; i++) {
+    bool inDma = index < FILE_STREAM_DMA_SLOTS;
+    if (!slot.buffers[i]) slot.buffers[i] = allocateStreamBuffer(inDma);
+    internal = internal && inDma;
+  }
+  if (!slot.buffers[0] || !slot.buffers[1]) {
+    Serial.printf("Bestandsstreamer: geen geheugen voor de buffers van stream %u\n", index);
+    return false;
+  }
+
+  portENTER_CRITICAL(&streamMux);
+  stats.allocatedSlots++;
+  if (internal) stats.dmaSlots++;
+  portEXIT_CRITICAL(&streamMux);
+  Serial.printf("Bestandsstreamer: buffers voor stream %u in %s\n", index,
+                internal ? "intern DMA-geheugen" : "PSRAM");
+  return true;
+}
+
+// Start de leestaak; de streambuffers volgen bij het eerste gebruik
+bool startFileStreamer() {
+  freeSlots = xQueueCreate(FILE_STREAM_SLOTS, sizeof(uint8_t));
+  readQueue = xQueueCreate(FILE_STREAM_SLOTS, sizeof(ReadJob));
+  if (!freeSlots || !readQueue) {
+    Serial.println("Bestandsstreamer: geen geheugen voor queues");
+    freeSlots = NULL;
+    readQueue = NULL;
+    return false;
+  }
+
+  uint8_t slotCount = 0;
+  for (uint8_t i = 0; i < FILE_STREAM_SLOTS; i++) {
+    slots[i].buffers[0] = NULL;
+    slots[i].buffers[1] = NULL;
+    slots[i].readDone = xSemaphoreCreateBinary();
+    if (!slots[i].readDone) {
+      break;
+    }
+    xQueueSend(freeSlots, &i, 0);
+    slotCount++;
+  }
+  if (slotCount == 0) {
+    Serial.println("Bestandsstreamer: geen geheugen voor semaforen");
+    freeSlots = NULL;
+    readQueue = NULL;
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(readerTask, "sd_reader", READER_TASK_STACK, NULL,
+                              READER_TASK_PRIORITY, NULL, READER_TASK_CORE) != pdPASS) {
+    // Zonder leestaak wordt in de worker zelf gelezen, nog steeds in grote blokken
+    readQueue = NULL;
+    Serial.println("Leestaak starten mislukt, lezen en versturen niet overlappend");
+  }
+
+  Serial.printf("Bestandsstreamer gestart: %u streams met 2 x %u KB (bij eerste gebruik)\n", slotCount,
+                FILE_STREAM_CHUNK / 1024);
+  return true;
+}
+
+// Lees een blok op de achtergrond (of direct als er geen leestaak is)
+static void startRead(StreamSlot& slot, File& file, uint8_t index, size_t length) {
+  ReadJob job = { &file, NULL, 0, slot.buffers[index], length, &slot.results[index], slot.readDone };
+  if (!readQueue || xQueueSend(readQueue, &job, portMAX_DELAY) != pdPASS) {
+    slot.results[index] = file.read(slot.buffers[index], length);
+    xSemaphoreGive(slot.readDone);
+  }
+}
+
+// Lees (een deel van) een bestand op de achtergrond in buffer, bijvoorbeeld
+// het volgende frame terwijl het huidige verstuurd wordt; offset is de
+// positie in het bestand (foto in een segment). path moet geldig blijven tot
+// done gegeven is; result bevat dan het aantal gelezen bytes.
+void readFileInBackground(const char* path, uint8_t* buffer, size_t length, size_t* result, SemaphoreHandle_t done,
+                          uint32_t offset) {
+  ReadJob job = { NULL, path, offset, buffer, length, result, done };
+  if (!readQueue || xQueueSend(readQueue, &job, portMAX_DELAY) != pdPASS) {
+    *result = readFileAt(path, offset, buffer, length);
+    xSemaphoreGive(done);
+  }
+}
+
+// Stuur een buffer volledig; stopt als de client niets meer aanneemt
+static size_t writeAll(WiFiClient& client, const uint8_t* buffer, size_t length) {
+  size_t sent = 0;
+  while (sent < length) {
+    size_t written = client.write(buffer + sent, length - sent);
+    if (written == 0) {
+      break;
+    }
+    sent += written;
+  }
+  return sent;
+}
+
+// Tel een afgeronde stream
+static void recordStream(bool direct, size_t sent, size_t length, uint32_t shortReads) {
+  portENTER_CRITICAL(&streamMux);
+  if (direct) stats.directStreams++;
+  else stats.streams++;
+  if (sent < length) stats.aborted++;
+  stats.shortReads += shortReads;
+  stats.bytesSent += sent;
+  portEXIT_CRITICAL(&streamMux);
+}
+
+// Terugval zonder vrije buffers: kleine blokken via de stack
+static size_t streamFileDirect(WiFiClient& client, File& file, size_t length, uint32_t* crc) {
+  uint8_t buffer[FILE_STREAM_DIRECT_CHUNK];
+  size_t sent = 0;
+  uint32_t shortReads = 0;
+
+  while (sent < length) {
+    size_t wanted = min((size_t)FILE_STREAM_DIRECT_CHUNK, length - sent);
+    size_t bytesRead = file.read(buffer, wanted);
+    if (bytesRead < wanted) shortReads++;
+    if (bytesRead == 0) break;
+    if (crc) *crc = esp_rom_crc32_le(*crc, buffer, bytesRead);
+    size_t written = writeAll(client, buffer, bytesRead);
+    sent += written;
+    if (written < bytesRead) break;
+  }
+
+  recordStream(true, sent, length, shortReads);
+  return sent;
+}
+
+// Stuur length bytes vanaf de huidige positie van file naar de client.
+// Geeft het aantal verstuurde bytes; minder dan length betekent dat het
+// bestand korter was of de client de verbinding verbrak. Met crc wordt de
+// CRC-32 over de gelezen bytes bijgewerkt (voor archieven).
+size_t streamFile(WiFiClient& client, File& file, size_t length, uint32_t* crc) {
+  if (length == 0) {
+    return 0;
+  }
+
+  uint8_t slotIndex;
+  if (!freeSlots || xQueueReceive(freeSlots, &slotIndex, pdMS_TO_TICKS(FILE_STREAM_SLOT_WAIT)) != pdPASS) {
+    return streamFileDirect(client, file, length, crc);
+  }
+  if (!allocateSlotBuffers(slotIndex)) {
+    xQueueSendToFront(freeSlots, &slotIndex, 0);
+    return streamFileDirect(client, file, length, crc);
+  }
+  StreamSlot& slot = slots[slotIndex];
+
+  // Eerste blok tot de volgende sectorgrens, daarna volle uitgelijnde blokken
+  size_t remaining = length;
+  size_t request = min(remaining, (size_t)(FILE_STREAM_CHUNK - file.position() % SD_SECTOR_SIZE));
+  size_t sent = 0;
+  uint32_t shortReads = 0;
+  uint8_t current = 0;
+  startRead(slot, file, current, request);
+
+  for (;;) {
+    xSemaphoreTake(slot.readDone, portMAX_DELAY);
+    size_t bytesRead = slot.results[current];
+    if (bytesRead < request) shortReads++;
+    if (bytesRead == 0) break;
+    remaining -= bytesRead;
+    if (crc) *crc = esp_rom_crc32_le(*crc, slot.buffers[current], bytesRead);
+
+    // Volgende blok lezen terwijl dit blok verstuurd wordt
+    size_t nextRequest = min(remaining, (size_t)FILE_STREAM_CHUNK);
+    if (nextRequest > 0) {
+      startRead(slot, file, current ^ 1, nextRequest);
+    }
+
+    size_t written = writeAll(client, slot.buffers[current], bytesRead);
+    sent += written;
+    if (written < bytesRead || nextRequest == 0) {
+      // Lopende leesactie afmaken voordat de buffers worden vrijgegeven
+      if (nextRequest > 0) xSemaphoreTake(slot.readDone, portMAX_DELAY);
+      break;
+    }
+
+    current ^= 1;
+    request = nextRequest;
+  }
+
+  xQueueSendToFront(freeSlots, &slotIndex, 0);
+  recordStream(false, sent, length, shortReads);
+  return sent;
+}
+
+// Kopie van de statistieken
+FileStreamStats getFileStreamStats() {
+  portENTER_CRITICAL(&streamMux);
+  FileStreamStats copy = stats;
+  portEXIT_CRITICAL(&streamMux);
+  return copy;
+}
\ No newline at end of file
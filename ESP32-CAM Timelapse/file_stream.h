@@ -0,0 +1,35 @@
+#ifndef FILE_STREAM_H
+#define FILE_STREAM_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Bestanden van de SD-kaart naar een client sturen
+#define SD_SECTOR_SIZE           512
+#define FILE_STREAM_CHUNK        8192   // Leesblok, veelvoud van de sectorgrootte
+#define FILE_STREAM_SLOTS        3      // Gelijktijdige streams met eigen buffers
+#define FILE_STREAM_DMA_SLOTS    1      // Streams met buffers in intern DMA-geheugen, de rest in PSRAM
+#define FILE_STREAM_SLOT_WAIT    100    // ms wachten op vrije buffers
+#define FILE_STREAM_DIRECT_CHUNK 1024   // Stackbuffer als er geen buffers vrij zijn
+
+// Statistieken van de bestandsstreamer
+struct FileStreamStats {
+  uint32_t streams;          // Met dubbele buffer verstuurd
+  uint32_t directStreams;    // Zonder vrije buffers, via de stackbuffer
+  uint32_t shortReads;       // Minder gelezen dan gevraagd
+  uint32_t aborted;          // Client nam niet alles aan
+  uint64_t bytesSent;
+  uint8_t allocatedSlots;    // Streams waarvoor al buffers zijn gereserveerd
+  uint8_t dmaSlots;          // Daarvan met buffers in intern DMA-geheugen
+};
+
+// Functies voor de bestandsstreamer
+bool startFileStreamer();
+size_t streamFile(WiFiClient& client, File& file, size_t length, uint32_t* crc = NULL);
+void readFileInBackground(const char* path, uint8_t* buffer, size_t length, size_t* result, SemaphoreHandle_t done,
+                          uint32_t offset = 0);
+FileStreamStats getFileStreamStats();
+
+#endif // FILE_STREAM_H
\ No newline at end of file
@@ -28,6 +28,7 @@ h1, h2 { color: #333; }
 .photo-item { width: calc(33.333% - 10px); margin-bottom: 20px; box-shadow: 0 0 5px rgba(0,0,0,0.2); border-radius: 4px; overflow: hidden; }
 .photo-item img { width: 100%; height: auto; display: block; }
 .photo-info { padding: 10px; background-color: white; }
+.pagination { display: flex; align-items: center; justify-content: center; gap: 10px; margin: 10px 0; }
 .photo-actions { display: flex; justify-content: space-between; margin-top: 10px; }
 @media (max-width: 768px) { .photo-item { width: calc(50% - 10px); } }
 @media (max-width: 480px) { .photo-item { width: 100%; } }
@@ -82,6 +83,8 @@ const char* MAIN_PAGE_HTML_ACTIONS = R"rawliteral(
 <div class="actions">
   <a href="/photo" class="btn btn-primary">Maak Nu Een Foto</a>
   <a href="/stream" target="_blank" class="btn btn-info">Open Live Stream (30 sec)</a>
+  <form action="/rebuildindex" method="post" style="display:inline"><button type="submit" class="btn">Index herbouwen</button></form>
+  <a href="/backfillthumbs" class="btn">Miniaturen aanvullen</a>
   <a href="/confirmwipe" class="btn btn-warning">Wis SD-kaart</a>
 </div>
 )rawliteral";
@@ -108,6 +111,15 @@ const char* SETTINGS_TAB_HTML = R"rawliteral(
       <input type="number" name="photoInterval" value="{photoInterval}" min="1" max="60" style="padding: 8px; width: 100px;">
     </div>
 
+    <div style="margin-bottom: 15px;">
+      <label style="display: block; margin-bottom: 5px; font-weight: bold;">Opnamemodus:</label>
+      <select name="captureMode" style="padding: 8px;">
+        <option value="0"{modeInterval}>Vast interval</option>
+        <option value="1"{modeChange}>Bij verandering</option>
+      </select>
+      <p style="margin-top: 5px; font-size: 12px; color: #666;">Bij verandering kijkt de camera elke 30 seconden met een klein beeld of er iets is veranderd, en maakt dan een foto (maximaal één per minuut). Zonder verandering volgt na 4x het interval toch een foto.</p>
+    </div>
+
     <div style="margin-bottom: 15px;">
       <label style="display: block; margin-bottom: 5px; font-weight: bold;">Dagelijkse opnameperiode:</label>
       <div style="display: flex; gap: 10px; align-items: center;">
@@ -125,6 +137,25 @@ const char* SETTINGS_TAB_HTML = R"rawliteral(
       <p style="margin-top: 5px; font-size: 12px; color: #666;">Waarschuwing: Hogere kwaliteit (lagere waarde) gebruikt meer opslagruimte.</p>
     </div>
 
+    <div style="margin-bottom: 15px;">
+      <label style="display: block; margin-bottom: 5px; font-weight: bold;">Bewaarbeleid:</label>
+      <div style="display: flex; gap: 10px; align-items: center; flex-wrap: wrap;">
+        <span>Maximaal</span>
+        <input type="number" name="retentionMaxMB" value="{retentionMaxMB}" min="0" style="padding: 8px; width: 100px;">
+        <span>MB en</span>
+        <input type="number" name="retentionMaxDays" value="{retentionMaxDays}" min="0" style="padding: 8px; width: 80px;">
+        <span>dagen bewaren</span>
+      </div>
+      <div style="display: flex; gap: 10px; align-items: center; flex-wrap: wrap; margin-top: 5px;">
+        <span>Dagen ouder dan</span>
+        <input type="number" name="thinAfterDays" value="{thinAfterDays}" min="0" style="padding: 8px; width: 80px;">
+        <span>dagen uitdunnen tot elke</span>
+        <input type="number" name="thinKeepEvery" value="{thinKeepEvery}" min="2" max="60" style="padding: 8px; width: 80px;">
+        <span>e foto</span>
+      </div>
+      <p style="margin-top: 5px; font-size: 12px; color: #666;">0 = geen maximum / niet uitdunnen. Als de kaart (of het maximum) vol raakt, worden de oudste dagen op de achtergrond verwijderd; vandaag blijft altijd staan.</p>
+    </div>
+
     <button type="submit" class="btn btn-primary">Instellingen opslaan</button>
   </form>
 </div>
@@ -0,0 +1,198 @@
+#include "http_parser.h"
+
+// Incrementele HTTP/1.x parser. Bytes worden in blokken in een vaste buffer
+// per verbinding gelezen; alleen nieuw ontvangen bytes worden doorzocht op het
+// einde van de headers. Daarna worden verzoekregel en headers in de buffer
+// zelf opgesplitst, zonder String-kopieën. Bytes van een volgend verzoek
+// (pipelining) blijven in de buffer staan.
+
+// Start een nieuwe verbinding met een lege buffer
+void beginHttpConnection(HttpConnection& connection, WiFiClient& client) {
+  connection.client = client;
+  connection.length = 0;
+  connection.consumed = 0;
+  connection.scanned = 0;
+  connection.requests = 0;
+}
+
+// Zoek het einde van de headers ("\r\n\r\n") vanaf de eerder doorzochte positie
+static int findHeaderEnd(HttpConnection& connection) {
+  size_t start = connection.scanned > 3 ? connection.scanned - 3 : 0;
+  for (size_t i = start; i + 3 < connection.length; i++) {
+    if (connection.buffer[i] == '\r' && connection.buffer[i + 1] == '\n' &&
+        connection.buffer[i + 2] == '\r' && connection.buffer[i + 3] == '\n') {
+      return (int)i;
+    }
+  }
+  connection.scanned = connection.length;
+  return -1;
+}
+
+// Verwijder spaties aan het begin en einde van een headerwaarde
+static char* trimValue(char* value) {
+  while (*value == ' ' || *value == '\t') value++;
+  char* end = value + strlen(value);
+  while (end > value && (end[-1] == ' ' || end[-1] == '\t')) end--;
+  *end = '\0';
+  return value;
+}
+
+// Splits verzoekregel en headers op; de buffer wordt hierbij aangepast
+static bool parseHeaders(char* buffer, HttpRequest& request) {
+  char* line = buffer;
+  char* lineEnd = strstr(line, "\r\n");
+  if (!lineEnd) return false;
+  *lineEnd = '\0';
+
+  // Verzoekregel: METHODE SP DOEL SP HTTP/1.x
+  char* target = strchr(line, ' ');
+  if (!target) return false;
+  *target++ = '\0';
+  char* version = strchr(target, ' ');
+  if (!version) return false;
+  *version++ = '\0';
+  if (strncmp(version, "HTTP/1.", 7) != 0 || target[0] != '/') return false;
+
+  request.method = line;
+  request.target = target;
+  request.pathLength = strcspn(target, "?");
+  request.versionMinor = version[7] == '1' ? 1 : 0;
+  request.contentLength = 0;
+  request.range = NULL;
+  request.ifRange = NULL;
+  request.ifNoneMatch = NULL;
+  request.ifModifiedSince = NULL;
+
+  bool connectionClose = false;
+  bool connectionKeepAlive = false;
+
+  for (line = lineEnd + 2; *line; line = lineEnd + 2) {
+    lineEnd = strstr(line, "\r\n");
+    if (!lineEnd) break;
+    *lineEnd = '\0';
+
+    char* colon = strchr(line, ':');
+    if (!colon) return false;
+    *colon = '\0';
+    char* value = trimValue(colon + 1);
+
+    if (strcasecmp(line, "Content-Length") == 0) {
+      request.contentLength = strtoul(value, NULL, 10);
+    } else if (strcasecmp(line, "Connection") == 0) {
+      if (strcasestr(value, "close")) connectionClose = true;
+      if (strcasestr(value, "keep-alive")) connectionKeepAlive = true;
+    } else if (strcasecmp(line, "Range") == 0) {
+      request.range = value;
+    } else if (strcasecmp(line, "If-Range") == 0) {
+      request.ifRange = value;
+    } else if (strcasecmp(line, "If-None-Match") == 0) {
+      request.ifNoneMatch = value;
+    } else if (strcasecmp(line, "If-Modified-Since") == 0) {
+      request.ifModifiedSince = value;
+    }
+  }
+
+  // HTTP/1.1 houdt de verbinding standaard open, HTTP/1.0 alleen op verzoek
+  request.keepAliveRequested = request.versionMinor == 1 ? !connectionClose : connectionKeepAlive;
+  request.keepAlive = false;
+  return true;
+}
+
+// Lees de body (POST) deels uit de buffer en de rest van de client
+static bool readBody(HttpConnection& connection, HttpRequest& request) {
+  request.body = "";
+  if (request.contentLength == 0) return true;
+  request.body.reserve(request.contentLength);
+
+  size_t inBuffer = min(request.contentLength, connection.length - connection.consumed);
+  for (size_t i = 0; i < inBuffer; i++) {
+    request.body += connection.buffer[connection.consumed + i];
+  }
+  connection.consumed += inBuffer;
+
+  unsigned long start = millis();
+  char chunk[128];
+  while (request.body.length() < request.contentLength && connection.client.connected() &&
+         millis() - start < HTTP_REQUEST_TIMEOUT) {
+    int available = connection.client.available();
+    if (available <= 0) {
+      delay(1);
+      continue;
+    }
+    size_t wanted = min((size_t)available, min(sizeof(chunk), request.contentLength - request.body.length()));
+    int n = connection.client.read((uint8_t*)chunk, wanted);
+    for (int i = 0; i < n; i++) {
+      request.body += chunk[i];
+    }
+  }
+  return request.body.length() == request.contentLength;
+}
+
+// Lees het volgende verzoek van de verbinding. Zolang er nog geen byte van een
+// nieuw verzoek binnen is, wordt maximaal idleTimeoutMs gewacht (of tot
+// abortIdle() true geeft, bijv. omdat een andere client wacht).
+HttpReadResult readHttpRequest(HttpConnection& connection, HttpRequest& request,
+                               unsigned long idleTimeoutMs, bool (*abortIdle)()) {
+  // Vorig verzoek uit de buffer halen; gepipelinede bytes blijven staan
+  if (connection.consumed > 0) {
+    connection.length -= connection.consumed;
+    memmove(connection.buffer, connection.buffer + connection.consumed, connection.length);
+    connection.consumed = 0;
+    connection.scanned = 0;
+  }
+
+  unsigned long start = millis();
+  int headerEnd;
+  while ((headerEnd = findHeaderEnd(connection)) < 0) {
+    if (connection.length >= HTTP_BUFFER_SIZE) {
+      return HTTP_READ_TOO_LARGE;
+    }
+
+    int available = connection.client.available();
+    if (available > 0) {
+      size_t space = HTTP_BUFFER_SIZE - connection.length;
+      int n = connection.client.read((uint8_t*)connection.buffer + connection.length,
+                                     min((size_t)available, space));
+      if (n > 0) connection.length += n;
+      continue;
+    }
+
+    if (!connection.client.connected()) {
+      return HTTP_READ_CLOSED;
+    }
+    if (connection.length == 0) {
+      if (millis() - start >= idleTimeoutMs || (abortIdle && abortIdle())) {
+        return HTTP_READ_IDLE;
+      }
+    } else if (millis() - start >= HTTP_REQUEST_TIMEOUT) {
+      return HTTP_READ_BAD_REQUEST;
+    }
+    delay(1);
+  }
+
+  connection.buffer[headerEnd + 2] = '\0';
+  if (!parseHeaders(connection.buffer, request)) {
+    return HTTP_READ_BAD_REQUEST;
+  }
+  connection.consumed = headerEnd + 4;
+
+  if (request.contentLength > HTTP_MAX_BODY) {
+    return HTTP_READ_BODY_TOO_LARGE;
+  }
+  if (!readBody(connection, request)) {
+    return HTTP_READ_BAD_REQUEST;
+  }
+  return HTTP_READ_OK;
+}
+
+// Exacte vergelijking van het pad (zonder query string)
+bool requestPathEquals(const HttpRequest& request, const char* path) {
+  size_t length = strlen(path);
+  return request.pathLength == length && strncmp(request.target, path, length) == 0;
+}
+
+// Begint het pad met prefix?
+bool requestPathStartsWith(const HttpRequest& request, const char* prefix) {
+  size_t length = strlen(prefix);
+  return request.pathLength >= length && strncmp(request.target, prefix, length) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include "config.h"
+#include <WiFi.h>
+
+// Limieten van de HTTP-parser
+#define HTTP_BUFFER_SIZE     2048   // Verzoekregel + headers moeten hierin passen
+#define HTTP_MAX_BODY        2048   // Grootste POST body (instellingenformulier)
+#define HTTP_REQUEST_TIMEOUT 10000  // ms voor een volledig verzoek
+
+// Een ontvangen HTTP-verzoek. method, target en de headerwaarden wijzen in de
+// buffer van de verbinding en zijn geldig tot het volgende verzoek wordt gelezen.
+struct HttpRequest {
+  const char* method;
+  const char* target;        // Pad inclusief query string
+  size_t pathLength;         // Lengte van het pad zonder query string
+  uint8_t versionMinor;      // HTTP/1.0 of HTTP/1.1
+  size_t contentLength;
+  const char* range;         // Waarde van Range, of NULL
+  const char* ifRange;       // Waarde van If-Range, of NULL
+  const char* ifNoneMatch;   // Waarde van If-None-Match, of NULL
+  const char* ifModifiedSince; // Waarde van If-Modified-Since, of NULL
+  bool keepAliveRequested;   // Client en server willen de verbinding openhouden
+  bool keepAlive;            // Antwoord is verstuurd met Connection: keep-alive
+  String body;
+};
+
+// Een clientverbinding met de buffer waarin verzoeken worden geparsed
+struct HttpConnection {
+  WiFiClient client;
+  char buffer[HTTP_BUFFER_SIZE + 1];
+  size_t length;             // Ontvangen bytes in de buffer
+  size_t consumed;           // Bytes van het vorige verzoek
+  size_t scanned;            // Al doorzocht op het einde van de headers
+  uint16_t requests;         // Afgehandelde verzoeken op deze verbinding
+};
+
+// Resultaat van het lezen van een verzoek
+enum HttpReadResult {
+  HTTP_READ_OK,
+  HTTP_READ_CLOSED,          // Client heeft de verbinding gesloten
+  HTTP_READ_IDLE,            // Geen nieuw verzoek binnen de wachttijd
+  HTTP_READ_TOO_LARGE,       // Headers passen niet in de buffer
+  HTTP_READ_BODY_TOO_LARGE,  // Body groter dan HTTP_MAX_BODY
+  HTTP_READ_BAD_REQUEST
+};
+
+// Functies voor de HTTP-parser
+void beginHttpConnection(HttpConnection& connection, WiFiClient& client);
+HttpReadResult readHttpRequest(HttpConnection& connection, HttpRequest& request,
+                               unsigned long idleTimeoutMs, bool (*abortIdle)() = NULL);
+bool requestPathEquals(const HttpRequest& request, const char* path);
+bool requestPathStartsWith(const HttpRequest& request, const char* prefix);
+
+#endif // HTTP_PARSER_H
\ No newline at end of file
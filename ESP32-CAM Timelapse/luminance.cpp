@@ -0,0 +1,445 @@
+#include "luminance.h"
+
+// Helderheidsanalyse uit de DC-coëfficiënten van een baseline JPEG (zoals de
+// OV2640 ze maakt). Alleen de Huffman-data wordt gedecodeerd; AC-coëfficiënten
+// worden overgeslagen zonder ze op te slaan. Per blok van 8x8 pixels levert
+// dat de gemiddelde luminantie, genoeg voor een histogram van de hele foto.
+// Progressieve of rekenkundig gecodeerde JPEG's worden niet ondersteund.
+
+#define HUFF_FAST_BITS 9
+
+struct HuffmanTable {
+  // (lengte << 8) | symbool, 0 = langere code. Bij AC-tabellen telt de lengte
+  // ook de extra bits van de coëfficiënt mee; die worden toch overgeslagen.
+  uint16_t fast[1 << HUFF_FAST_BITS];
+  int32_t maxCode[18];
+  int32_t valueOffset[18];
+  uint8_t values[256];
+  bool defined;
+};
+
+struct JpegComponent {
+  uint8_t id;
+  uint8_t h;
+  uint8_t v;
+  uint8_t quantTable;
+  uint8_t dcTable;
+  uint8_t acTable;
+  int predictor;
+};
+
+struct BitReader {
+  const uint8_t* data;
+  size_t pos;
+  size_t end;
+  uint64_t buffer;           // Links uitgelijnd
+  int bits;
+  bool marker;               // Marker bereikt: daarna alleen nullen
+};
+
+// Decoder-toestand; te groot voor de stack van de taken, dus op de heap
+struct LumaDecoder {
+  HuffmanTable dc[4];
+  HuffmanTable ac[4];
+  uint16_t dcQuant[4];
+  JpegComponent components[4];
+  int componentCount;
+  int width;
+  int height;
+  int restartInterval;
+  uint32_t histogram[LUMA_BINS];
+  uint64_t sum;
+  uint64_t sumSquares;
+  uint32_t blocks;
+  // Optioneel raster (jpegLuminanceGrid)
+  uint32_t* gridSum;
+  uint16_t* gridCount;
+  int blocksX;               // Y-blokken per rij en kolom van het beeld
+  int blocksY;
+};
+
+static uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Canonieke Huffman-tabel opbouwen (JPEG-standaard, bijlage C)
+static bool buildHuffmanTable(HuffmanTable& table, const uint8_t* counts, const uint8_t* values, int total,
+                              bool ac) {
+  memset(&table, 0, sizeof(table));
+  memcpy(table.values, values, total);
+  int code = 0;
+  int k = 0;
+  for (int length = 1; length <= 16; length++) {
+    table.valueOffset[length] = k - code;
+    for (int i = 0; i < counts[length - 1]; i++) {
+      if (length <= HUFF_FAST_BITS) {
+        int shift = HUFF_FAST_BITS - length;
+        int skip = length + (ac ? (values[k] & 0x0F) : 0);
+        for (int j = 0; j < (1 << shift); j++) {
+          table.fast[(code << shift) | j] = (uint16_t)((skip << 8) | values[k]);
+        }
+      }
+      code++;
+      k++;
+    }
+    table.maxCode[length] = counts[length - 1] ? code - 1 : -1;
+    if (code > (1 << length)) return false;
+    code <<= 1;
+  }
+  table.maxCode[17] = INT32_MAX;
+  table.defined = true;
+  return true;
+}
+
+// Vul de bitbuffer aan tot minstens 32 bits, genoeg voor een code plus de
+// bijbehorende extra bits. 0xFF00 is een opgevulde 0xFF, andere 0xFF-reeksen
+// zijn markers (herstart of einde).
+static inline void fillBits(BitReader& reader) {
+  // Snelle weg: genoeg data over en geen 0xFF
+  if (!reader.marker && reader.pos + 8 <= reader.end) {
+    while (reader.bits <= 56 && reader.data[reader.pos] != 0xFF) {
+      reader.buffer |= (uint64_t)reader.data[reader.pos++] << (56 - reader.bits);
+      reader.bits += 8;
+    }
+  }
+  while (reader.bits <= 56) {
+    uint64_t byte = 0;
+    if (!reader.marker && reader.pos < reader.end) {
+      byte = reader.data[reader.pos];
+      if (byte == 0xFF) {
+        uint8_t next = reader.pos + 1 < reader.end ? reader.data[reader.pos + 1] : 0xD9;
+        if (next == 0x00) {
+          reader.pos += 2;
+        } else {
+          reader.marker = true;
+          byte = 0;
+        }
+      } else {
+        reader.pos++;
+      }
+    }
+    reader.buffer |= byte << (56 - reader.bits);
+    reader.bits += 8;
+  }
+}
+
+static inline void consumeBits(BitReader& reader, int count) {
+  reader.buffer <<= count;
+  reader.bits -= count;
+}
+
+// Decodeer één DC-symbool, of een AC-symbool met een code langer dan
+// HUFF_FAST_BITS (na fillBits); -1 bij een ongeldige code
+static inline int decodeSymbol(BitReader& reader, const HuffmanTable& table) {
+  uint16_t fast = table.fast[reader.buffer >> (64 - HUFF_FAST_BITS)];
+  if (fast) {
+    consumeBits(reader, fast >> 8);
+    return fast & 0xFF;
+  }
+  for (int length = HUFF_FAST_BITS + 1; length <= 16; length++) {
+    int32_t code = (int32_t)(reader.buffer >> (64 - length));
+    if (code <= table.maxCode[length]) {
+      consumeBits(reader, length);
+      return table.values[code + table.valueOffset[length]];
+    }
+  }
+  return -1;
+}
+
+// Lees 'size' bits en breid uit naar een getal met teken (JPEG EXTEND)
+static inline int receiveExtend(BitReader& reader, int size) {
+  if (size == 0) return 0;
+  int value = (int)(reader.buffer >> (64 - size));
+  consumeBits(reader, size);
+  if (value < (1 << (size - 1))) value -= (1 << size) - 1;
+  return value;
+}
+
+// Decodeer één blok: DC bijwerken, AC-coëfficiënten overslaan
+static bool decodeBlock(LumaDecoder& decoder, BitReader& reader, JpegComponent& component) {
+  fillBits(reader);
+  int size = decodeSymbol(reader, decoder.dc[component.dcTable]);
+  if (size < 0 || size > 16) return false;
+  component.predictor += receiveExtend(reader, size);
+
+  const HuffmanTable& ac = decoder.ac[component.acTable];
+  for (int k = 1; k < 64; ) {
+    fillBits(reader);
+    int rs;
+    uint16_t fast = ac.fast[reader.buffer >> (64 - HUFF_FAST_BITS)];
+    if (fast) {
+      // Code en extra bits in één keer
+      consumeBits(reader, fast >> 8);
+      rs = fast & 0xFF;
+    } else {
+      rs = decodeSymbol(reader, ac);
+      if (rs < 0) return false;
+      consumeBits(reader, rs & 0x0F);
+    }
+    int run = rs >> 4;
+    if ((rs & 0x0F) == 0) {
+      if (run != 15) break;  // Einde van het blok
+      k += 16;
+      continue;
+    }
+    k += run + 1;
+  }
+  return true;
+}
+
+// Tel de gemiddelde luminantie van het Y-blok op (x, y) mee
+static void addLumaBlock(LumaDecoder& decoder, const JpegComponent& component, int x, int y) {
+  int level = 128 + component.predictor * decoder.dcQuant[component.quantTable] / 8;
+  level = level < 0 ? 0 : (level > 255 ? 255 : level);
+  decoder.histogram[level * LUMA_BINS / 256]++;
+  decoder.sum += level;
+  decoder.sumSquares += (uint32_t)(level * level);
+  decoder.blocks++;
+
+  // Opvulblokken buiten het beeld tellen niet mee in het raster
+  if (decoder.gridSum && x < decoder.blocksX && y < decoder.blocksY) {
+    int cell = (y * LUMA_GRID_ROWS / decoder.blocksY) * LUMA_GRID_COLS + x * LUMA_GRID_COLS / decoder.blocksX;
+    decoder.gridSum[cell] += level;
+    decoder.gridCount[cell]++;
+  }
+}
+
+// Na een herstartinterval: naar de volgende RSTn-marker en voorspellers wissen
+static void restart(LumaDecoder& decoder, BitReader& reader, int* scanComponents, int scanCount) {
+  while (reader.pos + 1 < reader.end &&
+         !(reader.data[reader.pos] == 0xFF && reader.data[reader.pos + 1] >= 0xD0 &&
+           reader.data[reader.pos + 1] <= 0xD7)) {
+    reader.pos++;
+  }
+  reader.pos += 2;
+  reader.buffer = 0;
+  reader.bits = 0;
+  reader.marker = false;
+  for (int i = 0; i < scanCount; i++) {
+    decoder.components[scanComponents[i]].predictor = 0;
+  }
+}
+
+// Doorloop de entropie-gecodeerde data van de eerste scan
+static bool decodeScan(LumaDecoder& decoder, const uint8_t* data, size_t start, size_t end,
+                       int* scanComponents, int scanCount) {
+  int hMax = 1, vMax = 1;
+  for (int i = 0; i < decoder.componentCount; i++) {
+    hMax = max(hMax, (int)decoder.components[i].h);
+    vMax = max(vMax, (int)decoder.components[i].v);
+  }
+
+  // Alleen component 0 (Y) telt mee; een losse scan moet dus Y zijn
+  int mcusX, mcusY;
+  if (scanCount == 1) {
+    if (scanComponents[0] != 0) return false;
+    const JpegComponent& y = decoder.components[0];
+    mcusX = ((decoder.width * y.h + hMax - 1) / hMax + 7) / 8;
+    mcusY = ((decoder.height * y.v + vMax - 1) / vMax + 7) / 8;
+  } else {
+    mcusX = (decoder.width + 8 * hMax - 1) / (8 * hMax);
+    mcusY = (decoder.height + 8 * vMax - 1) / (8 * vMax);
+  }
+
+  const JpegComponent& luma = decoder.components[0];
+  int lumaW = (decoder.width * luma.h + hMax - 1) / hMax;
+  int lumaH = (decoder.height * luma.v + vMax - 1) / vMax;
+  decoder.blocksX = (lumaW + 7) / 8;
+  decoder.blocksY = (lumaH + 7) / 8;
+
+  BitReader reader = { data, start, end, 0, 0, false };
+  int mcuCount = mcusX * mcusY;
+  for (int mcu = 0; mcu < mcuCount; mcu++) {
+    if (decoder.restartInterval && mcu > 0 && mcu % decoder.restartInterval == 0) {
+      restart(decoder, reader, scanComponents, scanCount);
+    }
+    for (int i = 0; i < scanCount; i++) {
+      JpegComponent& component = decoder.components[scanComponents[i]];
+      int blocks = scanCount == 1 ? 1 : component.h * component.v;
+      for (int b = 0; b < blocks; b++) {
+        if (!decodeBlock(decoder, reader, component)) return false;
+        if (scanComponents[i] != 0) continue;
+        if (scanCount == 1) {
+          addLumaBlock(decoder, component, mcu % mcusX, mcu / mcusX);
+        } else {
+          addLumaBlock(decoder, component, (mcu % mcusX) * component.h + b % component.h,
+                       (mcu / mcusX) * component.v + b / component.h);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Lees de headers tot de eerste scan en decodeer die
+static bool parseAndDecode(LumaDecoder& decoder, const uint8_t* jpeg, size_t len) {
+  if (len < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return false;
+  bool frameSeen = false;
+  size_t pos = 2;
+
+  while (pos + 4 <= len) {
+    if (jpeg[pos] != 0xFF) return false;
+    uint8_t marker = jpeg[pos + 1];
+    if (marker == 0xFF) {
+      pos++;
+      continue;
+    }
+    size_t segLen = readU16(jpeg + pos + 2);
+    const uint8_t* seg = jpeg + pos + 4;
+    size_t segEnd = pos + 2 + segLen;
+    if (segLen < 2 || segEnd > len) return false;
+
+    if (marker == 0xDB) {
+      // Kwantisatietabellen: alleen de DC-factor (eerste waarde) is nodig
+      size_t p = pos + 4;
+      while (p < segEnd) {
+        int precision = jpeg[p] >> 4;
+        int id = jpeg[p] & 0x03;
+        if (p + 1 + (precision ? 128 : 64) > segEnd) return false;
+        decoder.dcQuant[id] = precision ? readU16(jpeg + p + 1) : jpeg[p + 1];
+        p += 1 + (precision ? 128 : 64);
+      }
+    } else if (marker == 0xC4) {
+      // Huffman-tabellen
+      size_t p = pos + 4;
+      while (p + 17 <= segEnd) {
+        int tableClass = jpeg[p] >> 4;
+        int id = jpeg[p] & 0x03;
+        const uint8_t* counts = jpeg + p + 1;
+        int total = 0;
+        for (int i = 0; i < 16; i++) total += counts[i];
+        if (total > 256 || p + 17 + total > segEnd) return false;
+        HuffmanTable& table = tableClass ? decoder.ac[id] : decoder.dc[id];
+        if (!buildHuffmanTable(table, counts, jpeg + p + 17, total, tableClass != 0)) return false;
+        p += 17 + total;
+      }
+    } else if (marker == 0xC0 || marker == 0xC1) {
+      // Baseline of extended sequentieel, 8 bits
+      if (seg[0] != 8) return false;
+      decoder.height = readU16(seg + 1);
+      decoder.width = readU16(seg + 3);
+      decoder.componentCount = seg[5];
+      if (decoder.componentCount < 1 || decoder.componentCount > 4 ||
+          decoder.width == 0 || decoder.height == 0) return false;
+      for (int i = 0; i < decoder.componentCount; i++) {
+        JpegComponent& component = decoder.components[i];
+        component.id = seg[6 + i * 3];
+        component.h = seg[7 + i * 3] >> 4;
+        component.v = seg[7 + i * 3] & 0x0F;
+        component.quantTable = seg[8 + i * 3] & 0x03;
+        component.predictor = 0;
+        if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4) return false;
+      }
+      frameSeen = true;
+    } else if ((marker >= 0xC2 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      return false;  // Progressief, lossless of rekenkundig
+    } else if (marker == 0xDD) {
+      decoder.restartInterval = readU16(seg);
+    } else if (marker == 0xDA) {
+      if (!frameSeen) return false;
+      int scanCount = seg[0];
+      if (scanCount < 1 || scanCount > decoder.componentCount) return false;
+      int scanComponents[4];
+      for (int i = 0; i < scanCount; i++) {
+        uint8_t id = seg[1 + i * 2];
+        int index = -1;
+        for (int c = 0; c < decoder.componentCount; c++) {
+          if (decoder.components[c].id == id) index = c;
+        }
+        if (index < 0) return false;
+        JpegComponent& component = decoder.components[index];
+        component.dcTable = (seg[2 + i * 2] >> 4) & 0x03;
+        component.acTable = seg[2 + i * 2] & 0x03;
+        if (!decoder.dc[component.dcTable].defined || !decoder.ac[component.acTable].defined) return false;
+        scanComponents[i] = index;
+      }
+      return decodeScan(decoder, jpeg, segEnd, len, scanComponents, scanCount);
+    } else if (marker == 0xD9) {
+      return false;
+    }
+    pos = segEnd;
+  }
+  return false;
+}
+
+// Bepaal histogram, gemiddelde en spreiding van de luminantie van een JPEG
+bool jpegLuminance(const uint8_t* jpeg, size_t len, LuminanceStats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  if (!jpeg || len == 0) return false;
+
+  LumaDecoder* decoder = (LumaDecoder*)calloc(1, sizeof(LumaDecoder));
+  if (!decoder) return false;
+
+  bool ok = parseAndDecode(*decoder, jpeg, len) && decoder->blocks > 0;
+  if (ok) {
+    uint32_t blocks = decoder->blocks;
+    for (int i = 0; i < LUMA_BINS; i++) {
+      stats.bins[i] = (uint16_t)(((uint64_t)decoder->histogram[i] * 1000 + blocks / 2) / blocks);
+    }
+    uint32_t mean = (uint32_t)(decoder->sum / blocks);
+    uint64_t variance = (decoder->sumSquares - decoder->sum * decoder->sum / blocks) / blocks;
+    stats.mean = (uint8_t)mean;
+    stats.stdDev = (uint8_t)min((int)sqrtf((float)variance), 255);
+    if (stats.mean < LUMA_DARK_MEAN) stats.flags |= LUMA_FLAG_DARK;
+    if (stats.mean > LUMA_BRIGHT_MEAN || stats.bins[LUMA_BINS - 1] >= LUMA_CLIPPED_PERMILLE) {
+      stats.flags |= LUMA_FLAG_OVEREXPOSED;
+    }
+    if (stats.stdDev < LUMA_BLOCKED_STDDEV) stats.flags |= LUMA_FLAG_BLOCKED;
+    stats.valid = 1;
+  }
+
+  free(decoder);
+  return ok;
+}
+
+// Gemiddelde luminantie per vak van een raster van LUMA_GRID_COLS x
+// LUMA_GRID_ROWS, onafhankelijk van de framegrootte
+bool jpegLuminanceGrid(const uint8_t* jpeg, size_t len, uint8_t* grid) {
+  memset(grid, 0, LUMA_GRID_CELLS);
+  if (!jpeg || len == 0) return false;
+
+  LumaDecoder* decoder = (LumaDecoder*)calloc(1, sizeof(LumaDecoder));
+  uint32_t* sums = (uint32_t*)calloc(LUMA_GRID_CELLS, sizeof(uint32_t));
+  uint16_t* counts = (uint16_t*)calloc(LUMA_GRID_CELLS, sizeof(uint16_t));
+  bool ok = false;
+  if (decoder && sums && counts) {
+    decoder->gridSum = sums;
+    decoder->gridCount = counts;
+    ok = parseAndDecode(*decoder, jpeg, len) && decoder->blocks > 0;
+    for (int i = 0; ok && i < LUMA_GRID_CELLS; i++) {
+      grid[i] = counts[i] ? (uint8_t)(sums[i] / counts[i]) : 0;
+    }
+  }
+
+  free(counts);
+  free(sums);
+  free(decoder);
+  return ok;
+}
+
+// Verschil tussen twee rasters: gemiddeld absoluut verschil per vak, nadat
+// het verschil in gemiddelde helderheid is afgetrokken. Een andere belichting
+// telt zo niet mee, een veranderde of verschoven plant wel.
+uint8_t luminanceGridDifference(const uint8_t* a, const uint8_t* b) {
+  int32_t sumA = 0, sumB = 0;
+  for (int i = 0; i < LUMA_GRID_CELLS; i++) {
+    sumA += a[i];
+    sumB += b[i];
+  }
+  int32_t offset = (sumA - sumB) / LUMA_GRID_CELLS;
+  uint32_t total = 0;
+  for (int i = 0; i < LUMA_GRID_CELLS; i++) {
+    int32_t diff = (int32_t)a[i] - b[i] - offset;
+    total += diff < 0 ? -diff : diff;
+  }
+  return (uint8_t)min(total / LUMA_GRID_CELLS, (uint32_t)255);
+}
+
+// Markeringen als JSON-array, bijv. ["dark","blocked"]
+String luminanceFlagsJson(uint8_t flags) {
+  String json = "[";
+  if (flags & LUMA_FLAG_DARK) json += "\"dark\"";
+  if (flags & LUMA_FLAG_OVEREXPOSED) json += String(json.length() > 1 ? "," : "") + "\"overexposed\"";
+  if (flags & LUMA_FLAG_BLOCKED) json += String(json.length() > 1 ? "," : "") + "\"blocked\"";
+  return json + "]";
+}
\ No newline at end of file
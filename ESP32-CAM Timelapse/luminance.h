@@ -0,0 +1,41 @@
+#ifndef LUMINANCE_H
+#define LUMINANCE_H
+
+#include "config.h"
+
+// Helderheid van een foto, bepaald uit de DC-coëfficiënten van de JPEG: elke
+// DC-waarde is de gemiddelde luminantie van een blok van 8x8 pixels. Er is
+// geen IDCT of kleurconversie nodig, alleen het doorlopen van de Huffman-data.
+#define LUMA_BINS            16     // Helderheidsbanden van 16 niveaus
+#define LUMA_DARK_MEAN       40     // Gemiddelde hieronder: te donker
+#define LUMA_BRIGHT_MEAN     215    // Gemiddelde hierboven: overbelicht
+#define LUMA_CLIPPED_PERMILLE 250   // Of zoveel promille in de hoogste band
+#define LUMA_BLOCKED_STDDEV  6      // Spreiding hieronder: lens afgedekt of egaal beeld
+
+// Grof raster van gemiddelde luminantie per vak, om frames van verschillende
+// grootte met elkaar te vergelijken (veranderingsdetectie)
+#define LUMA_GRID_COLS       16
+#define LUMA_GRID_ROWS       12
+#define LUMA_GRID_CELLS      (LUMA_GRID_COLS * LUMA_GRID_ROWS)
+
+// Markeringen voor afwijkende foto's
+#define LUMA_FLAG_DARK        0x01
+#define LUMA_FLAG_OVEREXPOSED 0x02
+#define LUMA_FLAG_BLOCKED     0x04
+
+// Histogram en samenvatting van één foto; ook het record op de SD-kaart
+struct LuminanceStats {
+  uint16_t bins[LUMA_BINS];  // Aandeel van de 8x8-blokken per band, in promille
+  uint8_t mean;              // Gemiddelde luminantie (0-255)
+  uint8_t stdDev;            // Standaardafwijking over de blokken
+  uint8_t flags;             // LUMA_FLAG_*
+  uint8_t valid;             // 0: niet bepaald (bijv. foto van oudere firmware)
+};
+
+// Functies voor de helderheidsanalyse
+bool jpegLuminance(const uint8_t* jpeg, size_t len, LuminanceStats& stats);
+bool jpegLuminanceGrid(const uint8_t* jpeg, size_t len, uint8_t* grid);
+uint8_t luminanceGridDifference(const uint8_t* a, const uint8_t* b);
+String luminanceFlagsJson(uint8_t flags);
+
+#endif // LUMINANCE_H
\ No newline at end of file
@@ -0,0 +1,811 @@
+#include "photo_index.h"
+#include "photo_store.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Foto-index. Elke dagmap krijgt een indexbestand met een vast record per
+// foto, en /timelapse/days.idx houdt per dag het aantal foto's bij. Naast de
+// dagindex staat photos.lum met het helderheidshistogram van elke foto, record
+// voor record in dezelfde volgorde. Alles wordt bij elke opgeslagen foto bijgewerkt, zodat de webpagina's geen
+// mappen hoeven te doorlopen. Kaarten van oudere firmware worden bij het
+// opstarten (of via /rebuildindex, op de achtergrond) eenmalig geïndexeerd;
+// foto's in segmenten komen dan uit de trailer van het segment.
+
+static SemaphoreHandle_t indexLock = NULL;
+
+static void lockIndex() {
+  if (indexLock) xSemaphoreTake(indexLock, portMAX_DELAY);
+}
+
+static void unlockIndex() {
+  if (indexLock) xSemaphoreGive(indexLock);
+}
+
+// Pad naar het indexbestand van een dagmap
+static String dayIndexPath(const String& dayName) {
+  return "/timelapse/" + dayName + "/" + DAY_INDEX_FILE;
+}
+
+// Pad naar het helderheidsbestand van een dagmap
+static String dayLuminancePath(const String& dayName) {
+  return "/timelapse/" + dayName + "/" + DAY_LUMA_FILE;
+}
+
+// Open een bestand om records toe te voegen of te overschrijven. Een half
+// geschreven laatste record (stroomuitval) wordt overschreven.
+static File openForUpdate(const String& path, size_t recordSize, int& count) {
+  File file = SD_MMC.exists(path) ? SD_MMC.open(path, "r+") : SD_MMC.open(path, FILE_WRITE);
+  count = file ? file.size() / recordSize : 0;
+  return file;
+}
+
+// Sorteersleutel YYYYMMDD van een dagmapnaam (DD-MM-YYYY)
+static uint32_t dayKey(const char* dayName) {
+  int day = 0, month = 0, year = 0;
+  if (sscanf(dayName, "%d-%d-%d", &day, &month, &year) != 3) return 0;
+  return (uint32_t)(year * 10000 + month * 100 + day);
+}
+
+// Opnametijd uit een bestandsnaam (DD-MM-YYYY_HH-MM-SS.jpg)
+static time_t timestampFromName(const char* fileName) {
+  struct tm timeinfo = {};
+  if (sscanf(fileName, "%d-%d-%d_%d-%d-%d", &timeinfo.tm_mday, &timeinfo.tm_mon, &timeinfo.tm_year,
+             &timeinfo.tm_hour, &timeinfo.tm_min, &timeinfo.tm_sec) != 6) {
+    return 0;
+  }
+  timeinfo.tm_mon -= 1;
+  timeinfo.tm_year -= 1900;
+  timeinfo.tm_isdst = -1;
+  return mktime(&timeinfo);
+}
+
+// Bestandsnaam van een foto uit de opnametijd (DD-MM-YYYY_HH-MM-SS.jpg). Een
+// tweede foto in dezelfde seconde krijgt _1, de volgende _2, enzovoort.
+void photoFileName(time_t timestamp, int duplicate, char* name, size_t size) {
+  struct tm timeinfo;
+  localtime_r(&timestamp, &timeinfo);
+  if (duplicate > 0) {
+    snprintf(name, size, "%02d-%02d-%04d_%02d-%02d-%02d_%d.jpg",
+             timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900,
+             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, duplicate);
+  } else {
+    snprintf(name, size, "%02d-%02d-%04d_%02d-%02d-%02d.jpg",
+             timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900,
+             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  }
+}
+
+// Laad de index bij het opstarten; bouw hem op als hij nog niet bestaat
+bool initPhotoIndex() {
+  if (!indexLock) {
+    indexLock = xSemaphoreCreateMutex();
+  }
+  if (!sdCardAvailable) return false;
+
+  if (!SD_MMC.exists(DAY_SUMMARY_FILE)) {
+    Serial.println("Geen foto-index gevonden, index wordt opgebouwd");
+    return rebuildPhotoIndex();
+  }
+  return true;
+}
+
+// Voeg een opgeslagen foto toe aan de dagindex en werk het dagoverzicht bij
+bool indexAddPhoto(const char* dayName, const char* fileName, time_t timestamp, uint32_t size, uint32_t offset,
+                   const LuminanceStats* luminance) {
+  if (!sdCardAvailable) return false;
+
+  PhotoIndexEntry entry = {};
+  strncpy(entry.name, fileName, sizeof(entry.name) - 1);
+  entry.timestamp = (uint32_t)timestamp;
+  entry.size = size;
+  entry.offset = offset;
+
+  lockIndex();
+
+  int count;
+  File dayIndex = openForUpdate(dayIndexPath(dayName), sizeof(PhotoIndexEntry), count);
+  if (!dayIndex) {
+    unlockIndex();
+    Serial.println("Dagindex openen mislukt");
+    return false;
+  }
+  int position = count;
+  dayIndex.seek(position * sizeof(PhotoIndexEntry));
+  bool ok = dayIndex.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+  dayIndex.close();
+
+  // Helderheid op dezelfde positie; ontbrekende records (foto's zonder
+  // analyse) worden met lege records aangevuld
+  if (ok && luminance) {
+    int lumaCount;
+    File lumaFile = openForUpdate(dayLuminancePath(dayName), sizeof(LuminanceStats), lumaCount);
+    if (lumaFile) {
+      LuminanceStats empty = {};
+      lumaFile.seek(lumaCount * sizeof(LuminanceStats));
+      for (int i = lumaCount; i < position; i++) {
+        lumaFile.write((const uint8_t*)&empty, sizeof(empty));
+      }
+      lumaFile.seek(position * sizeof(LuminanceStats));
+      lumaFile.write((const uint8_t*)luminance, sizeof(LuminanceStats));
+      lumaFile.close();
+    }
+  }
+
+  // Dagoverzicht: de dag staat bijna altijd achteraan
+  File summaries = openForUpdate(DAY_SUMMARY_FILE, sizeof(DayIndexSummary), count);
+  if (summaries) {
+    DayIndexSummary summary;
+    int found = -1;
+    for (int i = count - 1; i >= 0 && found < 0; i--) {
+      summaries.seek(i * sizeof(DayIndexSummary));
+      if (summaries.read((uint8_t*)&summary, sizeof(summary)) == sizeof(summary) &&
+          strncmp(summary.name, dayName, sizeof(summary.name)) == 0) {
+        found = i;
+      }
+    }
+
+    if (found < 0) {
+      memset(&summary, 0, sizeof(summary));
+      strncpy(summary.name, dayName, sizeof(summary.name) - 1);
+      summary.firstTimestamp = entry.timestamp;
+      found = count;
+    }
+    summary.photoCount++;
+    summary.totalBytes += size;
+    summary.lastTimestamp = entry.timestamp;
+
+    summaries.seek(found * sizeof(DayIndexSummary));
+    ok = summaries.write((const uint8_t*)&summary, sizeof(summary)) == sizeof(summary) && ok;
+    summaries.close();
+  } else {
+    ok = false;
+  }
+
+  unlockIndex();
+
+  if (!ok) {
+    Serial.println("Foto-index bijwerken mislukt");
+  }
+  return ok;
+}
+
+// Bewaarde helderheid van een foto uit de oude index, op bestandsnaam
+struct SavedLuminance {
+  char name[32];
+  LuminanceStats stats;
+};
+
+// Lees de helderheid uit de oude index voordat die wordt vervangen; de
+// foto's zelf opnieuw analyseren zou de hele dag van de kaart lezen
+static SavedLuminance* loadSavedLuminance(const String& dayName, int& count) {
+  count = 0;
+  int photoCount = 0, lumaCount = 0;
+  File dayIndex = openDayIndex(dayName, photoCount);
+  File lumaFile = openDayLuminance(dayName, lumaCount);
+  int n = min(photoCount, lumaCount);
+  SavedLuminance* saved = NULL;
+  if (n > 0) {
+    saved = psramFound() ? (SavedLuminance*)ps_malloc(n * sizeof(SavedLuminance))
+                         : (SavedLuminance*)malloc(n * sizeof(SavedLuminance));
+  }
+  if (saved) {
+    PhotoIndexEntry entry;
+    for (int i = 0; i < n; i++) {
+      if (!readDayIndexEntry(dayIndex, i, entry)) break;
+      if (!readDayLuminance(lumaFile, i, saved[count].stats)) continue;
+      memcpy(saved[count].name, entry.name, sizeof(entry.name));
+      count++;
+    }
+  }
+  if (dayIndex) dayIndex.close();
+  if (lumaFile) lumaFile.close();
+  return saved;
+}
+
+// Herbouwen in stappen. Per dagmap wordt een nieuwe index naast de oude
+// geschreven (photos.idx.new) terwijl de map wordt doorlopen, zonder het
+// indexslot. Alleen het afronden van een dag gebeurt onder het slot: foto's
+// die intussen zijn opgeslagen overnemen, de bestanden vervangen en het
+// dagoverzicht bijwerken. De SD-schrijver wacht dus hooguit op het afronden
+// van één dag, niet op de hele kaart.
+#define REBUILD_SUFFIX ".new"
+
+struct RebuildState {
+  File root;                 // /timelapse, open tussen de stappen
+  File dir;                  // Dagmap die nu wordt doorlopen
+  String day;
+  File dayIndex;             // Nieuwe dagindex (w+: lezen bij het afronden)
+  File lumaFile;             // Nieuwe helderheid: als er oude was of er een bijkwam
+  SavedLuminance* saved;
+  int savedCount;
+  int liveCount;             // Records in de oude dagindex bij het begin van de dag
+  uint32_t segmentTime;      // Opnametijd van het vorige segmentrecord
+  int duplicates;            // Eerdere segmentfoto's in die seconde
+  DayIndexSummary summary;
+};
+
+static RebuildState rebuild;
+static portMUX_TYPE rebuildMux = portMUX_INITIALIZER_UNLOCKED;
+static IndexRebuildProgress progress = {};
+
+// Schrijf een foto naar de nieuwe dagindex, met de bewaarde helderheid (of
+// 'luminance'), en tel hem mee in de samenvatting
+static void addRebuiltPhoto(const PhotoIndexEntry& entry, const LuminanceStats* luminance = NULL) {
+  rebuild.dayIndex.write((const uint8_t*)&entry, sizeof(entry));
+
+  if (rebuild.lumaFile) {
+    LuminanceStats stats = {};
+    if (luminance) {
+      stats = *luminance;
+    } else {
+      for (int i = 0; i < rebuild.savedCount; i++) {
+        if (strcmp(rebuild.saved[i].name, entry.name) == 0) {
+          stats = rebuild.saved[i].stats;
+          break;
+        }
+      }
+    }
+    rebuild.lumaFile.write((const uint8_t*)&stats, sizeof(stats));
+  }
+
+  DayIndexSummary& summary = rebuild.summary;
+  if (summary.photoCount == 0 || entry.timestamp < summary.firstTimestamp) {
+    summary.firstTimestamp = entry.timestamp;
+  }
+  if (entry.timestamp > summary.lastTimestamp) {
+    summary.lastTimestamp = entry.timestamp;
+  }
+  summary.photoCount++;
+  summary.totalBytes += entry.size;
+}
+
+// Begin aan een dagmap: bewaarde helderheid en de lengte van de oude index
+// onder het slot vastleggen, dan de nieuwe bestanden aanmaken
+static bool beginRebuildDay(const String& dayName) {
+  rebuild.day = dayName;
+  memset(&rebuild.summary, 0, sizeof(rebuild.summary));
+  rebuild.segmentTime = 0;
+  rebuild.duplicates = 0;
+  strncpy(rebuild.summary.name, dayName.c_str(), sizeof(rebuild.summary.name) - 1);
+
+  lockIndex();
+  rebuild.saved = loadSavedLuminance(dayName, rebuild.savedCount);
+  File live = openDayIndex(dayName, rebuild.liveCount);
+  if (live) live.close();
+  unlockIndex();
+
+  String indexPath = dayIndexPath(dayName) + REBUILD_SUFFIX;
+  String lumaPath = dayLuminancePath(dayName) + REBUILD_SUFFIX;
+  rebuild.dir = SD_MMC.open("/timelapse/" + dayName);
+  rebuild.dayIndex = SD_MMC.open(indexPath, "w+");
+  rebuild.lumaFile = rebuild.savedCount > 0 ? SD_MMC.open(lumaPath, FILE_WRITE) : File();
+  if (!rebuild.dir || !rebuild.dayIndex) {
+    if (rebuild.dir) rebuild.dir.close();
+    if (rebuild.dayIndex) rebuild.dayIndex.close();
+    if (rebuild.lumaFile) rebuild.lumaFile.close();
+    rebuild.dir = File();
+    free(rebuild.saved);
+    rebuild.saved = NULL;
+    return false;
+  }
+  return true;
+}
+
+// Verwerk het volgende bestand van de dagmap; false als de map doorlopen is
+static bool rebuildDayStep() {
+  File file = rebuild.dir.openNextFile();
+  if (!file) return false;
+
+  String fileName = String(file.name()).substring(String(file.name()).lastIndexOf('/') + 1);
+  int segment;
+  if (!file.isDirectory() && fileName.endsWith(".jpg")) {
+    PhotoIndexEntry entry = {};
+    strncpy(entry.name, fileName.c_str(), sizeof(entry.name) - 1);
+    time_t timestamp = timestampFromName(entry.name);
+    entry.timestamp = (uint32_t)(timestamp ? timestamp : file.getLastWrite());
+    entry.size = file.size();
+    entry.offset = 0;
+    addRebuiltPhoto(entry);
+  } else if (!file.isDirectory() && segmentFileNumber(fileName, segment)) {
+    // Foto's in een segment staan in de trailer
+    SegmentHeader header;
+    SegmentRecord record;
+    if (readSegmentHeader(file, header)) {
+      for (int i = 0; readSegmentRecord(file, header, i, record); i++) {
+        // Zelfde naamgeving als bij het opslaan: de records staan op volgorde
+        PhotoIndexEntry entry = {};
+        rebuild.duplicates = record.timestamp == rebuild.segmentTime ? rebuild.duplicates + 1 : 0;
+        rebuild.segmentTime = record.timestamp;
+        photoFileName(record.timestamp, rebuild.duplicates, entry.name, sizeof(entry.name));
+        entry.timestamp = record.timestamp;
+        entry.size = record.size;
+        entry.offset = (uint32_t)segment * SEGMENT_SIZE + record.position;
+        addRebuiltPhoto(entry);
+      }
+    }
+  }
+  file.close();
+  return true;
+}
+
+// Staat een foto al in de nieuwe dagindex?
+static bool rebuiltIndexContains(const char* name) {
+  PhotoIndexEntry entry;
+  rebuild.dayIndex.seek(0);
+  while (rebuild.dayIndex.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry)) {
+    if (strncmp(entry.name, name, sizeof(entry.name)) == 0) return true;
+  }
+  return false;
+}
+
+// Maak de nieuwe helderheid alsnog aan (de dag had er bij het begin geen),
+// met lege records voor de foto's die al in de nieuwe index staan
+static void openRebuiltLuminance() {
+  rebuild.lumaFile = SD_MMC.open(dayLuminancePath(rebuild.day) + REBUILD_SUFFIX, FILE_WRITE);
+  if (!rebuild.lumaFile) return;
+  LuminanceStats empty = {};
+  int written = rebuild.dayIndex.size() / sizeof(PhotoIndexEntry);
+  for (int i = 0; i < written; i++) {
+    rebuild.lumaFile.write((const uint8_t*)&empty, sizeof(empty));
+  }
+}
+
+// Foto's die tijdens het doorlopen aan de oude dagindex zijn toegevoegd en
+// nog niet in de nieuwe staan alsnog overnemen, met hun helderheid;
+// aanroepen onder het slot
+static void appendNewPhotos() {
+  int count = 0, lumaCount = 0;
+  File live = openDayIndex(rebuild.day, count);
+  if (!live) return;
+  File liveLuma = count > rebuild.liveCount ? openDayLuminance(rebuild.day, lumaCount) : File();
+
+  for (int i = rebuild.liveCount; i < count; i++) {
+    PhotoIndexEntry entry;
+    if (!readDayIndexEntry(live, i, entry) || rebuiltIndexContains(entry.name)) continue;
+    LuminanceStats stats;
+    bool hasLuma = i < lumaCount && readDayLuminance(liveLuma, i, stats);
+    rebuild.dayIndex.seek(rebuild.dayIndex.size());
+    if (hasLuma && !rebuild.lumaFile) openRebuiltLuminance();
+    addRebuiltPhoto(entry, hasLuma ? &stats : NULL);
+  }
+  live.close();
+  if (liveLuma) liveLuma.close();
+}
+
+// Zet de samenvatting van een dag in het dagoverzicht, op chronologische
+// plaats; aanroepen onder het slot
+static bool setDaySummary(const DayIndexSummary& summary) {
+  int count = 0;
+  File summaries = openDaySummaries(count);
+  DayIndexSummary* days = (DayIndexSummary*)malloc((count + 1) * sizeof(DayIndexSummary));
+  int total = 0;
+  bool placed = false;
+  uint32_t key = dayKey(summary.name);
+  for (int i = 0; i < count && days; i++) {
+    DayIndexSummary day;
+    if (!readDaySummary(summaries, i, day)) break;
+    if (strncmp(day.name, summary.name, sizeof(day.name)) == 0) continue;
+    if (!placed && dayKey(day.name) > key) {
+      days[total++] = summary;
+      placed = true;
+    }
+    days[total++] = day;
+  }
+  if (summaries) summaries.close();
+  if (!days) return false;
+  if (!placed) days[total++] = summary;
+
+  summaries = SD_MMC.open(DAY_SUMMARY_FILE, FILE_WRITE);
+  size_t length = total * sizeof(DayIndexSummary);
+  bool ok = summaries && summaries.write((const uint8_t*)days, length) == length;
+  if (summaries) summaries.close();
+  free(days);
+  return ok;
+}
+
+// Rond een dagmap af: nieuwe bestanden op de plaats van de oude
+static void finishRebuildDay() {
+  rebuild.dir.close();
+  rebuild.dir = File();
+  String indexPath = dayIndexPath(rebuild.day);
+  String lumaPath = dayLuminancePath(rebuild.day);
+  bool ok = true;
+
+  lockIndex();
+  // Dag intussen verwijderd (map naar /trash): niets vervangen
+  bool exists = SD_MMC.exists("/timelapse/" + rebuild.day);
+  if (exists) appendNewPhotos();
+  rebuild.dayIndex.close();
+  bool hasLuma = (bool)rebuild.lumaFile;
+  if (rebuild.lumaFile) rebuild.lumaFile.close();
+  if (exists) {
+    SD_MMC.remove(indexPath);
+    ok = SD_MMC.rename(indexPath + REBUILD_SUFFIX, indexPath);
+    SD_MMC.remove(lumaPath);
+    if (hasLuma) SD_MMC.rename(lumaPath + REBUILD_SUFFIX, lumaPath);
+    ok = ok && setDaySummary(rebuild.summary);
+  }
+  unlockIndex();
+
+  free(rebuild.saved);
+  rebuild.saved = NULL;
+  portENTER_CRITICAL(&rebuildMux);
+  progress.daysDone++;
+  if (exists) progress.photos += rebuild.summary.photoCount;
+  if (!ok) progress.ok = false;
+  portEXIT_CRITICAL(&rebuildMux);
+}
+
+// Haal dagen zonder map uit het dagoverzicht (na het herbouwen)
+static void dropMissingDays() {
+  lockIndex();
+  int count = 0;
+  File summaries = openDaySummaries(count);
+  DayIndexSummary* days = count > 0 ? (DayIndexSummary*)malloc(count * sizeof(DayIndexSummary)) : NULL;
+  int remaining = 0;
+  for (int i = 0; i < count && days; i++) {
+    if (!readDaySummary(summaries, i, days[remaining])) break;
+    if (SD_MMC.exists("/timelapse/" + String(days[remaining].name))) remaining++;
+  }
+  if (summaries) summaries.close();
+  if (days && remaining < count) {
+    summaries = SD_MMC.open(DAY_SUMMARY_FILE, FILE_WRITE);
+    size_t length = remaining * sizeof(DayIndexSummary);
+    if (summaries) {
+      if (length > 0) summaries.write((const uint8_t*)days, length);
+      summaries.close();
+    }
+  }
+  free(days);
+  unlockIndex();
+}
+
+// Start het herbouwen van de index; daarna indexRebuildSlice() tot die false geeft
+bool indexRebuildStart() {
+  if (!sdCardAvailable) return false;
+  portENTER_CRITICAL(&rebuildMux);
+  bool busy = progress.active;
+  portEXIT_CRITICAL(&rebuildMux);
+  if (busy) return false;
+
+  // Eerst tellen hoeveel dagmappen er zijn, voor de voortgang
+  File root = SD_MMC.open("/timelapse");
+  if (!root || !root.isDirectory()) {
+    if (root) root.close();
+    return false;
+  }
+  uint32_t folderCount = 0;
+  File entry = root.openNextFile();
+  while (entry) {
+    if (entry.isDirectory()) folderCount++;
+    entry.close();
+    entry = root.openNextFile();
+  }
+  root.close();
+
+  rebuild.root = SD_MMC.open("/timelapse");
+  if (!rebuild.root) return false;
+  rebuild.dir = File();
+
+  portENTER_CRITICAL(&rebuildMux);
+  progress = IndexRebuildProgress();
+  progress.active = true;
+  progress.ok = true;
+  progress.daysTotal = folderCount;
+  progress.startMs = millis();
+  portEXIT_CRITICAL(&rebuildMux);
+  return true;
+}
+
+// Herbouw tot de deadline; true als er nog werk is
+bool indexRebuildSlice(unsigned long deadline) {
+  if (!progress.active) return false;
+
+  while ((long)(millis() - deadline) < 0) {
+    if (rebuild.dir) {
+      if (!rebuildDayStep()) finishRebuildDay();
+      continue;
+    }
+
+    // Volgende dagmap
+    File entry = rebuild.root.openNextFile();
+    if (!entry) {
+      rebuild.root.close();
+      rebuild.root = File();
+      dropMissingDays();
+      portENTER_CRITICAL(&rebuildMux);
+      progress.active = false;
+      progress.elapsedMs = millis() - progress.startMs;
+      IndexRebuildProgress done = progress;
+      portEXIT_CRITICAL(&rebuildMux);
+      Serial.printf("Foto-index opgebouwd: %u dagen, %u foto's in %u ms\n", done.daysDone, done.photos, done.elapsedMs);
+      return false;
+    }
+    bool isDay = entry.isDirectory();
+    String dirName = String(entry.name()).substring(String(entry.name()).lastIndexOf('/') + 1);
+    entry.close();
+    if (isDay && !beginRebuildDay(dirName)) {
+      portENTER_CRITICAL(&rebuildMux);
+      progress.daysDone++;
+      progress.ok = false;
+      portEXIT_CRITICAL(&rebuildMux);
+    }
+  }
+  return true;
+}
+
+// Voortgang van het (laatste) herbouwen
+IndexRebuildProgress getIndexRebuildProgress() {
+  portENTER_CRITICAL(&rebuildMux);
+  IndexRebuildProgress copy = progress;
+  portEXIT_CRITICAL(&rebuildMux);
+  if (copy.active) copy.elapsedMs = millis() - copy.startMs;
+  return copy;
+}
+
+// Bouw de volledige index in één keer opnieuw op uit de mappen op de
+// SD-kaart (bij het opstarten, voordat er foto's worden opgeslagen)
+bool rebuildPhotoIndex(uint32_t* dayCount, uint32_t* photoCount) {
+  if (!indexRebuildStart()) return false;
+  while (indexRebuildSlice(millis() + 1000)) {
+  }
+  IndexRebuildProgress result = getIndexRebuildProgress();
+  if (dayCount) *dayCount = result.daysDone;
+  if (photoCount) *photoCount = result.photos;
+  return result.ok;
+}
+
+// Lege index na het wissen van de SD-kaart
+void resetPhotoIndex() {
+  if (!sdCardAvailable) return;
+
+  lockIndex();
+  File summaries = SD_MMC.open(DAY_SUMMARY_FILE, FILE_WRITE);
+  if (summaries) summaries.close();
+  unlockIndex();
+}
+
+// Haal een dag uit het dagoverzicht (voordat de map wordt verwijderd)
+bool indexRemoveDay(const String& dayName) {
+  if (!sdCardAvailable) return false;
+
+  lockIndex();
+  int count = 0;
+  File summaries = openDaySummaries(count);
+  DayIndexSummary* days = count > 0 ? (DayIndexSummary*)malloc(count * sizeof(DayIndexSummary)) : NULL;
+  int remaining = 0;
+  bool found = false;
+  for (int i = 0; i < count && days; i++) {
+    if (!readDaySummary(summaries, i, days[remaining])) break;
+    if (!found && dayName == days[remaining].name) {
+      found = true;
+    } else {
+      remaining++;
+    }
+  }
+  if (summaries) summaries.close();
+
+  bool ok = false;
+  if (found) {
+    summaries = SD_MMC.open(DAY_SUMMARY_FILE, FILE_WRITE);
+    if (summaries) {
+      size_t length = remaining * sizeof(DayIndexSummary);
+      ok = length == 0 || summaries.write((const uint8_t*)days, length) == length;
+      summaries.close();
+    }
+  }
+  free(days);
+  unlockIndex();
+  return ok;
+}
+
+// Schrijf de dagindex, het helderheidsbestand en de samenvatting van een dag
+// opnieuw met alleen de foto's waarvoor keep() true geeft
+typedef bool (*KeepEntry)(int index, const PhotoIndexEntry& entry, const void* context);
+
+static bool rewriteDay(const String& dayName, KeepEntry keep, const void* context,
+                       uint32_t& kept, uint32_t& dropped) {
+  kept = 0;
+  dropped = 0;
+  lockIndex();
+  int count = 0, lumaCount = 0;
+  File dayIndex = openDayIndex(dayName, count);
+  File lumaFile = openDayLuminance(dayName, lumaCount);
+  PhotoIndexEntry* entries = NULL;
+  LuminanceStats* luma = NULL;
+  if (count > 0) {
+    entries = psramFound() ? (PhotoIndexEntry*)ps_malloc(count * sizeof(PhotoIndexEntry))
+                           : (PhotoIndexEntry*)malloc(count * sizeof(PhotoIndexEntry));
+    luma = psramFound() ? (LuminanceStats*)ps_malloc(count * sizeof(LuminanceStats))
+                        : (LuminanceStats*)malloc(count * sizeof(LuminanceStats));
+  }
+  bool ok = entries && luma;
+  for (int i = 0; i < count && ok; i++) {
+    ok = readDayIndexEntry(dayIndex, i, entries[i]);
+    if (i >= lumaCount || !readDayLuminance(lumaFile, i, luma[i])) {
+      memset(&luma[i], 0, sizeof(LuminanceStats));
+    }
+  }
+  if (dayIndex) dayIndex.close();
+  if (lumaFile) lumaFile.close();
+
+  DayIndexSummary summary = {};
+  strncpy(summary.name, dayName.c_str(), sizeof(summary.name) - 1);
+  for (int i = 0; i < count && ok; i++) {
+    if (!keep(i, entries[i], context)) {
+      dropped++;
+      continue;
+    }
+    entries[kept] = entries[i];
+    luma[kept] = luma[i];
+    if (kept == 0 || entries[kept].timestamp < summary.firstTimestamp) {
+      summary.firstTimestamp = entries[kept].timestamp;
+    }
+    if (entries[kept].timestamp > summary.lastTimestamp) {
+      summary.lastTimestamp = entries[kept].timestamp;
+    }
+    summary.photoCount++;
+    summary.totalBytes += entries[kept].size;
+    kept++;
+  }
+
+  if (ok && dropped > 0) {
+    dayIndex = SD_MMC.open(dayIndexPath(dayName), FILE_WRITE);
+    ok = dayIndex && dayIndex.write((const uint8_t*)entries, kept * sizeof(PhotoIndexEntry)) ==
+                     kept * sizeof(PhotoIndexEntry);
+    if (dayIndex) dayIndex.close();
+    if (ok && lumaCount > 0) {
+      lumaFile = SD_MMC.open(dayLuminancePath(dayName), FILE_WRITE);
+      if (lumaFile) {
+        lumaFile.write((const uint8_t*)luma, kept * sizeof(LuminanceStats));
+        lumaFile.close();
+      }
+    }
+
+    // Samenvatting van de dag op dezelfde plaats bijwerken
+    int dayCount;
+    File summaries = openForUpdate(DAY_SUMMARY_FILE, sizeof(DayIndexSummary), dayCount);
+    DayIndexSummary current;
+    for (int i = 0; i < dayCount && summaries && ok; i++) {
+      if (readDaySummary(summaries, i, current) && dayName == current.name) {
+        summaries.seek(i * sizeof(DayIndexSummary));
+        ok = summaries.write((const uint8_t*)&summary, sizeof(summary)) == sizeof(summary);
+        break;
+      }
+    }
+    if (summaries) summaries.close();
+  }
+  free(entries);
+  free(luma);
+  unlockIndex();
+  return ok;
+}
+
+// Dun een dag uit tot elke 'keepEvery'-de foto. Foto's in een segment
+// blijven staan: een segment wordt niet kleiner. Alleen de dagindex, het
+// helderheidsbestand en het dagoverzicht veranderen; de bestanden van de
+// weggelaten foto's worden daarna door het bewaarbeleid verwijderd.
+static bool keepThinned(int index, const PhotoIndexEntry& entry, const void* context) {
+  return index % *(const int*)context == 0 || entry.offset != 0;
+}
+
+bool indexThinDay(const String& dayName, int keepEvery, uint32_t& kept, uint32_t& dropped) {
+  kept = 0;
+  dropped = 0;
+  if (!sdCardAvailable || keepEvery < 2) return false;
+  return rewriteDay(dayName, keepThinned, &keepEvery, kept, dropped);
+}
+
+// Haal één foto uit de index van een dag (onbruikbaar bestand na herstel)
+static bool keepOthers(int, const PhotoIndexEntry& entry, const void* context) {
+  return strncmp(entry.name, (const char*)context, sizeof(entry.name)) != 0;
+}
+
+bool indexRemovePhoto(const String& dayName, const String& fileName) {
+  if (!sdCardAvailable) return false;
+  uint32_t kept, dropped;
+  return rewriteDay(dayName, keepOthers, fileName.c_str(), kept, dropped) && dropped > 0;
+}
+
+// Open het dagoverzicht; count geeft het aantal dagen
+File openDaySummaries(int& count) {
+  File file = SD_MMC.open(DAY_SUMMARY_FILE, FILE_READ);
+  count = file ? file.size() / sizeof(DayIndexSummary) : 0;
+  return file;
+}
+
+// Lees de samenvatting van dag 'index' (0 = oudste)
+bool readDaySummary(File& file, int index, DayIndexSummary& summary) {
+  if (!file.seek(index * sizeof(DayIndexSummary))) return false;
+  if (file.read((uint8_t*)&summary, sizeof(summary)) != sizeof(summary)) return false;
+  summary.name[sizeof(summary.name) - 1] = '\0';
+  return true;
+}
+
+// Open de index van een dagmap; count geeft het aantal foto's
+File openDayIndex(const String& dayName, int& count) {
+  String path = dayIndexPath(dayName);
+  File file = SD_MMC.exists(path) ? SD_MMC.open(path, FILE_READ) : File();
+  count = file ? file.size() / sizeof(PhotoIndexEntry) : 0;
+  return file;
+}
+
+// Lees foto 'index' (0 = eerste van de dag) uit een dagindex
+bool readDayIndexEntry(File& file, int index, PhotoIndexEntry& entry) {
+  size_t position = index * sizeof(PhotoIndexEntry);
+  if (file.position() != position && !file.seek(position)) return false;
+  if (file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) return false;
+  entry.name[sizeof(entry.name) - 1] = '\0';
+  return true;
+}
+
+// Eerste record met opnametijd 'timestamp' of later (binair zoeken)
+static int firstAtTime(File& file, int count, uint32_t timestamp) {
+  PhotoIndexEntry entry;
+  int low = 0, high = count;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (!readDayIndexEntry(file, middle, entry)) break;
+    if (entry.timestamp < timestamp) low = middle + 1;
+    else high = middle;
+  }
+  return low;
+}
+
+// Staat er al een foto met deze naam in de dagindex? Alleen de records met
+// dezelfde opnametijd worden bekeken, dus goedkoop genoeg voor elke opslag.
+bool indexPhotoNameTaken(const char* dayName, const char* fileName) {
+  int count = 0;
+  File file = openDayIndex(dayName, count);
+  if (!file) return false;
+
+  uint32_t timestamp = (uint32_t)timestampFromName(fileName);
+  PhotoIndexEntry entry;
+  bool taken = false;
+  for (int i = firstAtTime(file, count, timestamp); i < count && !taken; i++) {
+    if (!readDayIndexEntry(file, i, entry) || entry.timestamp != timestamp) break;
+    taken = strncmp(entry.name, fileName, sizeof(entry.name)) == 0;
+  }
+  file.close();
+  return taken;
+}
+
+// Zoek een foto op bestandsnaam in de dagindex. De foto's staan op volgorde
+// van opname, dus eerst binair zoeken op de tijd uit de naam; staat hij daar
+// niet (index met een andere volgorde), dan de hele index doorlopen.
+bool indexFindPhoto(const String& dayName, const String& fileName, PhotoIndexEntry& entry) {
+  int count = 0;
+  File file = openDayIndex(dayName, count);
+  if (!file) return false;
+
+  uint32_t timestamp = (uint32_t)timestampFromName(fileName.c_str());
+  bool found = false;
+  for (int i = firstAtTime(file, count, timestamp); i < count && !found; i++) {
+    if (!readDayIndexEntry(file, i, entry) || entry.timestamp != timestamp) break;
+    found = fileName == entry.name;
+  }
+  for (int i = 0; i < count && !found; i++) {
+    found = readDayIndexEntry(file, i, entry) && fileName == entry.name;
+  }
+  file.close();
+  return found;
+}
+
+// Open het helderheidsbestand van een dagmap; count geeft het aantal records
+File openDayLuminance(const String& dayName, int& count) {
+  String path = dayLuminancePath(dayName);
+  File file = SD_MMC.exists(path) ? SD_MMC.open(path, FILE_READ) : File();
+  count = file ? file.size() / sizeof(LuminanceStats) : 0;
+  return file;
+}
+
+// Lees de helderheid van foto 'index'; false als die niet is bepaald
+bool readDayLuminance(File& file, int index, LuminanceStats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  if (!file) return false;
+  size_t position = index * sizeof(LuminanceStats);
+  if (position + sizeof(stats) > file.size()) return false;
+  if (file.position() != position && !file.seek(position)) return false;
+  if (file.read((uint8_t*)&stats, sizeof(stats)) != sizeof(stats)) return false;
+  return stats.valid != 0;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef PHOTO_INDEX_H
+#define PHOTO_INDEX_H
+
+#include "config.h"
+#include "luminance.h"
+
+// Indexbestanden op de SD-kaart
+#define DAY_INDEX_FILE     "photos.idx"              // Per dagmap
+#define DAY_SUMMARY_FILE   "/timelapse/days.idx"     // Overzicht van alle dagen
+#define DAY_LUMA_FILE      "photos.lum"              // Per dagmap: LuminanceStats per foto, zelfde volgorde
+#define PHOTO_MAX_DUPLICATES 99                      // Foto's in dezelfde seconde: naam_1 t/m naam_99
+
+// Eén foto in de index van een dagmap (vaste grootte, alleen toevoegen)
+struct PhotoIndexEntry {
+  char name[32];             // Bestandsnaam binnen de dagmap
+  uint32_t timestamp;        // Opnametijd (epoch)
+  uint32_t size;             // Grootte van de foto in bytes
+  uint32_t offset;           // Positie in de segmenten van de dag (0 = los bestand, zie photo_store)
+};
+
+// Samenvatting van één dag in het overzichtsbestand, in chronologische volgorde
+struct DayIndexSummary {
+  char name[16];             // Naam van de dagmap (DD-MM-YYYY)
+  uint32_t photoCount;
+  uint32_t totalBytes;
+  uint32_t firstTimestamp;
+  uint32_t lastTimestamp;
+};
+
+// Voortgang van het herbouwen van de index
+struct IndexRebuildProgress {
+  bool active;
+  bool ok;                   // Alle dagen zonder fouten herbouwd
+  uint32_t daysTotal;        // Dagmappen bij de start
+  uint32_t daysDone;
+  uint32_t photos;
+  uint32_t startMs;
+  uint32_t elapsedMs;
+};
+
+// Functies voor de foto-index
+bool initPhotoIndex();
+bool indexAddPhoto(const char* dayName, const char* fileName, time_t timestamp, uint32_t size, uint32_t offset = 0,
+                   const LuminanceStats* luminance = NULL);
+bool rebuildPhotoIndex(uint32_t* dayCount = NULL, uint32_t* photoCount = NULL);
+bool indexRebuildStart();
+bool indexRebuildSlice(unsigned long deadline);
+IndexRebuildProgress getIndexRebuildProgress();
+void resetPhotoIndex();
+bool indexRemoveDay(const String& dayName);
+bool indexThinDay(const String& dayName, int keepEvery, uint32_t& kept, uint32_t& dropped);
+bool indexRemovePhoto(const String& dayName, const String& fileName);
+
+// Lezen van de index; de aanroeper sluit het bestand
+File openDaySummaries(int& count);
+bool readDaySummary(File& file, int index, DayIndexSummary& summary);
+File openDayIndex(const String& dayName, int& count);
+bool readDayIndexEntry(File& file, int index, PhotoIndexEntry& entry);
+bool indexFindPhoto(const String& dayName, const String& fileName, PhotoIndexEntry& entry);
+bool indexPhotoNameTaken(const char* dayName, const char* fileName);
+void photoFileName(time_t timestamp, int duplicate, char* name, size_t size);
+File openDayLuminance(const String& dayName, int& count);
+bool readDayLuminance(File& file, int index, LuminanceStats& stats);
+
+#endif // PHOTO_INDEX_H
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "photo_journal.h"
+#include "photo_index.h"
+#include "card_usage.h"
+#include "thumbnails.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+
+// Herstel na stroomuitval. Een losse foto wordt als <naam>.tmp geschreven en
+// pas na het sluiten (f_close schrijft de FAT en de mapregel weg, zoals
+// fsync) hernoemd; een onderbroken opslag laat dus alleen een tijdelijk
+// bestand achter. Daarna volgt de index. Bij het opstarten loopt
+// recoverPhotoJournal() de records van nieuw naar oud af:
+//  - tijdelijk bestand aanwezig: opslag onderbroken, bestand verwijderen
+//  - foto zonder SOI aan het begin of EOI aan het eind: verwijderen en uit
+//    de index halen, zodat de galerij hem niet meer toont
+//  - geldige foto die niet in de index staat (stroom weg tussen hernoemen en
+//    index): alsnog toevoegen, zonder helderheidshistogram
+// Hooguit JOURNAL_ENTRIES foto's en JOURNAL_MAX_MS, ook op een volle kaart.
+// Foto's in segmenten komen niet in het journaal: ze staan niet als los
+// bestand in de dagmap en hun trailerrecord komt pas na de foto (zie
+// photo_store). Een extra open/schrijf/sluit per foto zou de winst van de
+// segmenten tenietdoen.
+
+static portMUX_TYPE journalMux = portMUX_INITIALIZER_UNLOCKED;
+static JournalStats stats = {};
+static uint32_t nextSequence = 1;
+
+static uint32_t recordCheck(const JournalRecord& record) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(JournalRecord, check));
+}
+
+// Controleer een JPEG-bestand op SOI (FFD8) aan het begin en EOI (FFD9) in
+// de laatste bytes; de positie blijft daarna ongedefinieerd
+bool jpegFileValid(File& file) {
+  uint32_t size = file.size();
+  if (size < 4) return false;
+
+  uint8_t head[2];
+  if (!file.seek(0) || file.read(head, 2) != 2 || head[0] != 0xFF || head[1] != 0xD8) return false;
+
+  uint8_t tail[JOURNAL_TAIL_BYTES];
+  uint32_t length = min(size, (uint32_t)JOURNAL_TAIL_BYTES);
+  if (!file.seek(size - length) || file.read(tail, length) != length) return false;
+  for (int i = length - 2; i >= 0; i--) {
+    if (tail[i] == 0xFF && tail[i + 1] == 0xD9) return true;
+  }
+  return false;
+}
+
+// Controleer de foto van één record
+static void recoverRecord(const JournalRecord& record) {
+  String path = "/timelapse/" + String(record.day) + "/" + record.name;
+  String tempPath = path + JOURNAL_TEMP_SUFFIX;
+  stats.checked++;
+
+  if (SD_MMC.exists(tempPath)) {
+    File temp = SD_MMC.open(tempPath, FILE_READ);
+    uint32_t size = temp ? temp.size() : 0;
+    if (temp) temp.close();
+    if (SD_MMC.remove(tempPath)) {
+      cardUsageRemove(size);
+      stats.tempRemoved++;
+      Serial.println("Herstel: onderbroken opslag verwijderd: " + tempPath);
+    }
+  }
+
+  File file = SD_MMC.open(path, FILE_READ);
+  if (!file || file.isDirectory()) {
+    // Dag verwijderd, foto in een segment, of nooit verder gekomen dan .tmp
+    if (file) file.close();
+    return;
+  }
+  uint32_t size = file.size();
+  bool valid = jpegFileValid(file);
+  file.close();
+
+  if (!valid) {
+    indexRemovePhoto(record.day, record.name);
+    if (SD_MMC.remove(path)) cardUsageRemove(size);
+    SD_MMC.remove(thumbnailPath(record.day, record.name));
+    stats.corrupt++;
+    Serial.println("Herstel: beschadigde foto verwijderd: " + path);
+    return;
+  }
+
+  PhotoIndexEntry entry;
+  if (!indexFindPhoto(record.day, record.name, entry)) {
+    indexAddPhoto(record.day, record.name, record.timestamp, size);
+    stats.reindexed++;
+    Serial.println("Herstel: foto aan de index toegevoegd: " + path);
+  }
+}
+
+// Controleer de laatst opgeslagen foto's; aanroepen na initPhotoIndex(),
+// voordat er nieuwe foto's worden opgeslagen
+bool recoverPhotoJournal() {
+  if (!sdCardAvailable) return false;
+  unsigned long start = millis();
+  stats.checked = stats.tempRemoved = stats.corrupt = stats.reindexed = 0;
+
+  JournalRecord records[JOURNAL_ENTRIES] = {};
+  File journal = SD_MMC.open(JOURNAL_FILE, FILE_READ);
+  if (journal) {
+    journal.read((uint8_t*)records, sizeof(records));
+    journal.close();
+  } else {
+    // Eerste keer: ring in één keer aanmaken, daarna alleen overschrijven
+    journal = SD_MMC.open(JOURNAL_FILE, FILE_WRITE);
+    if (!journal) {
+      Serial.println("Journaal aanmaken mislukt");
+      return false;
+    }
+    journal.write((const uint8_t*)records, sizeof(records));
+    journal.close();
+  }
+
+  // Geldige records, nieuwste eerst
+  int order[JOURNAL_ENTRIES];
+  int count = 0;
+  for (int i = 0; i < JOURNAL_ENTRIES; i++) {
+    if (records[i].sequence == 0 || records[i].check != recordCheck(records[i])) continue;
+    records[i].day[sizeof(records[i].day) - 1] = '\0';
+    records[i].name[sizeof(records[i].name) - 1] = '\0';
+    nextSequence = max(nextSequence, records[i].sequence + 1);
+    int j = count++;
+    while (j > 0 && records[order[j - 1]].sequence < records[i].sequence) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  stats.complete = true;
+  for (int i = 0; i < count; i++) {
+    if (millis() - start > JOURNAL_MAX_MS) {
+      stats.complete = false;
+      break;
+    }
+    recoverRecord(records[order[i]]);
+  }
+  stats.recoveryMs = millis() - start;
+
+  Serial.printf("Herstel na opstarten: %u van %d foto's gecontroleerd in %u ms (%u onderbroken, %u beschadigd, %u opnieuw in de index)\n",
+                stats.checked, count, stats.recoveryMs, stats.tempRemoved, stats.corrupt, stats.reindexed);
+  return true;
+}
+
+// Leg een foto vast vóór het opslaan
+void journalPhoto(const char* dayName, const char* fileName, time_t timestamp, uint32_t size) {
+  JournalRecord record = {};
+  portENTER_CRITICAL(&journalMux);
+  record.sequence = nextSequence++;
+  portEXIT_CRITICAL(&journalMux);
+  record.timestamp = (uint32_t)timestamp;
+  record.size = size;
+  strncpy(record.day, dayName, sizeof(record.day) - 1);
+  strncpy(record.name, fileName, sizeof(record.name) - 1);
+  record.check = recordCheck(record);
+
+  File journal = SD_MMC.open(JOURNAL_FILE, "r+");
+  bool ok = journal && journal.seek((record.sequence % JOURNAL_ENTRIES) * sizeof(JournalRecord)) &&
+            journal.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+  if (journal) journal.close();
+
+  portENTER_CRITICAL(&journalMux);
+  if (ok) stats.journaled++;
+  else stats.failures++;
+  portEXIT_CRITICAL(&journalMux);
+}
+
+// Kopie van de statistieken
+JournalStats getJournalStats() {
+  portENTER_CRITICAL(&journalMux);
+  JournalStats copy = stats;
+  portEXIT_CRITICAL(&journalMux);
+  return copy;
+}
\ No newline at end of file
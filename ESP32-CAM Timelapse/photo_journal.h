@@ -0,0 +1,43 @@
+#ifndef PHOTO_JOURNAL_H
+#define PHOTO_JOURNAL_H
+
+#include "config.h"
+
+// Journaal van de laatst opgeslagen foto's: een klein bestand met een ring
+// van vaste records, één per los fotobestand, geschreven vóór de foto zelf. Bij het
+// opstarten worden alleen deze foto's gecontroleerd in plaats van de hele kaart.
+#define JOURNAL_FILE        "/photos.jnl"
+#define JOURNAL_ENTRIES     16       // Foto's die bij het opstarten worden gecontroleerd
+#define JOURNAL_MAX_MS      1000     // Bovengrens voor het herstel bij het opstarten
+#define JOURNAL_TAIL_BYTES  32       // EOI zoeken in de laatste bytes (opvulling na FFD9)
+#define JOURNAL_TEMP_SUFFIX ".tmp"   // Foto wordt eerst onder deze naam geschreven
+
+// Eén opgeslagen foto in het journaal (64 bytes)
+struct JournalRecord {
+  uint32_t sequence;         // Oplopend; 0 = leeg
+  uint32_t timestamp;
+  uint32_t size;
+  char day[16];
+  char name[32];
+  uint32_t check;            // CRC32 van de velden hiervoor
+};
+
+// Resultaat van het herstel bij het opstarten en tellers van het journaal
+struct JournalStats {
+  uint32_t recoveryMs;
+  uint32_t checked;          // Gecontroleerde foto's
+  uint32_t tempRemoved;      // Onderbroken opslag: tijdelijk bestand verwijderd
+  uint32_t corrupt;          // Foto zonder SOI/EOI verwijderd en uit de index gehaald
+  uint32_t reindexed;        // Foto opgeslagen maar niet in de index: alsnog toegevoegd
+  bool complete;             // Alle records binnen JOURNAL_MAX_MS gecontroleerd
+  uint32_t journaled;        // Records geschreven sinds het opstarten
+  uint32_t failures;         // Record schrijven mislukt
+};
+
+// Functies voor het journaal
+bool recoverPhotoJournal();
+void journalPhoto(const char* dayName, const char* fileName, time_t timestamp, uint32_t size);
+bool jpegFileValid(File& file);
+JournalStats getJournalStats();
+
+#endif // PHOTO_JOURNAL_H
\ No newline at end of file
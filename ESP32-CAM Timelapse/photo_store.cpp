@@ -0,0 +1,341 @@
+#include "photo_store.h"
+#include "card_usage.h"
+#include "photo_journal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Foto-opslag. Standaard krijgt elke foto een eigen bestand in de dagmap:
+// per foto een nieuw mapitem met lange bestandsnaam en een FAT-keten die
+// cluster voor cluster groeit, en bij het wissen weer één verwijdering per
+// foto. Met segmentStorage gaan de foto's achter elkaar in een segment dat
+// bij het aanmaken in één keer op volle grootte wordt gebracht. De offset in
+// de dagindex wijst de foto aan (segmentnummer * SEGMENT_SIZE + positie), dus
+// de webpagina's lezen foto's uit een segment net zo makkelijk als losse
+// bestanden. De trailer van elk segment maakt de index herbouwbaar.
+
+bool segmentStorage = PHOTO_SEGMENTS;
+
+// Het segment waarin nu geschreven wordt, zodat niet voor elke foto de
+// trailer opnieuw gelezen hoeft te worden
+struct SegmentCursor {
+  char dayName[16];
+  int segment;               // -1: geen bruikbaar segment
+  uint32_t segmentId;
+  uint32_t next;             // Eerste vrije positie voor een foto
+  int frames;                // Gebruikte records in de trailer
+};
+
+static SemaphoreHandle_t storeLock = NULL;
+static SegmentCursor cursor = { "", -1, 0, 0, 0 };
+
+static portMUX_TYPE storeMux = portMUX_INITIALIZER_UNLOCKED;
+static SegmentStats stats = {};
+
+// Begin van de trailer en ruimte voor foto's in een segment
+#define SEGMENT_TRAILER_START (SEGMENT_SIZE - SEGMENT_MAX_FRAMES * sizeof(SegmentRecord))
+
+// Pad naar segment 'segment' van een dag
+static String segmentPath(const String& dayName, int segment) {
+  char name[16];
+  snprintf(name, sizeof(name), "seg%03d.bin", segment);
+  return "/timelapse/" + dayName + "/" + name;
+}
+
+// Controlewaarde van een trailerrecord
+static uint32_t recordCheck(const SegmentRecord& record, uint32_t segmentId) {
+  return SEGMENT_MAGIC ^ segmentId ^ record.timestamp ^ record.position ^ record.size;
+}
+
+// Volgende positie op een sectorgrens na een foto
+static uint32_t alignPosition(uint32_t position) {
+  return (position + SEGMENT_ALIGN - 1) & ~(uint32_t)(SEGMENT_ALIGN - 1);
+}
+
+// Maak het slot aan (vanuit setup, voor de taken starten)
+void initPhotoStore() {
+  if (!storeLock) {
+    storeLock = xSemaphoreCreateMutex();
+  }
+  Serial.printf("Foto-opslag: %s\n", segmentStorage ? "segmenten per dag" : "één bestand per foto");
+}
+
+// Is dit een segmentbestand (segNNN.bin)? segment geeft het nummer
+bool segmentFileNumber(const String& fileName, int& segment) {
+  if (fileName.length() != 10 || !fileName.startsWith("seg") || !fileName.endsWith(".bin")) return false;
+  for (int i = 3; i < 6; i++) {
+    if (!isdigit((unsigned char)fileName[i])) return false;
+  }
+  segment = fileName.substring(3, 6).toInt();
+  return segment < SEGMENT_MAX_COUNT;
+}
+
+// Lees de kop van een open segment; false als het bestand geen (volledig
+// aangemaakt) segment van deze firmware is
+bool readSegmentHeader(File& segment, SegmentHeader& header) {
+  if (!segment || segment.size() < SEGMENT_SIZE || !segment.seek(0) ||
+      segment.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  return header.magic == SEGMENT_MAGIC && header.version == SEGMENT_VERSION &&
+         header.maxFrames == SEGMENT_MAX_FRAMES && header.size == SEGMENT_SIZE;
+}
+
+// Lees trailerrecord 'index'. De records staan aaneengesloten: het eerste
+// ongeldige record (nog leeg, of oude data) sluit de reeks af.
+bool readSegmentRecord(File& segment, const SegmentHeader& header, int index, SegmentRecord& record) {
+  if (index < 0 || index >= SEGMENT_MAX_FRAMES) return false;
+  size_t position = SEGMENT_TRAILER_START + index * sizeof(SegmentRecord);
+  if (segment.position() != position && !segment.seek(position)) return false;
+  if (segment.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) return false;
+  return record.check == recordCheck(record, header.segmentId) && record.size > 0 &&
+         record.position >= SEGMENT_HEADER_SIZE && record.position + record.size <= SEGMENT_TRAILER_START;
+}
+
+// Zoek het laatste segment van een dag en de eerste vrije positie daarin
+static void loadCursor(const char* dayName) {
+  memset(&cursor, 0, sizeof(cursor));
+  strncpy(cursor.dayName, dayName, sizeof(cursor.dayName) - 1);
+  cursor.segment = -1;
+
+  int last = -1;
+  while (last + 1 < SEGMENT_MAX_COUNT && SD_MMC.exists(segmentPath(dayName, last + 1))) {
+    last++;
+  }
+  if (last < 0) return;
+
+  cursor.segment = last;
+  File file = SD_MMC.open(segmentPath(dayName, last), FILE_READ);
+  SegmentHeader header;
+  if (!readSegmentHeader(file, header)) {
+    // Onvolledig aangemaakt (stroomuitval): niet verder in schrijven
+    cursor.frames = SEGMENT_MAX_FRAMES;
+    if (file) file.close();
+    return;
+  }
+
+  SegmentRecord record;
+  cursor.segmentId = header.segmentId;
+  cursor.next = SEGMENT_HEADER_SIZE;
+  while (readSegmentRecord(file, header, cursor.frames, record)) {
+    cursor.next = alignPosition(record.position + record.size);
+    cursor.frames++;
+  }
+  file.close();
+}
+
+// Maak het volgende segment van de dag aan: kopsector schrijven en de lege
+// trailer aan het eind, waarmee het bestand direct zijn volle grootte krijgt.
+// De FAT-keten wordt zo in één keer toegewezen in plaats van per foto.
+static bool createSegment() {
+  int segment = cursor.segment + 1;
+  if (segment >= SEGMENT_MAX_COUNT) return false;
+
+  String path = segmentPath(cursor.dayName, segment);
+  File file = SD_MMC.open(path, FILE_WRITE);
+  if (!file) return false;
+
+  uint8_t sector[SEGMENT_HEADER_SIZE] = {};
+  SegmentHeader header = { SEGMENT_MAGIC, SEGMENT_VERSION, SEGMENT_MAX_FRAMES, esp_random(), SEGMENT_SIZE };
+  memcpy(sector, &header, sizeof(header));
+  bool ok = file.write(sector, sizeof(sector)) == sizeof(sector);
+
+  memset(sector, 0, sizeof(sector));
+  ok = ok && file.seek(SEGMENT_TRAILER_START);
+  for (size_t i = 0; ok && i < SEGMENT_MAX_FRAMES * sizeof(SegmentRecord); i += sizeof(sector)) {
+    ok = file.write(sector, sizeof(sector)) == sizeof(sector);
+  }
+  file.close();
+
+  if (!ok) {
+    // Geen ruimte voor een volledig segment: weghalen, los bestand gebruiken
+    SD_MMC.remove(path);
+    return false;
+  }
+  cardUsageAdd(SEGMENT_SIZE);
+
+  cursor.segment = segment;
+  cursor.segmentId = header.segmentId;
+  cursor.next = SEGMENT_HEADER_SIZE;
+  cursor.frames = 0;
+
+  portENTER_CRITICAL(&storeMux);
+  stats.segmentsCreated++;
+  portEXIT_CRITICAL(&storeMux);
+  Serial.println("Nieuw segment: " + path);
+  return true;
+}
+
+// Voeg een foto toe aan het huidige segment van de dag (of een nieuw segment).
+// Eerst de foto, dan het trailerrecord: na een onderbreking tussendoor is de
+// foto er niet, maar het segment blijft leesbaar.
+static bool appendToSegment(const char* dayName, time_t timestamp, const uint8_t* buf, size_t len,
+                            uint32_t& offset) {
+  if (len == 0 || len > SEGMENT_TRAILER_START - SEGMENT_HEADER_SIZE) return false;
+
+  File file;
+  for (int attempt = 0; attempt < 2 && !file; attempt++) {
+    if (strncmp(cursor.dayName, dayName, sizeof(cursor.dayName)) != 0) {
+      loadCursor(dayName);
+    }
+    if (cursor.segment < 0 || cursor.frames >= SEGMENT_MAX_FRAMES || cursor.next + len > SEGMENT_TRAILER_START) {
+      if (!createSegment()) return false;
+    }
+    file = SD_MMC.open(segmentPath(dayName, cursor.segment), "r+");
+    if (!file) {
+      // Dag gewist of kaart gewisseld: segmenten opnieuw zoeken
+      cursor.dayName[0] = '\0';
+    }
+  }
+  if (!file) return false;
+
+  SegmentRecord record = { (uint32_t)timestamp, cursor.next, (uint32_t)len, 0 };
+  record.check = recordCheck(record, cursor.segmentId);
+  bool ok = file.seek(cursor.next) && file.write(buf, len) == len &&
+            file.seek(SEGMENT_TRAILER_START + cursor.frames * sizeof(SegmentRecord)) &&
+            file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+  file.close();
+  if (!ok) {
+    // Positie opnieuw bepalen uit de trailer; een half geschreven foto wordt
+    // dan door de volgende overschreven
+    cursor.dayName[0] = '\0';
+    return false;
+  }
+
+  offset = (uint32_t)cursor.segment * SEGMENT_SIZE + cursor.next;
+  cursor.next = alignPosition(cursor.next + len);
+  cursor.frames++;
+  return true;
+}
+
+// Schrijf een foto als los bestand in de dagmap: eerst onder een tijdelijke
+// naam, na het sluiten (f_close legt data en FAT vast) hernoemen. Na een
+// onderbreking staat er dus nooit een halve foto onder de echte naam.
+static bool writePhotoFile(const char* dayName, const char* fileName, const uint8_t* buf, size_t len) {
+  String path = "/timelapse/" + String(dayName) + "/" + fileName;
+  String tempPath = path + JOURNAL_TEMP_SUFFIX;
+  File file = SD_MMC.open(tempPath, FILE_WRITE);
+  if (!file) {
+    Serial.println("Bestand openen mislukt");
+    return false;
+  }
+  bool ok = file.write(buf, len) == len;
+  file.close();
+  if (!ok) {
+    Serial.println("Schrijven naar bestand mislukt");
+    SD_MMC.remove(tempPath);
+    return false;
+  }
+
+  // FAT hernoemt niet naar een bestaande naam; savePhotoBuffer() kiest een
+  // vrije naam, dus een bestaande foto wordt nooit overschreven
+  if (!SD_MMC.rename(tempPath, path)) {
+    Serial.println("Hernoemen van de foto mislukt");
+    SD_MMC.remove(tempPath);
+    return false;
+  }
+  // Pas meetellen als de foto onder de echte naam staat
+  cardUsageAdd(len);
+  return true;
+}
+
+// Sla de JPEG-data op, in een segment of als los bestand
+static bool storePhotoBytes(const char* dayName, const char* fileName, time_t timestamp,
+                            const uint8_t* buf, size_t len, uint32_t& offset) {
+  offset = 0;
+  if (!segmentStorage) {
+    return writePhotoFile(dayName, fileName, buf, len);
+  }
+
+  unsigned long start = millis();
+  if (storeLock) xSemaphoreTake(storeLock, portMAX_DELAY);
+  bool appended = appendToSegment(dayName, timestamp, buf, len, offset);
+  if (storeLock) xSemaphoreGive(storeLock);
+  uint32_t elapsed = millis() - start;
+
+  portENTER_CRITICAL(&storeMux);
+  if (appended) {
+    stats.appended++;
+    stats.lastMs = elapsed;
+    if (elapsed > stats.maxMs) stats.maxMs = elapsed;
+  } else {
+    stats.fallbacks++;
+  }
+  portEXIT_CRITICAL(&storeMux);
+
+  if (appended) return true;
+  Serial.println("Segment niet bruikbaar, foto als los bestand opgeslagen");
+  return writePhotoFile(dayName, fileName, buf, len);
+}
+
+// Sla de JPEG-data van een foto op. offset wordt 0 voor een los bestand, of
+// de positie in de segmenten van de dag (voor PhotoIndexEntry.offset). De duur
+// telt mee voor de gezondheid van de kaart.
+bool storePhotoData(const char* dayName, const char* fileName, time_t timestamp,
+                    const uint8_t* buf, size_t len, uint32_t& offset) {
+  unsigned long start = millis();
+  bool ok = storePhotoBytes(dayName, fileName, timestamp, buf, len, offset);
+  cardWriteTimed(len, millis() - start, ok);
+  return ok;
+}
+
+// Bestand waarin een foto uit de index staat, met de positie van de foto
+String photoDataPath(const String& dayName, const PhotoIndexEntry& entry, uint32_t& start) {
+  if (entry.offset == 0) {
+    start = 0;
+    return "/timelapse/" + dayName + "/" + entry.name;
+  }
+  start = entry.offset % SEGMENT_SIZE;
+  return segmentPath(dayName, entry.offset / SEGMENT_SIZE);
+}
+
+// Open de bytes van een foto uit de index
+bool openPhotoEntry(const String& dayName, const PhotoIndexEntry& entry, PhotoSource& source) {
+  String path = photoDataPath(dayName, entry, source.start);
+  source.file = SD_MMC.exists(path) ? SD_MMC.open(path, FILE_READ) : File();
+  if (!source.file) return false;
+
+  if (entry.offset == 0) {
+    source.size = source.file.size();
+    source.lastWrite = source.file.getLastWrite();
+    return true;
+  }
+  source.size = entry.size;
+  source.lastWrite = entry.timestamp;
+  if (source.start + source.size > source.file.size() || !source.file.seek(source.start)) {
+    source.file.close();
+    return false;
+  }
+  return true;
+}
+
+// Open een bestand op pad. Bestaat het niet en is het een foto van een dag
+// (/timelapse/<dag>/<foto>), dan wordt de foto in de dagindex opgezocht; zo
+// werken /view/ en /download/ ook voor foto's in een segment.
+bool openPhotoSource(const String& path, PhotoSource& source) {
+  source.start = 0;
+  if (SD_MMC.exists(path)) {
+    source.file = SD_MMC.open(path, FILE_READ);
+    source.size = source.file ? source.file.size() : 0;
+    source.lastWrite = source.file ? source.file.getLastWrite() : 0;
+    return (bool)source.file;
+  }
+
+  const char* prefix = "/timelapse/";
+  if (!path.startsWith(prefix) || !path.endsWith(".jpg")) return false;
+  String relative = path.substring(strlen(prefix));
+  int slash = relative.indexOf('/');
+  if (slash <= 0 || relative.indexOf('/', slash + 1) >= 0) return false;
+
+  PhotoIndexEntry entry;
+  String dayName = relative.substring(0, slash);
+  return indexFindPhoto(dayName, relative.substring(slash + 1), entry) && entry.offset != 0 &&
+         openPhotoEntry(dayName, entry, source);
+}
+
+// Kopie van de statistieken
+SegmentStats getSegmentStats() {
+  portENTER_CRITICAL(&storeMux);
+  SegmentStats copy = stats;
+  portEXIT_CRITICAL(&storeMux);
+  return copy;
+}
\ No newline at end of file
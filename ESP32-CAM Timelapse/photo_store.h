@@ -0,0 +1,70 @@
+#ifndef PHOTO_STORE_H
+#define PHOTO_STORE_H
+
+#include "config.h"
+#include "photo_index.h"
+
+// Opslag van foto's: één bestand per foto (standaard), of achter elkaar in
+// vooraf toegewezen segmentbestanden per dag: /timelapse/<dag>/segNNN.bin.
+// Een segment begint met een kopsector; de foto's staan op sectorgrenzen en
+// aan het eind staat een trailer met een record per foto.
+#ifndef PHOTO_SEGMENTS
+#define PHOTO_SEGMENTS        0                     // 1: nieuwe foto's in segmenten opslaan
+#endif
+#define SEGMENT_SIZE          (8UL * 1024 * 1024)   // Vooraf toegewezen grootte van een segment
+#define SEGMENT_MAX_FRAMES    128                   // Records in de trailer
+#define SEGMENT_MAX_COUNT     512                   // Segmenten per dag (offset past in 32 bits)
+#define SEGMENT_HEADER_SIZE   512                   // Kopsector
+#define SEGMENT_ALIGN         512                   // Foto's beginnen op een sectorgrens
+#define SEGMENT_MAGIC         0x47534C54            // "TLSG"
+#define SEGMENT_VERSION       1
+
+// Kop aan het begin van een segment
+struct SegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t maxFrames;
+  uint32_t segmentId;        // Willekeurig; oude data op hergebruikte clusters telt niet mee
+  uint32_t size;
+};
+
+// Record in de trailer: waar een foto in het segment staat
+struct SegmentRecord {
+  uint32_t timestamp;
+  uint32_t position;         // Vanaf het begin van het segment
+  uint32_t size;
+  uint32_t check;            // SEGMENT_MAGIC ^ segmentId ^ de velden hierboven
+};
+
+// De bytes van één foto: een los bestand, of een stuk van een segment
+struct PhotoSource {
+  File file;                 // Staat op start
+  uint32_t start;
+  uint32_t size;
+  time_t lastWrite;
+};
+
+// Statistieken van de segmentopslag
+struct SegmentStats {
+  uint32_t appended;
+  uint32_t segmentsCreated;
+  uint32_t fallbacks;        // Segment niet bruikbaar, als los bestand opgeslagen
+  uint32_t lastMs;
+  uint32_t maxMs;
+};
+
+extern bool segmentStorage;  // Start op PHOTO_SEGMENTS
+
+// Functies voor de foto-opslag
+void initPhotoStore();
+bool storePhotoData(const char* dayName, const char* fileName, time_t timestamp,
+                    const uint8_t* buf, size_t len, uint32_t& offset);
+String photoDataPath(const String& dayName, const PhotoIndexEntry& entry, uint32_t& start);
+bool openPhotoEntry(const String& dayName, const PhotoIndexEntry& entry, PhotoSource& source);
+bool openPhotoSource(const String& path, PhotoSource& source);
+bool segmentFileNumber(const String& fileName, int& segment);
+bool readSegmentHeader(File& segment, SegmentHeader& header);
+bool readSegmentRecord(File& segment, const SegmentHeader& header, int index, SegmentRecord& record);
+SegmentStats getSegmentStats();
+
+#endif // PHOTO_STORE_H
\ No newline at end of file
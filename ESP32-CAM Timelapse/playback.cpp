@@ -0,0 +1,157 @@
+#include "playback.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "file_stream.h"
+#include "web_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Voorvertoning van een dag zonder download: de opgeslagen JPEG's gaan als
+// multipart/x-mixed-replace naar de browser, net als de livestream. Terwijl
+// een frame verstuurd wordt, leest de leestaak van de bestandsstreamer al het
+// volgende frame in de tweede buffer. De buffers staan in PSRAM en groeien
+// mee met de grootste foto.
+
+// Eén framebuffer met het pad dat erin gelezen wordt
+struct PlaybackBuffer {
+  uint8_t* data;
+  size_t capacity;
+  size_t length;
+  char path[64];
+};
+
+static portMUX_TYPE playbackMux = portMUX_INITIALIZER_UNLOCKED;
+static PlaybackStats stats = {};
+
+// Zorg dat een buffer minstens size bytes kan bevatten
+static bool reserveBuffer(PlaybackBuffer& buffer, size_t size) {
+  if (buffer.capacity >= size) return true;
+  free(buffer.data);
+  buffer.data = psramFound() ? (uint8_t*)ps_malloc(size) : (uint8_t*)malloc(size);
+  buffer.capacity = buffer.data ? size : 0;
+  return buffer.data != NULL;
+}
+
+// Zoek het volgende leesbare frame vanaf position en start het lezen ervan
+static bool prefetchFrame(File& index, int count, int& position, uint32_t step, const String& dayName,
+                          PlaybackBuffer& buffer, SemaphoreHandle_t done) {
+  PhotoIndexEntry entry;
+  for (; position < count; position += step) {
+    if (!readDayIndexEntry(index, position, entry) || entry.size == 0) continue;
+    if (!reserveBuffer(buffer, entry.size)) return false;
+    uint32_t start;
+    strncpy(buffer.path, photoDataPath(dayName, entry, start).c_str(), sizeof(buffer.path) - 1);
+    buffer.path[sizeof(buffer.path) - 1] = '\0';
+    buffer.length = entry.size;
+    position += step;
+    readFileInBackground(buffer.path, buffer.data, entry.size, &buffer.length, done, start);
+    return true;
+  }
+  return false;
+}
+
+// Speel de foto's van een dag af met fps beelden per seconde, elke step-de foto
+void sendDayPlayback(WiFiClient& client, HttpRequest& request, const String& dayName, uint32_t fps, uint32_t step) {
+  fps = constrain(fps, (uint32_t)1, (uint32_t)PLAYBACK_MAX_FPS);
+  step = max(step, (uint32_t)1);
+
+  int count = 0;
+  File index = sdCardAvailable ? openDayIndex(dayName, count) : File();
+  if (!index || count == 0) {
+    if (index) index.close();
+    sendHttpError(client, request, 404);
+    return;
+  }
+
+  SemaphoreHandle_t done = xSemaphoreCreateBinary();
+  PlaybackBuffer buffers[2] = {};
+  int position = 0;
+  uint8_t current = 0;
+  if (!done || !prefetchFrame(index, count, position, step, dayName, buffers[current], done)) {
+    index.close();
+    if (done) vSemaphoreDelete(done);
+    free(buffers[0].data);
+    sendHttpError(client, request, 503);
+    return;
+  }
+
+  client.println("HTTP/1.1 200 OK");
+  client.println("Content-Type: multipart/x-mixed-replace; boundary=frame");
+  client.println("Cache-Control: no-cache");
+  client.println("Connection: close");
+  client.println();
+
+  uint32_t interval = 1000 / fps;
+  uint32_t frames = 0, hits = 0, misses = 0, skipped = 0;
+  unsigned long nextFrameAt = millis();
+  unsigned long firstSentAt = 0, lastSentAt = 0;
+  bool pending = true;
+  bool first = true;
+
+  while (pending && client.connected()) {
+    // Huidige frame: lag het al klaar, dan was het voorlezen op tijd
+    bool ready = xSemaphoreTake(done, 0) == pdTRUE;
+    if (!ready) xSemaphoreTake(done, portMAX_DELAY);
+    if (!first) {
+      if (ready) hits++;
+      else misses++;
+    }
+    first = false;
+    PlaybackBuffer& frame = buffers[current];
+
+    // Alvast het volgende frame lezen
+    pending = prefetchFrame(index, count, position, step, dayName, buffers[current ^ 1], done);
+
+    if (frame.length == 0) {
+      skipped++;
+    } else {
+      // Tempo bewaken; bij een achterstand niet inhalen maar doorgaan
+      long wait = (long)(nextFrameAt - millis());
+      if (wait > 0) delay(wait);
+      else if (wait < -(long)interval) nextFrameAt = millis();
+      nextFrameAt += interval;
+
+      client.println("--frame");
+      client.println("Content-Type: image/jpeg");
+      client.print("Content-Length: ");
+      client.println(frame.length);
+      client.println();
+      bool sent = client.write(frame.data, frame.length) == frame.length;
+      client.println();
+      if (!sent) break;
+      lastSentAt = millis();
+      if (frames++ == 0) firstSentAt = lastSentAt;
+    }
+    current ^= 1;
+  }
+
+  // Een lopende leesactie afmaken voordat de buffers worden vrijgegeven
+  if (pending) xSemaphoreTake(done, portMAX_DELAY);
+  index.close();
+  vSemaphoreDelete(done);
+  free(buffers[0].data);
+  free(buffers[1].data);
+
+  // Gehaalde snelheid over de intervallen tussen het eerste en laatste frame
+  unsigned long elapsed = lastSentAt - firstSentAt;
+  uint32_t fpsX10 = frames > 1 && elapsed > 0 ? (uint32_t)((uint64_t)(frames - 1) * 10000 / elapsed) : 0;
+  portENTER_CRITICAL(&playbackMux);
+  stats.sessions++;
+  stats.frames += frames;
+  stats.prefetchHits += hits;
+  stats.prefetchMisses += misses;
+  stats.skipped += skipped;
+  stats.lastFpsX10 = fpsX10;
+  portEXIT_CRITICAL(&playbackMux);
+
+  Serial.printf("Afspelen %s: %u frames, %u.%u fps (gevraagd %u), voorlezen %u/%u op tijd\n",
+                dayName.c_str(), frames, fpsX10 / 10, fpsX10 % 10, fps, hits, hits + misses);
+}
+
+// Kopie van de statistieken
+PlaybackStats getPlaybackStats() {
+  portENTER_CRITICAL(&playbackMux);
+  PlaybackStats copy = stats;
+  portEXIT_CRITICAL(&playbackMux);
+  return copy;
+}
\ No newline at end of file
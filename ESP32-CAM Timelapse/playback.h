@@ -0,0 +1,26 @@
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "http_parser.h"
+
+// Afspelen van opgeslagen foto's als MJPEG (/play/day/<dag>?fps=&step=)
+#define PLAYBACK_DEFAULT_FPS 10
+#define PLAYBACK_MAX_FPS     30
+
+// Statistieken van het afspelen
+struct PlaybackStats {
+  uint32_t sessions;
+  uint32_t frames;           // Verstuurde frames
+  uint32_t prefetchHits;     // Volgende frame lag al klaar
+  uint32_t prefetchMisses;   // Moest op de SD-kaart wachten
+  uint32_t skipped;          // Onleesbare frames overgeslagen
+  uint32_t lastFpsX10;       // Gehaalde beelden per seconde (x10) van de laatste sessie
+};
+
+// Functies voor het afspelen
+void sendDayPlayback(WiFiClient& client, HttpRequest& request, const String& dayName, uint32_t fps, uint32_t step);
+PlaybackStats getPlaybackStats();
+
+#endif // PLAYBACK_H
\ No newline at end of file
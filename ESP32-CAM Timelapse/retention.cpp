@@ -0,0 +1,689 @@
+#include "retention.h"
+#include "photo_index.h"
+#include "card_usage.h"
+#include "settings_manager.h"
+#include "thumbnails.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Bewaarbeleid. Eens per minuut (of direct na retentionNotify()) vergelijkt
+// deze taak het gebruik van de kaart met de grens en het aantal dagen met het
+// maximum, met het dagoverzicht uit de index en de vrije ruimte die FatFs na
+// de eerste opvraag in het geheugen bijhoudt, zonder mappen te doorlopen. Een
+// dag die weg moet wordt in één keer naar /trash verplaatst en uit het
+// dagoverzicht gehaald; het leegmaken van /trash en het verwijderen van
+// uitgedunde foto's gebeurt daarna bestand voor bestand in tijdsplakken van
+// hooguit RETENTION_SLICE_MS. De opnametaak wacht dus nooit op meer dan één
+// bestandsoperatie. De vandaag gebruikte dagmap wordt nooit aangeraakt.
+//
+// Wissen en het verwijderen van een dag via de webinterface gaan op dezelfde
+// manier: de webhandler verplaatst de map naar /trash/j<id>_<naam> en past de
+// index aan (een paar bestandsoperaties), en deze taak ruimt de map daarna
+// op, vóór het uitdunnen. Het herbouwen van de index (POST /rebuildindex)
+// loopt hier ook, in tijdsplakken na het uitdunnen, zodat het nooit tegelijk
+// met het uitdunnen dezelfde dagindex herschrijft. De voortgang staat per
+// taak-id in een kleine tabel.
+
+#define RETENTION_TASK_STACK    6144
+#define RETENTION_TASK_PRIORITY 1
+#define RETENTION_TASK_CORE     0
+
+// Een dag die wordt uitgedund; de map blijft open tussen de tijdsplakken
+struct ThinJob {
+  bool active;
+  char day[sizeof(DayIndexSummary::name)];
+  int keepEvery;
+  uint32_t photoCount;       // Aantal foto's voor het uitdunnen (staat in de marker)
+  char (*keep)[32];          // Namen uit de nieuwe dagindex, gesorteerd
+  int keepCount;
+  File dir;
+  bool thumbs;               // Na de foto's de miniaturen
+};
+
+static TaskHandle_t retentionTaskHandle = NULL;
+static portMUX_TYPE retentionMux = portMUX_INITIALIZER_UNLOCKED;
+static RetentionStats stats = {};
+static ThinJob thinJob = {};
+static volatile bool trashPending = true;  // Bij het opstarten kijken of /trash nog iets bevat
+static BackgroundJob jobs[RETENTION_MAX_JOBS];
+static uint32_t nextJobId = 1;
+static uint32_t sweepJobId = 0;       // Taak van de map die nu wordt opgeruimd (0 = bewaarbeleid)
+static volatile uint32_t rebuildJobId = 0;  // Lopend herbouwen van de index (0 = geen)
+static uint32_t thinCheckedKey = 0;  // Dagen tot en met deze sleutel zijn al uitgedund
+
+// Sorteersleutel YYYYMMDD van een dagmapnaam (DD-MM-YYYY)
+static uint32_t dayKey(const char* dayName) {
+  int day = 0, month = 0, year = 0;
+  if (sscanf(dayName, "%d-%d-%d", &day, &month, &year) != 3) return 0;
+  return (uint32_t)(year * 10000 + month * 100 + day);
+}
+
+// Middag van een dag, voor de leeftijd in dagen
+static time_t dayNoon(const char* dayName) {
+  struct tm timeinfo = {};
+  if (sscanf(dayName, "%d-%d-%d", &timeinfo.tm_mday, &timeinfo.tm_mon, &timeinfo.tm_year) != 3) return 0;
+  timeinfo.tm_mon -= 1;
+  timeinfo.tm_year -= 1900;
+  timeinfo.tm_hour = 12;
+  timeinfo.tm_isdst = -1;
+  return mktime(&timeinfo);
+}
+
+// Naam van de dagmap van vandaag
+static void todayName(char* name, size_t size) {
+  time_t now;
+  struct tm timeinfo;
+  time(&now);
+  localtime_r(&now, &timeinfo);
+  snprintf(name, size, "%02d-%02d-%04d", timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+}
+
+// Laatste actie voor de statuspagina en de seriële monitor
+static void setLastAction(const String& action) {
+  if (action == stats.lastAction) return;
+  Serial.println("Bewaarbeleid: " + action);
+  portENTER_CRITICAL(&retentionMux);
+  strncpy(stats.lastAction, action.c_str(), sizeof(stats.lastAction) - 1);
+  stats.lastAction[sizeof(stats.lastAction) - 1] = '\0';
+  portEXIT_CRITICAL(&retentionMux);
+}
+
+// Achtergrondtaak met dit id in de tabel; aanroepen binnen retentionMux
+static BackgroundJob* findJob(uint32_t id) {
+  for (int i = 0; i < RETENTION_MAX_JOBS && id > 0; i++) {
+    if (jobs[i].id == id) return &jobs[i];
+  }
+  return NULL;
+}
+
+// Neem de plaats van de oudste taak in de tabel; aanroepen binnen retentionMux
+static BackgroundJob* newJob(uint32_t id, uint8_t kind) {
+  BackgroundJob* job = &jobs[0];
+  for (int i = 1; i < RETENTION_MAX_JOBS; i++) {
+    if (jobs[i].id < job->id) job = &jobs[i];
+  }
+  memset(job, 0, sizeof(BackgroundJob));
+  job->id = id;
+  job->kind = kind;
+  job->state = JOB_RUNNING;
+  job->startMs = millis();
+  return job;
+}
+
+// Sluit een achtergrondtaak af
+static void finishJob(uint32_t id, uint8_t state) {
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* job = findJob(id);
+  if (job && job->state == JOB_RUNNING) {
+    job->state = state;
+    job->elapsedMs = millis() - job->startMs;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+}
+
+// Verwijder één bestand en tel het mee bij de taak of het bewaarbeleid
+static bool removeCounted(const String& path, uint32_t size) {
+  if (!SD_MMC.remove(path)) return false;
+  cardUsageRemove(size);
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* job = findJob(sweepJobId);
+  if (job) {
+    job->filesRemoved++;
+    job->bytesFreed += size;
+  } else {
+    stats.filesRemoved++;
+    stats.bytesFreed += size;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+  return true;
+}
+
+// Deadline van een tijdsplak verstreken?
+static bool sliceExpired(unsigned long deadline) {
+  return (long)(millis() - deadline) >= 0;
+}
+
+// Verwijder een map met inhoud tot de deadline; true als er nog iets over is
+static bool removeTreeSlice(const String& path, unsigned long deadline, uint32_t& removed) {
+  File dir = SD_MMC.open(path);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return false;
+  }
+
+  bool more = false;
+  File file = dir.openNextFile();
+  while (file) {
+    String child = String(file.path());
+    if (file.isDirectory()) {
+      file.close();
+      more = removeTreeSlice(child, deadline, removed);
+    } else {
+      uint32_t size = file.size();
+      file.close();
+      if (removeCounted(child, size)) removed++;
+    }
+    if (more || sliceExpired(deadline)) {
+      more = true;
+      break;
+    }
+    file = dir.openNextFile();
+  }
+  dir.close();
+
+  if (!more) SD_MMC.rmdir(path);
+  return more;
+}
+
+// Stop het uitdunnen als de dag intussen is verwijderd; de open map zou het
+// opruimen in /trash anders blokkeren
+static void abortMovedThinning() {
+  if (!thinJob.active || SD_MMC.exists("/timelapse/" + String(thinJob.day))) return;
+  if (thinJob.dir) thinJob.dir.close();
+  thinJob.dir = File();
+  free(thinJob.keep);
+  thinJob.keep = NULL;
+  thinJob.active = false;
+}
+
+// Ruim de eerste map in /trash verder op; false als /trash leeg is of het
+// verwijderen niet opschiet
+static bool sweepTrashSlice(unsigned long deadline) {
+  abortMovedThinning();
+  File trash = SD_MMC.open(RETENTION_TRASH_DIR);
+  if (!trash || !trash.isDirectory()) {
+    if (trash) trash.close();
+    return false;
+  }
+  File entry = trash.openNextFile();
+  trash.close();
+  if (!entry) return false;
+
+  String path = String(entry.path());
+  String name = path.substring(path.lastIndexOf('/') + 1);
+  bool isDirectory = entry.isDirectory();
+  uint32_t size = entry.size();
+  entry.close();
+
+  // Mappen van verwijdertaken heten j<id>_<naam>
+  unsigned int id = 0;
+  sweepJobId = sscanf(name.c_str(), "j%u_", &id) == 1 ? id : 0;
+
+  uint32_t removed = 0;
+  bool more = false;
+  if (isDirectory) {
+    more = removeTreeSlice(path, deadline, removed);
+  } else if (removeCounted(path, size)) {
+    removed++;
+  }
+  if (!more && SD_MMC.exists(path)) {
+    // Niet te verwijderen; pas bij de volgende taak of herstart opnieuw proberen
+    finishJob(sweepJobId, JOB_FAILED);
+    setLastAction("/trash leegmaken lukt niet");
+    return false;
+  }
+  if (!more) finishJob(sweepJobId, JOB_DONE);
+  return true;
+}
+
+// Verplaats een dag naar /trash en haal hem uit het dagoverzicht
+static bool deleteDay(const char* dayName, const String& reason) {
+  String dayPath = "/timelapse/" + String(dayName);
+  String trashPath = String(RETENTION_TRASH_DIR) + "/" + dayName;
+  if (!SD_MMC.exists(RETENTION_TRASH_DIR)) SD_MMC.mkdir(RETENTION_TRASH_DIR);
+  if (SD_MMC.exists(trashPath)) trashPath += "_" + String(millis());
+
+  // Eerst de map, dan het overzicht: na stroomuitval daartussen staat de dag
+  // nog in het overzicht en wordt hij de volgende keer alleen daaruit gehaald
+  if (SD_MMC.exists(dayPath) && !SD_MMC.rename(dayPath, trashPath)) {
+    setLastAction("Verplaatsen van " + String(dayName) + " mislukt");
+    return false;
+  }
+  indexRemoveDay(dayName);
+  trashPending = true;
+
+  portENTER_CRITICAL(&retentionMux);
+  stats.daysDeleted++;
+  portEXIT_CRITICAL(&retentionMux);
+  setLastAction(String(dayName) + " verwijderd (" + reason + ")");
+  return true;
+}
+
+// Staat een naam in de (gesorteerde) lijst van bewaarde foto's?
+static bool isKept(const char* name) {
+  int low = 0, high = thinJob.keepCount - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    int cmp = strcmp(thinJob.keep[middle], name);
+    if (cmp == 0) return true;
+    if (cmp < 0) low = middle + 1;
+    else high = middle - 1;
+  }
+  return false;
+}
+
+static int compareNames(const void* a, const void* b) {
+  return strcmp((const char*)a, (const char*)b);
+}
+
+// Pad van de marker van een dag
+static String thinMarkerPath(const char* dayName) {
+  return "/timelapse/" + String(dayName) + "/" + RETENTION_THIN_MARKER;
+}
+
+// Schrijf de marker: 'P' bezig of 'D' klaar, met de instelling en het
+// oorspronkelijke aantal foto's
+static void writeThinMarker(char state) {
+  File marker = SD_MMC.open(thinMarkerPath(thinJob.day), FILE_WRITE);
+  if (marker) {
+    marker.printf("%c %d %u\n", state, thinJob.keepEvery, thinJob.photoCount);
+    marker.close();
+  }
+}
+
+// Begin (of hervat na een herstart) het uitdunnen van een dag
+static bool startThinning(const DayIndexSummary& day, bool resume, int keepEvery, uint32_t photoCount) {
+  thinJob = ThinJob();
+  snprintf(thinJob.day, sizeof(thinJob.day), "%s", day.name);
+  thinJob.keepEvery = keepEvery;
+  thinJob.photoCount = photoCount;
+
+  // De index is al uitgedund als het aantal foto's is veranderd
+  uint32_t kept = 0, dropped = 0;
+  if (!resume || day.photoCount == photoCount) {
+    writeThinMarker('P');
+    if (!indexThinDay(day.name, keepEvery, kept, dropped)) {
+      thinCheckedKey = max(thinCheckedKey, dayKey(day.name));
+      setLastAction("Uitdunnen van " + String(day.name) + " mislukt");
+      return false;
+    }
+    portENTER_CRITICAL(&retentionMux);
+    stats.photosThinned += dropped;
+    portEXIT_CRITICAL(&retentionMux);
+  }
+
+  // Bewaarde namen uit de nieuwe dagindex
+  int count = 0;
+  File index = openDayIndex(day.name, count);
+  thinJob.keep = count > 0 ? (char (*)[32])malloc(count * 32) : NULL;
+  PhotoIndexEntry entry;
+  for (int i = 0; i < count && thinJob.keep && index; i++) {
+    if (!readDayIndexEntry(index, i, entry)) break;
+    memcpy(thinJob.keep[thinJob.keepCount++], entry.name, 32);
+  }
+  if (index) index.close();
+  // Zonder bewaarde namen zou de hele dag verdwijnen
+  if (thinJob.keepCount == 0) {
+    free(thinJob.keep);
+    thinJob.keep = NULL;
+    thinCheckedKey = max(thinCheckedKey, dayKey(day.name));
+    setLastAction("Dagindex van " + String(day.name) + " niet leesbaar, niet uitgedund");
+    return false;
+  }
+  qsort(thinJob.keep, thinJob.keepCount, 32, compareNames);
+
+  thinJob.dir = SD_MMC.open("/timelapse/" + String(day.name));
+  thinJob.active = true;
+  setLastAction(String(day.name) + " uitdunnen: elke " + String(keepEvery) + "e foto bewaren");
+  return true;
+}
+
+// Rond het uitdunnen af
+static void finishThinning() {
+  writeThinMarker('D');
+  free(thinJob.keep);
+  thinJob.keep = NULL;
+  thinJob.active = false;
+  thinCheckedKey = max(thinCheckedKey, dayKey(thinJob.day));
+  portENTER_CRITICAL(&retentionMux);
+  stats.daysThinned++;
+  portEXIT_CRITICAL(&retentionMux);
+  setLastAction(String(thinJob.day) + " uitgedund");
+}
+
+// Verwijder foto's (en daarna miniaturen) die niet meer in de dagindex
+// staan, tot de deadline; false als de dag klaar is
+static bool thinSlice(unsigned long deadline) {
+  while (thinJob.dir) {
+    File file = thinJob.dir.openNextFile();
+    while (file) {
+      String path = String(file.path());
+      String name = path.substring(path.lastIndexOf('/') + 1);
+      uint32_t size = file.size();
+      bool drop = !file.isDirectory() && name.endsWith(".jpg") && !isKept(name.c_str());
+      file.close();
+      if (drop) removeCounted(path, size);
+      if (sliceExpired(deadline)) return true;
+      file = thinJob.dir.openNextFile();
+    }
+    thinJob.dir.close();
+    thinJob.dir = File();
+
+    if (!thinJob.thumbs) {
+      thinJob.thumbs = true;
+      thinJob.dir = SD_MMC.open("/timelapse/" + String(thinJob.day) + "/" + THUMB_DIR);
+      if (thinJob.dir && !thinJob.dir.isDirectory()) {
+        thinJob.dir.close();
+        thinJob.dir = File();
+      }
+    }
+  }
+  finishThinning();
+  return false;
+}
+
+// Zoek de oudste dag die nog uitgedund moet worden
+static bool thinNextDay(const DayIndexSummary* days, int count, const char* today) {
+  time_t todayNoon = dayNoon(today);
+  for (int i = 0; i < count; i++) {
+    if (strcmp(days[i].name, today) == 0) continue;
+    uint32_t key = dayKey(days[i].name);
+    if (key <= thinCheckedKey) continue;
+    // Chronologisch: alle volgende dagen zijn nog jonger
+    if ((todayNoon - dayNoon(days[i].name)) / 86400 < thinAfterDays) break;
+
+    char state = 0;
+    int keepEvery = 0;
+    uint32_t photoCount = 0;
+    File marker = SD_MMC.open(thinMarkerPath(days[i].name), FILE_READ);
+    if (marker) {
+      char line[32];
+      size_t length = marker.read((uint8_t*)line, sizeof(line) - 1);
+      marker.close();
+      line[length] = '\0';
+      sscanf(line, "%c %d %u", &state, &keepEvery, &photoCount);
+    }
+    if (state == 'D') {
+      thinCheckedKey = key;
+      continue;
+    }
+    if (state == 'P' && keepEvery > 1) {
+      return startThinning(days[i], true, keepEvery, photoCount);
+    }
+    return startThinning(days[i], false, thinKeepEvery, days[i].photoCount);
+  }
+  return false;
+}
+
+// Verwachte bytes aan foto's per dag: gemiddelde van de laatste dagen die
+// nog niet zijn uitgedund, of vandaag doorgetrokken over de opnameperiode als
+// er nog geen eerdere dag is
+static uint32_t estimateDailyBytes(const DayIndexSummary* days, int count, const char* today) {
+  time_t todayNoon = dayNoon(today);
+  uint64_t total = 0;
+  int used = 0;
+  for (int i = count - 1; i >= 0 && used < RETENTION_RATE_DAYS; i--) {
+    if (strcmp(days[i].name, today) == 0) continue;
+    if (thinAfterDays > 0 && (todayNoon - dayNoon(days[i].name)) / 86400 >= thinAfterDays) break;
+    total += days[i].totalBytes;
+    used++;
+  }
+  if (used > 0) return (uint32_t)(total / used);
+
+  for (int i = 0; i < count; i++) {
+    if (strcmp(days[i].name, today) != 0) continue;
+    uint32_t span = days[i].lastTimestamp - days[i].firstTimestamp;
+    int hours = dayEndHour > dayStartHour ? dayEndHour - dayStartHour : dayEndHour + 24 - dayStartHour;
+    if (span >= 3600) return (uint32_t)((uint64_t)days[i].totalBytes * hours * 3600 / span);
+  }
+  return 0;
+}
+
+// Controleer het beleid en start zo nodig één actie; true als er iets is gestart
+static bool evaluatePolicy() {
+  if (!sdCardAvailable || !timeInitialized) return false;
+
+  int count = 0;
+  File summaries = openDaySummaries(count);
+  DayIndexSummary* days = count > 0 ? (DayIndexSummary*)malloc(count * sizeof(DayIndexSummary)) : NULL;
+  int valid = 0;
+  for (int i = 0; i < count && days; i++) {
+    if (readDaySummary(summaries, i, days[valid])) valid++;
+  }
+  if (summaries) summaries.close();
+  count = valid;
+
+  char today[DAY_NAME_SIZE];
+  todayName(today, sizeof(today));
+
+  // Gebruik van de kaart: FatFs telt de vrije clusters alleen bij de eerste
+  // opvraag, daarna houdt het de telling zelf bij. Ook de correctie van het
+  // kaartgebruik in het geheugen.
+  unsigned long start = millis();
+  uint64_t cardBytes = SD_MMC.totalBytes();
+  uint64_t usedBytes = SD_MMC.usedBytes();
+  cardUsageResync(cardBytes, usedBytes, millis() - start);
+  uint64_t reserve = (uint64_t)RETENTION_MIN_FREE_MB * 1024 * 1024;
+  uint64_t limit = cardBytes > reserve ? cardBytes - reserve : 0;
+  if (retentionMaxMB > 0) limit = min(limit, (uint64_t)retentionMaxMB * 1024 * 1024);
+
+  // Prognose: foto's per dag maal de verhouding kaartgebruik/fotobytes
+  // (miniaturen, dagvideo en indexbestanden komen er nog bij)
+  uint64_t photoBytes = 0;
+  for (int i = 0; i < count; i++) photoBytes += days[i].totalBytes;
+  float overhead = photoBytes > 0 ? constrain((float)usedBytes / photoBytes, 1.0f, 4.0f) : 1.0f;
+  uint32_t dailyBytes = (uint32_t)(estimateDailyBytes(days, count, today) * overhead);
+  int32_t daysUntilFull = -1;
+  if (cardBytes > 0 && usedBytes >= limit) {
+    daysUntilFull = 0;
+  } else if (cardBytes > 0 && dailyBytes > 0) {
+    daysUntilFull = (int32_t)((limit - usedBytes) / dailyBytes);
+  }
+
+  portENTER_CRITICAL(&retentionMux);
+  stats.cardBytes = cardBytes;
+  stats.usedBytes = usedBytes;
+  stats.limitBytes = limit;
+  stats.dailyBytes = dailyBytes;
+  stats.daysUntilFull = daysUntilFull;
+  portEXIT_CRITICAL(&retentionMux);
+
+  // Oudste dag eerst; vandaag blijft altijd staan
+  bool started = false;
+  if (count > 0 && strcmp(days[0].name, today) != 0) {
+    if (retentionMaxDays > 0 && count > retentionMaxDays) {
+      started = deleteDay(days[0].name, "meer dan " + String(retentionMaxDays) + " dagen");
+    } else if (cardBytes > 0 && usedBytes > limit) {
+      started = deleteDay(days[0].name, "kaart vol");
+    }
+  } else if (cardBytes > 0 && usedBytes > limit) {
+    setLastAction("Kaart vol, alleen vandaag over");
+  }
+  if (!started && thinAfterDays > 0 && thinKeepEvery > 1) {
+    started = thinNextDay(days, count, today);
+  }
+
+  free(days);
+  return started;
+}
+
+// Houd de duur van een tijdsplak bij, voor de taak of het bewaarbeleid
+static void recordSlice(uint32_t jobId, uint32_t elapsed) {
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* job = findJob(jobId);
+  if (job) {
+    job->busyMs += elapsed;
+    if (elapsed > job->maxSliceMs) job->maxSliceMs = elapsed;
+  } else {
+    stats.busyMs += elapsed;
+    stats.slices++;
+    if (elapsed > stats.maxSliceMs) stats.maxSliceMs = elapsed;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+}
+
+// Herbouw de index tot de deadline en werk de taak bij
+static void rebuildSlice(unsigned long deadline) {
+  bool more = indexRebuildSlice(deadline);
+  IndexRebuildProgress progress = getIndexRebuildProgress();
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* job = findJob(rebuildJobId);
+  if (job) {
+    job->daysDone = progress.daysDone;
+    job->photosIndexed = progress.photos;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+  if (!more) {
+    finishJob(rebuildJobId, progress.ok ? JOB_DONE : JOB_FAILED);
+    rebuildJobId = 0;
+  }
+}
+
+// Retentietaak: lopend werk in tijdsplakken (eerst /trash, dan uitdunnen,
+// dan de index herbouwen), daarna het beleid controleren
+static void retentionTask(void*) {
+  // Kaartgebruik vullen, ook zonder NTP-tijd (dan loopt het beleid niet)
+  cardUsageSeed();
+
+  for (;;) {
+    if (thinJob.active || trashPending || rebuildJobId > 0) {
+      unsigned long start = millis();
+      unsigned long deadline = start + RETENTION_SLICE_MS;
+      uint32_t jobId = 0;
+      if (trashPending) {
+        trashPending = sweepTrashSlice(deadline);
+        jobId = sweepJobId;
+      } else if (thinJob.active) {
+        thinSlice(deadline);
+      } else {
+        jobId = rebuildJobId;
+        rebuildSlice(deadline);
+      }
+      recordSlice(jobId, millis() - start);
+      vTaskDelay(pdMS_TO_TICKS(jobId > 0 ? RETENTION_JOB_PAUSE_MS : RETENTION_PAUSE_MS));
+      continue;
+    }
+
+    if (!evaluatePolicy()) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RETENTION_INTERVAL_MS));
+    }
+  }
+}
+
+// Start de retentietaak
+bool startRetentionTask() {
+  if (xTaskCreatePinnedToCore(retentionTask, "retention", RETENTION_TASK_STACK, NULL,
+                              RETENTION_TASK_PRIORITY, &retentionTaskHandle, RETENTION_TASK_CORE) != pdPASS) {
+    Serial.println("Retentietaak starten mislukt");
+    // Zonder taak het kaartgebruik hier vullen; kan op een grote kaart even duren
+    cardUsageSeed();
+    return false;
+  }
+  Serial.println("Retentietaak gestart");
+  return true;
+}
+
+// Controleer het beleid nu (na het wijzigen van de instellingen)
+void retentionNotify() {
+  if (retentionTaskHandle) xTaskNotifyGive(retentionTaskHandle);
+}
+
+// Start een verwijdertaak voor een dag of (lege naam) alle foto's; geeft
+// het id, of 0 als de map niet kon worden verplaatst
+uint32_t startDeleteJob(const String& dayName) {
+  if (!sdCardAvailable || !retentionTaskHandle) return 0;
+
+  // Schatting van het aantal bestanden uit het dagoverzicht
+  uint32_t estimated = 0;
+  int count = 0;
+  File summaries = openDaySummaries(count);
+  DayIndexSummary day;
+  for (int i = 0; i < count && summaries; i++) {
+    if (!readDaySummary(summaries, i, day)) continue;
+    if (dayName.length() == 0 || dayName == day.name) estimated += day.photoCount * 2 + 4;
+  }
+  if (summaries) summaries.close();
+
+  portENTER_CRITICAL(&retentionMux);
+  uint32_t id = nextJobId++;
+  portEXIT_CRITICAL(&retentionMux);
+
+  String source = dayName.length() > 0 ? "/timelapse/" + dayName : String("/timelapse");
+  String target = String(RETENTION_TRASH_DIR) + "/j" + String(id) + "_" +
+                  (dayName.length() > 0 ? dayName : String("timelapse"));
+  if (!SD_MMC.exists(RETENTION_TRASH_DIR)) SD_MMC.mkdir(RETENTION_TRASH_DIR);
+  bool ok = SD_MMC.exists(source) && SD_MMC.rename(source, target);
+  if (ok && dayName.length() > 0) {
+    indexRemoveDay(dayName);
+  } else if (ok) {
+    // Wissen: lege timelapse-map en index, opnemen gaat direct verder
+    SD_MMC.mkdir("/timelapse");
+    resetPhotoIndex();
+  }
+  if (!ok) {
+    Serial.println("Verwijdertaak: " + source + " verplaatsen mislukt");
+    return 0;
+  }
+
+  // Oudste taak in de tabel overschrijven
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* job = newJob(id, JOB_KIND_DELETE);
+  strncpy(job->target, dayName.c_str(), sizeof(job->target) - 1);
+  job->estimatedFiles = estimated;
+  portEXIT_CRITICAL(&retentionMux);
+
+  Serial.printf("Verwijdertaak %u gestart: %s (ca. %u bestanden)\n", id, source.c_str(), estimated);
+  trashPending = true;
+  xTaskNotifyGive(retentionTaskHandle);
+  return id;
+}
+
+// Start het herbouwen van de index op de achtergrond; geeft het id (van een
+// al lopend herbouwen), of 0 als er geen retentietaak is of /timelapse ontbreekt
+uint32_t startRebuildJob() {
+  if (!sdCardAvailable || !retentionTaskHandle) return 0;
+  if (rebuildJobId > 0) return rebuildJobId;
+  if (!indexRebuildStart()) return 0;
+
+  portENTER_CRITICAL(&retentionMux);
+  uint32_t id = nextJobId++;
+  BackgroundJob* job = newJob(id, JOB_KIND_REBUILD);
+  job->daysTotal = getIndexRebuildProgress().daysTotal;
+  portEXIT_CRITICAL(&retentionMux);
+
+  Serial.printf("Herbouwen van de index gestart als taak %u\n", id);
+  rebuildJobId = id;
+  xTaskNotifyGive(retentionTaskHandle);
+  return id;
+}
+
+// Kopie van een achtergrondtaak; false als het id onbekend is
+bool getBackgroundJob(uint32_t id, BackgroundJob& job) {
+  portENTER_CRITICAL(&retentionMux);
+  BackgroundJob* found = findJob(id);
+  if (found) {
+    job = *found;
+    if (job.state == JOB_RUNNING) job.elapsedMs = millis() - job.startMs;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+  return found != NULL;
+}
+
+// Kopie van de bekende achtergrondtaken, nieuwste eerst; geeft het aantal
+int getBackgroundJobs(BackgroundJob* out, int maxJobs) {
+  int count = 0;
+  portENTER_CRITICAL(&retentionMux);
+  uint32_t below = UINT32_MAX;
+  while (count < maxJobs) {
+    BackgroundJob* newest = NULL;
+    for (int i = 0; i < RETENTION_MAX_JOBS; i++) {
+      if (jobs[i].id > 0 && jobs[i].id < below && (!newest || jobs[i].id > newest->id)) newest = &jobs[i];
+    }
+    if (!newest) break;
+    out[count] = *newest;
+    if (out[count].state == JOB_RUNNING) out[count].elapsedMs = millis() - out[count].startMs;
+    below = newest->id;
+    count++;
+  }
+  portEXIT_CRITICAL(&retentionMux);
+  return count;
+}
+
+// Kopie van de statistieken voor weergave
+RetentionStats getRetentionStats() {
+  portENTER_CRITICAL(&retentionMux);
+  RetentionStats copy = stats;
+  copy.active = thinJob.active || trashPending;
+  portEXIT_CRITICAL(&retentionMux);
+  return copy;
+}
\ No newline at end of file
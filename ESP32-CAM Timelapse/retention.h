@@ -0,0 +1,81 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include "config.h"
+
+// Bewaarbeleid voor de SD-kaart: oudste dagen verwijderen als de kaart (of het
+// ingestelde maximum) vol raakt of er meer dagen zijn dan ingesteld, en oude
+// dagen uitdunnen tot elke N-de foto. Dezelfde taak voert ook het wissen van
+// de kaart, het verwijderen van een dag en het herbouwen van de index uit
+// (achtergrondtaken met een id).
+// Alles gebeurt in een eigen taak, in korte tijdsplakken met pauzes ertussen.
+#define RETENTION_INTERVAL_MS   60000    // Beleid controleren (of eerder na retentionNotify())
+#define RETENTION_SLICE_MS      40       // Maximale duur van één tijdsplak
+#define RETENTION_PAUSE_MS      100      // Pauze tussen tijdsplakken
+#define RETENTION_JOB_PAUSE_MS  20       // Kortere pauze voor een gevraagde achtergrondtaak
+#define RETENTION_MIN_FREE_MB   256      // Altijd zoveel vrij houden op de kaart
+#define RETENTION_RATE_DAYS     7        // Dagen voor de verwachte groei per dag
+#define RETENTION_TRASH_DIR     "/trash" // Te verwijderen dagen, buiten /timelapse
+#define RETENTION_THIN_MARKER   "thinned" // In de dagmap: dag is (of wordt) uitgedund
+#define RETENTION_MAX_JOBS      8        // Laatste achtergrondtaken voor /api/jobs/
+
+// Toestand van een achtergrondtaak
+#define JOB_RUNNING 0
+#define JOB_DONE    1
+#define JOB_FAILED  2
+
+// Soort achtergrondtaak
+#define JOB_KIND_DELETE  0
+#define JOB_KIND_REBUILD 1
+
+// Statistieken en prognose van het bewaarbeleid
+struct RetentionStats {
+  uint64_t cardBytes;
+  uint64_t usedBytes;
+  uint64_t limitBytes;       // Kaart min reserve, of het ingestelde maximum
+  uint32_t dailyBytes;       // Verwachte groei per dag, inclusief miniaturen en video
+  int32_t daysUntilFull;     // Tot het verwijderen begint; -1 = onbekend
+  uint32_t daysDeleted;
+  uint32_t daysThinned;
+  uint32_t photosThinned;
+  uint32_t filesRemoved;
+  uint64_t bytesFreed;
+  uint32_t busyMs;           // Totale duur van de tijdsplakken
+  uint32_t slices;
+  uint32_t maxSliceMs;
+  bool active;               // Verwijderen of uitdunnen bezig
+  char lastAction[48];
+};
+
+// Achtergrondtaak. Verwijderen: één dag of alle foto's (wissen); de map gaat
+// direct naar /trash en de taak is klaar als die kopie bestand voor bestand
+// is verwijderd. Herbouwen: de index, dagmap voor dagmap.
+struct BackgroundJob {
+  uint32_t id;
+  uint8_t kind;              // JOB_KIND_*
+  char target[16];           // Dagmap, of leeg voor alle foto's
+  uint8_t state;             // JOB_*
+  uint32_t estimatedFiles;   // Schatting uit het dagoverzicht (foto's, miniaturen, dagbestanden)
+  uint32_t filesRemoved;
+  uint64_t bytesFreed;
+  uint32_t startMs;
+  uint32_t elapsedMs;
+  uint32_t busyMs;           // Duur van de tijdsplakken voor deze taak
+  uint32_t maxSliceMs;
+  uint32_t daysTotal;        // Herbouwen: dagmappen bij de start
+  uint32_t daysDone;
+  uint32_t photosIndexed;
+};
+
+// Functies voor het bewaarbeleid
+bool startRetentionTask();
+void retentionNotify();
+RetentionStats getRetentionStats();
+
+// Functies voor achtergrondtaken
+uint32_t startDeleteJob(const String& dayName);
+uint32_t startRebuildJob();
+bool getBackgroundJob(uint32_t id, BackgroundJob& job);
+int getBackgroundJobs(BackgroundJob* out, int maxJobs);
+
+#endif // RETENTION_H
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "sd_card.h"
+#include "card_usage.h"
 
 // Initialiseer de SD-kaart
 bool initSDCard() {
@@ -18,7 +19,7 @@ bool initSDCard() {
   
   // SD-kaart capaciteit controleren
   uint64_t cardSize = SD_MMC.cardSize() / (1024 * 1024);
-  Serial.printf("SD-kaart gedetecteerd. Type: %d, Grootte: %lluMB\n", cardType, cardSize);
+  Serial.printf("SD-kaart gedetecteerd. Type: %d, Grootte: %lluMB\n", cardType, (unsigned long long)cardSize);
   
   // Verzeker dat de kaart toegankelijk is
   if (cardSize == 0) {
@@ -37,19 +38,21 @@ bool initSDCard() {
   return true;
 }
 
-// Maak een map aan voor de huidige dag als die nog niet bestaat
-bool createDayFolder() {
+// Maak een map aan voor de dag van 'timestamp' (0 = vandaag) als die nog niet bestaat
+bool createDayFolder(time_t timestamp) {
   if (!sdCardAvailable) return false;
   
-  // Huidige datum ophalen
-  time_t now;
+  // Datum ophalen
+  time_t now = timestamp;
   struct tm timeinfo;
-  time(&now);
+  if (now == 0) time(&now);
   localtime_r(&now, &timeinfo);
   
-  // Map pad aanmaken in het formaat "/timelapse/DD-MM-YYYY"
-  sprintf(folderPath, "/timelapse/%02d-%02d-%04d", 
-          timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+  // Map pad aanmaken in het formaat "/timelapse/DD-MM-YYYY"; lokaal, want
+  // de SD-schrijver en de webserver kunnen dit tegelijk aanroepen
+  char folderPath[12 + DAY_NAME_SIZE];
+  snprintf(folderPath, sizeof(folderPath), "/timelapse/%02d-%02d-%04d",
+           timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
   
   // Controleer of de map al bestaat
   if (!SD_MMC.exists(folderPath)) {
@@ -77,7 +80,8 @@ void removeDir(String path) {
       removeDir(String(file.path()));
     } else {
       // Verwijder bestand
-      SD_MMC.remove(String(file.path()));
+      uint32_t size = file.size();
+      if (SD_MMC.remove(String(file.path()))) cardUsageRemove(size);
     }
     file = dir.openNextFile();
   }
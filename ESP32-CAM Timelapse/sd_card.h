@@ -5,7 +5,7 @@
 
 // Functies voor SD-kaart beheer
 bool initSDCard();
-bool createDayFolder();
+bool createDayFolder(time_t timestamp = 0);
 void removeDir(String path);
 String formatFileSize(size_t bytes);
 
@@ -0,0 +1,221 @@
+#include "sd_writer.h"
+#include "camera.h"
+#include "sd_card.h"
+
+// Asynchrone SD-schrijver. De capture-taak kopieert een frame naar een vrij
+// slot in een pool in PSRAM en geeft de camerabuffer direct terug; deze taak
+// schrijft de slots op volgorde naar de SD-kaart. Zijn alle slots bezet omdat
+// de kaart hapert, dan wordt de nieuwe foto overgeslagen in plaats van de
+// camera te blokkeren.
+
+#define WRITER_TASK_STACK      8192
+#define WRITER_TASK_PRIORITY   1
+#define WRITER_TASK_CORE       0
+#define WRITER_POOL_SLOTS      3
+#define WRITER_LATENCY_SAMPLES 64
+
+// Een foto in de pool die op schrijven wacht
+struct WriteJob {
+  uint8_t slot;
+  size_t len;
+  time_t timestamp;
+  unsigned long capturedMs;
+  SemaphoreHandle_t done;
+  volatile bool* result;
+  char* savedPath;           // Optioneel: pad van de opgeslagen foto
+  size_t pathSize;
+};
+
+static uint8_t* poolBuffers[WRITER_POOL_SLOTS];
+static size_t poolSlotSize = 0;
+static uint8_t poolSlots = 0;
+static QueueHandle_t freeSlots = NULL;
+static QueueHandle_t writeQueue = NULL;
+static TaskHandle_t writerTaskHandle = NULL;
+
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static WriterStats stats = {};
+static uint32_t latencySamples[WRITER_LATENCY_SAMPLES];
+static uint32_t latencyCount = 0;
+
+// Registreer het resultaat en de duur van een schrijfactie
+static void recordWrite(bool saved, uint32_t elapsedMs) {
+  portENTER_CRITICAL(&statsMux);
+  if (saved) {
+    stats.written++;
+    latencySamples[latencyCount % WRITER_LATENCY_SAMPLES] = elapsedMs;
+    latencyCount++;
+    if (elapsedMs > stats.maxMs) stats.maxMs = elapsedMs;
+  } else {
+    stats.failed++;
+  }
+  portEXIT_CRITICAL(&statsMux);
+}
+
+// Laat een eventueel wachtende aanroeper weten dat de foto verwerkt is
+static void finishJob(SemaphoreHandle_t done, volatile bool* result, bool saved) {
+  if (result) *result = saved;
+  if (done) xSemaphoreGive(done);
+}
+
+// Schrijftaak: haalt foto's uit de queue en schrijft ze naar de SD-kaart
+static void writerTask(void*) {
+  WriteJob job;
+
+  for (;;) {
+    if (xQueueReceive(writeQueue, &job, portMAX_DELAY) != pdPASS) {
+      continue;
+    }
+
+    unsigned long start = millis();
+    bool saved = createDayFolder(job.timestamp) &&
+                 savePhotoBuffer(poolBuffers[job.slot], job.len, job.timestamp, job.savedPath, job.pathSize);
+    uint32_t elapsed = millis() - start;
+
+    // Slot direct teruggeven zodat de capture-taak het weer kan gebruiken
+    xQueueSend(freeSlots, &job.slot, portMAX_DELAY);
+    recordWrite(saved, elapsed);
+
+    if (saved) {
+      lastPhotoTime = job.capturedMs;
+      Serial.printf("Foto opgeslagen in %u ms\n", elapsed);
+    } else {
+      Serial.println("Fout bij opslaan van foto");
+    }
+
+    finishJob(job.done, job.result, saved);
+  }
+}
+
+// Reserveer de pool en start de schrijftaak
+bool startSdWriter() {
+  // Een JPEG-frame is nooit groter dan de framebuffer van de camera
+  // (breedte * hoogte / 5 bij JPEG)
+  uint8_t wantedSlots;
+  if (psramFound()) {
+    poolSlotSize = 1600 * 1200 / 5;
+    wantedSlots = WRITER_POOL_SLOTS;
+  } else {
+    poolSlotSize = 800 * 600 / 5;
+    wantedSlots = 1;
+  }
+
+  poolSlots = 0;
+  for (uint8_t i = 0; i < wantedSlots; i++) {
+    poolBuffers[i] = psramFound() ? (uint8_t*)ps_malloc(poolSlotSize) : (uint8_t*)malloc(poolSlotSize);
+    if (!poolBuffers[i]) break;
+    poolSlots++;
+  }
+  if (poolSlots == 0) {
+    Serial.println("SD-schrijver: geen geheugen voor de pool, foto's worden synchroon opgeslagen");
+    return false;
+  }
+
+  freeSlots = xQueueCreate(poolSlots, sizeof(uint8_t));
+  writeQueue = xQueueCreate(poolSlots, sizeof(WriteJob));
+  if (!freeSlots || !writeQueue) {
+    Serial.println("SD-schrijver: queues aanmaken mislukt");
+    return false;
+  }
+  for (uint8_t i = 0; i < poolSlots; i++) {
+    xQueueSend(freeSlots, &i, 0);
+  }
+
+  if (xTaskCreatePinnedToCore(writerTask, "sdwriter", WRITER_TASK_STACK, NULL,
+                              WRITER_TASK_PRIORITY, &writerTaskHandle, WRITER_TASK_CORE) != pdPASS) {
+    Serial.println("SD-schrijver: taak starten mislukt");
+    writeQueue = NULL;
+    return false;
+  }
+
+  portENTER_CRITICAL(&statsMux);
+  stats.poolSlots = poolSlots;
+  portEXIT_CRITICAL(&statsMux);
+  Serial.printf("SD-schrijver gestart met %u slots van %u KB\n", poolSlots, (unsigned)(poolSlotSize / 1024));
+  return true;
+}
+
+// Bied een foto aan voor opslag. De inhoud van fb wordt gekopieerd, dus de
+// aanroeper kan de framebuffer direct teruggeven. Geeft false als de foto is
+// overgeslagen omdat er binnen waitMs geen slot vrijkwam; anders wordt 'done'
+// gegeven (en 'result' gezet) zodra de foto is weggeschreven; bij succes
+// staat het pad dan in 'savedPath'.
+bool submitPhoto(camera_fb_t * fb, time_t timestamp, unsigned long waitMs,
+                 SemaphoreHandle_t done, volatile bool* result, char* savedPath, size_t pathSize) {
+  if (!fb) return false;
+
+  // Geen pool of frame te groot voor een slot: synchroon schrijven
+  if (!writeQueue || fb->len > poolSlotSize) {
+    unsigned long start = millis();
+    bool saved = createDayFolder(timestamp) && savePhotoFrame(fb, timestamp, savedPath, pathSize);
+    recordWrite(saved, millis() - start);
+    if (saved) lastPhotoTime = millis();
+    finishJob(done, result, saved);
+    return true;
+  }
+
+  uint8_t slot;
+  if (xQueueReceive(freeSlots, &slot, pdMS_TO_TICKS(waitMs)) != pdPASS) {
+    Serial.println("SD-kaart loopt achter, foto overgeslagen");
+    portENTER_CRITICAL(&statsMux);
+    stats.dropped++;
+    portEXIT_CRITICAL(&statsMux);
+    return false;
+  }
+
+  memcpy(poolBuffers[slot], fb->buf, fb->len);
+
+  WriteJob job;
+  job.slot = slot;
+  job.len = fb->len;
+  job.timestamp = timestamp;
+  job.capturedMs = millis();
+  job.done = done;
+  job.result = result;
+  job.savedPath = savedPath;
+  job.pathSize = pathSize;
+  // Er zijn nooit meer jobs dan slots, dus dit blokkeert niet
+  xQueueSend(writeQueue, &job, portMAX_DELAY);
+
+  uint32_t depth = poolSlots - uxQueueMessagesWaiting(freeSlots);
+  portENTER_CRITICAL(&statsMux);
+  if (depth > stats.maxQueueDepth) stats.maxQueueDepth = depth;
+  portEXIT_CRITICAL(&statsMux);
+  return true;
+}
+
+// Waarde op percentiel p (0-100) van een gesorteerde reeks
+static uint32_t percentileOf(const uint32_t* sorted, uint32_t count, uint32_t p) {
+  if (count == 0) return 0;
+  uint32_t index = (count - 1) * p / 100;
+  return sorted[index];
+}
+
+// Kopie van de statistieken, inclusief latentiepercentielen
+WriterStats getWriterStats() {
+  uint32_t sorted[WRITER_LATENCY_SAMPLES];
+  uint32_t count;
+
+  portENTER_CRITICAL(&statsMux);
+  WriterStats copy = stats;
+  count = latencyCount < WRITER_LATENCY_SAMPLES ? latencyCount : WRITER_LATENCY_SAMPLES;
+  memcpy(sorted, latencySamples, count * sizeof(uint32_t));
+  portEXIT_CRITICAL(&statsMux);
+
+  // Insertion sort: hooguit 64 waarden
+  for (uint32_t i = 1; i < count; i++) {
+    uint32_t value = sorted[i];
+    int32_t j = i - 1;
+    while (j >= 0 && sorted[j] > value) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+
+  copy.p50Ms = percentileOf(sorted, count, 50);
+  copy.p95Ms = percentileOf(sorted, count, 95);
+  copy.p99Ms = percentileOf(sorted, count, 99);
+  copy.queueDepth = freeSlots ? poolSlots - uxQueueMessagesWaiting(freeSlots) : 0;
+  return copy;
+}
@@ -0,0 +1,31 @@
+#ifndef SD_WRITER_H
+#define SD_WRITER_H
+
+#include "config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// Statistieken van de asynchrone SD-schrijver
+struct WriterStats {
+  uint32_t queueDepth;       // Foto's die nu op schrijven wachten
+  uint32_t maxQueueDepth;
+  uint32_t poolSlots;
+  uint32_t written;
+  uint32_t dropped;          // Overgeslagen omdat alle poolslots bezet waren
+  uint32_t failed;           // Schrijven naar de SD-kaart mislukt
+  uint32_t p50Ms;            // Schrijflatentie percentielen (laatste metingen)
+  uint32_t p95Ms;
+  uint32_t p99Ms;
+  uint32_t maxMs;
+};
+
+// Functies voor de asynchrone SD-schrijver
+bool startSdWriter();
+bool submitPhoto(camera_fb_t * fb, time_t timestamp, unsigned long waitMs,
+                 SemaphoreHandle_t done = NULL, volatile bool* result = NULL,
+                 char* savedPath = NULL, size_t pathSize = 0);
+WriterStats getWriterStats();
+
+#endif // SD_WRITER_H
@@ -6,16 +6,27 @@ int photoInterval = 5;    // Standaard 5 minuten tussen foto's
 int dayStartHour = 8;     // Start om 8:00
 int dayEndHour = 20;      // Eindigt om 20:00
 int jpegQuality = 10;     // Hoge kwaliteit
+int captureMode = CAPTURE_MODE_INTERVAL;
+int retentionMaxMB = 0;   // Tot de kaart op de reserve na vol is
+int retentionMaxDays = 0; // Geen maximum aantal dagen
+int thinAfterDays = 0;    // Niet uitdunnen
+int thinKeepEvery = 4;    // Bij uitdunnen elke 4e foto bewaren
 
 // Bereken een eenvoudige checksum voor instellingen validatie
 uint32_t calculateChecksum(TimelapseSavedSettings* settings) {
   return settings->photoInterval + settings->dayStartHour + settings->dayEndHour + 
-         settings->jpegQuality + SETTINGS_CHECKSUM;
+         settings->jpegQuality + settings->captureMode + SETTINGS_CHECKSUM;
+}
+
+// Checksum van het bewaarbeleid
+uint32_t calculateRetentionChecksum(RetentionSavedSettings* settings) {
+  return settings->maxMB + settings->maxDays + settings->thinAfterDays +
+         settings->thinKeepEvery + RETENTION_SETTINGS_CHECKSUM;
 }
 
 // Laad instellingen uit flash (EEPROM emulatie)
 void loadSettings() {
-  EEPROM.begin(sizeof(TimelapseSavedSettings));
+  EEPROM.begin(sizeof(TimelapseSavedSettings) + sizeof(RetentionSavedSettings));
   
   TimelapseSavedSettings savedSettings;
   EEPROM.get(0, savedSettings);
@@ -26,34 +37,67 @@ void loadSettings() {
     dayStartHour = savedSettings.dayStartHour;
     dayEndHour = savedSettings.dayEndHour;
     jpegQuality = savedSettings.jpegQuality;
+    captureMode = savedSettings.captureMode == CAPTURE_MODE_CHANGE ? CAPTURE_MODE_CHANGE : CAPTURE_MODE_INTERVAL;
     Serial.println("Instellingen geladen uit flash");
+  } else if ((uint32_t)savedSettings.captureMode == (uint32_t)(savedSettings.photoInterval + savedSettings.dayStartHour +
+             savedSettings.dayEndHour + savedSettings.jpegQuality + SETTINGS_CHECKSUM)) {
+    // Instellingen van oudere firmware, nog zonder opnamemodus
+    photoInterval = savedSettings.photoInterval;
+    dayStartHour = savedSettings.dayStartHour;
+    dayEndHour = savedSettings.dayEndHour;
+    jpegQuality = savedSettings.jpegQuality;
+    Serial.println("Instellingen van oudere firmware geladen uit flash");
   } else {
     Serial.println("Geen geldige instellingen gevonden in flash, standaardwaarden worden gebruikt");
   }
   
+  // Bewaarbeleid; ontbreekt bij instellingen van oudere firmware
+  RetentionSavedSettings retention;
+  EEPROM.get(sizeof(TimelapseSavedSettings), retention);
+  if (calculateRetentionChecksum(&retention) == retention.checksum) {
+    retentionMaxMB = max(retention.maxMB, 0);
+    retentionMaxDays = max(retention.maxDays, 0);
+    thinAfterDays = max(retention.thinAfterDays, 0);
+    thinKeepEvery = constrain(retention.thinKeepEvery, 2, 60);
+  }
+  
   EEPROM.end();
 }
 
 // Sla instellingen op in flash (EEPROM emulatie)
 void saveSettings() {
   // Preferenties in EEPROM opslaan
-  EEPROM.begin(sizeof(TimelapseSavedSettings));
+  EEPROM.begin(sizeof(TimelapseSavedSettings) + sizeof(RetentionSavedSettings));
   
   TimelapseSavedSettings savedSettings;
   savedSettings.photoInterval = photoInterval;
   savedSettings.dayStartHour = dayStartHour;
   savedSettings.dayEndHour = dayEndHour;
   savedSettings.jpegQuality = jpegQuality;
+  savedSettings.captureMode = captureMode;
   savedSettings.checksum = calculateChecksum(&savedSettings);
   
+  RetentionSavedSettings retention;
+  retention.maxMB = retentionMaxMB;
+  retention.maxDays = retentionMaxDays;
+  retention.thinAfterDays = thinAfterDays;
+  retention.thinKeepEvery = thinKeepEvery;
+  retention.checksum = calculateRetentionChecksum(&retention);
+  
   // Debug info printen
   Serial.println("Opslaan van instellingen:");
   Serial.println("photoInterval: " + String(photoInterval));
   Serial.println("dayStartHour: " + String(dayStartHour));
   Serial.println("dayEndHour: " + String(dayEndHour));
   Serial.println("jpegQuality: " + String(jpegQuality));
+  Serial.println("captureMode: " + String(captureMode));
+  Serial.println("retentionMaxMB: " + String(retentionMaxMB));
+  Serial.println("retentionMaxDays: " + String(retentionMaxDays));
+  Serial.println("thinAfterDays: " + String(thinAfterDays));
+  Serial.println("thinKeepEvery: " + String(thinKeepEvery));
   
   EEPROM.put(0, savedSettings);
+  EEPROM.put(sizeof(TimelapseSavedSettings), retention);
   bool success = EEPROM.commit();
   Serial.println("EEPROM commit resultaat: " + String(success ? "Succesvol" : "Mislukt"));
   EEPROM.end();
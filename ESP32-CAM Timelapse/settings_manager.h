@@ -8,10 +8,16 @@ extern int photoInterval;  // Tijd tussen foto's in minuten
 extern int dayStartHour;   // Start tijdstip voor foto's
 extern int dayEndHour;     // Eind tijdstip voor foto's
 extern int jpegQuality;    // JPEG kwaliteit (0-63)
+extern int captureMode;    // Vast interval of bij verandering
+extern int retentionMaxMB;   // Maximaal kaartgebruik in MB
+extern int retentionMaxDays; // Maximaal aantal dagen
+extern int thinAfterDays;    // Dagen ouder dan dit uitdunnen
+extern int thinKeepEvery;    // Bij uitdunnen elke N-de foto bewaren
 
 // Functie voor instellingenbeheer
 void loadSettings();
 void saveSettings();
 uint32_t calculateChecksum(TimelapseSavedSettings* settings);
+uint32_t calculateRetentionChecksum(RetentionSavedSettings* settings);
 
 #endif // SETTINGS_MANAGER_H
\ No newline at end of file
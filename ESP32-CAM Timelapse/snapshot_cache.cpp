@@ -0,0 +1,172 @@
+#include "snapshot_cache.h"
+#include "camera.h"
+#include "web_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Het dashboard vraagt /snapshot periodiek op, soms voor meerdere camera's
+// tegelijk. Zolang het laatste frame jonger is dan de maximale leeftijd gaat
+// dat frame uit de cache (met ETag, zodat een ongewijzigd frame een 304 wordt).
+// Pas een verouderd frame leidt tot een nieuwe opname, en verzoeken die
+// tegelijk binnenkomen wachten op die ene opname in plaats van elk de camera
+// aan te spreken. Frames staan in buffers met referentietelling, zodat een
+// nieuwe opname een frame dat nog verstuurd wordt niet overschrijft.
+
+// Een gecachet frame; refs telt de cache (nieuwste frame) en de verzoeken die het versturen
+struct SnapshotBuffer {
+  uint8_t* data;
+  size_t capacity;
+  size_t length;
+  uint32_t sequence;
+  unsigned long capturedAt;
+  uint8_t refs;
+};
+
+static SnapshotBuffer buffers[SNAPSHOT_BUFFERS];
+static SnapshotBuffer* latest = NULL;
+static uint32_t sequence = 0;
+static SemaphoreHandle_t captureLock = NULL;
+
+static portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+static SnapshotStats stats = {};
+
+// Het nieuwste frame vasthouden als het jong genoeg is
+static SnapshotBuffer* acquireFresh(uint32_t maxAgeMs) {
+  portENTER_CRITICAL(&snapshotMux);
+  SnapshotBuffer* frame = latest;
+  if (frame && millis() - frame->capturedAt <= maxAgeMs) {
+    frame->refs++;
+  } else {
+    frame = NULL;
+  }
+  portEXIT_CRITICAL(&snapshotMux);
+  return frame;
+}
+
+static void releaseFrame(SnapshotBuffer* frame) {
+  portENTER_CRITICAL(&snapshotMux);
+  if (frame->refs > 0) frame->refs--;
+  portEXIT_CRITICAL(&snapshotMux);
+}
+
+// Nieuwe opname in een vrije buffer; geeft het frame vastgehouden terug
+static SnapshotBuffer* captureFrame() {
+  camera_fb_t * fb = cameraGetFrame();
+  if (!fb) {
+    Serial.println("Camera frame capture mislukt");
+    return NULL;
+  }
+
+  SnapshotBuffer* frame = NULL;
+  portENTER_CRITICAL(&snapshotMux);
+  for (int i = 0; i < SNAPSHOT_BUFFERS && !frame; i++) {
+    if (buffers[i].refs == 0) {
+      frame = &buffers[i];
+      frame->refs = 1;
+    }
+  }
+  portEXIT_CRITICAL(&snapshotMux);
+
+  if (frame && frame->capacity < fb->len) {
+    free(frame->data);
+    size_t capacity = fb->len + fb->len / 4;  // Ruimte voor iets grotere frames
+    frame->data = psramFound() ? (uint8_t*)ps_malloc(capacity) : (uint8_t*)malloc(capacity);
+    frame->capacity = frame->data ? capacity : 0;
+  }
+  if (!frame || !frame->data) {
+    if (frame) releaseFrame(frame);
+    esp_camera_fb_return(fb);
+    Serial.println("Momentopname: geen vrije buffer");
+    return NULL;
+  }
+
+  memcpy(frame->data, fb->buf, fb->len);
+  frame->length = fb->len;
+  esp_camera_fb_return(fb);
+
+  // Nieuwste frame vervangen; de cache en de aanroeper houden het vast
+  portENTER_CRITICAL(&snapshotMux);
+  frame->sequence = ++sequence;
+  frame->capturedAt = millis();
+  frame->refs = 2;
+  if (latest && latest->refs > 0) latest->refs--;
+  latest = frame;
+  portEXIT_CRITICAL(&snapshotMux);
+  return frame;
+}
+
+// Maak het slot voor opnames aan; zonder slot neemt elk verzoek zelf een opname
+bool initSnapshotCache() {
+  captureLock = xSemaphoreCreateMutex();
+  if (!captureLock) {
+    Serial.println("Momentopnamecache: geheugen voor semafoor ontbreekt");
+    return false;
+  }
+  return true;
+}
+
+// Stuur een momentopname die hooguit maxAgeMs oud is
+void sendSnapshot(WiFiClient& client, HttpRequest& request, uint32_t maxAgeMs) {
+  maxAgeMs = min(maxAgeMs, (uint32_t)SNAPSHOT_MAX_AGE_LIMIT);
+
+  bool hit = false, coalesced = false, captured = false;
+  SnapshotBuffer* frame = acquireFresh(maxAgeMs);
+  if (frame) {
+    hit = true;
+  } else if (!captureLock) {
+    frame = captureFrame();
+    captured = frame != NULL;
+  } else if (xSemaphoreTake(captureLock, pdMS_TO_TICKS(SNAPSHOT_CAPTURE_WAIT)) == pdTRUE) {
+    // Tijdens het wachten kan een ander verzoek al een opname hebben gemaakt
+    frame = acquireFresh(maxAgeMs);
+    if (frame) {
+      coalesced = true;
+    } else {
+      frame = captureFrame();
+      captured = frame != NULL;
+    }
+    xSemaphoreGive(captureLock);
+  }
+
+  char etag[24];
+  bool notModified = false;
+  if (frame) {
+    snprintf(etag, sizeof(etag), "\"snap-%x\"", frame->sequence);
+    notModified = requestNotModified(request, etag, "");
+  }
+
+  portENTER_CRITICAL(&snapshotMux);
+  stats.requests++;
+  if (hit) stats.hits++;
+  if (coalesced) stats.coalesced++;
+  if (captured) stats.captures++;
+  if (!frame) stats.failed++;
+  if (notModified) stats.notModified++;
+  portEXIT_CRITICAL(&snapshotMux);
+
+  if (!frame) {
+    sendHttpError(client, request, 500);
+    return;
+  }
+
+  String headers = "ETag: " + String(etag) + "\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Age: " + String((millis() - frame->capturedAt) / 1000) + "\r\n";
+  if (notModified) {
+    sendHttpResponse(client, request, 304, "", 0, headers);
+  } else {
+    sendHttpResponse(client, request, 200, "image/jpeg", frame->length, headers);
+    if (client.write(frame->data, frame->length) < frame->length) {
+      request.keepAlive = false;
+    }
+  }
+  releaseFrame(frame);
+}
+
+// Kopie van de statistieken
+SnapshotStats getSnapshotStats() {
+  portENTER_CRITICAL(&snapshotMux);
+  SnapshotStats copy = stats;
+  portEXIT_CRITICAL(&snapshotMux);
+  return copy;
+}
\ No newline at end of file
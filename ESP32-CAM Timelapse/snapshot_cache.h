@@ -0,0 +1,29 @@
+#ifndef SNAPSHOT_CACHE_H
+#define SNAPSHOT_CACHE_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "http_parser.h"
+
+// Momentopnamen (/snapshot) uit een cache van het laatste frame
+#define SNAPSHOT_MAX_AGE_MS     2000     // Ouder frame: nieuwe opname maken
+#define SNAPSHOT_MAX_AGE_LIMIT  60000    // Grootste waarde voor ?maxage=
+#define SNAPSHOT_BUFFERS        4        // Nieuwste frame plus frames die nog verstuurd worden
+#define SNAPSHOT_CAPTURE_WAIT   5000     // ms wachten op een lopende opname
+
+// Statistieken van de momentopnamecache
+struct SnapshotStats {
+  uint32_t requests;
+  uint32_t hits;             // Vers frame uit de cache
+  uint32_t coalesced;        // Meegelift met de opname van een ander verzoek
+  uint32_t captures;         // Opnames voor /snapshot
+  uint32_t failed;
+  uint32_t notModified;      // 304: de client had dit frame al
+};
+
+// Functies voor de momentopnamecache
+bool initSnapshotCache();
+void sendSnapshot(WiFiClient& client, HttpRequest& request, uint32_t maxAgeMs);
+SnapshotStats getSnapshotStats();
+
+#endif // SNAPSHOT_CACHE_H
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include "stream_broadcaster.h"
+#include "camera.h"
+#include "web_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+// Eén taak haalt zolang er kijkers zijn frames van de camera, kopieert ze
+// naar een framebuffer met referentietelling en geeft het camerabuffer direct
+// terug. Elke kijker draait op zijn eigen webserver-worker en stuurt steeds
+// het nieuwste frame; frames die verschijnen terwijl een trage client nog
+// bezig is, worden voor alleen die client overgeslagen. De bron wacht op
+// niemand, dus één trage kijker houdt de anderen niet op.
+//
+// Per kijker meet een regeling de verzendtijd en de vertraging van opname
+// tot verzonden frame. Loopt die boven STREAM_LATENCY_TARGET_MS, of is de
+// verbinding het grootste deel van de tijd bezig, dan gaat eerst het aantal
+// beelden per seconde omlaag tot STREAM_COMFORT_FPS, daarna de framegrootte
+// en kwaliteit; bij ruimte gaat het in omgekeerde volgorde terug. Zo blijven
+// er geen seconden aan frames in de TCP-buffers hangen. De camera gebruikt
+// het beste niveau dat een kijker aankan; tragere kijkers krijgen minder
+// beelden. Timelapse-opnames gebruiken altijd de volledige instellingen.
+
+#define BROADCAST_TASK_STACK    4096
+#define BROADCAST_TASK_PRIORITY 2
+#define BROADCAST_TASK_CORE     0
+#define STREAM_FRAME_POOL       (STREAM_MAX_VIEWERS + 2)  // Nieuwste, in vulling en één per kijker
+
+// Beeldniveaus 1 en hoger; niveau 0 zijn de instellingen van de timelapse
+static const CameraProfile streamProfiles[STREAM_LEVELS - 1] = {
+  { FRAMESIZE_SVGA, 12 },
+  { FRAMESIZE_VGA,  15 },
+  { FRAMESIZE_CIF,  20 },
+  { FRAMESIZE_QVGA, 25 },
+};
+
+// Een gedeeld frame; refs telt de bron (nieuwste frame) en de kijkers die het versturen
+struct StreamFrame {
+  uint8_t* data;
+  size_t capacity;
+  size_t length;
+  uint32_t sequence;
+  unsigned long capturedAt;
+  uint8_t refs;
+};
+
+// Een aangemelde kijker met de toestand van zijn regeling
+struct StreamViewer {
+  bool active;
+  SemaphoreHandle_t frameReady;
+  uint8_t requestedFps;
+  uint8_t fps;
+  uint8_t level;
+  unsigned long since;
+  unsigned long lastAdjustAt;
+  uint32_t sendMs;
+  uint32_t latencyMs;
+  uint32_t framesSent;
+  uint32_t framesDropped;
+  uint64_t bytesSent;
+};
+
+static TaskHandle_t broadcastTaskHandle = NULL;
+static StreamFrame frames[STREAM_FRAME_POOL];
+static StreamFrame* latest = NULL;
+static StreamViewer viewers[STREAM_MAX_VIEWERS];
+static uint32_t sequence = 0;
+
+static portMUX_TYPE streamMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t captured = 0;
+static uint32_t failed = 0;
+static uint64_t captureUs = 0;
+static uint32_t sessionFrames = 0;
+static unsigned long sessionStart = 0;
+static uint8_t targetFps = 0;
+static uint8_t cameraLevel = 0;
+static uint16_t frameWidth = 0;
+static uint16_t frameHeight = 0;
+static uint8_t frameQuality = 0;
+
+// Aantal kijkers, hun hoogste snelheid en beste beeldniveau; alleen met streamMux
+static uint8_t activeViewers(uint8_t* maxFps, uint8_t* bestLevel) {
+  uint8_t count = 0;
+  uint8_t fps = 0;
+  uint8_t level = STREAM_LEVELS - 1;
+  for (int i = 0; i < STREAM_MAX_VIEWERS; i++) {
+    if (!viewers[i].active) continue;
+    count++;
+    if (viewers[i].fps > fps) fps = viewers[i].fps;
+    if (viewers[i].level < level) level = viewers[i].level;
+  }
+  if (maxFps) *maxFps = fps;
+  if (bestLevel) *bestLevel = count > 0 ? level : 0;
+  return count;
+}
+
+// Geef een frame terug; alleen met streamMux
+static void releaseFrameLocked(StreamFrame* frame) {
+  if (frame && frame->refs > 0) frame->refs--;
+}
+
+// Zonder kijkers: het laatste frame loslaten en de buffers vrijgeven
+static void releaseFramePool() {
+  portENTER_CRITICAL(&streamMux);
+  releaseFrameLocked(latest);
+  latest = NULL;
+  portEXIT_CRITICAL(&streamMux);
+
+  for (int i = 0; i < STREAM_FRAME_POOL; i++) {
+    if (frames[i].refs == 0 && frames[i].data) {
+      free(frames[i].data);
+      frames[i].data = NULL;
+      frames[i].capacity = 0;
+    }
+  }
+}
+
+// Haal een frame van de camera en maak het het nieuwste frame
+static void captureFrame(uint8_t level) {
+  unsigned long start = micros();
+  CameraProfile profile = level == 0 ? cameraCaptureProfile() : streamProfiles[level - 1];
+  camera_fb_t * fb = cameraGetFrame(&profile);
+  unsigned long capturedAt = millis();
+  if (!fb) {
+    portENTER_CRITICAL(&streamMux);
+    failed++;
+    portEXIT_CRITICAL(&streamMux);
+    Serial.println("Camera frame capture mislukt");
+    delay(100);
+    return;
+  }
+
+  // Vrije buffer zoeken; de pool is groot genoeg dat er altijd één is
+  StreamFrame* frame = NULL;
+  portENTER_CRITICAL(&streamMux);
+  for (int i = 0; i < STREAM_FRAME_POOL && !frame; i++) {
+    if (frames[i].refs == 0) {
+      frame = &frames[i];
+      frame->refs = 1;
+    }
+  }
+  portEXIT_CRITICAL(&streamMux);
+  if (!frame) {
+    esp_camera_fb_return(fb);
+    return;
+  }
+
+  if (frame->capacity < fb->len) {
+    free(frame->data);
+    size_t capacity = fb->len + fb->len / 4;  // Ruimte voor iets grotere frames
+    frame->data = psramFound() ? (uint8_t*)ps_malloc(capacity) : (uint8_t*)malloc(capacity);
+    frame->capacity = frame->data ? capacity : 0;
+  }
+  bool copied = frame->data != NULL;
+  if (copied) {
+    memcpy(frame->data, fb->buf, fb->len);
+    frame->length = fb->len;
+  }
+  uint16_t width = fb->width;
+  uint16_t height = fb->height;
+  esp_camera_fb_return(fb);
+  uint32_t elapsed = micros() - start;
+
+  portENTER_CRITICAL(&streamMux);
+  if (copied) {
+    frame->sequence = ++sequence;
+    frame->capturedAt = capturedAt;
+    frameWidth = width;
+    frameHeight = height;
+    frameQuality = profile.quality;
+    releaseFrameLocked(latest);
+    latest = frame;
+    captured++;
+    sessionFrames++;
+    captureUs += elapsed;
+  } else {
+    frame->refs = 0;
+    failed++;
+  }
+  portEXIT_CRITICAL(&streamMux);
+
+  if (!copied) {
+    Serial.println("Livestream: geen geheugen voor framebuffer");
+    delay(100);
+    return;
+  }
+
+  // Alle kijkers wekken; een kijker die nog verstuurt ziet het bij de volgende ronde
+  for (int i = 0; i < STREAM_MAX_VIEWERS; i++) {
+    if (viewers[i].active) xSemaphoreGive(viewers[i].frameReady);
+  }
+}
+
+// Framebron: slaapt zonder kijkers, maakt anders frames op de hoogste snelheid
+// en het beste beeldniveau dat de kijkers aankunnen
+static void broadcastTask(void*) {
+  unsigned long nextFrameAt = millis();
+
+  for (;;) {
+    uint8_t fps, level;
+    portENTER_CRITICAL(&streamMux);
+    uint8_t count = activeViewers(&fps, &level);
+    targetFps = fps;
+    cameraLevel = level;
+    portEXIT_CRITICAL(&streamMux);
+
+    if (count == 0) {
+      releaseFramePool();
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      portENTER_CRITICAL(&streamMux);
+      sessionFrames = 0;
+      sessionStart = millis();
+      portEXIT_CRITICAL(&streamMux);
+      nextFrameAt = millis();
+      continue;
+    }
+
+    long wait = (long)(nextFrameAt - millis());
+    if (wait > 0) {
+      // Wakker worden bij een nieuwe kijker, die mogelijk sneller wil
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+      continue;
+    }
+    unsigned long interval = 1000 / fps;
+    nextFrameAt = (wait < -(long)interval) ? millis() + interval : nextFrameAt + interval;
+
+    captureFrame(level);
+  }
+}
+
+// Start de framebron; zonder taak valt /stream terug op één kijker tegelijk
+bool startStreamBroadcaster() {
+  for (int i = 0; i < STREAM_MAX_VIEWERS; i++) {
+    viewers[i].frameReady = xSemaphoreCreateBinary();
+    if (!viewers[i].frameReady) {
+      Serial.println("Livestream: geheugen voor semaforen ontbreekt");
+      return false;
+    }
+  }
+
+  if (xTaskCreatePinnedToCore(broadcastTask, "stream", BROADCAST_TASK_STACK, NULL,
+                              BROADCAST_TASK_PRIORITY, &broadcastTaskHandle, BROADCAST_TASK_CORE) != pdPASS) {
+    Serial.println("Livestream-taak starten mislukt");
+    return false;
+  }
+
+  Serial.println("Livestream-taak gestart");
+  return true;
+}
+
+// Regeling van één kijker na een verstuurd frame; alleen met streamMux.
+// Eerst minder beelden tot STREAM_COMFORT_FPS, dan een lager beeldniveau,
+// en als laatste nog minder beelden; bij ruimte in omgekeerde volgorde terug.
+static void adjustViewer(StreamViewer& viewer, uint32_t sendMs, uint32_t latencyMs) {
+  // Gemiddelden over de laatste frames (EWMA, 1/4 nieuw)
+  if (viewer.framesSent <= 1) {
+    viewer.sendMs = sendMs;
+    viewer.latencyMs = latencyMs;
+  } else {
+    viewer.sendMs = (viewer.sendMs * 3 + sendMs) / 4;
+    viewer.latencyMs = (viewer.latencyMs * 3 + latencyMs) / 4;
+  }
+
+  unsigned long now = millis();
+  uint32_t sinceAdjust = now - viewer.lastAdjustAt;
+  if (sinceAdjust < STREAM_ADJUST_MS) return;
+
+  // Milliseconden per seconde dat de verbinding bezig is met versturen
+  uint32_t busy = viewer.sendMs * viewer.fps;
+  uint8_t comfort = min((uint8_t)STREAM_COMFORT_FPS, viewer.requestedFps);
+  uint8_t fps = viewer.fps;
+  uint8_t level = viewer.level;
+
+  if (viewer.latencyMs > STREAM_LATENCY_TARGET_MS || busy > 800) {
+    // Ruim boven het doel: direct naar STREAM_COMFORT_FPS
+    if (fps > comfort) fps = viewer.latencyMs > STREAM_LATENCY_TARGET_MS * 3 / 2 ? comfort : max(comfort, (uint8_t)(fps * 3 / 4));
+    else if (level < STREAM_LEVELS - 1) level++;
+    else if (fps > 1) fps--;
+  } else if (viewer.latencyMs < STREAM_LATENCY_TARGET_MS / 2 && busy < 400) {
+    // Omhoog voorzichtiger dan omlaag
+    if (sinceAdjust < 2 * STREAM_ADJUST_MS) return;
+    if (fps < comfort) fps++;
+    else if (level > 0) level--;
+    else if (fps < viewer.requestedFps) fps++;
+  }
+
+  if (fps != viewer.fps || level != viewer.level) {
+    viewer.fps = fps;
+    viewer.level = level;
+    viewer.lastAdjustAt = now;
+  }
+}
+
+// Stuur één frame als multipart-deel
+static bool sendStreamFrame(WiFiClient& client, const uint8_t* data, size_t length) {
+  client.println("--frame");
+  client.println("Content-Type: image/jpeg");
+  client.print("Content-Length: ");
+  client.println(length);
+  client.println();
+  bool sent = client.write(data, length) == length;
+  client.println();
+  return sent;
+}
+
+// Oude werkwijze zonder framebron: elke iteratie een eigen camerabeeld
+static void serveStreamDirect(WiFiClient& client, uint32_t fps) {
+  unsigned long streamStartTime = millis();
+  while (client.connected() && (millis() - streamStartTime < STREAM_DURATION_MS)) {
+    camera_fb_t * fb = cameraGetFrame();
+    if (!fb) {
+      Serial.println("Camera frame capture mislukt");
+      break;
+    }
+    bool sent = sendStreamFrame(client, fb->buf, fb->len);
+    esp_camera_fb_return(fb);
+    if (!sent) break;
+    delay(1000 / fps);
+  }
+}
+
+// Bedien één kijker van de livestream tot STREAM_DURATION_MS verstreken is
+// of de client de verbinding verbreekt
+void serveStreamViewer(WiFiClient& client, HttpRequest& request, uint32_t fps) {
+  fps = constrain(fps, (uint32_t)1, (uint32_t)STREAM_MAX_FPS);
+
+  // Aanmelden bij de framebron
+  int slot = -1;
+  if (broadcastTaskHandle) {
+    portENTER_CRITICAL(&streamMux);
+    for (int i = 0; i < STREAM_MAX_VIEWERS && slot < 0; i++) {
+      if (!viewers[i].active) {
+        slot = i;
+        SemaphoreHandle_t frameReady = viewers[i].frameReady;
+        viewers[i] = {};
+        viewers[i].active = true;
+        viewers[i].frameReady = frameReady;
+        viewers[i].requestedFps = fps;
+        viewers[i].fps = fps;
+        viewers[i].since = millis();
+        viewers[i].lastAdjustAt = millis();
+      }
+    }
+    portEXIT_CRITICAL(&streamMux);
+    if (slot < 0) {
+      sendHttpResponse(client, request, 503, "text/plain", 0, "Retry-After: 5\r\n");
+      return;
+    }
+    xSemaphoreTake(viewers[slot].frameReady, 0);
+    xTaskNotifyGive(broadcastTaskHandle);
+  }
+
+  client.println("HTTP/1.1 200 OK");
+  client.println("Content-Type: multipart/x-mixed-replace; boundary=frame");
+  client.println("Cache-Control: no-cache");
+  client.println("Connection: close");
+  client.println();
+
+  if (slot < 0) {
+    serveStreamDirect(client, fps);
+    return;
+  }
+
+  StreamViewer& viewer = viewers[slot];
+  uint32_t lastSequence = 0;
+  unsigned long nextDueAt = millis();
+  unsigned long streamStartTime = millis();
+
+  while (client.connected() && millis() - streamStartTime < STREAM_DURATION_MS) {
+    if (xSemaphoreTake(viewer.frameReady, pdMS_TO_TICKS(STREAM_FRAME_TIMEOUT)) != pdTRUE) {
+      Serial.println("Livestream: geen frames van de camera");
+      break;
+    }
+
+    // Nieuwste frame vasthouden; frames tussendoor waren er terwijl deze client nog verstuurde
+    portENTER_CRITICAL(&streamMux);
+    StreamFrame* frame = latest;
+    if (frame) frame->refs++;
+    portEXIT_CRITICAL(&streamMux);
+    if (!frame) continue;
+
+    // Een wachtende kijker ziet elk frame; een gat in de volgnummers zijn
+    // frames die kwamen terwijl deze client nog aan het versturen was
+    if (lastSequence != 0 && frame->sequence - lastSequence > 1) {
+      portENTER_CRITICAL(&streamMux);
+      viewer.framesDropped += frame->sequence - lastSequence - 1;
+      portEXIT_CRITICAL(&streamMux);
+    }
+
+    // Langzamere kijker: alleen frames op het eigen tempo versturen, zonder
+    // een achterstand in te halen
+    uint32_t interval = 1000 / viewer.fps;
+    bool due = (long)(millis() - nextDueAt) + (long)(interval / 4) >= 0;
+    bool sent = true;
+    if (due && frame->sequence != lastSequence) {
+      nextDueAt += interval;
+      if ((long)(millis() - nextDueAt) > 0) nextDueAt = millis();
+      unsigned long start = micros();
+      sent = sendStreamFrame(client, frame->data, frame->length);
+      uint32_t sendMs = (micros() - start) / 1000;
+      // Vertraging van opname tot het frame de socket uit is; lwIP laat
+      // write() pas terugkeren als bijna alles bevestigd is
+      uint32_t latencyMs = millis() - frame->capturedAt;
+      portENTER_CRITICAL(&streamMux);
+      if (sent) {
+        viewer.framesSent++;
+        viewer.bytesSent += frame->length;
+        adjustViewer(viewer, sendMs, latencyMs);
+      }
+      portEXIT_CRITICAL(&streamMux);
+    }
+    lastSequence = frame->sequence;
+
+    portENTER_CRITICAL(&streamMux);
+    releaseFrameLocked(frame);
+    portEXIT_CRITICAL(&streamMux);
+    if (!sent) break;
+  }
+
+  // Afmelden; de statistieken blijven staan tot de volgende kijker dit slot krijgt
+  unsigned long seconds = (millis() - viewer.since) / 1000;
+  portENTER_CRITICAL(&streamMux);
+  viewer.active = false;
+  portEXIT_CRITICAL(&streamMux);
+  Serial.printf("Livestream gestopt na %lu s: %u frames verstuurd, %u overgeslagen, laatst %u fps op niveau %u (%u ms vertraging)\n",
+                seconds, viewer.framesSent, viewer.framesDropped, viewer.fps, viewer.level, viewer.latencyMs);
+}
+
+// Statistieken van de framebron en (optioneel) van de actieve kijkers
+StreamStats getStreamStats(StreamViewerStats* viewerStats, int maxViewers) {
+  StreamStats result = {};
+  unsigned long now = millis();
+  int listed = 0;
+
+  portENTER_CRITICAL(&streamMux);
+  result.viewers = activeViewers(NULL, NULL);
+  result.targetFps = targetFps;
+  result.level = cameraLevel;
+  result.frameWidth = frameWidth;
+  result.frameHeight = frameHeight;
+  result.quality = frameQuality;
+  result.captured = captured;
+  result.failed = failed;
+  unsigned long sessionMs = now - sessionStart;
+  result.fpsX10 = result.viewers > 0 && sessionMs > 0 ? (uint32_t)((uint64_t)sessionFrames * 10000 / sessionMs) : 0;
+  result.avgCaptureUs = captured > 0 ? (uint32_t)(captureUs / captured) : 0;
+  uint32_t largestFrame = 0;
+  for (int i = 0; i < STREAM_FRAME_POOL; i++) {
+    result.frameBytes += frames[i].capacity;
+    if (frames[i].capacity > largestFrame) largestFrame = frames[i].capacity;
+  }
+  result.bytesPerViewer = largestFrame + sizeof(StreamViewer);
+
+  for (int i = 0; i < STREAM_MAX_VIEWERS && listed < maxViewers; i++) {
+    const StreamViewer& viewer = viewers[i];
+    if (!viewer.active) continue;
+    StreamViewerStats& out = viewerStats[listed++];
+    unsigned long connectedMs = now - viewer.since;
+    out.requestedFps = viewer.requestedFps;
+    out.fps = viewer.fps;
+    out.level = viewer.level;
+    out.sendMs = viewer.sendMs;
+    out.latencyMs = viewer.latencyMs;
+    out.fpsX10 = connectedMs > 0 ? (uint32_t)((uint64_t)viewer.framesSent * 10000 / connectedMs) : 0;
+    out.framesSent = viewer.framesSent;
+    out.framesDropped = viewer.framesDropped;
+    out.kbSent = viewer.bytesSent / 1024;
+    out.seconds = connectedMs / 1000;
+  }
+  portEXIT_CRITICAL(&streamMux);
+  return result;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef STREAM_BROADCASTER_H
+#define STREAM_BROADCASTER_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "http_parser.h"
+#include "web_server.h"
+
+// Livestream voor meerdere kijkers: één taak maakt de frames, elke kijker
+// krijgt steeds het nieuwste frame
+#define STREAM_MAX_VIEWERS   HTTP_LONG_WORKERS // Eén worker blijft vrij voor korte verzoeken
+#define STREAM_DEFAULT_FPS   10
+#define STREAM_MAX_FPS       25
+#define STREAM_DURATION_MS   30000    // Duur van een livestream per kijker
+#define STREAM_FRAME_TIMEOUT 2000     // ms zonder nieuw frame: stream stoppen
+
+// Snelheidsregeling per kijker: beelden per seconde, en daaronder framegrootte
+// en kwaliteit, worden aangepast zodat een frame binnen de doelvertraging aankomt
+#define STREAM_LATENCY_TARGET_MS 500  // Opname tot verzonden
+#define STREAM_COMFORT_FPS   5        // Eerst tot hier minder beelden, dan kleinere frames
+#define STREAM_ADJUST_MS     1000     // Minimale tijd tussen twee aanpassingen
+#define STREAM_LEVELS        5        // 0 = volledige instellingen, 4 = QVGA
+
+// Statistieken van één kijker
+struct StreamViewerStats {
+  uint8_t requestedFps;      // Gevraagde beelden per seconde
+  uint8_t fps;               // Door de regeling gekozen beelden per seconde
+  uint8_t level;             // Door de regeling gekozen beeldniveau
+  uint32_t fpsX10;           // Gehaalde beelden per seconde (x10)
+  uint32_t sendMs;           // Verzendtijd per frame (gemiddeld)
+  uint32_t latencyMs;        // Geschatte vertraging van opname tot client (gemiddeld)
+  uint32_t framesSent;
+  uint32_t framesDropped;    // Overgeslagen omdat de client nog bezig was
+  uint32_t kbSent;
+  uint32_t seconds;          // Duur van de verbinding
+};
+
+// Statistieken van de framebron
+struct StreamStats {
+  uint8_t viewers;
+  uint8_t targetFps;         // Hoogste gekozen snelheid van de kijkers
+  uint8_t level;             // Beeldniveau van de camera (beste van de kijkers)
+  uint16_t frameWidth;       // Afmetingen en kwaliteit van het laatste frame
+  uint16_t frameHeight;
+  uint8_t quality;
+  uint32_t captured;
+  uint32_t failed;
+  uint32_t fpsX10;           // Gehaalde opnamesnelheid (x10) sinds de eerste kijker
+  uint32_t avgCaptureUs;     // Frame ophalen en kopiëren
+  uint32_t frameBytes;       // Framebuffers in gebruik (PSRAM)
+  uint32_t bytesPerViewer;   // Extra geheugen per kijker: één framebuffer en de administratie
+};
+
+// Functies voor de livestream
+bool startStreamBroadcaster();
+void serveStreamViewer(WiFiClient& client, HttpRequest& request, uint32_t fps);
+StreamStats getStreamStats(StreamViewerStats* viewers = NULL, int maxViewers = 0);
+
+#endif // STREAM_BROADCASTER_H
\ No newline at end of file
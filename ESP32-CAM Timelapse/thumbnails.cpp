@@ -0,0 +1,256 @@
+#include "thumbnails.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "card_usage.h"
+#include "img_converters.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+// Miniaturentaak. Na het opslaan van een foto leest deze taak de JPEG terug
+// van de SD-kaart, decodeert hem verkleind (1/2, 1/4 of 1/8 in het DCT-domein,
+// zonder het volledige beeld te decoderen) en slaat het resultaat op als kleine
+// JPEG naast het origineel. Dit gebeurt buiten de capture- en schrijftaak om.
+// Bestaande dagmappen kunnen op de achtergrond worden aangevuld.
+
+#define THUMB_TASK_STACK    8192
+#define THUMB_TASK_PRIORITY 1
+#define THUMB_TASK_CORE     0
+#define THUMB_QUEUE_LENGTH  8
+
+// Een foto waarvan een miniatuur gemaakt moet worden
+struct ThumbJob {
+  char day[16];
+  char name[32];
+};
+
+static QueueHandle_t thumbQueue = NULL;
+static TaskHandle_t thumbTaskHandle = NULL;
+static uint8_t* jpegBuffer = NULL;
+static size_t jpegBufferSize = 0;
+
+static portMUX_TYPE thumbMux = portMUX_INITIALIZER_UNLOCKED;
+static ThumbnailStats stats = {};
+static volatile bool backfillRequested = false;
+static char backfillDay[16] = "";
+
+// Breedte en hoogte uit de SOF-marker van een JPEG
+bool jpegDimensions(const uint8_t* buf, size_t len, uint16_t& width, uint16_t& height) {
+  size_t i = 2;
+  while (i + 9 < len) {
+    if (buf[i] != 0xFF) {
+      i++;
+      continue;
+    }
+    uint8_t marker = buf[i + 1];
+    size_t segmentLength = ((size_t)buf[i + 2] << 8) | buf[i + 3];
+    if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+      height = ((uint16_t)buf[i + 5] << 8) | buf[i + 6];
+      width = ((uint16_t)buf[i + 7] << 8) | buf[i + 8];
+      return width > 0 && height > 0;
+    }
+    i += 2 + segmentLength;
+  }
+  return false;
+}
+
+// Pad van de miniatuur van een foto
+String thumbnailPath(const String& dayName, const String& fileName) {
+  return "/timelapse/" + dayName + "/" + THUMB_DIR + "/" + fileName;
+}
+
+// Maak de miniatuur van één foto. Alleen aanroepen vanuit de miniaturentaak
+// (de JPEG-buffer wordt gedeeld).
+static bool makeThumbnail(const String& dayName, const String& fileName) {
+  unsigned long start = millis();
+  String sourcePath = "/timelapse/" + dayName + "/" + fileName;
+
+  PhotoSource source;
+  if (!openPhotoSource(sourcePath, source)) return false;
+  size_t length = source.size;
+  if (length == 0 || length > jpegBufferSize) {
+    source.file.close();
+    return false;
+  }
+  size_t bytesRead = source.file.read(jpegBuffer, length);
+  source.file.close();
+  if (bytesRead != length) return false;
+
+  uint16_t width, height;
+  if (!jpegDimensions(jpegBuffer, length, width, height)) return false;
+
+  // Grootste verkleining waarbij de miniatuur minstens THUMB_MIN_WIDTH breed is
+  int scale = JPG_SCALE_MAX;
+  while (scale > JPG_SCALE_NONE && (width >> scale) < THUMB_MIN_WIDTH) {
+    scale--;
+  }
+  uint16_t thumbWidth = width >> scale;
+  uint16_t thumbHeight = height >> scale;
+  size_t rgbSize = (size_t)thumbWidth * thumbHeight * 2;
+
+  uint8_t* rgb = psramFound() ? (uint8_t*)ps_malloc(rgbSize) : (uint8_t*)malloc(rgbSize);
+  if (!rgb) return false;
+
+  uint8_t* thumb = NULL;
+  size_t thumbLength = 0;
+  bool ok = jpg2rgb565(jpegBuffer, length, rgb, (jpg_scale_t)scale) &&
+            fmt2jpg(rgb, rgbSize, thumbWidth, thumbHeight, PIXFORMAT_RGB565, THUMB_QUALITY, &thumb, &thumbLength);
+  free(rgb);
+  if (!ok) return false;
+
+  String thumbDir = "/timelapse/" + dayName + "/" + THUMB_DIR;
+  if (!SD_MMC.exists(thumbDir)) {
+    SD_MMC.mkdir(thumbDir);
+  }
+
+  File file = SD_MMC.open(thumbnailPath(dayName, fileName), FILE_WRITE);
+  ok = file && file.write(thumb, thumbLength) == thumbLength;
+  if (file) file.close();
+  free(thumb);
+
+  if (ok) {
+    cardUsageAdd(thumbLength);
+    portENTER_CRITICAL(&thumbMux);
+    stats.lastMs = millis() - start;
+    stats.lastBytes = thumbLength;
+    portEXIT_CRITICAL(&thumbMux);
+  }
+  return ok;
+}
+
+// Maak een miniatuur en houd de tellers bij
+static bool generateThumbnail(const String& dayName, const String& fileName) {
+  bool ok = makeThumbnail(dayName, fileName);
+  portENTER_CRITICAL(&thumbMux);
+  if (ok) stats.generated++;
+  else stats.failed++;
+  portEXIT_CRITICAL(&thumbMux);
+  if (!ok) {
+    Serial.println("Miniatuur maken mislukt: " + dayName + "/" + fileName);
+  }
+  return ok;
+}
+
+// Verwerk wachtende nieuwe foto's voordat de aanvulling verder gaat
+static void drainQueue() {
+  ThumbJob job;
+  while (xQueueReceive(thumbQueue, &job, 0) == pdPASS) {
+    if (job.name[0]) generateThumbnail(job.day, job.name);
+  }
+}
+
+// Vul ontbrekende miniaturen aan voor één dag of (lege naam) alle dagen
+static void runBackfill() {
+  char dayFilter[16];
+  portENTER_CRITICAL(&thumbMux);
+  strncpy(dayFilter, backfillDay, sizeof(dayFilter));
+  backfillRequested = false;
+  stats.backfillActive = true;
+  portEXIT_CRITICAL(&thumbMux);
+
+  uint32_t created = 0;
+  int dayCount = 0;
+  File summaries = openDaySummaries(dayCount);
+  DayIndexSummary day;
+  // Nieuwste dagen eerst: die worden het vaakst bekeken
+  for (int d = dayCount - 1; d >= 0 && summaries; d--) {
+    if (!readDaySummary(summaries, d, day)) continue;
+    if (dayFilter[0] && strcmp(dayFilter, day.name) != 0) continue;
+
+    int photoCount = 0;
+    File index = openDayIndex(day.name, photoCount);
+    PhotoIndexEntry entry;
+    for (int i = 0; i < photoCount && index; i++) {
+      if (!readDayIndexEntry(index, i, entry)) break;
+      if (!SD_MMC.exists(thumbnailPath(day.name, entry.name))) {
+        if (generateThumbnail(day.name, entry.name)) created++;
+      }
+      drainQueue();
+    }
+    if (index) index.close();
+  }
+  if (summaries) summaries.close();
+
+  portENTER_CRITICAL(&thumbMux);
+  stats.backfillActive = false;
+  portEXIT_CRITICAL(&thumbMux);
+  Serial.printf("Miniaturen aangevuld: %u nieuw\n", created);
+}
+
+// Miniaturentaak: nieuwe foto's eerst, daarna eventuele aanvulling
+static void thumbnailTask(void*) {
+  ThumbJob job;
+
+  for (;;) {
+    TickType_t wait = backfillRequested ? 0 : portMAX_DELAY;
+    if (xQueueReceive(thumbQueue, &job, wait) == pdPASS) {
+      // Een lege job wekt de taak alleen voor de aanvulling
+      if (job.name[0]) generateThumbnail(job.day, job.name);
+    } else if (backfillRequested) {
+      runBackfill();
+    }
+  }
+}
+
+// Start de miniaturentaak
+bool startThumbnailTask() {
+  // Buffer voor de originele JPEG, even groot als een camerabuffer
+  jpegBufferSize = psramFound() ? 1600 * 1200 / 5 : 800 * 600 / 5;
+  jpegBuffer = psramFound() ? (uint8_t*)ps_malloc(jpegBufferSize) : (uint8_t*)malloc(jpegBufferSize);
+  thumbQueue = xQueueCreate(THUMB_QUEUE_LENGTH, sizeof(ThumbJob));
+  if (!jpegBuffer || !thumbQueue) {
+    Serial.println("Miniaturen: geen geheugen voor buffer/queue");
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(thumbnailTask, "thumbs", THUMB_TASK_STACK, NULL,
+                              THUMB_TASK_PRIORITY, &thumbTaskHandle, THUMB_TASK_CORE) != pdPASS) {
+    Serial.println("Miniaturentaak starten mislukt");
+    thumbQueue = NULL;
+    return false;
+  }
+
+  Serial.println("Miniaturentaak gestart");
+  return true;
+}
+
+// Plan een miniatuur voor een net opgeslagen foto; blokkeert nooit
+bool queueThumbnail(const char* dayName, const char* fileName) {
+  if (!thumbQueue) return false;
+
+  ThumbJob job = {};
+  strncpy(job.day, dayName, sizeof(job.day) - 1);
+  strncpy(job.name, fileName, sizeof(job.name) - 1);
+  if (xQueueSend(thumbQueue, &job, 0) != pdPASS) {
+    portENTER_CRITICAL(&thumbMux);
+    stats.dropped++;
+    portEXIT_CRITICAL(&thumbMux);
+    return false;
+  }
+  return true;
+}
+
+// Vraag het aanvullen van ontbrekende miniaturen aan (lege naam = alle dagen)
+bool queueThumbnailBackfill(const String& dayName) {
+  if (!thumbQueue) return false;
+
+  portENTER_CRITICAL(&thumbMux);
+  strncpy(backfillDay, dayName.c_str(), sizeof(backfillDay) - 1);
+  backfillDay[sizeof(backfillDay) - 1] = '\0';
+  backfillRequested = true;
+  portEXIT_CRITICAL(&thumbMux);
+
+  // Taak wekken als die op de queue wacht
+  ThumbJob wake = {};
+  xQueueSend(thumbQueue, &wake, 0);
+  return true;
+}
+
+// Kopie van de statistieken voor weergave
+ThumbnailStats getThumbnailStats() {
+  portENTER_CRITICAL(&thumbMux);
+  ThumbnailStats copy = stats;
+  copy.backfillActive = copy.backfillActive || backfillRequested;
+  portEXIT_CRITICAL(&thumbMux);
+  return copy;
+}
\ No newline at end of file
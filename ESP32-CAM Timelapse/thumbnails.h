@@ -0,0 +1,29 @@
+#ifndef THUMBNAILS_H
+#define THUMBNAILS_H
+
+#include "config.h"
+
+// Miniaturen staan in een submap van de dagmap: /timelapse/<dag>/thumbs/<foto>
+#define THUMB_DIR          "thumbs"
+#define THUMB_MIN_WIDTH    160      // Kleinste breedte van een miniatuur in pixels
+#define THUMB_QUALITY      60       // JPEG kwaliteit van miniaturen (1-100)
+
+// Statistieken van de miniaturentaak
+struct ThumbnailStats {
+  uint32_t generated;
+  uint32_t failed;
+  uint32_t dropped;          // Niet in de queue gepast (later aan te vullen)
+  uint32_t lastMs;           // Duur van de laatste miniatuur
+  uint32_t lastBytes;        // Grootte van de laatste miniatuur
+  bool backfillActive;
+};
+
+// Functies voor miniaturen
+bool startThumbnailTask();
+bool queueThumbnail(const char* dayName, const char* fileName);
+bool queueThumbnailBackfill(const String& dayName = "");
+String thumbnailPath(const String& dayName, const String& fileName);
+ThumbnailStats getThumbnailStats();
+bool jpegDimensions(const uint8_t* buf, size_t len, uint16_t& width, uint16_t& height);
+
+#endif // THUMBNAILS_H
\ No newline at end of file
@@ -6,6 +6,19 @@
 #include "sd_card.h"
 #include "settings_manager.h"
 #include "time_manager.h"
+#include "capture_task.h"
+#include "photo_index.h"
+#include "thumbnails.h"
+#include "web_server.h"
+#include "file_stream.h"
+#include "zip_archive.h"
+#include "avi_writer.h"
+#include "playback.h"
+#include "stream_broadcaster.h"
+#include "snapshot_cache.h"
+#include "retention.h"
+#include "card_usage.h"
+#include "photo_journal.h"
 
 void initializeWebHandlers() {
   // Placeholder voor eventuele initialisatie van handlers
@@ -37,10 +50,16 @@ void handleRootPage(WiFiClient& client) {
   client.println(MAIN_PAGE_HTML_FINAL);
 }
 
-// Handler voor het bekijken van een specifieke dag
+// Handler voor het bekijken van een specifieke dag, per pagina van DAY_PAGE_SIZE foto's
 void handleDayView(WiFiClient& client, String folderName) {
+  std::map<String, String> params;
+  parseQueryParams(folderName, params);
+  folderName = stripQueryString(folderName);
   String fullPath = "/timelapse/" + folderName;
   
+  int limit = constrain(queryParamInt(params, "limit", DAY_PAGE_SIZE), 1, DAY_PAGE_MAX);
+  int offset = max(queryParamInt(params, "offset", 0), 0);
+  
   sendHttpHeaders(client);
   
   client.println("<!DOCTYPE html><html>");
@@ -55,39 +74,66 @@ void handleDayView(WiFiClient& client, String folderName) {
   client.println("<div class=\"container\">");
   client.println("<h1>Foto's van " + folderName + "</h1>");
   client.println("<a href=\"/\" class=\"btn btn-back\">Terug naar overzicht</a>");
+  client.println("<a href=\"/archive/day/" + folderName + ".zip\" class=\"btn\">Hele dag downloaden (ZIP)</a>");
+  client.println("<a href=\"/video/day/" + folderName + ".avi\" class=\"btn\">Timelapse-video (AVI)</a>");
+  client.println("<a href=\"/play/day/" + folderName + "\" class=\"btn\">Afspelen</a>");
+  client.println("<a href=\"/delete/day/" + folderName + "\" class=\"btn btn-warning\">Dag verwijderen</a>");
   
   if (sdCardAvailable) {
-    File dir = SD_MMC.open(fullPath);
-    if (dir && dir.isDirectory()) {
-      client.println("<div class=\"photos\">");
+    // Foto's uit de dagindex, zonder de map te doorlopen
+    int photoCount = 0;
+    File index = openDayIndex(folderName, photoCount);
+    if (index) {
+      int end = min(offset + limit, photoCount);
       
-      File file = dir.openNextFile();
-      int photoCount = 0;
+      // Paginanavigatie
+      String nav = "<div class=\"pagination\">";
+      if (offset > 0) {
+        nav += "<a href=\"/day/" + folderName + "?offset=" + String(max(offset - limit, 0)) +
+               "&limit=" + String(limit) + "\" class=\"btn\">Vorige</a>";
+      }
+      if (photoCount > 0) {
+        nav += "<span>Foto " + String(min(offset + 1, photoCount)) + " - " + String(end) +
+               " van " + String(photoCount) + "</span>";
+      }
+      if (end < photoCount) {
+        nav += "<a href=\"/day/" + folderName + "?offset=" + String(end) +
+               "&limit=" + String(limit) + "\" class=\"btn\">Volgende</a>";
+      }
+      nav += "</div>";
+      client.println(nav);
       
-      while (file) {
-        if (!file.isDirectory()) {
-          photoCount++;
-          String fileName = String(file.name()).substring(String(file.name()).lastIndexOf('/') + 1);
-          String filePath = String(file.name());
-          
-          client.println("<div class=\"photo-item\">");
-          client.println("<img src=\"/view/timelapse/" + folderName + "/" + fileName + "\" alt=\"" + fileName + "\">");
-          client.println("<div class=\"photo-info\">");
-          client.println("<div>" + fileName + " (" + formatFileSize(file.size()) + ")</div>");
-          client.println("<div class=\"photo-actions\">");
-          client.println("<a href=\"/download/timelapse/" + folderName + "/" + fileName + "\" class=\"btn\">Download</a>");
-          client.println("</div>");
-          client.println("</div>");
-          client.println("</div>");
-        }
-        file = dir.openNextFile();
+      client.println("<div class=\"photos\">");
+      
+      // Alleen de foto's van deze pagina; de browser laadt ze pas als ze in beeld komen
+      PhotoIndexEntry entry;
+      for (int i = offset; i < end; i++) {
+        if (!readDayIndexEntry(index, i, entry)) break;
+        String fileName = String(entry.name);
+        
+        client.println("<div class=\"photo-item\">");
+        client.println("<a href=\"/view/timelapse/" + folderName + "/" + fileName + "\">"
+                       "<img src=\"/thumb/timelapse/" + folderName + "/" + fileName + "\" alt=\"" + fileName +
+                       "\" loading=\"lazy\" decoding=\"async\" width=\"200\" height=\"150\"></a>");
+        client.println("<div class=\"photo-info\">");
+        client.println("<div>" + fileName + " (" + formatFileSize(entry.size) + ")</div>");
+        client.println("<div class=\"photo-actions\">");
+        client.println("<a href=\"/download/timelapse/" + folderName + "/" + fileName + "\" class=\"btn\">Download</a>");
+        client.println("</div>");
+        client.println("</div>");
+        client.println("</div>");
       }
+      index.close();
       
       client.println("</div>");
       
       if (photoCount == 0) {
         client.println("<p>Geen foto's gevonden in deze map.</p>");
+      } else {
+        client.println(nav);
       }
+    } else if (SD_MMC.exists(fullPath)) {
+      client.println("<p>Deze map staat nog niet in de foto-index. <a href=\"/rebuildindex\">Index herbouwen</a></p>");
     } else {
       client.println("<p>Map niet gevonden of geen toegang.</p>");
     }
@@ -99,12 +145,163 @@ void handleDayView(WiFiClient& client, String folderName) {
   client.println("</body></html>");
 }
 
+// API: foto's van een dag als JSON, per pagina (offset/limit)
+void handleDayApi(WiFiClient& client, HttpRequest& request, String folderName) {
+  std::map<String, String> params;
+  parseQueryParams(folderName, params);
+  folderName = stripQueryString(folderName);
+  
+  int limit = constrain(queryParamInt(params, "limit", DAY_PAGE_SIZE), 1, DAY_PAGE_MAX);
+  int offset = max(queryParamInt(params, "offset", 0), 0);
+  
+  int photoCount = 0;
+  File index;
+  if (sdCardAvailable) {
+    index = openDayIndex(folderName, photoCount);
+  }
+  if (!index) {
+    String error = "{\"error\":\"dag niet gevonden\"}";
+    sendHttpResponse(client, request, 404, "application/json", error.length());
+    client.print(error);
+    return;
+  }
+  
+  // JSON eerst opbouwen zodat de lengte bekend is (keep-alive)
+  int end = min(offset + limit, photoCount);
+  String json;
+  json.reserve(128 + (end > offset ? end - offset : 0) * 140);
+  json = "{\"day\":\"" + folderName + "\",\"total\":" + String(photoCount) +
+         ",\"offset\":" + String(offset) + ",\"limit\":" + String(limit) + ",\"photos\":[";
+  
+  PhotoIndexEntry entry;
+  for (int i = offset; i < end; i++) {
+    if (!readDayIndexEntry(index, i, entry)) break;
+    String fileName = String(entry.name);
+    if (i > offset) json += ",";
+    json += "{\"name\":\"" + fileName + "\",\"timestamp\":" + String(entry.timestamp) +
+            ",\"size\":" + String(entry.size) +
+            ",\"url\":\"/view/timelapse/" + folderName + "/" + fileName + "\"}";
+  }
+  index.close();
+  json += "]}";
+  
+  sendHttpResponse(client, request, 200, "application/json", json.length());
+  client.print(json);
+}
+
+// API: helderheid van de foto's van een dag als JSON. De samenvatting gaat
+// over de hele dag, de foto's worden per pagina (offset/limit) gestuurd.
+void handleDayStatsApi(WiFiClient& client, HttpRequest& request, String folderName) {
+  std::map<String, String> params;
+  parseQueryParams(folderName, params);
+  folderName = stripQueryString(folderName);
+  
+  int limit = constrain(queryParamInt(params, "limit", DAY_PAGE_SIZE), 1, DAY_PAGE_MAX);
+  int offset = max(queryParamInt(params, "offset", 0), 0);
+  
+  int photoCount = 0;
+  int lumaCount = 0;
+  File index;
+  File lumaFile;
+  if (sdCardAvailable) {
+    index = openDayIndex(folderName, photoCount);
+    lumaFile = openDayLuminance(folderName, lumaCount);
+  }
+  if (!index) {
+    if (lumaFile) lumaFile.close();
+    String error = "{\"error\":\"dag niet gevonden\"}";
+    sendHttpResponse(client, request, 404, "application/json", error.length());
+    client.print(error);
+    return;
+  }
+  
+  // Samenvatting over alle geanalyseerde foto's (Welford voor de spreiding)
+  LuminanceStats stats;
+  uint32_t analysed = 0, dark = 0, overexposed = 0, blocked = 0;
+  float mean = 0, m2 = 0;
+  for (int i = 0; i < min(lumaCount, photoCount); i++) {
+    if (!readDayLuminance(lumaFile, i, stats)) continue;
+    analysed++;
+    float delta = stats.mean - mean;
+    mean += delta / analysed;
+    m2 += delta * (stats.mean - mean);
+    if (stats.flags & LUMA_FLAG_DARK) dark++;
+    if (stats.flags & LUMA_FLAG_OVEREXPOSED) overexposed++;
+    if (stats.flags & LUMA_FLAG_BLOCKED) blocked++;
+  }
+  
+  int end = min(offset + limit, photoCount);
+  String json;
+  json.reserve(256 + (end > offset ? end - offset : 0) * 200);
+  json = "{\"day\":\"" + folderName + "\",\"total\":" + String(photoCount) +
+         ",\"analysed\":" + String(analysed) +
+         ",\"mean\":" + String(mean, 1) +
+         ",\"stdDev\":" + String(analysed > 1 ? sqrtf(m2 / (analysed - 1)) : 0.0f, 1) +
+         ",\"flagged\":{\"dark\":" + String(dark) + ",\"overexposed\":" + String(overexposed) +
+         ",\"blocked\":" + String(blocked) + "}" +
+         ",\"offset\":" + String(offset) + ",\"limit\":" + String(limit) + ",\"photos\":[";
+  
+  PhotoIndexEntry entry;
+  for (int i = offset; i < end; i++) {
+    if (!readDayIndexEntry(index, i, entry)) break;
+    if (i > offset) json += ",";
+    json += "{\"name\":\"" + String(entry.name) + "\",\"timestamp\":" + String(entry.timestamp);
+    if (i < lumaCount && readDayLuminance(lumaFile, i, stats)) {
+      json += ",\"mean\":" + String(stats.mean) + ",\"stdDev\":" + String(stats.stdDev) +
+              ",\"flags\":" + luminanceFlagsJson(stats.flags) + ",\"histogram\":[";
+      for (int b = 0; b < LUMA_BINS; b++) {
+        if (b > 0) json += ",";
+        json += String(stats.bins[b]);
+      }
+      json += "]}";
+    } else {
+      json += ",\"mean\":null}";
+    }
+  }
+  index.close();
+  if (lumaFile) lumaFile.close();
+  json += "]}";
+  
+  sendHttpResponse(client, request, 200, "application/json", json.length());
+  client.print(json);
+}
+
 // Handler voor het bekijken van een afbeelding
-void handleImageView(WiFiClient& client, String relativePath) {
+void handleImageView(WiFiClient& client, HttpRequest& request, String relativePath) {
   String filePath = "/" + relativePath;
   Serial.println("View aangevraagd voor bestand: " + filePath);
   
-  sendImageFile(client, filePath);
+  sendImageFile(client, request, filePath);
+}
+
+// Handler voor een miniatuur (/thumb/timelapse/<dag>/<foto>). Bestaat de
+// miniatuur nog niet, dan wordt het origineel gestuurd en de miniatuur gepland;
+// dat antwoord mag de browser niet vast bewaren.
+void handleThumbnail(WiFiClient& client, HttpRequest& request, String relativePath) {
+  String dayPath = relativePath.substring(0, relativePath.lastIndexOf('/'));
+  String dayName = dayPath.substring(dayPath.lastIndexOf('/') + 1);
+  String fileName = relativePath.substring(relativePath.lastIndexOf('/') + 1);
+  String thumbPath = thumbnailPath(dayName, fileName);
+  
+  if (sdCardAvailable && SD_MMC.exists(thumbPath)) {
+    sendImageFile(client, request, thumbPath);
+  } else {
+    queueThumbnail(dayName.c_str(), fileName.c_str());
+    sendImageFile(client, request, "/" + relativePath, false);
+  }
+}
+
+// Handler voor het aanvullen van ontbrekende miniaturen (kaarten van oudere firmware)
+void handleThumbnailBackfill(WiFiClient& client, String dayName) {
+  sendHttpHeaders(client);
+  
+  if (sdCardAvailable && queueThumbnailBackfill(dayName)) {
+    String scope = dayName.length() > 0 ? "dag " + dayName : "alle dagen";
+    generateSuccessPage(client, "Miniaturen aanvullen",
+                        "Ontbrekende miniaturen voor " + scope + " worden op de achtergrond gemaakt.", "/");
+  } else {
+    generateErrorPage(client, "Fout", "Miniaturen aanvullen is niet mogelijk. Is de SD-kaart beschikbaar?");
+  }
 }
 
 // Handler voor het maken van een handmatige foto
@@ -121,25 +318,19 @@ void handlePhoto(WiFiClient& client) {
   client.println("</style></head>");
   client.println("<body><h1>Handmatige Foto</h1>");
   
-  // Maak dagmap en neem een foto
+  // Neem een foto; de SD-schrijver maakt de dagmap en geeft het pad terug
   if (sdCardAvailable) {
-    if (createDayFolder()) {
-      if (takeSavePhoto()) {
-        client.println("<div class=\"message success\">");
-        client.println("<h2>Succes!</h2>");
-        client.println("<p>Foto succesvol gemaakt en opgeslagen.</p>");
-        client.println("<p>Bestandspad: " + String(filePath) + "</p>");
-        client.println("</div>");
-      } else {
-        client.println("<div class=\"message error\">");
-        client.println("<h2>Fout</h2>");
-        client.println("<p>Foto maken of opslaan is mislukt.</p>");
-        client.println("</div>");
-      }
+    String savedPath;
+    if (captureManualPhoto(&savedPath)) {
+      client.println("<div class=\"message success\">");
+      client.println("<h2>Succes!</h2>");
+      client.println("<p>Foto succesvol gemaakt en opgeslagen.</p>");
+      client.println("<p>Bestandspad: " + savedPath + "</p>");
+      client.println("</div>");
     } else {
       client.println("<div class=\"message error\">");
       client.println("<h2>Fout</h2>");
-      client.println("<p>Kon de dagmap niet aanmaken.</p>");
+      client.println("<p>Foto maken of opslaan is mislukt.</p>");
       client.println("</div>");
     }
   } else {
@@ -154,90 +345,106 @@ void handlePhoto(WiFiClient& client) {
 }
 
 // Handler voor live stream
-void handleStream(WiFiClient& client) {
-  client.println("HTTP/1.1 200 OK");
-  client.println("Content-Type: multipart/x-mixed-replace; boundary=frame");
-  client.println("Connection: close");
-  client.println();
-  
-  // Een livestream van 30 seconden (kan onderbroken worden door client)
-  unsigned long streamStartTime = millis();
-  while (client.connected() && (millis() - streamStartTime < 30000)) {
-    // Foto maken
-    camera_fb_t * fb = esp_camera_fb_get();
-    if (!fb) {
-      Serial.println("Camera frame capture mislukt");
-      break;
-    }
-    
-    client.println("--frame");
-    client.println("Content-Type: image/jpeg");
-    client.print("Content-Length: ");
-    client.println(fb->len);
-    client.println();
-    client.write(fb->buf, fb->len);
-    client.println();
-    
-    esp_camera_fb_return(fb);
-    
-    // Korte pauze tussen frames
-    delay(100);
-  }
+void handleStream(WiFiClient& client, HttpRequest& request) {
+  // Livestream van 30 seconden; meerdere kijkers delen dezelfde camerabeelden
+  std::map<String, String> params;
+  parseQueryParams(String(request.target), params);
+  serveStreamViewer(client, request, queryParamInt(params, "fps", STREAM_DEFAULT_FPS));
 }
 
 // Handler voor het downloaden van een bestand
-void handleDownload(WiFiClient& client, String relativePath) {
+void handleDownload(WiFiClient& client, HttpRequest& request, String relativePath) {
   String filePath = "/" + relativePath;
   
   Serial.println("Download aangevraagd voor bestand: " + filePath);
     
-  if (sdCardAvailable && SD_MMC.exists(filePath)) {
-    File file = SD_MMC.open(filePath, FILE_READ);
-    if (file) {
-      // Bestandsgrootte bepalen
-      size_t fileSize = file.size();
-      
-      // Bestandsnaam extraheren
-      String fileName = filePath.substring(filePath.lastIndexOf('/') + 1);
-      
-      client.println("HTTP/1.1 200 OK");
-      client.println("Content-Type: image/jpeg");
-      client.print("Content-Length: ");
-      client.println(fileSize);
-      client.println("Content-Disposition: attachment; filename=\"" + fileName + "\"");
-      client.println("Connection: close");
-      client.println();
-      
-      // Bestand in chunks naar client sturen
-      const size_t bufferSize = 1024;
-      uint8_t buffer[bufferSize];
-      size_t bytesRemaining = fileSize;
-      
-      while (bytesRemaining > 0) {
-        size_t bytesToRead = min(bufferSize, bytesRemaining);
-        file.read(buffer, bytesToRead);
-        client.write(buffer, bytesToRead);
-        bytesRemaining -= bytesToRead;
-        yield(); // WiFi-stack tijd geven om te verwerken
-      }
-      
-      file.close();
-      Serial.println("Bestand succesvol verzonden: " + fileName);
-    } else {
-      client.println("HTTP/1.1 404 Not Found");
-      client.println("Connection: close");
-      client.println();
-      Serial.println("Fout bij openen bestand: " + filePath);
-    }
-  } else {
-    client.println("HTTP/1.1 404 Not Found");
-    client.println("Connection: close");
-    client.println();
-    Serial.println("Bestand niet gevonden: " + filePath);
+  String fileName = filePath.substring(filePath.lastIndexOf('/') + 1);
+  sendFile(client, request, filePath, "image/jpeg",
+           String(PHOTO_CACHE_CONTROL) + "Content-Disposition: attachment; filename=\"" + fileName + "\"\r\n");
+}
+
+// Handler voor een ZIP-archief van een dag (/archive/day/<dag>.zip), of van
+// een reeks dagen met ?to=<laatste dag>
+void handleArchive(WiFiClient& client, HttpRequest& request, String param) {
+  std::map<String, String> params;
+  parseQueryParams(param, params);
+  String fromDay = stripQueryString(param);
+  if (fromDay.endsWith(".zip")) {
+    fromDay = fromDay.substring(0, fromDay.length() - 4);
+  }
+  String toDay = params.count("to") ? params["to"] : fromDay;
+  
+  Serial.println("Archief aangevraagd: " + fromDay + " t/m " + toDay);
+  sendDayArchive(client, request, fromDay, toDay);
+}
+
+// Handler voor de timelapse-video van een dag (/video/day/<dag>.avi), met
+// optioneel ?fps=<beelden per seconde>
+void handleVideo(WiFiClient& client, HttpRequest& request, String param) {
+  std::map<String, String> params;
+  parseQueryParams(param, params);
+  String dayName = stripQueryString(param);
+  if (dayName.endsWith(".avi")) {
+    dayName = dayName.substring(0, dayName.length() - 4);
+  }
+  uint32_t fps = params.count("fps") ? params["fps"].toInt() : AVI_DEFAULT_FPS;
+  
+  Serial.println("Dagvideo aangevraagd: " + dayName + " (" + String(fps) + " fps)");
+  sendDayVideo(client, request, dayName, fps);
+}
+
+// Handler voor het afspelen van een dag als MJPEG (/play/day/<dag>), met
+// optioneel ?fps=<beelden per seconde>&step=<elke n-de foto>
+void handlePlayback(WiFiClient& client, HttpRequest& request, String param) {
+  std::map<String, String> params;
+  parseQueryParams(param, params);
+  String dayName = stripQueryString(param);
+  uint32_t fps = params.count("fps") ? params["fps"].toInt() : PLAYBACK_DEFAULT_FPS;
+  uint32_t step = params.count("step") ? params["step"].toInt() : 1;
+  
+  Serial.println("Afspelen aangevraagd: " + dayName + " (" + String(fps) + " fps, stap " + String(step) + ")");
+  sendDayPlayback(client, request, dayName, fps, step);
+}
+
+// Dagmap in de vorm DD-MM-YYYY (geen paden)
+static bool isDayName(const String& name) {
+  if (name.length() != 10 || name[2] != '-' || name[5] != '-') return false;
+  for (int i = 0; i < 10; i++) {
+    if (i != 2 && i != 5 && !isdigit((unsigned char)name[i])) return false;
   }
+  return true;
 }
 
-// Handler voor het wissen van de SD-kaart
+// Voortgangspagina van een verwijdertaak; ververst zichzelf via /api/jobs/<id>
+static void sendJobProgressPage(WiFiClient& client, uint32_t id, const String& title) {
+  client.println("<h1>" + title + "</h1>");
+  client.println("<p id=\"job\">Verwijderen gestart...</p>");
+  client.println("<p>Opnemen gaat gewoon door; de foto's verdwijnen op de achtergrond.</p>");
+  client.println("<script>function poll(){fetch('/api/jobs/" + String(id) + "').then(r=>r.json()).then(j=>{"
+                 "var e=document.getElementById('job');"
+                 "if(j.state=='running'){e.textContent=j.percent+'% ('+j.filesRemoved+' van ca. '+j.estimatedFiles+' bestanden)';setTimeout(poll,1000);}"
+                 "else if(j.state=='done'){e.textContent='Klaar: '+j.filesRemoved+' bestanden verwijderd in '+(j.elapsedMs/1000).toFixed(1)+' s';}"
+                 "else{e.textContent='Verwijderen mislukt na '+j.filesRemoved+' bestanden';}"
+                 "}).catch(()=>setTimeout(poll,2000));}poll();</script>");
+}
+
+// Voortgangspagina van het herbouwen van de index
+static void sendRebuildProgressPage(WiFiClient& client, uint32_t id) {
+  client.println("<h1>Index wordt herbouwd</h1>");
+  client.println("<p id=\"job\">Herbouwen gestart...</p>");
+  client.println("<p>Opnemen gaat gewoon door; de dagen worden een voor een op de achtergrond geïndexeerd.</p>");
+  client.println("<script>function poll(){fetch('/api/jobs/" + String(id) + "').then(r=>r.json()).then(j=>{"
+                 "var e=document.getElementById('job');"
+                 "if(j.state=='running'){e.textContent=j.percent+'% ('+j.daysDone+' van '+j.daysTotal+' dagen, '+j.photos+' foto\\'s)';setTimeout(poll,1000);}"
+                 "else if(j.state=='done'){e.textContent='Klaar: '+j.daysDone+' dagen met '+j.photos+' foto\\'s in '+(j.elapsedMs/1000).toFixed(1)+' s';}"
+                 "else{e.textContent='Herbouwen niet voor alle dagen gelukt ('+j.daysDone+' dagen)';}"
+                 "}).catch(()=>setTimeout(poll,2000));}poll();</script>");
+}
+
+// Handler voor het wissen van de SD-kaart (alleen POST vanuit de
+// bevestigingspagina). De foto's gaan direct naar /trash
+// en worden door de retentietaak verwijderd; alleen zonder die taak wordt
+// alles hier in één keer gewist.
 void handleWipe(WiFiClient& client) {
   sendHttpHeaders(client);
   
@@ -247,12 +454,16 @@ void handleWipe(WiFiClient& client) {
   client.println("<style>" + String(CSS_STYLES) + "</style>");
   client.println("</head><body>");
   
-  if (sdCardAvailable) {
+  uint32_t id = startDeleteJob("");
+  if (id > 0) {
+    sendJobProgressPage(client, id, "SD-kaart wordt gewist");
+  } else if (sdCardAvailable) {
     // Eerst alle mappen/bestanden in de timelapse map wissen
     removeDir("/timelapse");
     
-    // Nu de timelapse map opnieuw aanmaken
+    // Nu de timelapse map en een lege index opnieuw aanmaken
     SD_MMC.mkdir("/timelapse");
+    resetPhotoIndex();
     
     client.println("<h1>SD-kaart succesvol gewist</h1>");
     client.println("<p>Alle timelapse foto's zijn verwijderd.</p>");
@@ -264,6 +475,45 @@ void handleWipe(WiFiClient& client) {
   client.println("</body></html>");
 }
 
+// Handler voor het verwijderen van één dag (/delete/day/<dag>). GET geeft
+// alleen de bevestigingspagina; verwijderen gebeurt pas met het formulier
+// (POST), zodat voorvertonen of prefetchen van de link niets wist.
+void handleDeleteDay(WiFiClient& client, HttpRequest& request, String param) {
+  String dayName = stripQueryString(param);
+  bool confirmed = strcmp(request.method, "POST") == 0;
+  
+  sendHttpHeaders(client);
+  
+  client.println("<html><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
+  client.println("<meta http-equiv=\"Content-Security-Policy\" content=\"frame-ancestors 'self' *\">");
+  client.println("<title>Dag verwijderen</title>");
+  client.println("<style>" + String(CSS_STYLES) + "</style>");
+  client.println("</head><body>");
+  
+  if (!isDayName(dayName)) {
+    client.println("<h1>Fout: ongeldige dag</h1>");
+  } else if (!confirmed) {
+    client.println("<h1>Dag " + dayName + " verwijderen</h1>");
+    client.println("<div class=\"warning\"><h2>Waarschuwing!</h2>");
+    client.println("<p>Alle foto's van " + dayName + " worden van de SD-kaart verwijderd.</p>");
+    client.println("<p>Deze actie kan niet ongedaan gemaakt worden!</p></div>");
+    client.println("<form action=\"/delete/day/" + dayName + "\" method=\"post\" style=\"display:inline\">");
+    client.println("<button type=\"submit\" class=\"btn btn-warning\">Ja, verwijder deze dag</button></form>");
+    client.println("<a href=\"/day/" + dayName + "\" class=\"btn\">Nee, ga terug</a>");
+  } else {
+    uint32_t id = startDeleteJob(dayName);
+    if (id > 0) {
+      Serial.println("Dag verwijderen aangevraagd: " + dayName);
+      sendJobProgressPage(client, id, "Dag " + dayName + " wordt verwijderd");
+    } else {
+      client.println("<h1>Fout: dag " + dayName + " kon niet worden verwijderd</h1>");
+    }
+  }
+  
+  client.println("<p><a href=\"/\" class=\"btn\">Terug naar het overzicht</a></p>");
+  client.println("</body></html>");
+}
+
 // Handler voor de bevestigingspagina voor wissen
 void handleConfirmWipe(WiFiClient& client) {
   sendHttpHeaders(client);
@@ -277,11 +527,48 @@ void handleConfirmWipe(WiFiClient& client) {
   client.println("<p>Je staat op het punt om alle timelapse foto's van de SD-kaart te wissen.</p>");
   client.println("<p>Deze actie kan niet ongedaan gemaakt worden!</p></div>");
   client.println("<p>Weet je zeker dat je wilt doorgaan?</p>");
-  client.println("<a href=\"/wipe\" class=\"btn btn-warning\">Ja, wis alle foto's</a>");
+  client.println("<form action=\"/wipe\" method=\"post\" style=\"display:inline\">");
+  client.println("<button type=\"submit\" class=\"btn btn-warning\">Ja, wis alle foto's</button></form>");
   client.println("<a href=\"/\" class=\"btn\">Nee, ga terug</a>");
   client.println("</body></html>");
 }
 
+// Handler voor het herbouwen van de foto-index (kaarten van oudere firmware).
+// GET toont alleen een knop; POST start het herbouwen als achtergrondtaak.
+// Alleen zonder retentietaak wordt de index hier in één keer herbouwd.
+void handleRebuildIndex(WiFiClient& client, HttpRequest& request) {
+  sendHttpHeaders(client);
+  
+  client.println("<html><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
+  client.println("<meta http-equiv=\"Content-Security-Policy\" content=\"frame-ancestors 'self' *\">");
+  client.println("<title>Index herbouwen</title>");
+  client.println("<style>" + String(CSS_STYLES) + "</style>");
+  client.println("</head><body>");
+  
+  if (strcmp(request.method, "POST") != 0) {
+    client.println("<h1>Index herbouwen</h1>");
+    client.println("<p>Alle dagmappen op de SD-kaart worden opnieuw doorlopen. Opnemen gaat gewoon door.</p>");
+    client.println("<form action=\"/rebuildindex\" method=\"post\" style=\"display:inline\">");
+    client.println("<button type=\"submit\" class=\"btn\">Index herbouwen</button></form>");
+  } else {
+    uint32_t id = startRebuildJob();
+    uint32_t dayCount = 0;
+    uint32_t photoCount = 0;
+    if (id > 0) {
+      sendRebuildProgressPage(client, id);
+    } else if (sdCardAvailable && rebuildPhotoIndex(&dayCount, &photoCount)) {
+      client.println("<h1>Index herbouwd</h1>");
+      client.println("<p>Foto-index opgebouwd voor " + String(dayCount) + " dagen met " + String(photoCount) + " foto's.</p>");
+    } else {
+      client.println("<h1>Fout</h1>");
+      client.println("<p>De foto-index kon niet worden opgebouwd. Is de SD-kaart beschikbaar?</p>");
+    }
+  }
+  
+  client.println("<p><a href=\"/\" class=\"btn\">Terug naar het overzicht</a></p>");
+  client.println("</body></html>");
+}
+
 // Handler voor iframe modus (voor dashboard integratie)
 void handleIframeView(WiFiClient& client) {
   // Status content voorbereiden
@@ -343,33 +630,272 @@ void handleSaveSettings(WiFiClient& client, String body) {
   client.println("<p>Foto interval: " + String(photoInterval) + " minuten</p>");
   client.println("<p>Opnametijden: " + String(dayStartHour) + ":00 - " + String(dayEndHour) + ":00</p>");
   client.println("<p>JPEG kwaliteit: " + String(jpegQuality) + "</p>");
+  client.println("<p>Opnamemodus: " + String(captureMode == CAPTURE_MODE_CHANGE ? "bij verandering" : "vast interval") + "</p>");
+  client.println("<p>Bewaren: " + (retentionMaxMB > 0 ? String(retentionMaxMB) + " MB" : String("hele kaart")) + ", " +
+                 (retentionMaxDays > 0 ? String(retentionMaxDays) + " dagen" : String("geen maximum aantal dagen")) +
+                 (thinAfterDays > 0 ? ", na " + String(thinAfterDays) + " dagen elke " + String(thinKeepEvery) + "e foto" : String("")) +
+                 "</p>");
   client.println("<p>Je wordt automatisch teruggeleid naar de hoofdpagina...</p>");
   client.println("</div>");
   client.println("</body></html>");
 }
 
 // Handler voor snapshot (momentopname)
-void handleSnapshot(WiFiClient& client) {
-  // Maak een foto en stuur deze direct naar de client
-  camera_fb_t * fb = esp_camera_fb_get();
-  if (!fb) {
-    client.println("HTTP/1.1 500 Internal Server Error");
-    client.println("Connection: close");
-    client.println();
-    Serial.println("Camera frame capture mislukt");
-    return;
+void handleSnapshot(WiFiClient& client, HttpRequest& request) {
+  // Laatste frame uit de cache, of een nieuwe opname als het te oud is
+  std::map<String, String> params;
+  parseQueryParams(String(request.target), params);
+  sendSnapshot(client, request, queryParamInt(params, "maxage", SNAPSHOT_MAX_AGE_MS));
+}
+
+// API: livestream met de opnamesnelheid en beeldinstellingen, en per kijker
+// de gekozen en gehaalde snelheid en de geschatte vertraging
+void handleStreamApi(WiFiClient& client, HttpRequest& request) {
+  StreamViewerStats viewers[STREAM_MAX_VIEWERS];
+  StreamStats stream = getStreamStats(viewers, STREAM_MAX_VIEWERS);
+  
+  String json;
+  json.reserve(256 + stream.viewers * 160);
+  json = "{\"viewers\":" + String(stream.viewers) +
+         ",\"maxViewers\":" + String(STREAM_MAX_VIEWERS) +
+         ",\"targetFps\":" + String(stream.targetFps) +
+         ",\"fps\":" + String(stream.fpsX10 / 10.0, 1) +
+         ",\"level\":" + String(stream.level) +
+         ",\"frameSize\":\"" + String(stream.frameWidth) + "x" + String(stream.frameHeight) + "\"" +
+         ",\"quality\":" + String(stream.quality) +
+         ",\"latencyTargetMs\":" + String(STREAM_LATENCY_TARGET_MS) +
+         ",\"captured\":" + String(stream.captured) +
+         ",\"failed\":" + String(stream.failed) +
+         ",\"avgCaptureUs\":" + String(stream.avgCaptureUs) +
+         ",\"frameBytes\":" + String(stream.frameBytes) +
+         ",\"bytesPerViewer\":" + String(stream.bytesPerViewer) +
+         ",\"freeHeap\":" + String(ESP.getFreeHeap()) +
+         ",\"freePsram\":" + String(ESP.getFreePsram()) + ",\"clients\":[";
+  
+  for (int i = 0; i < stream.viewers; i++) {
+    if (i > 0) json += ",";
+    json += "{\"requestedFps\":" + String(viewers[i].requestedFps) +
+            ",\"fps\":" + String(viewers[i].fps) +
+            ",\"level\":" + String(viewers[i].level) +
+            ",\"achievedFps\":" + String(viewers[i].fpsX10 / 10.0, 1) +
+            ",\"sendMs\":" + String(viewers[i].sendMs) +
+            ",\"latencyMs\":" + String(viewers[i].latencyMs) +
+            ",\"framesSent\":" + String(viewers[i].framesSent) +
+            ",\"framesDropped\":" + String(viewers[i].framesDropped) +
+            ",\"kbSent\":" + String(viewers[i].kbSent) +
+            ",\"seconds\":" + String(viewers[i].seconds) + "}";
   }
+  json += "]}";
   
-  client.println("HTTP/1.1 200 OK");
-  client.println("Content-Type: image/jpeg");
-  client.println("Cache-Control: no-cache, no-store, must-revalidate");
-  client.println("Pragma: no-cache");
-  client.println("Expires: 0");
-  client.print("Content-Length: ");
-  client.println(fb->len);
-  client.println("Connection: close");
-  client.println();
+  sendHttpResponse(client, request, 200, "application/json", json.length(), "Cache-Control: no-cache\r\n");
+  client.print(json);
+}
+
+// API: kaartgebruik, prognose en voortgang van het bewaarbeleid
+void handleStorageApi(WiFiClient& client, HttpRequest& request) {
+  RetentionStats retention = getRetentionStats();
+  uint32_t busy = max(retention.busyMs, (uint32_t)1);
+  
+  String json;
+  json.reserve(640);
+  json = "{\"cardMB\":" + String((unsigned long)(retention.cardBytes >> 20)) +
+         ",\"usedMB\":" + String((unsigned long)(retention.usedBytes >> 20)) +
+         ",\"limitMB\":" + String((unsigned long)(retention.limitBytes >> 20)) +
+         ",\"dailyKB\":" + String(retention.dailyBytes / 1024) +
+         ",\"daysUntilFull\":" + String(retention.daysUntilFull) +
+         ",\"policy\":{\"maxMB\":" + String(retentionMaxMB) +
+         ",\"maxDays\":" + String(retentionMaxDays) +
+         ",\"thinAfterDays\":" + String(thinAfterDays) +
+         ",\"thinKeepEvery\":" + String(thinKeepEvery) +
+         ",\"minFreeMB\":" + String(RETENTION_MIN_FREE_MB) + "}" +
+         ",\"pruning\":{\"active\":" + String(retention.active ? "true" : "false") +
+         ",\"daysDeleted\":" + String(retention.daysDeleted) +
+         ",\"daysThinned\":" + String(retention.daysThinned) +
+         ",\"photosThinned\":" + String(retention.photosThinned) +
+         ",\"filesRemoved\":" + String(retention.filesRemoved) +
+         ",\"kbFreed\":" + String((unsigned long)(retention.bytesFreed / 1024)) +
+         ",\"busyMs\":" + String(retention.busyMs) +
+         ",\"slices\":" + String(retention.slices) +
+         ",\"maxSliceMs\":" + String(retention.maxSliceMs) +
+         ",\"filesPerSecond\":" + String((float)retention.filesRemoved * 1000 / busy, 1) +
+         ",\"kbPerSecond\":" + String((unsigned long)(retention.bytesFreed / busy * 1000 / 1024)) +
+         ",\"lastAction\":\"" + String(retention.lastAction) + "\"}}";
+  
+  sendHttpResponse(client, request, 200, "application/json", json.length(), "Cache-Control: no-cache\r\n");
+  client.print(json);
+}
+
+// API: kaartgebruik en -gezondheid uit het geheugen, zonder de kaart te raken,
+// met het herstel bij het opstarten
+void handleCardApi(WiFiClient& client, HttpRequest& request) {
+  CardStatus card = getCardStatus();
+  JournalStats journal = getJournalStats();
+  uint64_t freeBytes = card.cardBytes > card.usedBytes ? card.cardBytes - card.usedBytes : 0;
+  
+  String json;
+  json.reserve(768);
+  json = "{\"seeded\":" + String(card.seeded ? "true" : "false") +
+         ",\"cardMB\":" + String((unsigned long)(card.cardBytes >> 20)) +
+         ",\"usedMB\":" + String((unsigned long)(card.usedBytes >> 20)) +
+         ",\"freeMB\":" + String((unsigned long)(freeBytes >> 20)) +
+         ",\"seedMs\":" + String(card.seedMs) +
+         ",\"clusterKB\":" + String(card.clusterBytes / 1024) +
+         ",\"filesAdded\":" + String(card.filesAdded) +
+         ",\"filesRemoved\":" + String(card.filesRemoved) +
+         ",\"kbAdded\":" + String((unsigned long)(card.bytesAdded / 1024)) +
+         ",\"kbRemoved\":" + String((unsigned long)(card.bytesRemoved / 1024)) +
+         ",\"resyncs\":" + String(card.resyncs) +
+         ",\"driftKB\":" + String((long)(card.lastDriftBytes / 1024)) +
+         ",\"health\":\"" + String(cardHealthName(card.health)) + "\"" +
+         ",\"writes\":{\"count\":" + String(card.writes) +
+         ",\"failed\":" + String(card.failedWrites) +
+         ",\"recentFailed\":" + String(card.recentFailures) +
+         ",\"p50Ms\":" + String(card.p50Ms) +
+         ",\"p95Ms\":" + String(card.p95Ms) +
+         ",\"maxMs\":" + String(card.maxMs) +
+         ",\"baselineKBps\":" + String(card.baselineKBps) +
+         ",\"recentKBps\":" + String(card.recentKBps) + "}" +
+         ",\"recovery\":{\"ms\":" + String(journal.recoveryMs) +
+         ",\"complete\":" + String(journal.complete ? "true" : "false") +
+         ",\"checked\":" + String(journal.checked) +
+         ",\"tempRemoved\":" + String(journal.tempRemoved) +
+         ",\"corrupt\":" + String(journal.corrupt) +
+         ",\"reindexed\":" + String(journal.reindexed) +
+         ",\"journaled\":" + String(journal.journaled) +
+         ",\"journalFailures\":" + String(journal.failures) + "}}";
+  
+  sendHttpResponse(client, request, 200, "application/json", json.length(), "Cache-Control: no-cache\r\n");
+  client.print(json);
+}
+
+// JSON van één achtergrondtaak
+static String jobJson(const BackgroundJob& job) {
+  static const char* states[] = { "running", "done", "failed" };
+  if (job.kind == JOB_KIND_REBUILD) {
+    uint32_t percent = 100;
+    if (job.state == JOB_RUNNING) {
+      percent = job.daysTotal > 0 ? min(job.daysDone * 100 / job.daysTotal, (uint32_t)99) : 0;
+    }
+    return "{\"id\":" + String(job.id) +
+           ",\"type\":\"rebuild\"" +
+           ",\"state\":\"" + String(states[job.state]) + "\"" +
+           ",\"percent\":" + String(percent) +
+           ",\"daysDone\":" + String(job.daysDone) +
+           ",\"daysTotal\":" + String(job.daysTotal) +
+           ",\"photos\":" + String(job.photosIndexed) +
+           ",\"elapsedMs\":" + String(job.elapsedMs) +
+           ",\"busyMs\":" + String(job.busyMs) +
+           ",\"maxSliceMs\":" + String(job.maxSliceMs) + "}";
+  }
+
+  uint32_t percent = 100;
+  if (job.state == JOB_RUNNING) {
+    // Schatting; pas 100% als de taak echt klaar is
+    percent = job.estimatedFiles > 0 ? min(job.filesRemoved * 100 / job.estimatedFiles, (uint32_t)99) : 0;
+  }
+  uint32_t busy = max(job.busyMs, (uint32_t)1);
+  return "{\"id\":" + String(job.id) +
+         ",\"type\":\"" + String(job.target[0] ? "day" : "wipe") + "\"" +
+         ",\"target\":\"" + String(job.target) + "\"" +
+         ",\"state\":\"" + String(states[job.state]) + "\"" +
+         ",\"percent\":" + String(percent) +
+         ",\"filesRemoved\":" + String(job.filesRemoved) +
+         ",\"estimatedFiles\":" + String(job.estimatedFiles) +
+         ",\"kbFreed\":" + String((unsigned long)(job.bytesFreed / 1024)) +
+         ",\"elapsedMs\":" + String(job.elapsedMs) +
+         ",\"busyMs\":" + String(job.busyMs) +
+         ",\"maxSliceMs\":" + String(job.maxSliceMs) +
+         ",\"filesPerSecond\":" + String((float)job.filesRemoved * 1000 / busy, 1) + "}";
+}
+
+// API: voortgang van achtergrondtaken (/api/jobs/<id>, of /api/jobs/ voor alle)
+void handleJobsApi(WiFiClient& client, HttpRequest& request, String param) {
+  String idText = stripQueryString(param);
+  String json;
+  if (idText.length() == 0) {
+    BackgroundJob jobs[RETENTION_MAX_JOBS];
+    int count = getBackgroundJobs(jobs, RETENTION_MAX_JOBS);
+    json.reserve(32 + count * 280);
+    json = "{\"jobs\":[";
+    for (int i = 0; i < count; i++) {
+      if (i > 0) json += ",";
+      json += jobJson(jobs[i]);
+    }
+    json += "]}";
+  } else {
+    BackgroundJob job;
+    if (!getBackgroundJob(idText.toInt(), job)) {
+      String error = "{\"error\":\"taak niet gevonden\"}";
+      sendHttpResponse(client, request, 404, "application/json", error.length());
+      client.print(error);
+      return;
+    }
+    json = jobJson(job);
+  }
+  
+  sendHttpResponse(client, request, 200, "application/json", json.length(), "Cache-Control: no-cache\r\n");
+  client.print(json);
+}
+
+// API: gelijktijdige verbindingen en latentie per route als JSON
+void handleServerApi(WiFiClient& client, HttpRequest& request) {
+  WebServerStats webStats = getWebServerStats();
+  RouteStats routes[HTTP_MAX_ROUTES];
+  int routeCount = getRouteStats(routes, HTTP_MAX_ROUTES);
+  
+  String json;
+  json.reserve(256 + routeCount * 96);
+  json = "{\"workers\":" + String(webStats.workers) +
+         ",\"activeConnections\":" + String(webStats.activeConnections) +
+         ",\"maxActiveConnections\":" + String(webStats.maxActiveConnections) +
+         ",\"connections\":" + String(webStats.connections) +
+         ",\"rejected\":" + String(webStats.rejected) +
+         ",\"requests\":" + String(webStats.requests) +
+         ",\"longActive\":" + String(webStats.longActive) +
+         ",\"maxLongActive\":" + String(webStats.maxLongActive) +
+         ",\"longRejected\":" + String(webStats.longRejected);
+  
+  FileStreamStats streams = getFileStreamStats();
+  json += ",\"fileStreams\":{\"streams\":" + String(streams.streams) +
+          ",\"direct\":" + String(streams.directStreams) +
+          ",\"allocatedSlots\":" + String(streams.allocatedSlots) +
+          ",\"dmaSlots\":" + String(streams.dmaSlots) +
+          ",\"shortReads\":" + String(streams.shortReads) +
+          ",\"aborted\":" + String(streams.aborted) +
+          ",\"kbSent\":" + String((unsigned long)(streams.bytesSent / 1024)) + "}";
+  
+  PlaybackStats playback = getPlaybackStats();
+  json += ",\"playback\":{\"sessions\":" + String(playback.sessions) +
+          ",\"frames\":" + String(playback.frames) +
+          ",\"prefetchHits\":" + String(playback.prefetchHits) +
+          ",\"prefetchMisses\":" + String(playback.prefetchMisses) +
+          ",\"skipped\":" + String(playback.skipped) +
+          ",\"lastFps\":" + String(playback.lastFpsX10 / 10.0, 1) + "}";
+  
+  SnapshotStats snapshots = getSnapshotStats();
+  uint32_t saved = snapshots.hits + snapshots.coalesced;
+  json += ",\"snapshots\":{\"requests\":" + String(snapshots.requests) +
+          ",\"hits\":" + String(snapshots.hits) +
+          ",\"coalesced\":" + String(snapshots.coalesced) +
+          ",\"captures\":" + String(snapshots.captures) +
+          ",\"capturesSaved\":" + String(saved) +
+          ",\"hitRatio\":" + String(snapshots.requests > 0 ? (float)saved / snapshots.requests : 0.0f, 2) +
+          ",\"notModified\":" + String(snapshots.notModified) +
+          ",\"failed\":" + String(snapshots.failed) + "},\"routes\":[";
+  
+  bool first = true;
+  for (int i = 0; i < routeCount; i++) {
+    if (routes[i].requests == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "{\"method\":\"" + String(routes[i].method) + "\",\"path\":\"" + String(routes[i].path) +
+            "\",\"requests\":" + String(routes[i].requests) +
+            ",\"avgMs\":" + String(routes[i].totalMs / routes[i].requests) +
+            ",\"maxMs\":" + String(routes[i].maxMs) + "}";
+  }
+  json += "]}";
   
-  client.write(fb->buf, fb->len);
-  esp_camera_fb_return(fb);
+  sendHttpResponse(client, request, 200, "application/json", json.length(),
+                   "Cache-Control: no-cache\r\n");
+  client.print(json);
 }
\ No newline at end of file
@@ -3,19 +3,38 @@
 
 #include "config.h"
 #include <WiFi.h>
+#include "http_parser.h"
+
+// Aantal foto's per pagina in de dagweergave en de API
+#define DAY_PAGE_SIZE 24
+#define DAY_PAGE_MAX  100
 
 // Declaraties voor endpoint-handlers
 void handleRootPage(WiFiClient& client);
 void handleDayView(WiFiClient& client, String folderName);
-void handleImageView(WiFiClient& client, String relativePath);
+void handleDayApi(WiFiClient& client, HttpRequest& request, String folderName);
+void handleDayStatsApi(WiFiClient& client, HttpRequest& request, String folderName);
+void handleImageView(WiFiClient& client, HttpRequest& request, String relativePath);
+void handleThumbnail(WiFiClient& client, HttpRequest& request, String relativePath);
+void handleThumbnailBackfill(WiFiClient& client, String dayName);
 void handlePhoto(WiFiClient& client);
-void handleStream(WiFiClient& client);
-void handleDownload(WiFiClient& client, String relativePath);
+void handleStream(WiFiClient& client, HttpRequest& request);
+void handleDownload(WiFiClient& client, HttpRequest& request, String relativePath);
+void handleArchive(WiFiClient& client, HttpRequest& request, String param);
+void handleVideo(WiFiClient& client, HttpRequest& request, String param);
+void handlePlayback(WiFiClient& client, HttpRequest& request, String param);
 void handleWipe(WiFiClient& client);
+void handleDeleteDay(WiFiClient& client, HttpRequest& request, String param);
 void handleConfirmWipe(WiFiClient& client);
+void handleRebuildIndex(WiFiClient& client, HttpRequest& request);
 void handleIframeView(WiFiClient& client);
 void handleSaveSettings(WiFiClient& client, String body);
-void handleSnapshot(WiFiClient& client);
+void handleSnapshot(WiFiClient& client, HttpRequest& request);
+void handleServerApi(WiFiClient& client, HttpRequest& request);
+void handleStreamApi(WiFiClient& client, HttpRequest& request);
+void handleStorageApi(WiFiClient& client, HttpRequest& request);
+void handleCardApi(WiFiClient& client, HttpRequest& request);
+void handleJobsApi(WiFiClient& client, HttpRequest& request, String param);
 
 // Initialisatiefunctie
 void initializeWebHandlers();
@@ -1,146 +1,380 @@
 #include "web_server.h"
 #include "web_handlers.h"
 #include "web_utils.h"
+#include "http_parser.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Verbindingen worden door HTTP_WORKERS taken parallel bediend, elk met een
+// eigen HttpConnection. Een aparte taak accepteert nieuwe clients en geeft ze
+// aan een vrije worker, zodat een download of /stream de overige bezoekers
+// (zoals de dashboard-iframe) niet meer blokkeert. Lukt het starten van de
+// taken niet, dan worden verbindingen zoals vroeger één voor één in loop()
+// bediend.
+
+#define HTTP_WORKER_STACK    8192
+#define HTTP_WORKER_PRIORITY 1
+#define HTTP_ACCEPT_STACK    4096
+#define HTTP_ACCEPT_PRIORITY 2
+#define HTTP_TASK_CORE       0
+#define HTTP_ACCEPT_POLL_MS  5
 
 // Webserver instantie
 WiFiServer server(80);
 
+// Handler in de routetabel; param is het deel van het doel na het prefix
+// (inclusief query string)
+typedef void (*RouteHandler)(WiFiClient& client, HttpRequest& request, const String& param);
+
+struct Route {
+  const char* method;
+  const char* path;
+  bool prefix;               // true: path is een prefix, de rest gaat als param mee
+  bool longRunning;          // Houdt een worker lang bezet (stream, video, archief)
+  RouteHandler handler;
+};
+
+// Routetabel: exacte paden en prefixen, in volgorde van controle. Lange
+// routes mogen samen hooguit HTTP_LONG_WORKERS workers bezetten, zodat er
+// altijd een worker overblijft voor de pagina's, /snapshot en de API.
+static const Route routes[] = {
+  { "GET",  "/",                false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleRootPage(c); } },
+  { "GET",  "/day/",            true,  false, [](WiFiClient& c, HttpRequest&, const String& p) { handleDayView(c, p); } },
+  { "GET",  "/api/day/",        true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleDayApi(c, r, p); } },
+  { "GET",  "/api/stats/day/",  true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleDayStatsApi(c, r, p); } },
+  { "GET",  "/thumb/",          true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleThumbnail(c, r, p); } },
+  { "GET",  "/view/",           true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleImageView(c, r, p); } },
+  { "GET",  "/download/",       true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleDownload(c, r, p); } },
+  { "GET",  "/archive/day/",    true,  true,  [](WiFiClient& c, HttpRequest& r, const String& p) { handleArchive(c, r, p); } },
+  { "GET",  "/video/day/",      true,  true,  [](WiFiClient& c, HttpRequest& r, const String& p) { handleVideo(c, r, p); } },
+  { "GET",  "/play/day/",       true,  true,  [](WiFiClient& c, HttpRequest& r, const String& p) { handlePlayback(c, r, p); } },
+  { "GET",  "/snapshot",        false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleSnapshot(c, r); } },
+  { "GET",  "/photo",           false, false, [](WiFiClient& c, HttpRequest&, const String&) { handlePhoto(c); } },
+  { "GET",  "/stream",          false, true,  [](WiFiClient& c, HttpRequest& r, const String&) { handleStream(c, r); } },
+  { "GET",  "/backfillthumbs",  false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleThumbnailBackfill(c, ""); } },
+  { "GET",  "/backfillthumbs/", true,  false, [](WiFiClient& c, HttpRequest&, const String& p) { handleThumbnailBackfill(c, p); } },
+  { "GET",  "/rebuildindex",    false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleRebuildIndex(c, r); } },
+  { "GET",  "/wipe",            false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleConfirmWipe(c); } },
+  { "GET",  "/delete/day/",     true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleDeleteDay(c, r, p); } },
+  { "GET",  "/confirmwipe",     false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleConfirmWipe(c); } },
+  { "GET",  "/api/server",      false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleServerApi(c, r); } },
+  { "GET",  "/api/stream",      false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleStreamApi(c, r); } },
+  { "GET",  "/api/storage",     false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleStorageApi(c, r); } },
+  { "GET",  "/api/card",        false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleCardApi(c, r); } },
+  { "GET",  "/api/jobs/",       true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleJobsApi(c, r, p); } },
+  { "GET",  "/iframe",          false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleIframeView(c); } },
+  { "POST", "/savesettings",    false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleSaveSettings(c, r.body); } },
+  { "POST", "/rebuildindex",    false, false, [](WiFiClient& c, HttpRequest& r, const String&) { handleRebuildIndex(c, r); } },
+  { "POST", "/wipe",            false, false, [](WiFiClient& c, HttpRequest&, const String&) { handleWipe(c); } },
+  { "POST", "/delete/day/",     true,  false, [](WiFiClient& c, HttpRequest& r, const String& p) { handleDeleteDay(c, r, p); } },
+};
+
+#define ROUTE_COUNT (sizeof(routes) / sizeof(routes[0]))
+static_assert(ROUTE_COUNT <= HTTP_MAX_ROUTES, "HTTP_MAX_ROUTES te klein voor de routetabel");
+
+// Een worker met zijn eigen verbinding (buffer niet op de stack)
+struct HttpWorker {
+  TaskHandle_t task;
+  HttpConnection connection;
+  volatile bool busy;
+};
+
+static HttpWorker workers[HTTP_WORKERS];
+static uint8_t workerCount = 0;
+
+// Verbinding voor loop() als de workers niet gestart zijn
+static HttpConnection inlineConnection;
+
+static portMUX_TYPE serverMux = portMUX_INITIALIZER_UNLOCKED;
+static WebServerStats stats = {};
+static uint32_t routeRequests[ROUTE_COUNT];
+static uint32_t routeTotalMs[ROUTE_COUNT];
+static uint32_t routeMaxMs[ROUTE_COUNT];
+static uint8_t idleYieldRequests = 0;
+static uint8_t longActive = 0;
+
+// Neem een plek voor een lange route; false als ze allemaal bezet zijn.
+// Zonder workers (alles in loop()) is er geen grens.
+static bool acquireLongSlot() {
+  bool acquired = false;
+  portENTER_CRITICAL(&serverMux);
+  uint8_t limit = workerCount > 1 ? min((uint8_t)HTTP_LONG_WORKERS, (uint8_t)(workerCount - 1)) : 1;
+  if (workerCount == 0 || longActive < limit) {
+    longActive++;
+    if (longActive > stats.maxLongActive) stats.maxLongActive = longActive;
+    acquired = true;
+  } else {
+    stats.longRejected++;
+  }
+  portEXIT_CRITICAL(&serverMux);
+  return acquired;
+}
+
+static void releaseLongSlot() {
+  portENTER_CRITICAL(&serverMux);
+  longActive--;
+  portEXIT_CRITICAL(&serverMux);
+}
+
+// Zoek de route bij een verzoek en voer de handler uit
+static void dispatchRequest(WiFiClient& client, HttpRequest& request) {
+  for (size_t i = 0; i < ROUTE_COUNT; i++) {
+    const Route& route = routes[i];
+    if (strcmp(request.method, route.method) != 0) continue;
+
+    if (route.prefix ? requestPathStartsWith(request, route.path) : requestPathEquals(request, route.path)) {
+      String param = route.prefix ? String(request.target + strlen(route.path)) : String("");
+      if (route.longRunning && !acquireLongSlot()) {
+        Serial.printf("Geen plek voor %s, client krijgt 503\n", route.path);
+        sendHttpResponse(client, request, 503, "", 0, "Retry-After: 5\r\n");
+        return;
+      }
+      unsigned long start = millis();
+      route.handler(client, request, param);
+      uint32_t elapsed = millis() - start;
+      if (route.longRunning) releaseLongSlot();
+
+      portENTER_CRITICAL(&serverMux);
+      routeRequests[i]++;
+      routeTotalMs[i] += elapsed;
+      if (elapsed > routeMaxMs[i]) routeMaxMs[i] = elapsed;
+      portEXIT_CRITICAL(&serverMux);
+      return;
+    }
+  }
+
+  Serial.printf("Onbekende route: %s %s\n", request.method, request.target);
+  sendHttpError(client, request, 404);
+}
+
+// Een wachtende keep-alive verbinding maakt plaats voor een nieuwe client.
+// Met workers geeft precies één wachtende verbinding zijn worker op.
+static bool otherClientWaiting() {
+  if (workerCount == 0) {
+    return server.hasClient();
+  }
+  bool yield = false;
+  portENTER_CRITICAL(&serverMux);
+  if (idleYieldRequests > 0) {
+    idleYieldRequests--;
+    yield = true;
+  }
+  portEXIT_CRITICAL(&serverMux);
+  return yield;
+}
+
+// Bedien alle verzoeken op één verbinding; de verbinding blijft open voor
+// volgende verzoeken zolang client en handlers dat toelaten
+static void serveConnection(HttpConnection& connection) {
+  WiFiClient& client = connection.client;
+
+  for (;;) {
+    HttpRequest request;
+    unsigned long idleTimeout = connection.requests == 0 ? HTTP_REQUEST_TIMEOUT : HTTP_KEEPALIVE_TIMEOUT;
+    HttpReadResult result = readHttpRequest(connection, request, idleTimeout, otherClientWaiting);
+
+    if (result == HTTP_READ_TOO_LARGE || result == HTTP_READ_BODY_TOO_LARGE || result == HTTP_READ_BAD_REQUEST) {
+      request.keepAliveRequested = false;
+      int status = result == HTTP_READ_TOO_LARGE ? 431 : (result == HTTP_READ_BODY_TOO_LARGE ? 413 : 400);
+      sendHttpError(client, request, status);
+      break;
+    }
+    if (result != HTTP_READ_OK) {
+      break;
+    }
+
+    connection.requests++;
+    if (connection.requests >= HTTP_KEEPALIVE_MAX_REQUESTS) {
+      request.keepAliveRequested = false;
+    }
+
+    portENTER_CRITICAL(&serverMux);
+    stats.requests++;
+    portEXIT_CRITICAL(&serverMux);
+
+    dispatchRequest(client, request);
+
+    // Handlers zonder bekende lengte sturen Connection: close
+    if (!request.keepAlive || !client.connected()) {
+      break;
+    }
+  }
+
+  // Verbinding sluiten
+  client.stop();
+  Serial.printf("Client verbinding verbroken na %u verzoek(en)\n", connection.requests);
+}
+
+// Houd het aantal open verbindingen bij
+static void connectionOpened() {
+  portENTER_CRITICAL(&serverMux);
+  stats.connections++;
+  stats.activeConnections++;
+  if (stats.activeConnections > stats.maxActiveConnections) {
+    stats.maxActiveConnections = stats.activeConnections;
+  }
+  portEXIT_CRITICAL(&serverMux);
+}
+
+static void connectionClosed() {
+  portENTER_CRITICAL(&serverMux);
+  stats.activeConnections--;
+  portEXIT_CRITICAL(&serverMux);
+}
+
+// Worker: wacht op een verbinding van de accepteertaak en bedient die
+static void workerTask(void* param) {
+  HttpWorker* worker = (HttpWorker*)param;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    serveConnection(worker->connection);
+    worker->connection.client = WiFiClient();
+    connectionClosed();
+    worker->busy = false;
+  }
+}
+
+// Geef een nieuwe client aan een vrije worker. Is er geen vrij, dan wordt een
+// wachtende keep-alive verbinding gevraagd plaats te maken.
+static bool assignWorker(WiFiClient& client) {
+  unsigned long start = millis();
+  bool yieldRequested = false;
+
+  for (;;) {
+    for (uint8_t i = 0; i < workerCount; i++) {
+      if (!workers[i].busy) {
+        workers[i].busy = true;
+        beginHttpConnection(workers[i].connection, client);
+        connectionOpened();
+        xTaskNotifyGive(workers[i].task);
+        return true;
+      }
+    }
+
+    if (millis() - start >= HTTP_WORKER_WAIT_MS) {
+      return false;
+    }
+    if (!yieldRequested) {
+      portENTER_CRITICAL(&serverMux);
+      idleYieldRequests = 1;
+      portEXIT_CRITICAL(&serverMux);
+      yieldRequested = true;
+    }
+    vTaskDelay(pdMS_TO_TICKS(HTTP_ACCEPT_POLL_MS));
+  }
+}
+
+// Accepteertaak: nieuwe clients naar een vrije worker, anders 503
+static void acceptTask(void*) {
+  for (;;) {
+    WiFiClient client = server.available();
+    if (!client) {
+      vTaskDelay(pdMS_TO_TICKS(HTTP_ACCEPT_POLL_MS));
+      continue;
+    }
+
+    Serial.println("Nieuwe client verbonden");
+    bool assigned = assignWorker(client);
+
+    portENTER_CRITICAL(&serverMux);
+    idleYieldRequests = 0;
+    if (!assigned) stats.rejected++;
+    portEXIT_CRITICAL(&serverMux);
+
+    if (!assigned) {
+      Serial.println("Geen worker vrij, client krijgt 503");
+      HttpRequest request = {};
+      sendHttpResponse(client, request, 503, "", 0, "Retry-After: 1\r\n");
+      client.stop();
+    }
+  }
+}
+
+// Start de workers en de accepteertaak
+static bool startWorkers() {
+  for (uint8_t i = 0; i < HTTP_WORKERS; i++) {
+    workers[i].busy = false;
+    char name[12];
+    snprintf(name, sizeof(name), "http%u", i);
+    if (xTaskCreatePinnedToCore(workerTask, name, HTTP_WORKER_STACK, &workers[i],
+                                HTTP_WORKER_PRIORITY, &workers[i].task, HTTP_TASK_CORE) != pdPASS) {
+      break;
+    }
+    workerCount++;
+  }
+  if (workerCount == 0) {
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(acceptTask, "http_accept", HTTP_ACCEPT_STACK, NULL,
+                              HTTP_ACCEPT_PRIORITY, NULL, HTTP_TASK_CORE) != pdPASS) {
+    // Gestarte workers blijven wachten; loop() bedient de verbindingen
+    workerCount = 0;
+    return false;
+  }
+  return true;
+}
+
 // Start de webserver
 void startWebServer() {
   server.begin();
+  server.setNoDelay(true);
   Serial.println("HTTP server gestart");
   Serial.print("Je kunt de interface benaderen op: http://");
   Serial.println(WiFi.localIP());
-  
+
   // Initialiseer handlers
   initializeWebHandlers();
+
+  if (startWorkers()) {
+    Serial.printf("HTTP workers gestart: %u gelijktijdige verbindingen\n", workerCount);
+  } else {
+    Serial.println("HTTP workers niet gestart, verzoeken worden één voor één bediend");
+  }
 }
 
-// Web-client verzoeken afhandelen
+// Web-client verzoeken afhandelen vanuit loop(); alleen nodig als de workers
+// niet draaien
 void handleClientRequests() {
+  if (workerCount > 0) {
+    return;
+  }
+
   WiFiClient client = server.available();
   if (!client) {
     return;
   }
-  
+
   Serial.println("Nieuwe client verbonden");
-  String currentLine = "";
-  String header = "";
-  
-  unsigned long currentTime = millis();
-  unsigned long previousTime = currentTime;
-  const unsigned long timeoutTime = 10000; // tijdslimiet voor HTTP verzoeken
-  
-  while (client.connected() && currentTime - previousTime <= timeoutTime) {
-    currentTime = millis();
-    
-    if (client.available()) {
-      char c = client.read();
-      header += c;
-      
-      if (c == '\n') {
-        if (currentLine.length() == 0) {
-          // HTTP headers zijn klaar, verwerk het verzoek
-          
-          // Root pagina
-          if (header.indexOf("GET / ") >= 0) {
-            handleRootPage(client);
-          }
-          // Dag foto's bekijken
-          else if (header.indexOf("GET /day/") >= 0) {
-            String folderName = extractPathParameter(header, "GET /day/");
-            handleDayView(client, folderName);
-          }
-          // Individuele foto bekijken
-          else if (header.indexOf("GET /view/") >= 0) {
-            String relativePath = extractPathParameter(header, "GET /view/");
-            handleImageView(client, relativePath);
-          }
-          // Snapshot endpoint
-          else if (header.indexOf("GET /snapshot") >= 0) {
-            handleSnapshot(client);
-          }
-          // Handmatige foto maken
-          else if (header.indexOf("GET /photo") >= 0) {
-            handlePhoto(client);
-          }
-          // Live stream
-          else if (header.indexOf("GET /stream") >= 0) {
-            handleStream(client);
-          }
-          // Download foto
-          else if (header.indexOf("GET /download/") >= 0) {
-            String relativePath = extractPathParameter(header, "GET /download/");
-            handleDownload(client, relativePath);
-          }
-          // Wis SD-kaart
-          else if (header.indexOf("GET /wipe") >= 0) {
-            handleWipe(client);
-          }
-          // Bevestig wissen
-          else if (header.indexOf("GET /confirmwipe") >= 0) {
-            handleConfirmWipe(client);
-          }
-          // Iframe view voor dashboard
-          else if (header.indexOf("GET /iframe") >= 0) {
-            handleIframeView(client);
-          }
-          // Instellingen opslaan
-          else if (header.indexOf("POST /savesettings") >= 0) {
-            // Verbeterde afhandeling van POST data
-            
-            // Zoek naar Content-Length header om de lengte van de POST body te bepalen
-            int contentLength = 0;
-            int contentLengthPos = header.indexOf("Content-Length: ");
-            if (contentLengthPos > 0) {
-              int endPos = header.indexOf("\r\n", contentLengthPos);
-              if (endPos > 0) {
-                contentLength = header.substring(contentLengthPos + 16, endPos).toInt();
-                Serial.println("Content-Length: " + String(contentLength));
-              }
-            }
-            
-            // Vind de start van de POST body
-            String body = "";
-            int bodyStart = header.indexOf("\r\n\r\n");
-            if (bodyStart > 0) {
-              // Alles na de headers is de body
-              body = header.substring(bodyStart + 4);
-              
-              // Als we nog niet alle data hebben ontvangen
-              if (body.length() < contentLength) {
-                Serial.println("Wachten op meer POST data...");
-                unsigned long postTimeout = millis() + 5000; // 5 seconden timeout
-                
-                // Blijf lezen tot we alle data hebben of tot de timeout
-                while (body.length() < contentLength && millis() < postTimeout && client.connected()) {
-                  if (client.available()) {
-                    char c = client.read();
-                    body += c;
-                  }
-                  yield(); // Geef de WiFi stack tijd
-                }
-              }
-            }
-            
-            Serial.println("Ontvangen POST data: " + body);
-            Serial.println("Data lengte: " + String(body.length()) + " bytes");
-            
-            handleSaveSettings(client, body);
-          }
-          
-          break;
-        } else {
-          currentLine = "";
-        }
-      } else if (c != '\r') {
-        currentLine += c;
-      }
-    }
+  beginHttpConnection(inlineConnection, client);
+  connectionOpened();
+  serveConnection(inlineConnection);
+  connectionClosed();
+}
+
+// Kopie van de servertellers
+WebServerStats getWebServerStats() {
+  portENTER_CRITICAL(&serverMux);
+  WebServerStats copy = stats;
+  portEXIT_CRITICAL(&serverMux);
+  copy.workers = workerCount;
+  copy.longActive = longActive;
+  return copy;
+}
+
+// Latentie per route; geeft het aantal ingevulde regels
+int getRouteStats(RouteStats* out, int maxRoutes) {
+  int count = 0;
+  portENTER_CRITICAL(&serverMux);
+  for (size_t i = 0; i < ROUTE_COUNT && count < maxRoutes; i++) {
+    out[count].method = routes[i].method;
+    out[count].path = routes[i].path;
+    out[count].requests = routeRequests[i];
+    out[count].totalMs = routeTotalMs[i];
+    out[count].maxMs = routeMaxMs[i];
+    count++;
   }
-  
-  // Verbinding sluiten
-  header = "";
-  client.stop();
-  Serial.println("Client verbinding verbroken");
+  portEXIT_CRITICAL(&serverMux);
+  return count;
 }
\ No newline at end of file
@@ -4,11 +4,45 @@
 #include "config.h"
 #include <WiFi.h>
 
+// Persistente verbindingen (HTTP keep-alive)
+#define HTTP_KEEPALIVE_TIMEOUT      5000   // ms wachten op een volgend verzoek
+#define HTTP_KEEPALIVE_MAX_REQUESTS 100    // Verzoeken per verbinding
+
+// Verbindingen worden parallel bediend door een vaste pool van workers
+#define HTTP_WORKERS                3      // Gelijktijdige verbindingen
+#define HTTP_WORKER_WAIT_MS         2000   // Zo lang wacht een nieuwe client op een vrije worker
+#define HTTP_LONG_WORKERS           (HTTP_WORKERS - 1) // Workers voor lange routes (stream, video, archief)
+#define HTTP_MAX_ROUTES             32     // Ruimte voor statistieken per route
+
+// Tellers van de webserver
+struct WebServerStats {
+  uint8_t workers;             // 0: geen pool, verzoeken worden in loop() bediend
+  uint8_t activeConnections;
+  uint8_t maxActiveConnections;
+  uint32_t connections;        // Geaccepteerde verbindingen
+  uint32_t rejected;           // 503: geen worker vrij binnen HTTP_WORKER_WAIT_MS
+  uint32_t requests;
+  uint8_t longActive;          // Workers bezet door lange routes
+  uint8_t maxLongActive;
+  uint32_t longRejected;       // 503: alle HTTP_LONG_WORKERS plekken bezet
+};
+
+// Latentie per route (verzoek gelezen tot antwoord verstuurd)
+struct RouteStats {
+  const char* method;
+  const char* path;
+  uint32_t requests;
+  uint32_t totalMs;
+  uint32_t maxMs;
+};
+
 // Webserver instantie
 extern WiFiServer server;
 
 // Basis webserver functionaliteit
 void startWebServer();
 void handleClientRequests();
+WebServerStats getWebServerStats();
+int getRouteStats(RouteStats* stats, int maxRoutes);
 
 #endif // WEB_SERVER_H
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "settings_manager.h"
 #include "camera.h"
 #include "sd_card.h"
+#include "file_stream.h"
+#include "photo_store.h"
+#include "retention.h"
 
 // Stuur standaard HTTP headers
 void sendHttpHeaders(WiFiClient& client, String contentType) {
@@ -11,11 +14,47 @@ void sendHttpHeaders(WiFiClient& client, String contentType) {
   client.println();
 }
 
-// Extraheer een padparameter uit de HTTP-header
-String extractPathParameter(String header, String prefix) {
-  int startPos = header.indexOf(prefix) + prefix.length();
-  int endPos = header.indexOf(" ", startPos);
-  return header.substring(startPos, endPos);
+// Stuur statusregel en headers voor een antwoord met bekende lengte. De
+// verbinding blijft open als de client dat wil (request.keepAliveRequested);
+// request.keepAlive geeft daarna aan of de server op een volgend verzoek wacht.
+void sendHttpResponse(WiFiClient& client, HttpRequest& request, int status, String contentType,
+                      size_t contentLength, String extraHeaders) {
+  request.keepAlive = request.keepAliveRequested;
+  
+  // Alle headers in één keer schrijven (één TCP-segment)
+  String headers = "HTTP/1.1 " + String(status) + " " + httpStatusText(status) + "\r\n";
+  if (contentType.length() > 0) {
+    headers += "Content-Type: " + contentType + "\r\n";
+  }
+  // Een 304 heeft geen body; Content-Length zou die van het 200-antwoord moeten zijn
+  if (status != 304) {
+    headers += "Content-Length: " + String((unsigned long)contentLength) + "\r\n";
+  }
+  headers += extraHeaders;
+  headers += request.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+  client.print(headers);
+}
+
+// Stuur een foutstatus zonder inhoud
+void sendHttpError(WiFiClient& client, HttpRequest& request, int status) {
+  sendHttpResponse(client, request, status, "", 0);
+}
+
+// Omschrijving bij een HTTP-statuscode
+const char* httpStatusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
 }
 
 // Haal een waarde uit een formulier
@@ -53,12 +92,14 @@ void processSettingsForm(String body) {
   String startHourStr = extractFormValue(body, "dayStartHour");
   String endHourStr = extractFormValue(body, "dayEndHour");
   String qualityStr = extractFormValue(body, "jpegQuality");
+  String modeStr = extractFormValue(body, "captureMode");
   
   Serial.println("Geëxtraheerde waarden:");
   Serial.println("- interval: '" + intervalStr + "'");
   Serial.println("- startHour: '" + startHourStr + "'");
   Serial.println("- endHour: '" + endHourStr + "'");
   Serial.println("- quality: '" + qualityStr + "'");
+  Serial.println("- mode: '" + modeStr + "'");
   
   // Converteer naar integers en valideer de waardes
   int interval = intervalStr.toInt();
@@ -95,14 +136,48 @@ void processSettingsForm(String body) {
     Serial.println("Ongeldige kwaliteitswaarde: " + String(quality));
   }
   
+  // Ontbreekt bij een formulier van oudere firmware: modus ongewijzigd laten
+  if (modeStr.length() > 0) {
+    captureMode = modeStr.toInt() == CAPTURE_MODE_CHANGE ? CAPTURE_MODE_CHANGE : CAPTURE_MODE_INTERVAL;
+    Serial.println("Nieuwe opnamemodus: " + String(captureMode));
+  }
+  
+  // Bewaarbeleid; ook deze velden ontbreken bij een formulier van oudere firmware
+  String maxMBStr = extractFormValue(body, "retentionMaxMB");
+  String maxDaysStr = extractFormValue(body, "retentionMaxDays");
+  String thinAfterStr = extractFormValue(body, "thinAfterDays");
+  String keepEveryStr = extractFormValue(body, "thinKeepEvery");
+  if (maxMBStr.length() > 0 && maxMBStr.toInt() >= 0) {
+    retentionMaxMB = maxMBStr.toInt();
+    Serial.println("Nieuw maximaal kaartgebruik: " + String(retentionMaxMB) + " MB");
+  }
+  if (maxDaysStr.length() > 0 && maxDaysStr.toInt() >= 0) {
+    retentionMaxDays = maxDaysStr.toInt();
+    Serial.println("Nieuw maximum aantal dagen: " + String(retentionMaxDays));
+  }
+  if (thinAfterStr.length() > 0 && thinAfterStr.toInt() >= 0) {
+    thinAfterDays = thinAfterStr.toInt();
+    Serial.println("Uitdunnen na: " + String(thinAfterDays) + " dagen");
+  }
+  int keepEvery = keepEveryStr.toInt();
+  if (keepEvery >= 2 && keepEvery <= 60) {
+    thinKeepEvery = keepEvery;
+    Serial.println("Bij uitdunnen elke " + String(thinKeepEvery) + "e foto bewaren");
+  } else if (keepEveryStr.length() > 0) {
+    Serial.println("Ongeldige uitdunwaarde: " + keepEveryStr);
+  }
+  
   // Sla instellingen op in flash
   saveSettings();
+  
+  // Nieuw bewaarbeleid direct toepassen
+  retentionNotify();
 }
 
 // Decodeer URL-encoded string
 String urlDecode(String input) {
   String output = "";
-  for (int i = 0; i < input.length(); i++) {
+  for (unsigned int i = 0; i < input.length(); i++) {
     if (input[i] == '%') {
       if (i + 2 < input.length()) {
         int hexValue = 0;
@@ -160,49 +235,159 @@ void parseQueryParams(String url, std::map<String, String>& params) {
   } while (ampersandPos >= 0);
 }
 
-// Stuur een afbeelding direct naar de browser voor weergave
-void sendImageFile(WiFiClient client, String filePath) {
-  if (!sdCardAvailable || !SD_MMC.exists(filePath)) {
-    client.println("HTTP/1.1 404 Not Found");
-    client.println("Connection: close");
-    client.println();
+// Pad zonder query parameters
+String stripQueryString(String url) {
+  int questionMarkPos = url.indexOf('?');
+  return questionMarkPos < 0 ? url : url.substring(0, questionMarkPos);
+}
+
+// Numerieke query parameter, of de standaardwaarde als die ontbreekt
+int queryParamInt(std::map<String, String>& params, String name, int defaultValue) {
+  std::map<String, String>::iterator it = params.find(name);
+  if (it == params.end() || it->second.length() == 0) return defaultValue;
+  return it->second.toInt();
+}
+
+// ETag van een opgeslagen bestand: grootte en wijzigingstijd. Foto's worden
+// na het opslaan niet meer aangepast, dus dit identificeert de inhoud.
+String fileETag(size_t fileSize, time_t lastWrite) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "\"%x-%lx\"", (unsigned int)fileSize, (unsigned long)lastWrite);
+  return String(buf);
+}
+
+// Bepaal het gevraagde bereik uit de Range-header (één bereik, in bytes).
+// Met If-Range wordt het bereik alleen gebruikt als de ETag of datum nog klopt;
+// anders, of bij meerdere bereiken, wordt het hele bestand gestuurd.
+RangeResult parseRangeHeader(const HttpRequest& request, size_t totalSize, const String& etag,
+                             const String& lastModified, size_t& start, size_t& length) {
+  if (!request.range || strncmp(request.range, "bytes=", 6) != 0) {
+    return RANGE_NONE;
+  }
+  if (request.ifRange && etag != request.ifRange && lastModified != request.ifRange) {
+    return RANGE_NONE;
+  }
+
+  const char* spec = request.range + 6;
+  if (strchr(spec, ',')) {
+    return RANGE_NONE;
+  }
+
+  char* endPtr;
+  if (spec[0] == '-') {
+    // Laatste N bytes
+    unsigned long suffix = strtoul(spec + 1, &endPtr, 10);
+    if (endPtr == spec + 1 || *endPtr != '\0') return RANGE_NONE;
+    if (suffix == 0 || totalSize == 0) return RANGE_UNSATISFIABLE;
+    length = min((size_t)suffix, totalSize);
+    start = totalSize - length;
+    return RANGE_OK;
+  }
+
+  unsigned long first = strtoul(spec, &endPtr, 10);
+  if (endPtr == spec || *endPtr != '-') return RANGE_NONE;
+  const char* lastSpec = endPtr + 1;
+  unsigned long last = totalSize > 0 ? totalSize - 1 : 0;
+  if (*lastSpec != '\0') {
+    last = strtoul(lastSpec, &endPtr, 10);
+    if (*endPtr != '\0' || last < first) return RANGE_NONE;
+  }
+
+  if (first >= totalSize) return RANGE_UNSATISFIABLE;
+  start = first;
+  length = min((size_t)last, totalSize - 1) - start + 1;
+  return RANGE_OK;
+}
+
+// Heeft de client deze versie al? If-None-Match gaat voor If-Modified-Since.
+// De datum wordt letterlijk vergeleken: browsers sturen de Last-Modified
+// waarde ongewijzigd terug.
+bool requestNotModified(const HttpRequest& request, const String& etag, const String& lastModified) {
+  if (request.ifNoneMatch) {
+    if (strcmp(request.ifNoneMatch, "*") == 0) return true;
+    // Lijst van (eventueel zwakke) ETags; zwakke vergelijking is hier toegestaan
+    const char* p = request.ifNoneMatch;
+    while (*p) {
+      while (*p == ' ' || *p == ',') p++;
+      if (strncmp(p, "W/", 2) == 0) p += 2;
+      size_t length = strcspn(p, ",");
+      while (length > 0 && p[length - 1] == ' ') length--;
+      if (length == etag.length() && strncmp(p, etag.c_str(), length) == 0) return true;
+      p += strcspn(p, ",");
+    }
+    return false;
+  }
+  return request.ifModifiedSince && lastModified.length() > 0 && lastModified == request.ifModifiedSince;
+}
+
+// Stuur een bestand van de SD-kaart met ETag, Last-Modified en ondersteuning
+// voor conditionele GET (304) en Range/If-Range (206 Partial Content), zodat
+// een browser niets opnieuw laadt en een afgebroken download kan worden hervat
+void sendFile(WiFiClient& client, HttpRequest& request, String filePath, String contentType,
+              String extraHeaders) {
+  // Los bestand, of een foto uit het segment van de dag
+  PhotoSource source;
+  if (!sdCardAvailable || !openPhotoSource(filePath, source)) {
+    sendHttpError(client, request, 404);
     return;
   }
+  File& file = source.file;
   
-  File file = SD_MMC.open(filePath, FILE_READ);
-  if (!file) {
-    client.println("HTTP/1.1 404 Not Found");
-    client.println("Connection: close");
-    client.println();
-    return;
+  // Bestandsgrootte en validators bepalen
+  size_t fileSize = source.size;
+  time_t lastWrite = source.lastWrite;
+  String etag = fileETag(fileSize, lastWrite);
+  String lastModified = lastWrite > 0 ? httpDate(lastWrite) : "";
+  
+  String headers = "Accept-Ranges: bytes\r\nETag: " + etag + "\r\n";
+  if (lastModified.length() > 0) {
+    headers += "Last-Modified: " + lastModified + "\r\n";
   }
+  headers += extraHeaders;
   
-  // Bestandsgrootte bepalen
-  size_t fileSize = file.size();
+  // Conditionele GET: alleen de metadata is gelezen, niet de inhoud
+  if (requestNotModified(request, etag, lastModified)) {
+    file.close();
+    sendHttpResponse(client, request, 304, "", 0, headers);
+    return;
+  }
   
-  client.println("HTTP/1.1 200 OK");
-  client.println("Content-Type: image/jpeg");
-  client.print("Content-Length: ");
-  client.println(fileSize);
-  client.println("Connection: close");
-  client.println();
+  size_t start = 0;
+  size_t length = fileSize;
+  RangeResult range = parseRangeHeader(request, fileSize, etag, lastModified, start, length);
+  if (range == RANGE_UNSATISFIABLE) {
+    file.close();
+    sendHttpResponse(client, request, 416, "", 0,
+                     "Content-Range: bytes */" + String((unsigned long)fileSize) + "\r\n");
+    return;
+  }
+  if (range == RANGE_OK) {
+    headers += "Content-Range: bytes " + String((unsigned long)start) + "-" +
+               String((unsigned long)(start + length - 1)) + "/" + String((unsigned long)fileSize) + "\r\n";
+    if (start > 0 && !file.seek(source.start + start)) {
+      file.close();
+      sendHttpError(client, request, 500);
+      return;
+    }
+  }
   
-  // Bestand in chunks naar client sturen
-  const size_t bufferSize = 1024;
-  uint8_t buffer[bufferSize];
-  size_t bytesRemaining = fileSize;
+  sendHttpResponse(client, request, range == RANGE_OK ? 206 : 200, contentType, length, headers);
   
-  while (bytesRemaining > 0) {
-    size_t bytesToRead = min(bufferSize, bytesRemaining);
-    file.read(buffer, bytesToRead);
-    client.write(buffer, bytesToRead);
-    bytesRemaining -= bytesToRead;
-    yield(); // WiFi-stack tijd geven om te verwerken
+  // Bestand in grote blokken versturen; lezen en versturen overlappen
+  if (streamFile(client, file, length) < length) {
+    // Bestand korter dan verwacht of client weg: de verbinding kan niet open blijven
+    request.keepAlive = false;
   }
   
   file.close();
 }
 
+// Stuur een afbeelding direct naar de browser voor weergave. Opgeslagen foto's
+// veranderen niet meer, dus de browser mag ze onbeperkt bewaren.
+void sendImageFile(WiFiClient& client, HttpRequest& request, String filePath, bool immutable) {
+  sendFile(client, request, filePath, "image/jpeg", immutable ? PHOTO_CACHE_CONTROL : "Cache-Control: no-cache\r\n");
+}
+
 // Controleer of een string begint met een bepaald patroon
 bool startsWith(String str, String prefix) {
   if (str.length() < prefix.length()) {
@@ -211,12 +396,14 @@ bool startsWith(String str, String prefix) {
   return str.substring(0, prefix.length()).equals(prefix);
 }
 
-// Genereer een HTTP datum header
-String httpDate() {
-  time_t now;
+// Genereer een HTTP datum header (0 = huidige tijd)
+String httpDate(time_t timestamp) {
+  time_t now = timestamp;
   struct tm timeinfo;
   
-  time(&now);
+  if (now == 0) {
+    time(&now);
+  }
   gmtime_r(&now, &timeinfo);
   
   char buf[50];
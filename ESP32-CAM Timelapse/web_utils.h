@@ -4,17 +4,39 @@
 #include "config.h"
 #include <WiFi.h>
 #include <map>
+#include "http_parser.h"
+
+// Opgeslagen foto's veranderen nooit: de browser mag ze een jaar bewaren
+#define PHOTO_CACHE_CONTROL "Cache-Control: public, max-age=31536000, immutable\r\n"
+
+// Uitkomst van een Range-header
+enum RangeResult {
+  RANGE_NONE,                // Geen (bruikbaar) bereik: hele bestand sturen
+  RANGE_OK,                  // 206 met start/length
+  RANGE_UNSATISFIABLE        // 416: bereik valt buiten het bestand
+};
 
 // Declaraties voor hulpfuncties
 void sendHttpHeaders(WiFiClient& client, String contentType = "text/html");
-String extractPathParameter(String header, String prefix);
+void sendHttpResponse(WiFiClient& client, HttpRequest& request, int status, String contentType,
+                      size_t contentLength, String extraHeaders = "");
+void sendHttpError(WiFiClient& client, HttpRequest& request, int status);
+const char* httpStatusText(int status);
 String extractFormValue(String body, String name);
 void processSettingsForm(String body);
 String urlDecode(String input);
 void parseQueryParams(String url, std::map<String, String>& params);
-void sendImageFile(WiFiClient client, String filePath);
+String stripQueryString(String url);
+int queryParamInt(std::map<String, String>& params, String name, int defaultValue);
+String fileETag(size_t fileSize, time_t lastWrite);
+RangeResult parseRangeHeader(const HttpRequest& request, size_t totalSize, const String& etag,
+                             const String& lastModified, size_t& start, size_t& length);
+void sendFile(WiFiClient& client, HttpRequest& request, String filePath, String contentType,
+              String extraHeaders = "");
+bool requestNotModified(const HttpRequest& request, const String& etag, const String& lastModified);
+void sendImageFile(WiFiClient& client, HttpRequest& request, String filePath, bool immutable = true);
 bool startsWith(String str, String prefix);
-String httpDate();
+String httpDate(time_t timestamp = 0);
 String getMimeType(String filename);
 
 #endif // WEB_UTILS_H
\ No newline at end of file
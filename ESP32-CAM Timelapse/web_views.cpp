@@ -3,6 +3,15 @@
 #include "time_manager.h"
 #include "settings_manager.h"
 #include "sd_card.h"
+#include "capture_task.h"
+#include "sd_writer.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "thumbnails.h"
+#include "retention.h"
+#include "card_usage.h"
+#include "photo_journal.h"
+#include "web_server.h"
 
 // Genereer de statussectie voor de hoofdpagina
 void generateStatusSection(WiFiClient& client) {
@@ -12,9 +21,135 @@ void generateStatusSection(WiFiClient& client) {
     client.println("<p>SD-kaart status: <span style=\"color: red;\">NIET BESCHIKBAAR</span></p>");
     client.println("<p>Plaats een SD-kaart en herstart de camera.</p>");
   }
-  client.println("<p>Foto interval: " + String(photoInterval) + " minuten</p>");
+  client.println("<p>Foto interval: " + String(photoInterval) + " minuten" +
+                 (captureMode == CAPTURE_MODE_CHANGE ? String(", opnemen bij verandering") : String("")) + "</p>");
   client.println("<p>Opnametijden: " + String(dayStartHour) + ":00 - " + String(dayEndHour) + ":00</p>");
   
+  // Afwijking van het opnameschema (gepland vs. werkelijk)
+  CaptureStats stats = getCaptureStats();
+  if (stats.captured > 0) {
+    client.println("<p>Opname-jitter: laatste " + String(stats.lastJitterMs) + " ms, max " +
+                   String(stats.maxJitterMs) + " ms, gem. " +
+                   String((long)(stats.totalJitterMs / stats.captured)) + " ms (" +
+                   String(stats.captured) + " opnames, " + String(stats.skipped) + " overgeslagen)</p>");
+  }
+  
+  // Inregelen van de belichting en spreiding over de dag
+  if (stats.settled > 0) {
+    String line = "<p>Belichting: inregelen laatste " + String(stats.lastSettleMs) + " ms, max " +
+                  String(stats.maxSettleMs) + " ms, gem. " +
+                  String((unsigned long)(stats.totalSettleMs / stats.settled)) + " ms; laatste frame " +
+                  String(stats.lastFinalMs) + " ms, max " + String(stats.maxFinalMs) + " ms (" +
+                  String(stats.settleTimeouts) + " time-outs); luminantie " + String(stats.lastLuma);
+    if (stats.exposureSamples > 0) {
+      line += ", vandaag gem. " + String(stats.exposureMean, 1) + " &plusmn; " +
+              String(captureExposureStdDev(stats), 1) + " over " + String(stats.exposureSamples) + " opnames";
+    }
+    if (stats.previousExposureSamples > 0) {
+      line += ", " + String(stats.previousExposureDay) + " &plusmn; " +
+              String(stats.previousExposureStdDev, 1);
+    }
+    client.println(line + "</p>");
+  }
+  
+  // Opnemen bij verandering: kosten van de proefbeelden en bespaarde opslag
+  if (stats.probes > 0 || stats.changeCaptures + stats.idleCaptures > 0) {
+    uint32_t adaptive = stats.changeCaptures + stats.idleCaptures;
+    int32_t saved = captureFramesSaved(stats);
+    String line = "<p>Bij verandering: " + String(stats.probes) + " proefbeelden (gem. " +
+                  String(stats.probes ? (unsigned long)(stats.totalProbeMs / stats.probes) : 0UL) + " ms, max " +
+                  String(stats.maxProbeMs) + " ms, " + String(stats.probeFailures) + " mislukt), laatste verschil " +
+                  String(stats.lastDifference) + " (drempel " + String(CHANGE_THRESHOLD) + "); " +
+                  String(stats.changeCaptures) + " foto's door verandering, " + String(stats.idleCaptures) +
+                  " na het maximale interval; " + String(saved) + " foto's bespaard t.o.v. vast interval";
+    if (adaptive > 0 && saved > 0) {
+      line += " (ca. " + formatFileSize((size_t)(stats.changeBytes / adaptive * saved)) + ")";
+    }
+    client.println(line + "</p>");
+  }
+  
+  // Achterstand en schrijftijden van de SD-schrijver
+  WriterStats writer = getWriterStats();
+  if (writer.written > 0 || writer.dropped > 0) {
+    client.println("<p>SD-schrijver: " + String(writer.queueDepth) + "/" + String(writer.poolSlots) +
+                   " in wachtrij (max " + String(writer.maxQueueDepth) + "), " +
+                   String(writer.written) + " geschreven, " + String(writer.dropped) + " overgeslagen, " +
+                   String(writer.failed) + " mislukt; schrijftijd p50 " + String(writer.p50Ms) +
+                   " ms, p95 " + String(writer.p95Ms) + " ms, p99 " + String(writer.p99Ms) + " ms</p>");
+  }
+  
+  // Segmentopslag (alleen als die aan staat)
+  if (segmentStorage) {
+    SegmentStats segments = getSegmentStats();
+    client.println("<p>Opslag: segmenten per dag, " + String(segments.appended) + " foto's toegevoegd in " +
+                   String(segments.segmentsCreated) + " nieuwe segmenten, " + String(segments.fallbacks) +
+                   " als los bestand; toevoegen laatste " + String(segments.lastMs) + " ms, max " +
+                   String(segments.maxMs) + " ms</p>");
+  }
+  
+  // Bewaarbeleid: prognose en voortgang van het opruimen, met het actuele
+  // gebruik uit het geheugen
+  RetentionStats retention = getRetentionStats();
+  CardStatus card = getCardStatus();
+  if (retention.cardBytes > 0) {
+    uint64_t used = card.seeded ? card.usedBytes : retention.usedBytes;
+    String line = "<p>Kaartgebruik: " + String((unsigned long)(used >> 20)) + " van " +
+                  String((unsigned long)(retention.limitBytes >> 20)) + " MB gebruikt";
+    if (retention.daysUntilFull > 0) {
+      line += ", ca. " + String(retention.dailyBytes / (1024.0 * 1024.0), 1) + " MB per dag, vol over " +
+              String(retention.daysUntilFull) + " dagen";
+    } else if (retention.daysUntilFull == 0 && retention.usedBytes >= retention.limitBytes) {
+      line += ", vol: oudste dagen worden verwijderd";
+    } else if (retention.daysUntilFull == 0) {
+      line += ", vol binnen een dag";
+    }
+    if (retention.filesRemoved > 0) {
+      uint32_t busy = max(retention.busyMs, (uint32_t)1);
+      line += "; opgeruimd: " + String(retention.daysDeleted) + " dagen, " + String(retention.daysThinned) +
+              " uitgedund, " + String(retention.filesRemoved) + " bestanden (" +
+              String((unsigned long)(retention.bytesFreed >> 20)) + " MB) met " +
+              String((unsigned long)((uint64_t)retention.filesRemoved * 1000 / busy)) + " bestanden/s";
+    }
+    if (retention.lastAction[0]) {
+      line += " (" + String(retention.lastAction) + (retention.active ? ", bezig" : "") + ")";
+    }
+    client.println(line + " (<a href=\"/api/storage\">details</a>)</p>");
+  }
+  
+  // Gezondheid van de kaart: schrijfsnelheid van foto's tegenover na het opstarten
+  if (card.writes > 0) {
+    String color = card.health == CARD_HEALTH_FAILING ? "red" : card.health == CARD_HEALTH_SLOW ? "orange" : "green";
+    String line = "<p>Kaart: <span style=\"color: " + color + ";\">" + String(cardHealthName(card.health)) +
+                  "</span>, foto schrijven p50 " + String(card.p50Ms) + " ms, p95 " + String(card.p95Ms) +
+                  " ms, " + String(card.recentKBps) + " KB/s";
+    if (card.baselineKBps > 0) line += " (na opstarten " + String(card.baselineKBps) + " KB/s)";
+    if (card.failedWrites > 0) line += ", " + String(card.failedWrites) + " mislukt";
+    client.println(line + " (<a href=\"/api/card\">details</a>)</p>");
+  }
+  
+  // Herstel na een onderbreking bij het opstarten
+  JournalStats journal = getJournalStats();
+  if (journal.tempRemoved + journal.corrupt + journal.reindexed > 0) {
+    client.println("<p>Herstel bij opstarten: " + String(journal.tempRemoved) + " onderbroken opslag, " +
+                   String(journal.corrupt) + " beschadigde foto's verwijderd, " + String(journal.reindexed) +
+                   " foto's opnieuw in de index (" + String(journal.recoveryMs) + " ms)</p>");
+  }
+  
+  // Miniaturen voor de galerij
+  ThumbnailStats thumbs = getThumbnailStats();
+  if (thumbs.generated > 0 || thumbs.failed > 0 || thumbs.backfillActive) {
+    client.println("<p>Miniaturen: " + String(thumbs.generated) + " gemaakt, " + String(thumbs.failed) +
+                   " mislukt, " + String(thumbs.dropped) + " uitgesteld; laatste " + String(thumbs.lastMs) +
+                   " ms, " + formatFileSize(thumbs.lastBytes) + (thumbs.backfillActive ? " (aanvullen bezig)" : "") + "</p>");
+  }
+  
+  // Gelijktijdige webverbindingen
+  WebServerStats webStats = getWebServerStats();
+  client.println("<p>Webserver: " + String(webStats.activeConnections) + " van " + String(webStats.workers) +
+                 " verbindingen actief (max " + String(webStats.maxActiveConnections) + "), " +
+                 String(webStats.requests) + " verzoeken, " + String(webStats.rejected) +
+                 " geweigerd, " + String(webStats.longRejected) + " lange verzoeken geweigerd (<a href=\"/api/server\">details</a>)</p>");
+  
   // Tijd weergeven
   time_t now;
   struct tm timeinfo;
@@ -30,79 +165,29 @@ void generatePhotosTab(WiFiClient& client) {
   client.println("<div id=\"photos-tab\" class=\"tab-content\">");
   client.println("<h2>Opgenomen Timelapse Foto's</h2>");
   
-  // Toon dagen met opnamen
+  // Toon dagen met opnamen uit het dagoverzicht van de index
   if (sdCardAvailable) {
-    File root = SD_MMC.open("/timelapse");
-    if (root && root.isDirectory()) {
-      // Array van mappen (dagen) creëren
-      struct DayFolder {
-        String name;
-        int fileCount;
-      };
-      
-      // Eerst tellen hoeveel mappen er zijn
-      int folderCount = 0;
-      File entry = root.openNextFile();
-      while (entry) {
-        if (entry.isDirectory()) {
-          folderCount++;
-        }
-        entry.close();
-        entry = root.openNextFile();
-      }
-      
-      // Als er mappen zijn, toon ze
-      if (folderCount > 0) {
-        // Array voor mappen maken
-        DayFolder days[folderCount];
-        
-        // Reset directory pointer
-        root.close();
-        root = SD_MMC.open("/timelapse");
-        
-        // Mappen lezen en aantal bestanden per map tellen
-        int dayIndex = 0;
-        entry = root.openNextFile();
-        while (entry && dayIndex < folderCount) {
-          if (entry.isDirectory()) {
-            String dirName = String(entry.name()).substring(String(entry.name()).lastIndexOf('/') + 1);
-            days[dayIndex].name = dirName;
-            
-            // Tel aantal bestanden in deze map
-            File dayDir = SD_MMC.open(String(entry.name()));
-            int fileCount = 0;
-            File dayFile = dayDir.openNextFile();
-            while (dayFile) {
-              if (!dayFile.isDirectory()) {
-                fileCount++;
-              }
-              dayFile.close();
-              dayFile = dayDir.openNextFile();
-            }
-            dayDir.close();
-            
-            days[dayIndex].fileCount = fileCount;
-            dayIndex++;
-          }
-          entry.close();
-          entry = root.openNextFile();
-        }
-        
-        // Toon de dagen in de UI, nieuwste eerst
-        client.println("<div class=\"day-list\">");
-        for (int i = folderCount - 1; i >= 0; i--) {
-          client.println("<div class=\"day-item\">");
-          client.println("<a href=\"/day/" + days[i].name + "\" class=\"day-link\">" + days[i].name + "</a>");
-          client.println("<span>" + String(days[i].fileCount) + " foto's</span>");
-          client.println("</div>");
-        }
+    int dayCount = 0;
+    File summaries = openDaySummaries(dayCount);
+    if (summaries && dayCount > 0) {
+      // Toon de dagen in de UI, nieuwste eerst
+      client.println("<div class=\"day-list\">");
+      DayIndexSummary day;
+      for (int i = dayCount - 1; i >= 0; i--) {
+        if (!readDaySummary(summaries, i, day)) continue;
+        String dayName = String(day.name);
+        client.println("<div class=\"day-item\">");
+        client.println("<a href=\"/day/" + dayName + "\" class=\"day-link\">" + dayName + "</a>");
+        client.println("<span>" + String(day.photoCount) + " foto's</span>");
         client.println("</div>");
-      } else {
-        client.println("<p>Geen timelapse opnamen gevonden.</p>");
       }
+      client.println("</div>");
+    } else if (summaries) {
+      client.println("<p>Geen timelapse opnamen gevonden.</p>");
     } else {
-      client.println("<p>Timelapse map niet gevonden of leeg.</p>");
+      client.println("<p>Foto-index niet gevonden. <a href=\"/rebuildindex\">Index herbouwen</a></p>");
     }
+    summaries.close();
   }
   
   client.println("</div>"); // einde foto's tabblad
@@ -115,6 +200,12 @@ void generateSettingsForm(WiFiClient& client) {
   settingsHTML.replace("{dayStartHour}", String(dayStartHour));
   settingsHTML.replace("{dayEndHour}", String(dayEndHour));
   settingsHTML.replace("{jpegQuality}", String(jpegQuality));
+  settingsHTML.replace("{modeInterval}", captureMode == CAPTURE_MODE_INTERVAL ? " selected" : "");
+  settingsHTML.replace("{modeChange}", captureMode == CAPTURE_MODE_CHANGE ? " selected" : "");
+  settingsHTML.replace("{retentionMaxMB}", String(retentionMaxMB));
+  settingsHTML.replace("{retentionMaxDays}", String(retentionMaxDays));
+  settingsHTML.replace("{thinAfterDays}", String(thinAfterDays));
+  settingsHTML.replace("{thinKeepEvery}", String(thinKeepEvery));
   client.println(settingsHTML);
 }
 
@@ -0,0 +1,389 @@
+#include "zip_archive.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "file_stream.h"
+#include "web_utils.h"
+#include "esp_rom_crc.h"
+#include <vector>
+
+// ZIP-export van een of meer dagmappen. Het archief wordt tijdens het
+// versturen opgebouwd: per foto een lokale header, de foto ongecomprimeerd
+// (stored) en een data descriptor met de CRC-32, daarna de centrale map.
+// Alle groottes komen uit de foto-index, zodat Content-Length vooraf bekend
+// is en een afgebroken download met Range kan worden hervat. Er wordt nooit
+// een hele foto in het geheugen gehouden; alleen de CRC per foto wordt
+// bewaard voor de centrale map.
+
+#define ZIP_LOCAL_HEADER_SIZE   30
+#define ZIP_DESCRIPTOR_SIZE     16
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE            22
+#define ZIP_FLAG_DESCRIPTOR     0x0008
+#define ZIP_VERSION             20
+
+// Een dag in het archief; count ligt vast bij het plannen, zodat foto's die
+// tijdens de download binnenkomen het archief niet veranderen
+struct ArchiveDay {
+  char name[sizeof(DayIndexSummary::name)];
+  int count;
+};
+
+// Voortgang door het archief en het deel dat de client wil ontvangen
+struct ArchiveStream {
+  WiFiClient* client;
+  uint32_t position;         // Positie in het archief
+  uint32_t rangeStart;
+  uint32_t rangeEnd;         // Exclusief
+  uint32_t sent;
+  bool failed;
+};
+
+// Sorteersleutel YYYYMMDD van een dagmapnaam (DD-MM-YYYY)
+static uint32_t archiveDayKey(const char* dayName) {
+  int day = 0, month = 0, year = 0;
+  if (sscanf(dayName, "%d-%d-%d", &day, &month, &year) != 3) return 0;
+  return (uint32_t)(year * 10000 + month * 100 + day);
+}
+
+// Little-endian velden in een header
+static uint8_t* put16(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+  return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+  return p + 4;
+}
+
+// Opnametijd als MS-DOS tijd en datum
+static void dosDateTime(uint32_t timestamp, uint16_t& dosTime, uint16_t& dosDate) {
+  time_t t = timestamp;
+  struct tm timeinfo;
+  localtime_r(&t, &timeinfo);
+  if (timeinfo.tm_year < 80) {
+    dosTime = 0;
+    dosDate = (1 << 5) | 1;  // 1 januari 1980
+    return;
+  }
+  dosTime = (timeinfo.tm_hour << 11) | (timeinfo.tm_min << 5) | (timeinfo.tm_sec / 2);
+  dosDate = ((timeinfo.tm_year - 80) << 9) | ((timeinfo.tm_mon + 1) << 5) | timeinfo.tm_mday;
+}
+
+// Overlapt [start, start + length) met het gevraagde bereik?
+static bool inRange(const ArchiveStream& stream, uint32_t start, uint32_t length) {
+  return start < stream.rangeEnd && start + length > stream.rangeStart;
+}
+
+// Schrijf bytes van het archief; alleen het deel binnen het bereik gaat naar de client
+static void emit(ArchiveStream& stream, const uint8_t* data, uint32_t length) {
+  if (!stream.failed && inRange(stream, stream.position, length)) {
+    uint32_t from = stream.rangeStart > stream.position ? stream.rangeStart - stream.position : 0;
+    uint32_t to = min(length, stream.rangeEnd - stream.position);
+    size_t written = stream.client->write(data + from, to - from);
+    stream.sent += written;
+    if (written < to - from) stream.failed = true;
+  }
+  stream.position += length;
+}
+
+// Lees bytes voor de CRC zonder ze te versturen
+static uint32_t crcFromFile(File& file, uint32_t length, uint32_t crc, uint32_t& bytesRead) {
+  uint8_t buffer[512];
+  bytesRead = 0;
+  while (bytesRead < length) {
+    size_t n = file ? file.read(buffer, min((uint32_t)sizeof(buffer), length - bytesRead)) : 0;
+    if (n == 0) break;
+    crc = esp_rom_crc32_le(crc, buffer, n);
+    bytesRead += n;
+  }
+  return crc;
+}
+
+// Nullen in plaats van ontbrekende bytes (foto korter dan in de index)
+static uint32_t emitPadding(ArchiveStream& stream, uint32_t length, uint32_t crc) {
+  uint8_t zeros[64] = {};
+  while (length > 0) {
+    uint32_t n = min((uint32_t)sizeof(zeros), length);
+    crc = esp_rom_crc32_le(crc, zeros, n);
+    emit(stream, zeros, n);
+    length -= n;
+  }
+  return crc;
+}
+
+// Stuur de inhoud van één foto en geef de CRC-32. De CRC is alleen nodig als
+// de data descriptor of de centrale map binnen het bereik valt; voor een
+// hervatte download wordt het overgeslagen deel dan wel gelezen, maar niet
+// verstuurd. Is de foto korter dan in de index, dan wordt met nullen
+// opgevuld zodat Content-Length blijft kloppen.
+static uint32_t emitPhotoData(ArchiveStream& stream, const String& dayName, const PhotoIndexEntry& entry,
+                              bool needCrc) {
+  uint32_t size = entry.size;
+  uint32_t start = stream.position;
+  uint32_t end = start + size;
+  bool dataInRange = inRange(stream, start, size);
+  if (!dataInRange && !needCrc) {
+    stream.position = end;
+    return 0;
+  }
+
+  // Los bestand of een stuk van een segment; het bestand staat op het begin van de foto
+  PhotoSource source;
+  if (!openPhotoEntry(dayName, entry, source)) {
+    Serial.println("Archief: foto ontbreekt, wordt opgevuld: " + dayName + "/" + entry.name);
+  }
+  File& file = source.file;
+
+  // Deel voor het bereik: lezen voor de CRC, of overslaan
+  uint32_t sendFrom = dataInRange ? max(start, stream.rangeStart) : end;
+  uint32_t sendTo = dataInRange ? min(end, stream.rangeEnd) : end;
+  uint32_t prefix = sendFrom - start;
+  uint32_t crc = 0;
+  uint32_t bytesRead = 0;
+  if (needCrc) {
+    crc = crcFromFile(file, prefix, crc, bytesRead);
+  } else if (file && prefix < source.size && file.seek(source.start + prefix)) {
+    bytesRead = prefix;
+  }
+  stream.position += bytesRead;
+  bool complete = bytesRead == prefix;
+  if (!complete) {
+    crc = emitPadding(stream, prefix - bytesRead, crc);
+  }
+
+  // Deel binnen het bereik: dubbel gebufferd versturen met CRC
+  uint32_t sendLength = sendTo - sendFrom;
+  if (sendLength > 0 && !stream.failed) {
+    size_t sent = file && complete ? streamFile(*stream.client, file, sendLength, needCrc ? &crc : NULL) : 0;
+    stream.sent += sent;
+    stream.position += sent;
+    if (sent < sendLength) {
+      if (!stream.client->connected()) {
+        stream.failed = true;
+      } else {
+        crc = emitPadding(stream, sendLength - sent, crc);
+      }
+    }
+  }
+  if (file) file.close();
+
+  stream.position = end;
+  return crc;
+}
+
+// Lees de dagen van het bereik met het huidige aantal foto's
+static void planArchive(uint32_t fromKey, uint32_t toKey, std::vector<ArchiveDay>& days) {
+  int dayCount = 0;
+  File summaries = openDaySummaries(dayCount);
+  DayIndexSummary summary;
+  for (int i = 0; i < dayCount && summaries; i++) {
+    if (!readDaySummary(summaries, i, summary)) continue;
+    uint32_t key = archiveDayKey(summary.name);
+    if (key < fromKey || key > toKey || summary.photoCount == 0) continue;
+
+    ArchiveDay day = {};
+    snprintf(day.name, sizeof(day.name), "%s", summary.name);
+    day.count = summary.photoCount;
+    days.push_back(day);
+  }
+  if (summaries) summaries.close();
+}
+
+// Naam van een foto in het archief: <dag>/<bestand>
+static String archiveEntryName(const ArchiveDay& day, const PhotoIndexEntry& entry) {
+  return String(day.name) + "/" + String(entry.name);
+}
+
+// Stuur de foto's van fromDay t/m toDay als ZIP-archief
+void sendDayArchive(WiFiClient& client, HttpRequest& request, const String& fromDay, const String& toDay) {
+  uint32_t fromKey = archiveDayKey(fromDay.c_str());
+  uint32_t toKey = archiveDayKey(toDay.c_str());
+  if (!sdCardAvailable || fromKey == 0 || toKey < fromKey) {
+    sendHttpError(client, request, sdCardAvailable ? 400 : 404);
+    return;
+  }
+
+  std::vector<ArchiveDay> days;
+  planArchive(fromKey, toKey, days);
+
+  // Eerste ronde door de index: totale grootte en aantal foto's
+  uint64_t totalSize = ZIP_END_SIZE;
+  uint64_t centralOffset = 0;
+  uint32_t entryCount = 0;
+  uint32_t photoBytes = 0;
+  uint32_t lastTimestamp = 0;
+  PhotoIndexEntry entry;
+  for (size_t d = 0; d < days.size(); d++) {
+    int count = 0;
+    File index = openDayIndex(days[d].name, count);
+    days[d].count = min(days[d].count, count);
+    for (int i = 0; i < days[d].count && index; i++) {
+      if (!readDayIndexEntry(index, i, entry)) {
+        days[d].count = i;
+        break;
+      }
+      uint32_t nameLength = archiveEntryName(days[d], entry).length();
+      centralOffset += ZIP_LOCAL_HEADER_SIZE + nameLength + entry.size + ZIP_DESCRIPTOR_SIZE;
+      totalSize += ZIP_LOCAL_HEADER_SIZE + nameLength + entry.size + ZIP_DESCRIPTOR_SIZE +
+                   ZIP_CENTRAL_HEADER_SIZE + nameLength;
+      photoBytes += entry.size;
+      lastTimestamp = max(lastTimestamp, entry.timestamp);
+      entryCount++;
+    }
+    if (index) index.close();
+  }
+
+  if (entryCount == 0) {
+    sendHttpError(client, request, 404);
+    return;
+  }
+  if (entryCount > ZIP_MAX_ENTRIES || totalSize > ZIP_MAX_SIZE) {
+    // Geen ZIP64: kies een kleiner bereik
+    sendHttpError(client, request, 413);
+    return;
+  }
+
+  // CRC per foto voor de centrale map
+  uint32_t* crcs = psramFound() ? (uint32_t*)ps_malloc(entryCount * sizeof(uint32_t))
+                                : (uint32_t*)malloc(entryCount * sizeof(uint32_t));
+  if (!crcs) {
+    sendHttpError(client, request, 503);
+    return;
+  }
+
+  // De ETag verandert zodra er een foto in het bereik bijkomt
+  char etagBuf[48];
+  snprintf(etagBuf, sizeof(etagBuf), "\"zip-%x-%x-%x\"", entryCount, photoBytes, lastTimestamp);
+  String etag = etagBuf;
+  String fileName = fromDay + (toKey != fromKey ? "_" + toDay : "") + ".zip";
+
+  size_t rangeFrom = 0;
+  size_t rangeLength = totalSize;
+  RangeResult range = parseRangeHeader(request, totalSize, etag, "", rangeFrom, rangeLength);
+  if (range == RANGE_UNSATISFIABLE) {
+    free(crcs);
+    sendHttpResponse(client, request, 416, "", 0,
+                     "Content-Range: bytes */" + String((unsigned long)totalSize) + "\r\n");
+    return;
+  }
+
+  String headers = "Accept-Ranges: bytes\r\nETag: " + etag + "\r\nCache-Control: no-cache\r\n"
+                   "Content-Disposition: attachment; filename=\"" + fileName + "\"\r\n";
+  if (range == RANGE_OK) {
+    headers += "Content-Range: bytes " + String((unsigned long)rangeFrom) + "-" +
+               String((unsigned long)(rangeFrom + rangeLength - 1)) + "/" +
+               String((unsigned long)totalSize) + "\r\n";
+  }
+  sendHttpResponse(client, request, range == RANGE_OK ? 206 : 200, "application/zip", rangeLength, headers);
+
+  ArchiveStream stream = { &client, 0, (uint32_t)rangeFrom, (uint32_t)(rangeFrom + rangeLength), 0, false };
+  uint32_t centralSize = (uint32_t)(totalSize - ZIP_END_SIZE - centralOffset);
+  uint8_t header[ZIP_CENTRAL_HEADER_SIZE + 64];
+  unsigned long startMs = millis();
+
+  // Tweede ronde: lokale headers, foto's en data descriptors
+  uint32_t n = 0;
+  for (size_t d = 0; d < days.size() && !stream.failed; d++) {
+    int count = 0;
+    File index = openDayIndex(days[d].name, count);
+    for (int i = 0; i < days[d].count && index && !stream.failed; i++, n++) {
+      readDayIndexEntry(index, i, entry);
+      String name = archiveEntryName(days[d], entry);
+      uint16_t dosTime, dosDate;
+      dosDateTime(entry.timestamp, dosTime, dosDate);
+
+      uint8_t* p = header;
+      p = put32(p, 0x04034b50);
+      p = put16(p, ZIP_VERSION);
+      p = put16(p, ZIP_FLAG_DESCRIPTOR);
+      p = put16(p, 0);                       // Stored
+      p = put16(p, dosTime);
+      p = put16(p, dosDate);
+      p = put32(p, 0);                       // CRC en groottes volgen in de descriptor
+      p = put32(p, 0);
+      p = put32(p, 0);
+      p = put16(p, name.length());
+      p = put16(p, 0);
+      emit(stream, header, p - header);
+      emit(stream, (const uint8_t*)name.c_str(), name.length());
+
+      uint32_t descriptorStart = stream.position + entry.size;
+      bool needCrc = inRange(stream, descriptorStart, ZIP_DESCRIPTOR_SIZE) ||
+                     stream.rangeEnd > centralOffset;
+      crcs[n] = emitPhotoData(stream, days[d].name, entry, needCrc);
+
+      p = header;
+      p = put32(p, 0x08074b50);
+      p = put32(p, crcs[n]);
+      p = put32(p, entry.size);
+      p = put32(p, entry.size);
+      emit(stream, header, p - header);
+    }
+    if (index) index.close();
+  }
+
+  // Derde ronde: centrale map met de CRC's, daarna het einde van het archief
+  uint32_t localOffset = 0;
+  n = 0;
+  for (size_t d = 0; d < days.size() && !stream.failed; d++) {
+    int count = 0;
+    File index = openDayIndex(days[d].name, count);
+    for (int i = 0; i < days[d].count && index && !stream.failed; i++, n++) {
+      readDayIndexEntry(index, i, entry);
+      String name = archiveEntryName(days[d], entry);
+      if (inRange(stream, stream.position, ZIP_CENTRAL_HEADER_SIZE + name.length())) {
+        uint16_t dosTime, dosDate;
+        dosDateTime(entry.timestamp, dosTime, dosDate);
+
+        uint8_t* p = header;
+        p = put32(p, 0x02014b50);
+        p = put16(p, ZIP_VERSION);             // Gemaakt door
+        p = put16(p, ZIP_VERSION);             // Nodig om uit te pakken
+        p = put16(p, ZIP_FLAG_DESCRIPTOR);
+        p = put16(p, 0);
+        p = put16(p, dosTime);
+        p = put16(p, dosDate);
+        p = put32(p, crcs[n]);
+        p = put32(p, entry.size);
+        p = put32(p, entry.size);
+        p = put16(p, name.length());
+        p = put16(p, 0);                       // Extra veld
+        p = put16(p, 0);                       // Commentaar
+        p = put16(p, 0);                       // Schijf
+        p = put16(p, 0);                       // Interne attributen
+        p = put32(p, 0);                       // Externe attributen
+        p = put32(p, localOffset);
+        emit(stream, header, p - header);
+        emit(stream, (const uint8_t*)name.c_str(), name.length());
+      } else {
+        stream.position += ZIP_CENTRAL_HEADER_SIZE + name.length();
+      }
+      localOffset += ZIP_LOCAL_HEADER_SIZE + name.length() + entry.size + ZIP_DESCRIPTOR_SIZE;
+    }
+    if (index) index.close();
+  }
+
+  uint8_t* p = header;
+  p = put32(p, 0x06054b50);
+  p = put16(p, 0);
+  p = put16(p, 0);
+  p = put16(p, entryCount);
+  p = put16(p, entryCount);
+  p = put32(p, centralSize);
+  p = put32(p, (uint32_t)centralOffset);
+  p = put16(p, 0);
+  emit(stream, header, p - header);
+  free(crcs);
+
+  if (stream.sent < rangeLength) {
+    request.keepAlive = false;
+  }
+  unsigned long elapsed = millis() - startMs;
+  Serial.printf("Archief %s: %u foto's, %u van %u bytes in %lu ms\n", fileName.c_str(), entryCount,
+                stream.sent, (uint32_t)rangeLength, elapsed);
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include "config.h"
+#include <WiFi.h>
+#include "http_parser.h"
+
+// Grenzen van een ZIP-archief zonder ZIP64
+#define ZIP_MAX_ENTRIES 65535
+#define ZIP_MAX_SIZE    0xFFFFFFFFUL
+
+// Stuur de foto's van fromDay t/m toDay (DD-MM-YYYY) als ZIP-archief
+void sendDayArchive(WiFiClient& client, HttpRequest& request, const String& fromDay, const String& toDay);
+
+#endif // ZIP_ARCHIVE_H
\ No newline at end of file
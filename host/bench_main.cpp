@@ -0,0 +1,1267 @@
+// Benchmark voor de host-simulatie.
+// Meet capture-naar-SD latentie van takeSavePhoto(), de bezettijd van de
+// camerabuffer met en zonder de asynchrone SD-schrijver, de twee indelingen van
+// de foto-opslag, de kaartgezondheid bij een tragere of volle kaart, het
+// herstel bij het opstarten na een onderbroken opslag, het
+// bewaarbeleid en het wissen van de kaart (snelheid van opruimen en
+// vertraging van de opname ondertussen), en per HTTP-endpoint de latentie, bytes per verzoek, doorvoer
+// en SD-leesoperaties, met de echte sketch (setup()/loop()) achter een
+// loopback-socket.
+
+#include <Arduino.h>
+#include "host_sim.h"
+#include "camera.h"
+#include "sd_card.h"
+#include "config.h"
+#include "capture_task.h"
+#include "sd_writer.h"
+#include "photo_index.h"
+#include "photo_store.h"
+#include "thumbnails.h"
+#include "retention.h"
+#include "card_usage.h"
+#include "photo_journal.h"
+#include "settings_manager.h"
+#include "web_server.h"
+#include "playback.h"
+#include "luminance.h"
+#include "img_converters.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void loop();
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+  std::string sdDir;
+  int captures = 20;
+  int requests = 10;
+  int days = 0;
+  int photosPerDay = 100;
+  uint32_t sdOpenUs = 0;
+  uint32_t sdWriteKBps = 0;
+  uint32_t sdReadKBps = 0;
+  uint32_t sdReadCallUs = 0;
+  uint32_t frameMs = 0;
+  int jitterMinutes = 10;
+  int writerBurst = 30;
+  int storePhotos = 150;
+  bool verbose = false;
+};
+
+struct Stats {
+  std::vector<double> samples;
+
+  void add(double v) { samples.push_back(v); }
+  double percentile(double p) const {
+    if (samples.empty()) return 0;
+    std::vector<double> s = samples;
+    std::sort(s.begin(), s.end());
+    size_t idx = (size_t)(p / 100.0 * (s.size() - 1) + 0.5);
+    return s[std::min(idx, s.size() - 1)];
+  }
+  double mean() const {
+    double sum = 0;
+    for (double v : samples) sum += v;
+    return samples.empty() ? 0 : sum / samples.size();
+  }
+  double max() const { return percentile(100); }
+};
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct HttpResult {
+  int status = 0;
+  size_t bytes = 0;
+  double ms = 0;
+};
+
+// Eenvoudige HTTP/1.1 client: één verzoek, lezen tot de server sluit
+HttpResult httpGet(int port, const std::string& path, std::string* body = nullptr) {
+  HttpResult result;
+  Clock::time_point start = Clock::now();
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct timeval tv = {30, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((uint16_t)port);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return result;
+  }
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+  char buf[16384];
+  std::string head;
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    if (head.size() < 16) head.append(buf, std::min<size_t>(n, 16 - head.size()));
+    if (body) body->append(buf, (size_t)n);
+    result.bytes += (size_t)n;
+  }
+  close(fd);
+  result.ms = msSince(start);
+  if (head.compare(0, 9, "HTTP/1.1 ") == 0) result.status = atoi(head.c_str() + 9);
+  return result;
+}
+
+// Persistente HTTP/1.1 verbinding: antwoorden worden op Content-Length gelezen
+struct KeepAliveClient {
+  int fd = -1;
+  std::string pending;  // Al ontvangen bytes van het volgende antwoord
+
+  bool connectTo(int port) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct timeval tv = {30, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+      close(fd);
+      fd = -1;
+    }
+    pending.clear();
+    return fd >= 0;
+  }
+
+  ~KeepAliveClient() {
+    if (fd >= 0) close(fd);
+  }
+
+  // Eén verzoek; closed wordt true als de server de verbinding sluit. Met
+  // etag wordt de ETag van het antwoord teruggegeven.
+  HttpResult get(const std::string& path, bool* closed, const std::string& extraHeaders = "",
+                 std::string* etag = nullptr) {
+    HttpResult result;
+    Clock::time_point start = Clock::now();
+    *closed = true;
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + extraHeaders + "\r\n";
+    if (fd < 0 || send(fd, request.data(), request.size(), MSG_NOSIGNAL) < 0) return result;
+
+    char buf[16384];
+    size_t headerEnd;
+    while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) return result;
+      pending.append(buf, (size_t)n);
+    }
+    std::string head = pending.substr(0, headerEnd + 4);
+    if (head.compare(0, 9, "HTTP/1.1 ") == 0) result.status = atoi(head.c_str() + 9);
+    size_t lengthPos = head.find("Content-Length: ");
+    bool keepAlive = head.find("Connection: keep-alive") != std::string::npos;
+    if (lengthPos == std::string::npos && result.status != 304) keepAlive = false;
+    size_t etagPos = head.find("ETag: ");
+    if (etag && etagPos != std::string::npos) {
+      etag->assign(head, etagPos + 6, head.find("\r\n", etagPos) - etagPos - 6);
+    }
+    size_t length = lengthPos == std::string::npos ? 0 : strtoul(head.c_str() + lengthPos + 16, nullptr, 10);
+
+    pending.erase(0, headerEnd + 4);
+    if (keepAlive) {
+      while (pending.size() < length) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return result;
+        pending.append(buf, (size_t)n);
+      }
+      pending.erase(0, length);
+    } else {
+      ssize_t n;
+      while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) length += (size_t)n;
+      close(fd);
+      fd = -1;
+    }
+    *closed = !keepAlive;
+    result.bytes = head.size() + length;
+    result.ms = msSince(start);
+    return result;
+  }
+};
+
+std::string todayFolderName(int daysAgo) {
+  time_t now;
+  time(&now);
+  now -= (time_t)daysAgo * 86400;
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  char buf[DAY_NAME_SIZE];
+  snprintf(buf, sizeof(buf), "%02d-%02d-%04d", timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
+  return buf;
+}
+
+// Vul de kaart met oudere dagen (buiten de SD-shim om, telt niet mee in metingen)
+void populateDays(const Options& opt, const std::string& sampleFile) {
+  std::vector<char> data;
+  FILE* in = fopen(sampleFile.c_str(), "rb");
+  if (!in) return;
+  char buf[65536];
+  size_t r;
+  while ((r = fread(buf, 1, sizeof(buf), in)) > 0) data.insert(data.end(), buf, buf + r);
+  fclose(in);
+
+  for (int d = 1; d <= opt.days; d++) {
+    std::string name = todayFolderName(d);
+    std::string dir = opt.sdDir + "/timelapse/" + name;
+    mkdir(dir.c_str(), 0755);
+    for (int p = 0; p < opt.photosPerDay; p++) {
+      char file[64];
+      int minutes = 8 * 60 + p * 5;
+      snprintf(file, sizeof(file), "/%s_%02d-%02d-00.jpg", name.c_str(), (minutes / 60) % 24, minutes % 60);
+      FILE* out = fopen((dir + file).c_str(), "wb");
+      if (!out) continue;
+      fwrite(data.data(), 1, data.size(), out);
+      fclose(out);
+    }
+  }
+}
+
+// Herstel bij het opstarten: de laatste JOURNAL_ENTRIES foto's opslaan, drie
+// onderbrekingen nabootsen (tijdelijk bestand, afgekapte foto, foto zonder
+// indexregel) en recoverPhotoJournal() timen, tegenover alle losse foto's op
+// de kaart op SOI/EOI controleren
+void benchRecovery(const Options& opt) {
+  const uint32_t cardOpenUs = 3000, cardWriteKBps = 2000;
+  camera_fb_t* fb = cameraGetFrame();
+  if (!fb) return;
+  std::vector<uint8_t> photo(fb->buf, fb->buf + fb->len);
+  esp_camera_fb_return(fb);
+  hostSdSetLatency(cardOpenUs, cardWriteKBps, opt.sdReadKBps);
+
+  std::vector<std::string> names;
+  for (int i = 0; i < JOURNAL_ENTRIES; i++) {
+    hostClockAdvanceSeconds(1);
+    time_t now;
+    time(&now);
+    char path[64] = "";
+    createDayFolder(now);
+    savePhotoBuffer(photo.data(), photo.size(), now, path, sizeof(path));
+    names.push_back(path);
+  }
+  std::string dayName = todayFolderName(0);
+  std::string last = names.back();
+  ::rename((opt.sdDir + last).c_str(), (opt.sdDir + last + JOURNAL_TEMP_SUFFIX).c_str());
+  indexRemovePhoto(dayName.c_str(), last.substr(last.rfind('/') + 1).c_str());
+  truncate((opt.sdDir + names[names.size() - 2]).c_str(), photo.size() / 2);
+  std::string unindexed = names[names.size() - 3];
+  indexRemovePhoto(dayName.c_str(), unindexed.substr(unindexed.rfind('/') + 1).c_str());
+
+  HostSdCounters before = hostSdCounters();
+  recoverPhotoJournal();
+  HostSdCounters after = hostSdCounters();
+  JournalStats journal = getJournalStats();
+
+  // Alternatief: elke losse foto in de index controleren
+  Clock::time_point start = Clock::now();
+  uint32_t scanned = 0, invalid = 0;
+  int dayCount = 0;
+  File summaries = openDaySummaries(dayCount);
+  DayIndexSummary day;
+  for (int d = 0; d < dayCount && readDaySummary(summaries, d, day); d++) {
+    int count = 0;
+    File index = openDayIndex(day.name, count);
+    PhotoIndexEntry entry;
+    for (int i = 0; i < count && readDayIndexEntry(index, i, entry); i++) {
+      if (entry.offset != 0) continue;
+      File file = SD_MMC.open("/timelapse/" + String(day.name) + "/" + entry.name, FILE_READ);
+      scanned++;
+      if (!file || !jpegFileValid(file)) invalid++;
+      if (file) file.close();
+    }
+    if (index) index.close();
+  }
+  if (summaries) summaries.close();
+  double scanMs = msSince(start);
+
+  printf("== Herstel bij opstarten (open %u us) ==\n", cardOpenUs);
+  printf("journaal: %u foto's in %u ms (%s), SD-open %llu: %u onderbroken, %u beschadigd, %u opnieuw in de index\n",
+         journal.checked, journal.recoveryMs, journal.complete ? "volledig" : "afgebroken",
+         (unsigned long long)(after.opens - before.opens), journal.tempRemoved, journal.corrupt, journal.reindexed);
+  printf("hele kaart: %u foto's in %.0f ms, %u ongeldig\n\n", scanned, scanMs, invalid);
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+}
+
+// Kaartgezondheid: foto's opslaan op een normale kaart (referentie), daarna
+// op een kaart met een kwart van de schrijfsnelheid en op een volle kaart
+void benchCardHealth(const Options& opt) {
+  const uint32_t cardOpenUs = 3000, cardWriteKBps = 2000;
+  camera_fb_t* fb = cameraGetFrame();
+  if (!fb) return;
+  std::vector<uint8_t> photo(fb->buf, fb->buf + fb->len);
+  esp_camera_fb_return(fb);
+
+  printf("== Kaartgezondheid: foto van %.1f KB, %d keer per fase (open %u us) ==\n", photo.size() / 1024.0,
+         CARD_LATENCY_SAMPLES, cardOpenUs);
+  printf("%-12s %8s %14s %8s %8s %10s %10s %8s\n", "kaart", "KB/s", "gezondheid", "p50 ms", "p95 ms",
+         "recent KB/s", "referentie", "mislukt");
+  for (int phase = 0; phase < 3; phase++) {
+    uint32_t writeKBps = phase == 1 ? cardWriteKBps / 4 : cardWriteKBps;
+    hostSdSetLatency(cardOpenUs, writeKBps, opt.sdReadKBps);
+    if (phase == 2) hostSdSetCapacity(SD_MMC.usedBytes());
+    int count = phase == 2 ? 4 : CARD_LATENCY_SAMPLES;
+    for (int i = 0; i < count; i++) {
+      hostClockAdvanceSeconds(1);
+      time_t now;
+      time(&now);
+      createDayFolder();
+      savePhotoBuffer(photo.data(), photo.size(), now);
+    }
+    CardStatus card = getCardStatus();
+    printf("%-12s %8u %14s %8u %8u %10u %10u %8u\n", phase == 0 ? "normaal" : phase == 1 ? "trager" : "vol",
+           writeKBps, cardHealthName(card.health), card.p50Ms, card.p95Ms, card.recentKBps, card.baselineKBps,
+           card.failedWrites);
+  }
+  hostSdSetCapacity(16ULL * 1024 * 1024 * 1024);
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+  printf("\n");
+}
+
+void benchCaptures(const Options& opt) {
+  Stats latency;
+  size_t failures = 0;
+  HostSdCounters before = hostSdCounters();
+  for (int i = 0; i < opt.captures; i++) {
+    hostClockAdvanceSeconds(1);  // Unieke bestandsnaam per foto
+    Clock::time_point start = Clock::now();
+    bool ok = createDayFolder() && takeSavePhoto();
+    latency.add(msSince(start));
+    if (!ok) failures++;
+  }
+  HostSdCounters after = hostSdCounters();
+  double avgKB = opt.captures ? (after.bytesWritten - before.bytesWritten) / 1024.0 / opt.captures : 0;
+
+  printf("== Capture naar SD (createDayFolder + takeSavePhoto) ==\n");
+  printf("n=%d  mislukt=%zu  p50=%.2f ms  p95=%.2f ms  max=%.2f ms  gem=%.2f ms  gem. foto=%.1f KB\n\n",
+         opt.captures, failures, latency.percentile(50), latency.percentile(95), latency.max(),
+         latency.mean(), avgKB);
+}
+
+// Helderheidshistogram per opname (DC-coëfficiënten) naast een verkleinde
+// decode op 1/8, op frames van de camera (synthetisch of --frames)
+void benchLuminance(const Options& opt) {
+  Stats dcMs, decodeMs;
+  size_t failures = 0;
+  double totalKB = 0;
+  size_t width = 0, height = 0;
+  LuminanceStats luma = {};
+  for (int i = 0; i < opt.captures; i++) {
+    camera_fb_t* fb = cameraGetFrame();
+    if (!fb) {
+      failures++;
+      continue;
+    }
+    width = fb->width;
+    height = fb->height;
+    totalKB += fb->len / 1024.0;
+
+    Clock::time_point start = Clock::now();
+    if (!jpegLuminance(fb->buf, fb->len, luma)) failures++;
+    dcMs.add(msSince(start));
+
+    std::vector<uint8_t> rgb((fb->width / 8 + 1) * (fb->height / 8 + 1) * 2);
+    start = Clock::now();
+    jpg2rgb565(fb->buf, fb->len, rgb.data(), JPG_SCALE_8X);
+    decodeMs.add(msSince(start));
+    esp_camera_fb_return(fb);
+  }
+
+  printf("== Helderheidshistogram per opname (%zux%zu, gem. %.1f KB) ==\n", width, height,
+         opt.captures ? totalKB / opt.captures : 0.0);
+  printf("DC-coëfficiënten: n=%d  mislukt=%zu  p50=%.2f ms  p95=%.2f ms  max=%.2f ms  (laatste: gem. %u, spreiding %u)\n",
+         opt.captures, failures, dcMs.percentile(50), dcMs.percentile(95), dcMs.max(), luma.mean, luma.stdDev);
+  printf("decode 1/8 (ter vergelijking): p50=%.2f ms  p95=%.2f ms\n\n",
+         decodeMs.percentile(50), decodeMs.percentile(95));
+}
+
+// Veranderingsdetectie: kosten van een proefbeeld met raster, het raster van
+// een volledige foto, de verschilkern los, en hoe het verschil met een vaste
+// referentie oploopt terwijl de synthetische plant groeit
+void benchChangeDetection(const Options& opt) {
+  CameraProfile probe = { CHANGE_PROBE_FRAMESIZE, CHANGE_PROBE_QUALITY };
+  Stats probeMs, gridMs, fullGridMs;
+  std::vector<int> differences;
+  uint8_t reference[LUMA_GRID_CELLS], grid[LUMA_GRID_CELLS];
+  size_t probeBytes = 0;
+  bool haveReference = false;
+
+  for (int i = 0; i < opt.captures; i++) {
+    Clock::time_point start = Clock::now();
+    camera_fb_t* fb = cameraGetFrame(&probe);
+    if (!fb) continue;
+    Clock::time_point gridStart = Clock::now();
+    bool ok = jpegLuminanceGrid(fb->buf, fb->len, grid);
+    gridMs.add(msSince(gridStart));
+    probeBytes = fb->len;
+    esp_camera_fb_return(fb);
+    probeMs.add(msSince(start));
+    if (ok && haveReference) differences.push_back(luminanceGridDifference(grid, reference));
+    if (ok && !haveReference) {
+      memcpy(reference, grid, sizeof(reference));
+      haveReference = true;
+    }
+  }
+
+  for (int i = 0; i < opt.captures; i++) {
+    camera_fb_t* fb = cameraGetFrame();
+    if (!fb) continue;
+    Clock::time_point start = Clock::now();
+    jpegLuminanceGrid(fb->buf, fb->len, grid);
+    fullGridMs.add(msSince(start));
+    esp_camera_fb_return(fb);
+  }
+
+  const int kernelRuns = 200000;
+  uint32_t sink = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kernelRuns; i++) {
+    reference[i % LUMA_GRID_CELLS] ^= (uint8_t)i;
+    sink += luminanceGridDifference(grid, reference);
+  }
+  double kernelUs = msSince(start) * 1000.0 / kernelRuns;
+
+  printf("== Veranderingsdetectie (proefbeeld %dx%d, %zu bytes; raster %dx%d) ==\n",
+         resolution[CHANGE_PROBE_FRAMESIZE].width, resolution[CHANGE_PROBE_FRAMESIZE].height, probeBytes,
+         LUMA_GRID_COLS, LUMA_GRID_ROWS);
+  printf("proefbeeld met raster: p50=%.2f ms  p95=%.2f ms  (waarvan raster p50=%.3f ms)\n",
+         probeMs.percentile(50), probeMs.percentile(95), gridMs.percentile(50));
+  printf("raster van een volledige foto: p50=%.2f ms  p95=%.2f ms\n",
+         fullGridMs.percentile(50), fullGridMs.percentile(95));
+  printf("verschilkern: %.3f us per vergelijking (controle %u)\n", kernelUs, sink & 1);
+  printf("verschil t.o.v. het eerste proefbeeld:");
+  for (size_t i = 0; i < differences.size() && i < 16; i++) printf(" %d", differences[i]);
+  printf("  (drempel %d)\n\n", CHANGE_THRESHOLD);
+}
+
+// Belichting inregelen: telkens na een pauze (koude AEC) cameraGetSettledFrame
+// zoals de opnametaak, met de tijden die het apparaat zelf rapporteert, en de
+// helderheidsbepaling per inregelframe op het kleine profiel tegenover een
+// volledig frame (zoals vóór het inregelen op kleine frames)
+void benchSettle(const Options& opt) {
+  Stats settleMs, finalMs, frames, smallMs, fullMs;
+  uint32_t timeouts = 0;
+  size_t finalBytes = 0;
+
+  for (int i = 0; i < opt.captures; i++) {
+    hostClockSetSpeed(100);
+    delay(6000);
+    hostClockSetSpeed(1);
+    CameraSettleInfo info;
+    camera_fb_t* fb = cameraGetSettledFrame(&info);
+    if (!fb) continue;
+    finalBytes = fb->len;
+    esp_camera_fb_return(fb);
+    settleMs.add(info.settleMs);
+    finalMs.add(info.finalMs);
+    frames.add(info.frames);
+    if (!info.converged) timeouts++;
+  }
+
+  CameraProfile settleProfile = { CAMERA_SETTLE_FRAMESIZE, CAMERA_SETTLE_QUALITY };
+  for (int i = 0; i < opt.captures; i++) {
+    LuminanceStats stats;
+    camera_fb_t* fb = cameraGetFrame(&settleProfile);
+    if (fb) {
+      Clock::time_point start = Clock::now();
+      jpegLuminance(fb->buf, fb->len, stats);
+      smallMs.add(msSince(start));
+      esp_camera_fb_return(fb);
+    }
+    fb = cameraGetFrame();
+    if (fb) {
+      Clock::time_point start = Clock::now();
+      jpegLuminance(fb->buf, fb->len, stats);
+      fullMs.add(msSince(start));
+      esp_camera_fb_return(fb);
+    }
+  }
+
+  printf("== Belichting inregelen (inregelen %dx%d, laatste frame %zu bytes) ==\n",
+         resolution[CAMERA_SETTLE_FRAMESIZE].width, resolution[CAMERA_SETTLE_FRAMESIZE].height, finalBytes);
+  printf("inregelen: p50=%.0f ms  max=%.0f ms  (laatste frame p50=%.0f ms, frames p50=%.0f, %u time-outs)\n",
+         settleMs.percentile(50), settleMs.max(), finalMs.percentile(50), frames.percentile(50), timeouts);
+  printf("helderheid per inregelframe: klein p50=%.3f ms  volledig p50=%.2f ms\n\n",
+         smallMs.percentile(50), fullMs.percentile(50));
+}
+
+// Foto-opslag: één bestand per foto tegenover segmenten per dag. Per indeling
+// een volle dag foto's opslaan (zelfde frame, opnametijd elke 5 minuten) op een
+// kaart met vaste kosten per bestandsoperatie, teruglezen en de dag wissen.
+// Kaartschrijfacties volgen het FAT32-model van de SD-shim: datasectoren,
+// plus per nieuw bestand en per gesloten gewijzigd bestand een mapsector, plus
+// per opslag met nieuwe clusters 2 FAT-sectoren (twee kopieën) per 128 clusters.
+void benchPhotoStore(const Options& opt) {
+  if (opt.storePhotos <= 0) return;
+  const uint32_t cardOpenUs = 3000, cardWriteKBps = 2000;
+  camera_fb_t* fb = cameraGetFrame();
+  if (!fb) return;
+  std::vector<uint8_t> photo(fb->buf, fb->buf + fb->len);
+  esp_camera_fb_return(fb);
+
+  printf("== Foto-opslag: %d foto's van %.1f KB per indeling (open %u us, %u KB/s) ==\n", opt.storePhotos,
+         photo.size() / 1024.0, cardOpenUs, cardWriteKBps);
+  printf("%-12s %7s %7s %7s %9s %9s %10s %10s %9s %10s %8s\n", "indeling", "p50 ms", "p95 ms", "max ms",
+         "bestanden", "clusters", "meta/foto", "KB/foto", "factor", "wissen ms", "fouten");
+
+  bool saved = segmentStorage;
+  hostSdSetLatency(cardOpenUs, cardWriteKBps, opt.sdReadKBps);
+  for (int layout = 0; layout < 2; layout++) {
+    segmentStorage = layout == 1;
+    const char* dayName = layout == 1 ? "02-01-2031" : "01-01-2031";
+    String dayPath = "/timelapse/" + String(dayName);
+    SD_MMC.mkdir(dayPath);
+
+    struct tm start = {};
+    start.tm_year = 131;
+    start.tm_mday = layout + 1;
+    start.tm_hour = 8;
+    start.tm_isdst = -1;
+    time_t first = mktime(&start);
+
+    Stats latency;
+    std::vector<PhotoIndexEntry> entries;
+    uint64_t metaSectors = 0;
+    HostSdCounters before = hostSdCounters();
+    for (int i = 0; i < opt.storePhotos; i++) {
+      PhotoIndexEntry entry = {};
+      time_t timestamp = first + i * 300;
+      struct tm timeinfo;
+      localtime_r(&timestamp, &timeinfo);
+      strftime(entry.name, sizeof(entry.name), "%d-%m-%Y_%H-%M-%S.jpg", &timeinfo);
+      entry.timestamp = (uint32_t)timestamp;
+      entry.size = photo.size();
+
+      HostSdCounters step = hostSdCounters();
+      Clock::time_point t = Clock::now();
+      storePhotoData(dayName, entry.name, timestamp, photo.data(), photo.size(), entry.offset);
+      latency.add(msSince(t));
+      uint64_t clusters = hostSdCounters().clustersAllocated - step.clustersAllocated;
+      metaSectors += 2 * ((clusters + 127) / 128);
+      entries.push_back(entry);
+    }
+    HostSdCounters after = hostSdCounters();
+    metaSectors += (after.filesCreated - before.filesCreated) + (after.modifiedCloses - before.modifiedCloses);
+    double cardKB = ((after.sectorsWritten - before.sectorsWritten) + metaSectors) * 512 / 1024.0;
+
+    // Teruglezen via dezelfde weg als /view/ en /download/
+    int errors = 0;
+    std::vector<uint8_t> check(photo.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+      PhotoSource source;
+      if (!openPhotoEntry(dayName, entries[i], source)) {
+        errors++;
+        continue;
+      }
+      bool same = source.size == photo.size() && source.file.read(check.data(), check.size()) == check.size() &&
+                  check == photo;
+      source.file.close();
+      if (!same) errors++;
+    }
+
+    HostSdCounters wipeBefore = hostSdCounters();
+    Clock::time_point t = Clock::now();
+    removeDir(dayPath);
+    double wipeMs = msSince(t);
+    uint64_t removed = hostSdCounters().removes - wipeBefore.removes;
+
+    int n = opt.storePhotos;
+    printf("%-12s %7.2f %7.2f %7.2f %9llu %9llu %10.2f %10.1f %9.3f %7.0f/%-3llu %8d\n",
+           layout == 1 ? "segmenten" : "los bestand", latency.percentile(50), latency.percentile(95),
+           latency.max(), (unsigned long long)(after.filesCreated - before.filesCreated),
+           (unsigned long long)(after.clustersAllocated - before.clustersAllocated), (double)metaSectors / n,
+           cardKB / n, cardKB * 1024 / ((double)photo.size() * n), wipeMs, (unsigned long long)removed, errors);
+  }
+  segmentStorage = saved;
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+  SegmentStats segments = getSegmentStats();
+  printf("segmenten: %u aangemaakt, %u foto's toegevoegd, %u als los bestand\n\n", segments.segmentsCreated,
+         segments.appended, segments.fallbacks);
+}
+
+// Eén dagpagina zoals een browser hem laadt: HTML plus alle afbeeldingen erop,
+// vergeleken met de hele dag in één pagina (gedrag zonder paginering)
+void benchDayPage(int port, const std::string& dayName) {
+  std::string html;
+  HttpResult page = httpGet(port, "/day/" + dayName, &html);
+
+  size_t imageBytes = 0;
+  int images = 0;
+  Clock::time_point start = Clock::now();
+  const std::string marker = "<img src=\"";
+  for (size_t pos = html.find(marker); pos != std::string::npos; pos = html.find(marker, pos)) {
+    pos += marker.size();
+    std::string url = html.substr(pos, html.find('"', pos) - pos);
+    imageBytes += httpGet(port, url).bytes;
+    images++;
+  }
+  double imageMs = msSince(start);
+
+  std::string json;
+  httpGet(port, "/api/day/" + dayName + "?offset=0&limit=1", &json);
+  size_t totalPos = json.find("\"total\":");
+  int total = totalPos == std::string::npos ? 0 : atoi(json.c_str() + totalPos + 8);
+
+  printf("\n== Dagpagina /day/%s (%d foto's op de dag) ==\n", dayName.c_str(), total);
+  printf("HTML %.1f ms, %zu bytes; %d afbeeldingen op de pagina, %.1f KB in %.1f ms; "
+         "hele dag zonder paginering ca. %.1f MB\n",
+         page.ms, page.bytes, images, imageBytes / 1024.0, imageMs,
+         images ? (double)imageBytes / images * total / (1024.0 * 1024.0) : 0.0);
+}
+
+// Galerij van maximaal 50 miniaturen laden: eerst met een nieuwe verbinding
+// per verzoek (Connection: close), daarna over één keep-alive verbinding
+void benchGallery(int port, const std::string& dayName) {
+  std::string json;
+  httpGet(port, "/api/day/" + dayName + "?offset=0&limit=50", &json);
+  std::vector<std::string> urls;
+  const std::string marker = "\"url\":\"/view/";
+  for (size_t pos = json.find(marker); pos != std::string::npos; pos = json.find(marker, pos)) {
+    pos += marker.size();
+    urls.push_back("/thumb/" + json.substr(pos, json.find('"', pos) - pos));
+  }
+  if (urls.empty()) return;
+
+  size_t bytes = 0;
+  Clock::time_point start = Clock::now();
+  for (const std::string& url : urls) bytes += httpGet(port, url).bytes;
+  double closeMs = msSince(start);
+
+  size_t keepAliveBytes = 0;
+  int connections = 0;
+  KeepAliveClient client;
+  start = Clock::now();
+  bool closed = true;
+  for (const std::string& url : urls) {
+    if (closed) {
+      client.connectTo(port);
+      connections++;
+    }
+    keepAliveBytes += client.get(url, &closed).bytes;
+  }
+  double keepAliveMs = msSince(start);
+
+  printf("\n== Galerij: %zu miniaturen van /day/%s ==\n", urls.size(), dayName.c_str());
+  printf("nieuwe verbinding per verzoek: %.1f ms  %.1f req/s  (%zu bytes)\n",
+         closeMs, urls.size() * 1000.0 / closeMs, bytes);
+  printf("keep-alive (%d verbinding%s):   %.1f ms  %.1f req/s  (%zu bytes)\n",
+         connections, connections == 1 ? "" : "en", keepAliveMs, urls.size() * 1000.0 / keepAliveMs,
+         keepAliveBytes);
+}
+
+// Aanhoudende doorvoer per bestandsroute over één keep-alive verbinding
+void benchThroughput(int port, const std::string& relPhoto, int requests) {
+  std::string thumbPath = relPhoto;
+  size_t slash = thumbPath.rfind('/');
+  if (slash == std::string::npos) return;
+
+  const char* labels[] = {"/view", "/download", "/thumb"};
+  std::string paths[] = {"/view/" + relPhoto, "/download/" + relPhoto, "/thumb/" + relPhoto};
+  printf("\n== Doorvoer bestandsroutes (keep-alive, %d verzoeken) ==\n", requests);
+  for (int r = 0; r < 3; r++) {
+    KeepAliveClient client;
+    bool closed = true;
+    size_t bytes = 0;
+    int badStatus = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < requests; i++) {
+      if (closed) client.connectTo(port);
+      HttpResult result = client.get(paths[r], &closed);
+      bytes += result.bytes;
+      if (result.status != 200) badStatus++;
+    }
+    double ms = msSince(start);
+    printf("%-10s %8.1f KB/verzoek  %8.2f MB/s%s\n", labels[r], bytes / 1024.0 / requests,
+           ms > 0 ? bytes / 1048576.0 / (ms / 1000.0) : 0.0, badStatus ? "  (!= 200)" : "");
+  }
+}
+
+// Een hele dag ophalen: elke foto via /download/ (eigen verbinding per foto)
+// tegenover één ZIP-archief
+void benchArchive(int port, const std::string& dayName) {
+  std::string json;
+  httpGet(port, "/api/day/" + dayName + "?offset=0&limit=100", &json);
+  std::vector<std::string> urls;
+  const std::string marker = "\"url\":\"/view/";
+  for (size_t pos = json.find(marker); pos != std::string::npos; pos = json.find(marker, pos)) {
+    pos += marker.size();
+    urls.push_back("/download/" + json.substr(pos, json.find('"', pos) - pos));
+  }
+  if (urls.empty()) return;
+
+  size_t bytes = 0;
+  Clock::time_point start = Clock::now();
+  for (const std::string& url : urls) bytes += httpGet(port, url).bytes;
+  double separateMs = msSince(start);
+
+  HttpResult zip = httpGet(port, "/archive/day/" + dayName + ".zip");
+  printf("\n== Dag /day/%s downloaden (%zu foto's) ==\n", dayName.c_str(), urls.size());
+  printf("los per foto:  %8.1f ms  %6.2f MB/s  %zu verbindingen\n", separateMs,
+         bytes / 1048576.0 / (separateMs / 1000.0), urls.size());
+  printf("ZIP-archief:   %8.1f ms  %6.2f MB/s  1 verbinding%s\n", zip.ms,
+         zip.bytes / 1048576.0 / (zip.ms / 1000.0), zip.status != 200 ? "  (!= 200)" : "");
+}
+
+// Een dag afspelen via /play/day/: gehaalde beelden per seconde en hoe vaak
+// het volgende frame al klaarlag
+void benchPlayback(int port, const std::string& dayName) {
+  printf("\n== Afspelen /play/day/%s ==\n", dayName.c_str());
+  const int rates[] = {10, 30};
+  for (int fps : rates) {
+    PlaybackStats before = getPlaybackStats();
+    HttpResult result = httpGet(port, "/play/day/" + dayName + "?fps=" + std::to_string(fps));
+    PlaybackStats after = getPlaybackStats();
+    uint32_t frames = after.frames - before.frames;
+    uint32_t hits = after.prefetchHits - before.prefetchHits;
+    uint32_t misses = after.prefetchMisses - before.prefetchMisses;
+    printf("fps=%-3d %4u frames  %6.1f fps gehaald  voorlezen %u/%u op tijd  %8.1f ms%s\n", fps, frames,
+           after.lastFpsX10 / 10.0, hits, hits + misses, result.ms, result.status != 200 ? "  (!= 200)" : "");
+  }
+}
+
+// Herhaald bezoek aan een dagpagina: de miniaturen eerst zonder cache, daarna
+// met If-None-Match zoals een browser bij herladen doet
+void benchRevisit(int port, const std::string& dayName) {
+  std::string json;
+  httpGet(port, "/api/day/" + dayName + "?offset=0&limit=24", &json);
+  std::vector<std::string> urls;
+  const std::string marker = "\"url\":\"/view/";
+  for (size_t pos = json.find(marker); pos != std::string::npos; pos = json.find(marker, pos)) {
+    pos += marker.size();
+    urls.push_back("/thumb/" + json.substr(pos, json.find('"', pos) - pos));
+  }
+  if (urls.empty()) return;
+
+  std::vector<std::string> etags(urls.size());
+  printf("\n== Herhaald bezoek /day/%s: %zu miniaturen ==\n", dayName.c_str(), urls.size());
+  for (int visit = 0; visit < 2; visit++) {
+    KeepAliveClient client;
+    bool closed = true;
+    size_t bytes = 0;
+    int notModified = 0;
+    HostSdCounters before = hostSdCounters();
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < urls.size(); i++) {
+      if (closed) client.connectTo(port);
+      std::string conditional = visit == 0 ? "" : "If-None-Match: " + etags[i] + "\r\n";
+      HttpResult r = client.get(urls[i], &closed, conditional, &etags[i]);
+      bytes += r.bytes;
+      if (r.status == 304) notModified++;
+    }
+    double ms = msSince(start);
+    HostSdCounters after = hostSdCounters();
+    printf("%-8s %6.1f ms  %8zu bytes verstuurd  %8.1f KB van SD  %d x 304\n",
+           visit == 0 ? "eerste" : "herladen", ms, bytes,
+           (after.bytesRead - before.bytesRead) / 1024.0, notModified);
+  }
+}
+
+// Head-of-line blocking: korte verzoeken terwijl andere clients /stream
+// bekijken. Met één verbinding tegelijk wachtten ze tot de stream (30 s) klaar
+// was; met evenveel kijkers als workers moet er nog één vrij blijven.
+void benchConcurrent(int port, const std::string& relPhoto, int requests) {
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> streamBytes(0);
+  std::atomic<int> streamRefused(0);
+  std::vector<std::thread> viewers;
+  for (int v = 0; v < HTTP_WORKERS; v++) viewers.emplace_back([port, &stop, &streamBytes, &streamRefused] {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct timeval tv = {0, 200000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+      std::string request = "GET /stream HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+      send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+      char buf[16384];
+      bool first = true;
+      while (!stop) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n == 0) break;
+        if (n > 0) {
+          if (first && strncmp(buf, "HTTP/1.1 503", 12) == 0) streamRefused++;
+          first = false;
+          streamBytes += (size_t)n;
+        }
+      }
+    }
+    close(fd);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+  const char* labels[] = {"/iframe", "/snapshot", "/view"};
+  std::string paths[] = {"/iframe", "/snapshot", "/view/" + relPhoto};
+  Stats latency[3];
+  int badStatus = 0;
+  for (int i = 0; i < requests; i++) {
+    for (int r = 0; r < 3; r++) {
+      HttpResult result = httpGet(port, paths[r]);
+      latency[r].add(result.ms);
+      if (result.status != 200) badStatus++;
+    }
+  }
+  WebServerStats server = getWebServerStats();
+  stop = true;
+  for (std::thread& viewer : viewers) viewer.join();
+
+  printf("\n== Gelijktijdig met %d x /stream (%u workers) ==\n", HTTP_WORKERS, server.workers);
+  for (int r = 0; r < 3; r++) {
+    printf("%-10s %4d  p50 %8.2f ms  max %8.2f ms\n", labels[r], requests,
+           latency[r].percentile(50), latency[r].max());
+  }
+  printf("stream ontvangen: %.1f MB, max %u verbindingen tegelijk, %u geweigerd, %d van %d streams 503%s\n",
+         streamBytes / 1048576.0, server.maxActiveConnections, server.rejected, streamRefused.load(),
+         HTTP_WORKERS, badStatus ? "  (!= 200)" : "");
+}
+
+// Camerabuffer-bezettijd (virtuele ms) bij een burst op een trage kaart:
+// synchroon opslaan vs. kopiëren naar de pool van de SD-schrijver
+void benchWriter(const Options& opt) {
+  if (opt.writerBurst <= 0) return;
+  const uint32_t slowOpenUs = 20000, slowWriteKBps = 400;
+  const uint32_t burstGapMs = 200;
+  hostSdSetLatency(slowOpenUs, slowWriteKBps, opt.sdReadKBps);
+
+  Stats syncHold;
+  for (int i = 0; i < opt.writerBurst; i++) {
+    hostClockAdvanceSeconds(1);
+    unsigned long start = millis();
+    takeSavePhoto();
+    syncHold.add(millis() - start);
+  }
+
+  WriterStats before = getWriterStats();
+  Stats asyncHold;
+  for (int i = 0; i < opt.writerBurst; i++) {
+    hostClockAdvanceSeconds(1);
+    unsigned long start = millis();
+    camera_fb_t* fb = esp_camera_fb_get();
+    time_t now;
+    time(&now);
+    submitPhoto(fb, now, 0);
+    esp_camera_fb_return(fb);
+    asyncHold.add(millis() - start);
+    delay(burstGapMs);
+  }
+  while (getWriterStats().queueDepth > 0) delay(50);
+  WriterStats after = getWriterStats();
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+  hostSdSetReadCallLatency(opt.sdReadCallUs);
+
+  printf("== SD-schrijver: burst van %d foto's elke %u ms op trage kaart (open %u us, %u KB/s) ==\n",
+         opt.writerBurst, burstGapMs, slowOpenUs, slowWriteKBps);
+  printf("buffer bezet synchroon: p50=%.0f ms  p95=%.0f ms  max=%.0f ms\n",
+         syncHold.percentile(50), syncHold.percentile(95), syncHold.max());
+  printf("buffer bezet via pool:  p50=%.0f ms  p95=%.0f ms  max=%.0f ms\n",
+         asyncHold.percentile(50), asyncHold.percentile(95), asyncHold.max());
+  printf("pool=%u slots  max wachtrij=%u  geschreven=%u  overgeslagen=%u  mislukt=%u  "
+         "schrijftijd p50=%u p95=%u p99=%u max=%u ms\n\n",
+         after.poolSlots, after.maxQueueDepth, after.written - before.written,
+         after.dropped - before.dropped, after.failed - before.failed,
+         after.p50Ms, after.p95Ms, after.p99Ms, after.maxMs);
+}
+
+void benchEndpoint(int port, const char* label, const std::string& path, int requests) {
+  Stats latency;
+  size_t bytes = 0;
+  int badStatus = 0;
+  HostSdCounters before = hostSdCounters();
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < requests; i++) {
+    HttpResult r = httpGet(port, path);
+    latency.add(r.ms);
+    bytes += r.bytes;
+    if (r.status != 200) badStatus++;
+  }
+  double totalMs = msSince(start);
+  HostSdCounters after = hostSdCounters();
+  double perReq = requests ? (double)bytes / requests : 0;
+  double mbps = totalMs > 0 ? bytes / 1048576.0 / (totalMs / 1000.0) : 0;
+  double opensPerReq = requests ? (double)(after.opens + after.dirOpens - before.opens - before.dirOpens) / requests : 0;
+  double sdKBPerReq = requests ? (after.bytesRead - before.bytesRead) / 1024.0 / requests : 0;
+  printf("%-10s %4d %9.2f %9.2f %9.2f %11.0f %8.2f %9.1f %10.1f%s\n", label, requests,
+         latency.percentile(50), latency.percentile(95), latency.max(), perReq, mbps,
+         opensPerReq, sdKBPerReq, badStatus ? "  (!= 200)" : "");
+}
+
+// Opnameschema onder HTTP-belasting: klok 60x versneld, interval 1 minuut,
+// terwijl een client continu /stream en /download opvraagt
+void benchJitter(int port, const Options& opt, const std::string& relPhoto) {
+  if (opt.jitterMinutes <= 0) return;
+  photoInterval = 1;
+  dayStartHour = 0;
+  dayEndHour = 24;
+  CaptureStats before = getCaptureStats();
+  hostClockSetSpeed(60);
+
+  std::atomic<bool> loadRunning(true);
+  std::atomic<int> loadRequests(0);
+  std::thread load([&] {
+    while (loadRunning) {
+      httpGet(port, "/stream");
+      httpGet(port, "/download/" + relPhoto);
+      loadRequests += 2;
+    }
+  });
+  delay((uint32_t)opt.jitterMinutes * 60 * 1000 + 500);
+  loadRunning = false;
+  load.join();
+  hostClockSetSpeed(1);
+
+  CaptureStats after = getCaptureStats();
+  uint32_t captured = after.captured - before.captured;
+  printf("\n== Opnameschema onder HTTP-belasting (%d gesimuleerde minuten, interval 1 min) ==\n",
+         opt.jitterMinutes);
+  printf("opnames=%u  overgeslagen=%u  mislukt=%u  jitter max=%ld ms  gem=%.1f ms  (%d verzoeken belasting)\n",
+         captured, after.skipped - before.skipped, after.failed - before.failed, after.maxJitterMs,
+         captured ? (double)(after.totalJitterMs - before.totalJitterMs) / captured : 0.0,
+         loadRequests.load());
+}
+
+// Bewaarbeleid: oude dagen uitdunnen en daarna verwijderen op de achtergrond,
+// met ondertussen foto's opslaan op dezelfde (trage) kaart. Eén bus, zodat
+// de opname op bestandsoperaties van de retentietaak moet wachten.
+void benchRetention(const Options& opt) {
+  if (opt.days <= 0) return;
+  const uint32_t cardOpenUs = 3000, cardWriteKBps = 2000;
+  const uint32_t captureGapMs = 250;
+  hostSdSetLatency(cardOpenUs, cardWriteKBps, opt.sdReadKBps);
+  hostSdSetSingleBus(true);
+
+  camera_fb_t* fb = cameraGetFrame();
+  if (!fb) return;
+  std::vector<uint8_t> photo(fb->buf, fb->buf + fb->len);
+  esp_camera_fb_return(fb);
+
+  // Alleen het opslaan (zonder inregelen van de belichting)
+  auto captureWhile = [&](Stats& latency, const std::function<bool()>& busy) {
+    do {
+      hostClockAdvanceSeconds(1);
+      time_t now;
+      time(&now);
+      Clock::time_point start = Clock::now();
+      createDayFolder();
+      savePhotoBuffer(photo.data(), photo.size(), now);
+      latency.add(msSince(start));
+      delay(captureGapMs);
+    } while (busy());
+  };
+
+  Stats idle;
+  int idleCaptures = 0;
+  captureWhile(idle, [&] { return ++idleCaptures < 10; });
+
+  printf("\n== Bewaarbeleid: %d dagen x %d foto's, foto van %.1f KB opslaan elke %u ms (open %u us, %u KB/s, één bus) ==\n",
+         opt.days, opt.photosPerDay, photo.size() / 1024.0, captureGapMs, cardOpenUs, cardWriteKBps);
+  printf("%-12s %8s %8s %9s %8s %9s %8s %9s %9s %9s\n", "fase", "duur s", "bestand", "MB", "best/s",
+         "MB/s", "plak max", "opn p50", "opn p95", "opn max");
+  printf("%-12s %8s %8s %9s %8s %9s %8s %9.1f %9.1f %9.1f\n", "geen", "-", "-", "-", "-", "-", "-",
+         idle.percentile(50), idle.percentile(95), idle.max());
+
+  for (int phase = 0; phase < 2; phase++) {
+    RetentionStats before = getRetentionStats();
+    if (phase == 0) {
+      thinAfterDays = 1;
+      thinKeepEvery = 4;
+    } else {
+      thinAfterDays = 0;
+      retentionMaxDays = 1;
+    }
+    Clock::time_point start = Clock::now();
+    retentionNotify();
+    Stats during;
+    captureWhile(during, [&] {
+      RetentionStats now = getRetentionStats();
+      bool done = phase == 0 ? now.daysThinned - before.daysThinned >= (uint32_t)opt.days
+                             : now.daysDeleted - before.daysDeleted >= (uint32_t)opt.days;
+      return (!done || now.active) && msSince(start) < 120000;
+    });
+    double seconds = msSince(start) / 1000.0;
+    RetentionStats after = getRetentionStats();
+    uint32_t files = after.filesRemoved - before.filesRemoved;
+    double mb = (after.bytesFreed - before.bytesFreed) / (1024.0 * 1024.0);
+    double busy = std::max<uint32_t>(after.busyMs - before.busyMs, 1) / 1000.0;
+    printf("%-12s %8.1f %8u %9.1f %8.0f %9.2f %8u %9.1f %9.1f %9.1f\n", phase == 0 ? "uitdunnen" : "verwijderen",
+           seconds, files, mb, files / busy, mb / busy, after.maxSliceMs, during.percentile(50),
+           during.percentile(95), during.max());
+  }
+
+  thinAfterDays = 0;
+  retentionMaxDays = 0;
+  hostSdSetSingleBus(false);
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+}
+
+// Aantal bestanden onder een map (buiten de SD-shim om)
+// Pad (vanaf de kaartwortel) van de laatste foto van vandaag, of leeg
+std::string latestPhoto(const Options& opt) {
+  std::string day = todayFolderName(0);
+  DIR* d = opendir((opt.sdDir + "/timelapse/" + day).c_str());
+  if (!d) return "";
+  std::string latest;
+  while (struct dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".jpg") == 0 && name > latest) latest = name;
+  }
+  closedir(d);
+  return latest.empty() ? "" : "/timelapse/" + day + "/" + latest;
+}
+
+uint32_t countFiles(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  uint32_t count = 0;
+  while (struct dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..") continue;
+    struct stat st;
+    std::string path = dir + "/" + name;
+    if (stat(path.c_str(), &st) != 0) continue;
+    count += S_ISDIR(st.st_mode) ? countFiles(path) : 1;
+  }
+  closedir(d);
+  return count;
+}
+
+// Kaart wissen: het oude synchrone removeDir() in de webhandler tegenover een
+// verwijdertaak van de retentietaak. Ondertussen foto's opslaan in een eigen
+// thread, op dezelfde trage kaart met één bus als bij het bewaarbeleid.
+void benchWipe(const Options& opt) {
+  if (opt.days <= 0) return;
+  const uint32_t cardOpenUs = 3000, cardWriteKBps = 2000;
+  const uint32_t captureGapMs = 250;
+
+  camera_fb_t* fb = cameraGetFrame();
+  if (!fb) return;
+  std::vector<uint8_t> photo(fb->buf, fb->buf + fb->len);
+  esp_camera_fb_return(fb);
+
+  // Voorbeeldfoto buiten /timelapse bewaren; het wissen haalt het origineel weg
+  std::string sample = opt.sdDir + "/wipe-sample.jpg";
+  FILE* out = fopen(sample.c_str(), "wb");
+  if (!out) return;
+  fwrite(photo.data(), 1, photo.size(), out);
+  fclose(out);
+
+  printf("\n== Kaart wissen: %d dagen x %d foto's, foto opslaan elke %u ms (open %u us, %u KB/s, één bus) ==\n",
+         opt.days, opt.photosPerDay, captureGapMs, cardOpenUs, cardWriteKBps);
+  printf("%-12s %9s %8s %8s %8s %8s %9s %9s %9s\n", "wissen", "handler", "duur s", "bestand", "best/s",
+         "plak max", "opn p50", "opn p95", "opn max");
+
+  for (int phase = 0; phase < 2; phase++) {
+    // Snel vullen zonder kaartmodel, dan de index zoals op de kaart
+    hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+    populateDays(opt, sample);
+    rebuildPhotoIndex();
+    uint32_t files = countFiles(opt.sdDir + "/timelapse");
+    hostSdSetLatency(cardOpenUs, cardWriteKBps, opt.sdReadKBps);
+    hostSdSetSingleBus(true);
+
+    std::atomic<bool> busy(true);
+    Stats during;
+    std::thread capture([&] {
+      while (busy) {
+        hostClockAdvanceSeconds(1);
+        time_t now;
+        time(&now);
+        Clock::time_point start = Clock::now();
+        createDayFolder();
+        savePhotoBuffer(photo.data(), photo.size(), now);
+        during.add(msSince(start));
+        delay(captureGapMs);
+      }
+    });
+
+    Clock::time_point start = Clock::now();
+    double handlerMs = 0, busyMs = 0;
+    uint32_t maxSlice = 0;
+    if (phase == 0) {
+      removeDir("/timelapse");
+      SD_MMC.mkdir("/timelapse");
+      resetPhotoIndex();
+      handlerMs = busyMs = msSince(start);
+    } else {
+      uint32_t id = startDeleteJob("");
+      handlerMs = msSince(start);
+      BackgroundJob job = {};
+      while (getBackgroundJob(id, job) && job.state == JOB_RUNNING && msSince(start) < 120000) delay(50);
+      files = job.filesRemoved;
+      busyMs = job.busyMs;
+      maxSlice = job.maxSliceMs;
+    }
+    double seconds = msSince(start) / 1000.0;
+    busy = false;
+    capture.join();
+
+    char slice[16] = "-";
+    if (phase == 1) snprintf(slice, sizeof(slice), "%u", maxSlice);
+    printf("%-12s %9.1f %8.1f %8u %8.0f %8s %9.1f %9.1f %9.1f\n", phase == 0 ? "synchroon" : "taak",
+           handlerMs, seconds, files, files / (std::max(busyMs, 1.0) / 1000.0), slice,
+           during.percentile(50), during.percentile(95), during.max());
+  }
+
+  remove(sample.c_str());
+  hostSdSetSingleBus(false);
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+}
+
+void usage(const char* prog) {
+  fprintf(stderr,
+          "Gebruik: %s [opties]\n"
+          "  --sd MAP            SD-kaart map (standaard: nieuwe tijdelijke map)\n"
+          "  --frames MAP        JPEG-bestanden om af te spelen i.p.v. synthetische frames\n"
+          "  --captures N        aantal foto's voor de capture-meting (20)\n"
+          "  --requests N        verzoeken per endpoint (10)\n"
+          "  --days N            extra oudere dagmappen aanmaken (0)\n"
+          "  --photos-per-day N  foto's per extra dagmap (100)\n"
+          "  --sd-open-us N      gesimuleerde SD open/mkdir latentie in us\n"
+          "  --sd-write-kbps N   gesimuleerde SD schrijfsnelheid in KB/s\n"
+          "  --sd-read-kbps N    gesimuleerde SD leessnelheid in KB/s\n"
+          "  --sd-read-call-us N gesimuleerde vaste kosten per leesaanroep in us\n"
+          "  --frame-ms N        gesimuleerde sensor frametijd in ms\n"
+          "  --jitter-minutes N  gesimuleerde minuten voor de opnameschema-meting (10, 0 = uit)\n"
+          "  --writer-burst N    foto's voor de SD-schrijver meting (30, 0 = uit)\n"
+          "  --store-photos N    foto's per indeling voor de opslagmeting (150, 0 = uit)\n"
+          "  --verbose           seriële uitvoer van de firmware tonen\n",
+          prog);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (arg == "--sd" && next) { opt.sdDir = next; i++; }
+    else if (arg == "--frames" && next) { hostCameraSetSource(next); i++; }
+    else if (arg == "--captures" && next) { opt.captures = atoi(next); i++; }
+    else if (arg == "--requests" && next) { opt.requests = atoi(next); i++; }
+    else if (arg == "--days" && next) { opt.days = atoi(next); i++; }
+    else if (arg == "--photos-per-day" && next) { opt.photosPerDay = atoi(next); i++; }
+    else if (arg == "--sd-open-us" && next) { opt.sdOpenUs = (uint32_t)atoi(next); i++; }
+    else if (arg == "--sd-write-kbps" && next) { opt.sdWriteKBps = (uint32_t)atoi(next); i++; }
+    else if (arg == "--sd-read-kbps" && next) { opt.sdReadKBps = (uint32_t)atoi(next); i++; }
+    else if (arg == "--sd-read-call-us" && next) { opt.sdReadCallUs = (uint32_t)atoi(next); i++; }
+    else if (arg == "--frame-ms" && next) { opt.frameMs = (uint32_t)atoi(next); i++; }
+    else if (arg == "--jitter-minutes" && next) { opt.jitterMinutes = atoi(next); i++; }
+    else if (arg == "--writer-burst" && next) { opt.writerBurst = atoi(next); i++; }
+    else if (arg == "--store-photos" && next) { opt.storePhotos = atoi(next); i++; }
+    else if (arg == "--verbose") { opt.verbose = true; }
+    else { usage(argv[0]); return 2; }
+  }
+
+  if (opt.sdDir.empty()) {
+    char tmpl[] = "/tmp/timelapse-bench-XXXXXX";
+    if (!mkdtemp(tmpl)) {
+      perror("mkdtemp");
+      return 1;
+    }
+    opt.sdDir = tmpl;
+  }
+  hostSdSetRoot(opt.sdDir);
+  hostSdSetLatency(opt.sdOpenUs, opt.sdWriteKBps, opt.sdReadKBps);
+  hostSdSetReadCallLatency(opt.sdReadCallUs);
+  hostCameraSetFrameTime(opt.frameMs);
+  hostWiFiSetPort(0);
+  hostSerialSetEnabled(opt.verbose);
+
+  printf("SD-kaart map: %s\n\n", opt.sdDir.c_str());
+  setup();
+  int port = hostWiFiBoundPort();
+
+  benchCardHealth(opt);
+  benchCaptures(opt);
+  benchLuminance(opt);
+  benchChangeDetection(opt);
+  benchSettle(opt);
+  benchPhotoStore(opt);
+  benchWriter(opt);
+
+  std::string lastPhoto = latestPhoto(opt);
+  if (opt.days > 0 && !lastPhoto.empty()) {
+    populateDays(opt, opt.sdDir + lastPhoto);
+    // Mappen zonder index, zoals op een kaart van oudere firmware
+    HostSdCounters before = hostSdCounters();
+    Clock::time_point start = Clock::now();
+    uint32_t dayCount = 0, photoCount = 0;
+    rebuildPhotoIndex(&dayCount, &photoCount);
+    HostSdCounters after = hostSdCounters();
+    printf("== Index herbouwen ==\n%u dagen, %u foto's in %.1f ms  (SD-open %llu, map-items %llu)\n\n",
+           dayCount, photoCount, msSince(start),
+           (unsigned long long)(after.opens - before.opens),
+           (unsigned long long)(after.dirEntries - before.dirEntries));
+
+    // Miniaturen voor alle dagen aanvullen op de achtergrond
+    ThumbnailStats thumbsBefore = getThumbnailStats();
+    start = Clock::now();
+    queueThumbnailBackfill();
+    delay(10);
+    while (getThumbnailStats().backfillActive) delay(10);
+    ThumbnailStats thumbs = getThumbnailStats();
+    uint32_t made = thumbs.generated - thumbsBefore.generated;
+    printf("== Miniaturen aanvullen ==\n%u gemaakt, %u mislukt in %.1f ms (%.2f ms per foto), laatste %u bytes\n\n",
+           made, thumbs.failed - thumbsBefore.failed, msSince(start),
+           made ? msSince(start) / made : 0.0, thumbs.lastBytes);
+  }
+  benchRecovery(opt);
+
+  std::atomic<bool> running(true);
+  std::thread server([&running] {
+    while (running) loop();
+  });
+
+  std::string relPhoto = lastPhoto.empty() ? "" : lastPhoto.substr(1);
+  printf("== HTTP endpoints (%d dagen extra x %d foto's) ==\n", opt.days, opt.photosPerDay);
+  printf("%-10s %4s %9s %9s %9s %11s %8s %9s %10s\n", "endpoint", "n", "p50 ms", "p95 ms",
+         "max ms", "bytes/req", "MB/s", "SD-open", "SD-KB/req");
+  benchEndpoint(port, "/", "/", opt.requests);
+  benchEndpoint(port, "/iframe", "/iframe", opt.requests);
+  benchEndpoint(port, "/day", "/day/" + todayFolderName(0), opt.requests);
+  benchEndpoint(port, "/api/day", "/api/day/" + todayFolderName(0) + "?offset=0&limit=24", opt.requests);
+  benchEndpoint(port, "/api/stats", "/api/stats/day/" + todayFolderName(0) + "?offset=0&limit=24", opt.requests);
+  benchEndpoint(port, "/view", "/view/" + relPhoto, opt.requests);
+  benchEndpoint(port, "/download", "/download/" + relPhoto, opt.requests);
+  benchEndpoint(port, "/snapshot", "/snapshot", opt.requests);
+  benchEndpoint(port, "/api/card", "/api/card", opt.requests);
+  benchDayPage(port, todayFolderName(opt.days > 0 ? 1 : 0));
+  benchGallery(port, todayFolderName(opt.days > 0 ? 1 : 0));
+  benchRevisit(port, todayFolderName(opt.days > 0 ? 1 : 0));
+  benchThroughput(port, relPhoto, opt.requests);
+  benchArchive(port, todayFolderName(opt.days > 0 ? 1 : 0));
+  benchPlayback(port, todayFolderName(opt.days > 0 ? 1 : 0));
+  benchConcurrent(port, relPhoto, opt.requests);
+
+  benchJitter(port, opt, relPhoto);
+  benchRetention(opt);
+  benchWipe(opt);
+
+  running = false;
+  server.join();
+  return 0;
+}
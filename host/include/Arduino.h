@@ -0,0 +1,76 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimale Arduino-core voor de host-simulatie (Linux).
+// Tijd loopt via een instelbare simulatieklok, zie host_sim.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "esp_err.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+uint32_t esp_random();
+
+// ESP32-specifiek: PSRAM en tijdconfiguratie
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t n, size_t size);
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart();
+  uint32_t getFreeHeap();
+  uint32_t getHeapSize();
+  uint32_t getPsramSize();
+  uint32_t getFreePsram();
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,44 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+// EEPROM-emulatie voor de host: leeft alleen in het geheugen van het proces.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+class EEPROMClass {
+public:
+  bool begin(size_t size) {
+    if (data_.size() < size) data_.resize(size, 0xFF);
+    size_ = size;
+    return true;
+  }
+  void end() { size_ = 0; }
+  bool commit() { return size_ > 0; }
+  size_t length() const { return size_; }
+
+  uint8_t read(int address) const { return (size_t)address < size_ ? data_[address] : 0; }
+  void write(int address, uint8_t value) { if ((size_t)address < size_) data_[address] = value; }
+
+  template <typename T>
+  T& get(int address, T& t) {
+    if (address >= 0 && address + sizeof(T) <= size_) memcpy(&t, &data_[address], sizeof(T));
+    return t;
+  }
+
+  template <typename T>
+  const T& put(int address, const T& t) {
+    if (address >= 0 && address + sizeof(T) <= size_) memcpy(&data_[address], &t, sizeof(T));
+    return t;
+  }
+
+private:
+  std::vector<uint8_t> data_;
+  size_t size_ = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
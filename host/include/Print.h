@@ -0,0 +1,64 @@
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "WString.h"
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+// Basisklasse voor alles waar tekst/bytes naartoe geschreven kunnen worden
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(int v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(long long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int digits = 2) { return print(String(v, (unsigned char)digits)); }
+  size_t print(const Printable& p) { return p.printTo(*this); }
+
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+  template <typename T>
+  size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(const T& v, int format) { size_t n = print(v, format); return n + println(); }
+
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+  unsigned long getTimeout() const { return timeout_; }
+
+protected:
+  unsigned long timeout_ = 1000;
+};
+
+#endif // HOST_PRINT_H
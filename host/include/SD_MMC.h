@@ -0,0 +1,33 @@
+#ifndef HOST_SD_MMC_H
+#define HOST_SD_MMC_H
+
+#include "FS.h"
+
+typedef enum {
+  CARD_NONE,
+  CARD_MMC,
+  CARD_SD,
+  CARD_SDHC,
+  CARD_UNKNOWN
+} sdcard_type_t;
+
+namespace fs {
+
+// SD_MMC shim: de kaart is een map op de host (zie hostSdSetRoot)
+class SDMMCFS : public FS {
+public:
+  bool begin(const char* mountpoint = "/sdcard", bool mode1bit = false,
+             bool format_if_mount_failed = false, int sdmmc_frequency = 20000,
+             uint8_t maxOpenFiles = 5);
+  void end();
+  sdcard_type_t cardType();
+  uint64_t cardSize();
+  uint64_t totalBytes();
+  uint64_t usedBytes();
+};
+
+} // namespace fs
+
+extern fs::SDMMCFS SD_MMC;
+
+#endif // HOST_SD_MMC_H
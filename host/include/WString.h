@@ -0,0 +1,117 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+// Host-implementatie van de Arduino String klasse.
+// Alleen het deel van de API dat de firmware gebruikt, gebouwd op std::string.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char* cstr) : s_(cstr ? cstr : "") {}
+  String(const std::string& str) : s_(str) {}
+  String(char c) : s_(1, c) {}
+  String(unsigned char value, unsigned char base = 10);
+  String(int value, unsigned char base = 10);
+  String(unsigned int value, unsigned char base = 10);
+  String(long value, unsigned char base = 10);
+  String(unsigned long value, unsigned char base = 10);
+  String(long long value, unsigned char base = 10);
+  String(unsigned long long value, unsigned char base = 10);
+  String(float value, unsigned char decimalPlaces = 2);
+  String(double value, unsigned char decimalPlaces = 2);
+
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  bool reserve(unsigned int size) { s_.reserve(size); return true; }
+  bool isEmpty() const { return s_.empty(); }
+
+  String& operator+=(const String& rhs) { s_ += rhs.s_; return *this; }
+  String& operator+=(const char* rhs) { if (rhs) s_ += rhs; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(unsigned char v) { return *this += String(v); }
+  String& operator+=(int v) { return *this += String(v); }
+  String& operator+=(unsigned int v) { return *this += String(v); }
+  String& operator+=(long v) { return *this += String(v); }
+  String& operator+=(unsigned long v) { return *this += String(v); }
+  String& operator+=(long long v) { return *this += String(v); }
+  String& operator+=(unsigned long long v) { return *this += String(v); }
+  String& operator+=(float v) { return *this += String(v); }
+  String& operator+=(double v) { return *this += String(v); }
+
+  bool concat(const String& rhs) { s_ += rhs.s_; return true; }
+  bool concat(const char* rhs) { if (rhs) s_ += rhs; return true; }
+  bool concat(const char* rhs, unsigned int len) { if (rhs) s_.append(rhs, len); return true; }
+  bool concat(char c) { s_ += c; return true; }
+  bool concat(int v) { *this += v; return true; }
+  bool concat(unsigned int v) { *this += v; return true; }
+  bool concat(long v) { *this += v; return true; }
+  bool concat(unsigned long v) { *this += v; return true; }
+
+  bool equals(const String& rhs) const { return s_ == rhs.s_; }
+  bool equals(const char* rhs) const { return s_ == (rhs ? rhs : ""); }
+  bool equalsIgnoreCase(const String& rhs) const;
+  bool startsWith(const String& prefix) const { return startsWith(prefix, 0); }
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const;
+
+  bool operator==(const String& rhs) const { return s_ == rhs.s_; }
+  bool operator==(const char* rhs) const { return equals(rhs); }
+  bool operator!=(const String& rhs) const { return s_ != rhs.s_; }
+  bool operator!=(const char* rhs) const { return !equals(rhs); }
+  bool operator<(const String& rhs) const { return s_ < rhs.s_; }
+  bool operator>(const String& rhs) const { return s_ > rhs.s_; }
+  bool operator<=(const String& rhs) const { return s_ <= rhs.s_; }
+  bool operator>=(const String& rhs) const { return s_ >= rhs.s_; }
+
+  char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : 0; }
+  void setCharAt(unsigned int index, char c) { if (index < s_.size()) s_[index] = c; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index);
+
+  int indexOf(char c) const { return indexOf(c, 0); }
+  int indexOf(char c, unsigned int fromIndex) const;
+  int indexOf(const String& str) const { return indexOf(str, 0); }
+  int indexOf(const String& str, unsigned int fromIndex) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(char c, unsigned int fromIndex) const;
+  int lastIndexOf(const String& str) const;
+
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replaceWith);
+  void replace(const String& find, const String& replaceWith);
+  void remove(unsigned int index) { if (index < s_.size()) s_.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < s_.size()) s_.erase(index, count); }
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+  const std::string& str() const { return s_; }
+
+private:
+  std::string s_;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+String operator+(const String& lhs, long long rhs);
+String operator+(const String& lhs, unsigned long long rhs);
+String operator+(const String& lhs, float rhs);
+String operator+(const String& lhs, double rhs);
+
+#endif // HOST_WSTRING_H
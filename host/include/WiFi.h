@@ -0,0 +1,92 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Loopback WiFi voor de host-simulatie: WiFiServer/WiFiClient zijn gewone
+// TCP-sockets op 127.0.0.1.
+
+#include <memory>
+#include "Arduino.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : addr_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr_{a, b, c, d} {}
+  uint8_t operator[](int index) const { return addr_[index]; }
+  String toString() const;
+  size_t printTo(Print& p) const override;
+
+private:
+  uint8_t addr_[4];
+};
+
+class WiFiClientSocketHandle;
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient();
+  explicit WiFiClient(int fd);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size);
+  int peek() override;
+  void flush() override {}
+  void stop();
+  uint8_t connected();
+  int fd() const;
+  int setNoDelay(bool nodelay);
+  IPAddress remoteIP() const;
+  uint16_t remotePort() const;
+
+  operator bool() { return connected(); }
+  bool operator==(const WiFiClient& rhs) const { return handle_ == rhs.handle_; }
+  bool operator!=(const WiFiClient& rhs) const { return handle_ != rhs.handle_; }
+
+private:
+  std::shared_ptr<WiFiClientSocketHandle> handle_;
+  bool connected_ = false;
+};
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t port = 80, uint8_t maxClients = 4) : port_(port), maxClients_(maxClients) {}
+  ~WiFiServer() { end(); }
+
+  void begin(uint16_t port = 0);
+  void end();
+  WiFiClient available();
+  WiFiClient accept() { return available(); }
+  bool hasClient();
+  void setNoDelay(bool nodelay) { noDelay_ = nodelay; }
+  operator bool() { return listenFd_ >= 0; }
+
+private:
+  uint16_t port_;
+  uint8_t maxClients_;
+  int listenFd_ = -1;
+  bool noDelay_ = false;
+};
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+  wl_status_t status();
+  IPAddress localIP();
+  int8_t RSSI() { return -55; }
+  bool disconnect(bool wifioff = false) { (void)wifioff; return true; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
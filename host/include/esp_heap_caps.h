@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+// Geheugen met eigenschappen (DMA, intern, PSRAM); op de host gewoon malloc.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+  (void)caps;
+  return malloc(size);
+}
+
+inline void heap_caps_free(void* ptr) {
+  free(ptr);
+}
+
+#endif // HOST_ESP_HEAP_CAPS_H
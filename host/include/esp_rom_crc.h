@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+// CRC-32 zoals de ROM-functie van de ESP32 (zelfde resultaat als zlib crc32)
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+#endif // HOST_ESP_ROM_CRC_H
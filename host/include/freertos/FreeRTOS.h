@@ -0,0 +1,36 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// FreeRTOS-API voor de host-simulatie, gebouwd op std::thread.
+// Eén tick is één milliseconde van de simulatieklok (configTICK_RATE_HZ 1000).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE  ((BaseType_t)0)
+#define pdTRUE   ((BaseType_t)1)
+#define pdFAIL   pdFALSE
+#define pdPASS   pdTRUE
+#define errQUEUE_FULL  ((BaseType_t)0)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Spinlock voor kritieke secties; op de host een gewone mutex
+struct portMUX_TYPE {
+  std::mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) ((mux)->m.lock())
+#define portEXIT_CRITICAL(mux) ((mux)->m.unlock())
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,25 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct HostTask* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority,
+                                   TaskHandle_t* pvCreatedTask, BaseType_t xCoreID);
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                       void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask);
+void vTaskDelete(TaskHandle_t xTask);
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+// Taaknotificaties (alleen de tel-variant)
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+#endif // HOST_FREERTOS_TASK_H
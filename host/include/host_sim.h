@@ -0,0 +1,61 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// Besturing van de host-simulatie. Deze functies bestaan alleen in de
+// Linux-build en worden gebruikt door de simulator en de benchmark.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Simulatieklok: millis()/delay()/time() lopen 'speed' keer sneller dan de
+// echte tijd, en time() kan vooruit gezet worden.
+void hostClockSetSpeed(double speed);
+double hostClockSpeed();
+void hostClockAdvanceSeconds(long seconds);
+
+// Seriële uitvoer (stderr) aan/uit
+void hostSerialSetEnabled(bool enabled);
+
+// SD_MMC shim: map op de host die als root van de kaart dient, plus een
+// optioneel vertragingsmodel om een trage kaart na te bootsen.
+void hostSdSetRoot(const std::string& path);
+const std::string& hostSdRoot();
+void hostSdSetLatency(uint32_t openUs, uint32_t writeKBps, uint32_t readKBps);
+// Vaste kosten per File::read() aanroep (commando + bus-overhead van de kaart)
+void hostSdSetReadCallLatency(uint32_t us);
+void hostSdSetCapacity(uint64_t bytes);
+// Eén bus voor alle taken: kaartvertragingen lopen na elkaar in plaats van
+// tegelijk (standaard uit)
+void hostSdSetSingleBus(bool enabled);
+
+struct HostSdCounters {
+  uint64_t opens;
+  uint64_t dirOpens;
+  uint64_t dirEntries;
+  uint64_t bytesRead;
+  uint64_t bytesWritten;
+  uint64_t removes;
+  // Kostenmodel voor FAT32: nieuwe bestanden (mapitem), aangeraakte
+  // datasectoren, nieuw toegewezen clusters en gesloten bestanden na
+  // schrijven (mapitem bijwerken)
+  uint64_t filesCreated;
+  uint64_t sectorsWritten;
+  uint64_t clustersAllocated;
+  uint64_t modifiedCloses;
+};
+HostSdCounters hostSdCounters();
+void hostSdResetCounters();
+
+// Nep-camera: speelt JPEG-bestanden uit een map af, of genereert synthetische
+// frames als er geen map is opgegeven. frameTimeMs simuleert de sensor-framerate.
+void hostCameraSetSource(const std::string& jpegDir);
+void hostCameraSetFrameTime(uint32_t frameTimeMs);
+uint64_t hostCameraFramesCaptured();
+
+// Loopback WiFi: poort waarop WiFiServer echt luistert (0 = willekeurig vrij)
+void hostWiFiSetPort(int port);
+int hostWiFiBoundPort();
+
+#endif // HOST_SIM_H
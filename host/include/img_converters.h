@@ -0,0 +1,27 @@
+#ifndef HOST_IMG_CONVERTERS_H
+#define HOST_IMG_CONVERTERS_H
+
+// Host-implementatie van de beeldconversies uit esp32-camera (img_converters.h),
+// gebouwd op libjpeg. RGB565 is big-endian, net als op de ESP32.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor.h"
+
+typedef enum {
+  JPG_SCALE_NONE,
+  JPG_SCALE_2X,
+  JPG_SCALE_4X,
+  JPG_SCALE_8X,
+  JPG_SCALE_MAX = JPG_SCALE_8X
+} jpg_scale_t;
+
+// Decodeer een JPEG naar RGB565, verkleind met 1 << scale (in het DCT-domein)
+bool jpg2rgb565(const uint8_t* src, size_t src_len, uint8_t* out, jpg_scale_t scale);
+
+// Codeer een RGB565/RGB888/grijswaardenbeeld als JPEG (kwaliteit 1-100).
+// *out wordt met malloc() gereserveerd; de aanroeper geeft het vrij.
+bool fmt2jpg(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format,
+             uint8_t quality, uint8_t** out, size_t* out_len);
+
+#endif // HOST_IMG_CONVERTERS_H
@@ -0,0 +1,34 @@
+// Simulator: draait setup() en loop() van de sketch op de host.
+// Gebruik: timelapse_sim [--sd MAP] [--frames MAP] [--port N] [--speed X] [--capacity-mb N]
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+#include "host_sim.h"
+
+void setup();
+void loop();
+
+int main(int argc, char** argv) {
+  std::string sdDir = "./sdcard";
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (arg == "--sd" && next) { sdDir = next; i++; }
+    else if (arg == "--frames" && next) { hostCameraSetSource(next); i++; }
+    else if (arg == "--port" && next) { hostWiFiSetPort(atoi(next)); i++; }
+    else if (arg == "--speed" && next) { hostClockSetSpeed(atof(next)); i++; }
+    else if (arg == "--capacity-mb" && next) { hostSdSetCapacity((uint64_t)atoll(next) * 1024 * 1024); i++; }
+    else {
+      fprintf(stderr, "Gebruik: %s [--sd MAP] [--frames MAP] [--port N] [--speed X] [--capacity-mb N]\n", argv[0]);
+      return 2;
+    }
+  }
+  hostSdSetRoot(sdDir);
+
+  setup();
+  fprintf(stderr, "[host] Webinterface op http://127.0.0.1:%d/\n", hostWiFiBoundPort());
+  while (true) {
+    loop();
+  }
+}
@@ -0,0 +1,2 @@
+// De .ino als gewone C++ vertaaleenheid: levert setup() en loop()
+#include "ESPS32_Timelapse.ino"
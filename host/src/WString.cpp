@@ -0,0 +1,152 @@
+#include "WString.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string integerToString(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int pos = sizeof(buf) - 1;
+  buf[pos] = '\0';
+  do {
+    int digit = (int)(value % base);
+    buf[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  } while (value > 0);
+  if (negative) buf[--pos] = '-';
+  return std::string(&buf[pos]);
+}
+
+static std::string signedToString(long long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    return integerToString(0ULL - (unsigned long long)value, true, base);
+  }
+  return integerToString((unsigned long long)value, false, base);
+}
+
+String::String(unsigned char value, unsigned char base) : s_(integerToString(value, false, base)) {}
+String::String(int value, unsigned char base) : s_(signedToString(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s_(integerToString(value, false, base)) {}
+String::String(long value, unsigned char base) : s_(signedToString(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s_(integerToString(value, false, base)) {}
+String::String(long long value, unsigned char base) : s_(signedToString(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : s_(integerToString(value, false, base)) {}
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  s_ = buf;
+}
+
+bool String::equalsIgnoreCase(const String& rhs) const {
+  if (s_.size() != rhs.s_.size()) return false;
+  for (size_t i = 0; i < s_.size(); i++) {
+    if (tolower((unsigned char)s_[i]) != tolower((unsigned char)rhs.s_[i])) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+  if (offset > s_.size() || prefix.s_.size() > s_.size() - offset) return false;
+  return s_.compare(offset, prefix.s_.size(), prefix.s_) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  if (suffix.s_.size() > s_.size()) return false;
+  return s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= s_.size()) {
+    dummy = 0;
+    return dummy;
+  }
+  return s_[index];
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  if (fromIndex >= s_.size()) return -1;
+  size_t pos = s_.find(c, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+  if (fromIndex >= s_.size()) return -1;
+  size_t pos = s_.find(str.s_, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = s_.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c, unsigned int fromIndex) const {
+  if (s_.empty()) return -1;
+  size_t pos = s_.rfind(c, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String& str) const {
+  size_t pos = s_.rfind(str.s_);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  // Arduino verwisselt de grenzen als ze omgekeerd zijn opgegeven
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= s_.size()) return String();
+  if (endIndex > s_.size()) endIndex = (unsigned int)s_.size();
+  return String(s_.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replaceWith) {
+  std::replace(s_.begin(), s_.end(), find, replaceWith);
+}
+
+void String::replace(const String& find, const String& replaceWith) {
+  if (find.s_.empty()) return;
+  size_t pos = 0;
+  while ((pos = s_.find(find.s_, pos)) != std::string::npos) {
+    s_.replace(pos, find.s_.size(), replaceWith.s_);
+    pos += replaceWith.s_.size();
+  }
+}
+
+void String::toLowerCase() {
+  for (char& c : s_) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char& c : s_) c = (char)toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < s_.size() && isspace((unsigned char)s_[begin])) begin++;
+  size_t end = s_.size();
+  while (end > begin && isspace((unsigned char)s_[end - 1])) end--;
+  s_ = s_.substr(begin, end - begin);
+}
+
+long String::toInt() const { return atol(s_.c_str()); }
+float String::toFloat() const { return (float)atof(s_.c_str()); }
+double String::toDouble() const { return atof(s_.c_str()); }
+
+String operator+(const String& lhs, const String& rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, const char* rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const char* lhs, const String& rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, char rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, int rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, unsigned int rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, long rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, unsigned long rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, long long rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, unsigned long long rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, float rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, double rhs) { String r(lhs); r += rhs; return r; }
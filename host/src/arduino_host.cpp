@@ -0,0 +1,222 @@
+// Arduino-core functies voor de host-simulatie: klok, Serial en ESP.
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "host_sim.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+
+namespace {
+
+typedef std::chrono::steady_clock SteadyClock;
+
+struct SimClock {
+  std::mutex lock;
+  SteadyClock::time_point anchorReal = SteadyClock::now();
+  double anchorVirtualUs = 0;
+  double speed = 1.0;
+  long offsetSeconds = 0;
+  time_t wallStart = 0;
+};
+
+SimClock& simClock() {
+  static SimClock clock;
+  return clock;
+}
+
+// Verstreken gesimuleerde tijd sinds de start, in microseconden
+double virtualMicros() {
+  SimClock& c = simClock();
+  std::lock_guard<std::mutex> guard(c.lock);
+  double realUs = std::chrono::duration<double, std::micro>(SteadyClock::now() - c.anchorReal).count();
+  return c.anchorVirtualUs + realUs * c.speed;
+}
+
+bool serialEnabled() {
+  static bool enabled = [] {
+    const char* env = getenv("HOST_SERIAL");
+    return !(env && strcmp(env, "0") == 0);
+  }();
+  return enabled;
+}
+
+bool serialOverride = true;
+std::mutex serialLock;
+
+} // namespace
+
+void hostClockSetSpeed(double speed) {
+  if (speed <= 0) speed = 1.0;
+  double now = virtualMicros();
+  SimClock& c = simClock();
+  std::lock_guard<std::mutex> guard(c.lock);
+  c.anchorVirtualUs = now;
+  c.anchorReal = SteadyClock::now();
+  c.speed = speed;
+}
+
+double hostClockSpeed() {
+  SimClock& c = simClock();
+  std::lock_guard<std::mutex> guard(c.lock);
+  return c.speed;
+}
+
+void hostClockAdvanceSeconds(long seconds) {
+  SimClock& c = simClock();
+  std::lock_guard<std::mutex> guard(c.lock);
+  c.offsetSeconds += seconds;
+}
+
+void hostSerialSetEnabled(bool enabled) {
+  serialOverride = enabled;
+}
+
+// time() wordt overschreven zodat de firmware de simulatieklok ziet
+extern "C" time_t time(time_t* t) __THROW {
+  SimClock& c = simClock();
+  time_t wallStart;
+  long offset;
+  {
+    std::lock_guard<std::mutex> guard(c.lock);
+    if (c.wallStart == 0) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      c.wallStart = ts.tv_sec;
+    }
+    wallStart = c.wallStart;
+    offset = c.offsetSeconds;
+  }
+  time_t now = wallStart + (time_t)(virtualMicros() / 1000000.0) + offset;
+  if (t) *t = now;
+  return now;
+}
+
+unsigned long millis() {
+  return (unsigned long)(virtualMicros() / 1000.0);
+}
+
+unsigned long micros() {
+  return (unsigned long)virtualMicros();
+}
+
+void delay(uint32_t ms) {
+  delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  double realUs = us / hostClockSpeed();
+  std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(realUs));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t val) { (void)pin; (void)val; }
+int digitalRead(uint8_t pin) { (void)pin; return LOW; }
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+uint32_t esp_random() {
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ (uint32_t)micros();
+}
+
+bool psramFound() {
+  return true;
+}
+
+void* ps_malloc(size_t size) {
+  return malloc(size);
+}
+
+void* ps_calloc(size_t n, size_t size) {
+  return calloc(n, size);
+}
+
+// Zelfde tijdzone-opbouw als de ESP32 core (esp32-hal-time.c)
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2, const char* server3) {
+  (void)server1; (void)server2; (void)server3;
+  long offset = -gmtOffset_sec;
+  char cst[32];
+  char cdt[24] = "DST";
+  char tz[64];
+  if (offset % 3600) {
+    snprintf(cst, sizeof(cst), "UTC%ld:%02u:%02u", offset / 3600,
+             (unsigned)labs((offset % 3600) / 60), (unsigned)labs(offset % 60));
+  } else {
+    snprintf(cst, sizeof(cst), "UTC%ld", offset / 3600);
+  }
+  if (daylightOffset_sec != 3600) {
+    long dst = offset - daylightOffset_sec;
+    snprintf(cdt, sizeof(cdt), "DST%ld", dst / 3600);
+  }
+  snprintf(tz, sizeof(tz), "%s%s", cst, cdt);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) n++;
+    else break;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(stackBuf)) {
+    return write((const uint8_t*)stackBuf, len);
+  }
+  char* heapBuf = (char*)malloc(len + 1);
+  if (!heapBuf) return 0;
+  va_start(args, format);
+  vsnprintf(heapBuf, len + 1, format, args);
+  va_end(args);
+  size_t n = write((const uint8_t*)heapBuf, len);
+  free(heapBuf);
+  return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (!serialOverride || !serialEnabled()) return size;
+  std::lock_guard<std::mutex> guard(serialLock);
+  fwrite(buffer, 1, size, stderr);
+  return size;
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "[host] ESP.restart() aangeroepen, simulatie stopt\n");
+  exit(1);
+}
+
+uint32_t EspClass::getFreeHeap() { return 200 * 1024; }
+uint32_t EspClass::getHeapSize() { return 320 * 1024; }
+uint32_t EspClass::getPsramSize() { return 4 * 1024 * 1024; }
+uint32_t EspClass::getFreePsram() { return 4 * 1024 * 1024; }
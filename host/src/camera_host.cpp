@@ -0,0 +1,337 @@
+// Nep-camera voor de host-simulatie.
+// Speelt JPEG-bestanden uit een map af (hostCameraSetSource) of genereert met
+// libjpeg een synthetische plantenscène met sensorruis, zodat framegroottes en
+// decodeerkosten lijken op die van een echte OV2640.
+
+#include "esp_camera.h"
+#include "Arduino.h"
+#include "host_sim.h"
+
+#include <condition_variable>
+#include <dirent.h>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include <jpeglib.h>
+
+const resolution_info_t resolution[] = {
+  {96, 96}, {160, 120}, {176, 144}, {240, 176}, {240, 240}, {320, 240}, {400, 296},
+  {480, 320}, {640, 480}, {800, 600}, {1024, 768}, {1280, 720}, {1280, 1024}, {1600, 1200},
+};
+
+namespace {
+
+const int SYNTHETIC_CYCLE = 16;
+const unsigned long FB_GET_TIMEOUT_MS = 4000;
+// Nagebootste automatische belichting: na een pauze begint een synthetisch
+// frame te donker en halveert de afwijking per frame. AEC regelt op de
+// sensor en loopt door bij het wisselen van framegrootte
+const unsigned long AEC_IDLE_MS = 5000;
+const int AEC_START_OFFSET = -48;
+
+std::mutex camLock;
+std::condition_variable camCond;
+bool initialized = false;
+size_t fbCount = 1;
+size_t fbOutstanding = 0;
+uint32_t frameTimeMs = 0;
+uint64_t framesCaptured = 0;
+std::string sourceDir;
+std::vector<std::vector<uint8_t> > replayFrames;
+size_t replayIndex = 0;
+std::map<uint64_t, std::vector<uint8_t> > syntheticCache;
+sensor_t sensor;
+int exposureOffset = 0;
+unsigned long lastFrameMs = 0;
+
+int libjpegQuality(int espQuality) {
+  // esp32-camera: 0-63, lager = beter. libjpeg: 1-100, hoger = beter.
+  int q = 100 - espQuality * 90 / 63;
+  return q < 5 ? 5 : (q > 95 ? 95 : q);
+}
+
+uint8_t clampByte(int v) {
+  return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Synthetische scène: lucht, grond en een plant die per frame iets groeit
+std::vector<uint8_t> renderSynthetic(int width, int height, int quality, int frameIndex, int exposure) {
+  std::vector<uint8_t> rgb((size_t)width * height * 3);
+  uint32_t seed = 0x9E3779B9u ^ (uint32_t)(frameIndex * 7919);
+  int stemX = width / 2 + (int)(width * 0.02 * sin(frameIndex * 0.7));
+  int plantTop = height * 3 / 4 - (height / 2) * (frameIndex + 4) / (SYNTHETIC_CYCLE + 4);
+  int leafRadius = width / 12 + frameIndex * width / 400;
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      seed = seed * 1664525u + 1013904223u;
+      int noise = (int)((seed >> 24) & 0x07) - 4 + exposure;
+      int r, g, b;
+      if (y < height * 3 / 4) {
+        r = 120 + y * 60 / height;
+        g = 160 + y * 40 / height;
+        b = 230 - y * 50 / height;
+      } else {
+        r = 110 + ((x / 7 + y / 5) % 9) * 3;
+        g = 80 + ((x / 11) % 5) * 4;
+        b = 50;
+      }
+      int dx = x - stemX;
+      if (y > plantTop && y < height * 3 / 4 && dx > -width / 160 && dx < width / 160) {
+        r = 40; g = 130; b = 40;
+      }
+      int ldx = x - stemX - leafRadius;
+      int ldy = y - plantTop;
+      int rdx = x - stemX + leafRadius;
+      if (ldx * ldx + 4 * ldy * ldy < leafRadius * leafRadius ||
+          rdx * rdx + 4 * (ldy - leafRadius / 2) * (ldy - leafRadius / 2) < leafRadius * leafRadius) {
+        r = 50 + ((x + y) % 13); g = 150 + ((x * 3 + y) % 17); b = 45;
+      }
+      size_t i = ((size_t)y * width + x) * 3;
+      rgb[i] = clampByte(r + noise);
+      rgb[i + 1] = clampByte(g + noise);
+      rgb[i + 2] = clampByte(b + noise);
+    }
+  }
+
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char* out = nullptr;
+  unsigned long outSize = 0;
+  jpeg_mem_dest(&cinfo, &out, &outSize);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, libjpegQuality(quality), TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row = &rgb[(size_t)cinfo.next_scanline * width * 3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  std::vector<uint8_t> jpeg(out, out + outSize);
+  jpeg_destroy_compress(&cinfo);
+  free(out);
+  return jpeg;
+}
+
+// Lees breedte/hoogte uit het SOF-segment van een JPEG
+void jpegDimensions(const std::vector<uint8_t>& jpeg, size_t* width, size_t* height) {
+  *width = 0;
+  *height = 0;
+  size_t i = 2;
+  while (i + 9 < jpeg.size()) {
+    if (jpeg[i] != 0xFF) { i++; continue; }
+    uint8_t marker = jpeg[i + 1];
+    size_t segLen = ((size_t)jpeg[i + 2] << 8) | jpeg[i + 3];
+    if (marker >= 0xC0 && marker <= 0xC3) {
+      *height = ((size_t)jpeg[i + 5] << 8) | jpeg[i + 6];
+      *width = ((size_t)jpeg[i + 7] << 8) | jpeg[i + 8];
+      return;
+    }
+    i += 2 + segLen;
+  }
+}
+
+void loadReplayFrames() {
+  replayFrames.clear();
+  replayIndex = 0;
+  if (sourceDir.empty()) return;
+  DIR* d = opendir(sourceDir.c_str());
+  if (!d) {
+    fprintf(stderr, "[host] Camera bronmap niet gevonden: %s\n", sourceDir.c_str());
+    return;
+  }
+  std::vector<std::string> names;
+  struct dirent* e;
+  while ((e = readdir(d)) != nullptr) {
+    std::string n = e->d_name;
+    if (n.size() > 4 && (n.substr(n.size() - 4) == ".jpg" || n.substr(n.size() - 4) == ".JPG")) {
+      names.push_back(n);
+    }
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  for (const std::string& n : names) {
+    FILE* f = fopen((sourceDir + "/" + n).c_str(), "rb");
+    if (!f) continue;
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + r);
+    fclose(f);
+    replayFrames.push_back(data);
+  }
+}
+
+int setFramesize(sensor_t* s, framesize_t framesize) {
+  if (framesize >= FRAMESIZE_INVALID) return -1;
+  s->status.framesize = framesize;
+  return 0;
+}
+
+int setQuality(sensor_t* s, int quality) {
+  s->status.quality = (uint8_t)quality;
+  return 0;
+}
+
+int setPixformat(sensor_t* s, pixformat_t pixformat) {
+  s->pixformat = pixformat;
+  return 0;
+}
+
+int setGainceiling(sensor_t* s, gainceiling_t gainceiling) {
+  s->status.gainceiling = (uint8_t)gainceiling;
+  return 0;
+}
+
+int setIgnored(sensor_t* s, int value) {
+  (void)s; (void)value;
+  return 0;
+}
+
+int getReg(sensor_t* s, int reg, int mask) {
+  (void)s; (void)reg; (void)mask;
+  return 0;
+}
+
+int setReg(sensor_t* s, int reg, int mask, int value) {
+  (void)s; (void)reg; (void)mask; (void)value;
+  return 0;
+}
+
+} // namespace
+
+void hostCameraSetSource(const std::string& jpegDir) {
+  std::lock_guard<std::mutex> guard(camLock);
+  sourceDir = jpegDir;
+  loadReplayFrames();
+}
+
+void hostCameraSetFrameTime(uint32_t ms) {
+  frameTimeMs = ms;
+}
+
+uint64_t hostCameraFramesCaptured() {
+  std::lock_guard<std::mutex> guard(camLock);
+  return framesCaptured;
+}
+
+esp_err_t esp_camera_init(const camera_config_t* config) {
+  std::lock_guard<std::mutex> guard(camLock);
+  memset(&sensor, 0, sizeof(sensor));
+  sensor.pixformat = config->pixel_format;
+  sensor.status.framesize = config->frame_size < FRAMESIZE_INVALID ? config->frame_size : FRAMESIZE_UXGA;
+  sensor.status.quality = (uint8_t)config->jpeg_quality;
+  sensor.set_pixformat = setPixformat;
+  sensor.set_framesize = setFramesize;
+  sensor.set_quality = setQuality;
+  sensor.set_gainceiling = setGainceiling;
+  sensor.set_contrast = setIgnored;
+  sensor.set_brightness = setIgnored;
+  sensor.set_saturation = setIgnored;
+  sensor.set_sharpness = setIgnored;
+  sensor.set_denoise = setIgnored;
+  sensor.set_colorbar = setIgnored;
+  sensor.set_whitebal = setIgnored;
+  sensor.set_gain_ctrl = setIgnored;
+  sensor.set_exposure_ctrl = setIgnored;
+  sensor.set_hmirror = setIgnored;
+  sensor.set_vflip = setIgnored;
+  sensor.set_aec2 = setIgnored;
+  sensor.set_awb_gain = setIgnored;
+  sensor.set_agc_gain = setIgnored;
+  sensor.set_aec_value = setIgnored;
+  sensor.set_special_effect = setIgnored;
+  sensor.set_wb_mode = setIgnored;
+  sensor.set_ae_level = setIgnored;
+  sensor.set_dcw = setIgnored;
+  sensor.set_bpc = setIgnored;
+  sensor.set_wpc = setIgnored;
+  sensor.set_raw_gma = setIgnored;
+  sensor.set_lenc = setIgnored;
+  sensor.get_reg = getReg;
+  sensor.set_reg = setReg;
+  fbCount = config->fb_count >= 1 && config->fb_count <= 3 ? config->fb_count : 1;
+  fbOutstanding = 0;
+  if (!sourceDir.empty() && replayFrames.empty()) loadReplayFrames();
+  initialized = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit() {
+  std::lock_guard<std::mutex> guard(camLock);
+  initialized = false;
+  return ESP_OK;
+}
+
+camera_fb_t* esp_camera_fb_get() {
+  std::vector<uint8_t> jpeg;
+  {
+    std::unique_lock<std::mutex> guard(camLock);
+    if (!initialized) return nullptr;
+
+    // Net als de driver: wachten tot er een framebuffer vrij is
+    double realTimeoutMs = FB_GET_TIMEOUT_MS / hostClockSpeed();
+    if (!camCond.wait_for(guard, std::chrono::duration<double, std::milli>(realTimeoutMs),
+                          [] { return fbOutstanding < fbCount; })) {
+      return nullptr;
+    }
+    fbOutstanding++;
+
+    if (!replayFrames.empty()) {
+      jpeg = replayFrames[replayIndex++ % replayFrames.size()];
+    } else {
+      int fs = sensor.status.framesize;
+      int quality = sensor.status.quality;
+      int index = (int)(framesCaptured % SYNTHETIC_CYCLE);
+      if (lastFrameMs == 0 || millis() - lastFrameMs > AEC_IDLE_MS) {
+        exposureOffset = AEC_START_OFFSET;
+      } else {
+        exposureOffset /= 2;
+      }
+      lastFrameMs = millis();
+      uint64_t key = ((uint64_t)fs << 40) | ((uint64_t)(exposureOffset + 128) << 32) |
+                     ((uint64_t)quality << 16) | (uint64_t)index;
+      auto it = syntheticCache.find(key);
+      if (it == syntheticCache.end()) {
+        it = syntheticCache.emplace(key, renderSynthetic(resolution[fs].width, resolution[fs].height,
+                                                         quality, index, exposureOffset)).first;
+      }
+      jpeg = it->second;
+    }
+    framesCaptured++;
+  }
+
+  if (frameTimeMs) delay(frameTimeMs);
+
+  camera_fb_t* fb = (camera_fb_t*)calloc(1, sizeof(camera_fb_t));
+  fb->buf = (uint8_t*)malloc(jpeg.size());
+  memcpy(fb->buf, jpeg.data(), jpeg.size());
+  fb->len = jpeg.size();
+  fb->format = PIXFORMAT_JPEG;
+  jpegDimensions(jpeg, &fb->width, &fb->height);
+  gettimeofday(&fb->timestamp, nullptr);
+  return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t* fb) {
+  if (!fb) return;
+  free(fb->buf);
+  free(fb);
+  std::lock_guard<std::mutex> guard(camLock);
+  if (fbOutstanding > 0) fbOutstanding--;
+  camCond.notify_all();
+}
+
+sensor_t* esp_camera_sensor_get() {
+  return initialized ? &sensor : nullptr;
+}
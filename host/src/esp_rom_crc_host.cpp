@@ -0,0 +1,29 @@
+// Software CRC-32 (polynoom 0xEDB88320) als vervanger van de ESP32 ROM-functie.
+
+#include "esp_rom_crc.h"
+
+namespace {
+
+struct CrcTable {
+  uint32_t entries[256];
+
+  CrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      entries[i] = c;
+    }
+  }
+};
+
+const CrcTable table;
+
+} // namespace
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc = table.entries[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
@@ -0,0 +1,285 @@
+// FreeRTOS taken, queues en semaforen op std::thread voor de host-simulatie.
+// Wachttijden in ticks worden via de simulatieklok omgerekend naar echte tijd.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "Arduino.h"
+#include "host_sim.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+  std::string name;
+  uint32_t stackDepth = 0;
+  std::mutex lock;
+  std::condition_variable cond;
+  uint32_t notifyCount = 0;
+};
+
+struct HostQueue {
+  std::mutex lock;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  std::deque<std::vector<uint8_t> > items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+struct HostSemaphore {
+  std::mutex lock;
+  std::condition_variable cond;
+  UBaseType_t count;
+  UBaseType_t maxCount;
+  std::thread::id owner;
+  UBaseType_t recursion = 0;
+};
+
+namespace {
+
+thread_local HostTask* currentTask = nullptr;
+
+// Wacht op een predicaat met een timeout in ticks (portMAX_DELAY = oneindig)
+template <typename Pred>
+bool waitTicks(std::condition_variable& cond, std::unique_lock<std::mutex>& guard, TickType_t ticks, Pred pred) {
+  if (ticks == portMAX_DELAY) {
+    cond.wait(guard, pred);
+    return true;
+  }
+  double realMs = ticks / hostClockSpeed();
+  return cond.wait_for(guard, std::chrono::duration<double, std::milli>(realMs), pred);
+}
+
+} // namespace
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority,
+                                   TaskHandle_t* pvCreatedTask, BaseType_t xCoreID) {
+  (void)uxPriority; (void)xCoreID;
+  HostTask* task = new HostTask();
+  task->name = pcName ? pcName : "";
+  task->stackDepth = usStackDepth;
+  if (pvCreatedTask) *pvCreatedTask = task;
+  std::thread([task, pvTaskCode, pvParameters] {
+    currentTask = task;
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+    pvTaskCode(pvParameters);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                       void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask) {
+  return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority,
+                                 pvCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTask) {
+  if (xTask == nullptr || xTask == currentTask) {
+    pthread_exit(nullptr);
+  }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  delay(xTicksToDelay);
+}
+
+void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement) {
+  TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(wake - now) > 0) delay(wake - now);
+  *pxPreviousWakeTime = wake;
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!currentTask) {
+    currentTask = new HostTask();
+    currentTask->name = "main";
+  }
+  return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) {
+  return xTask ? xTask->stackDepth : 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  if (!xTaskToNotify) return pdFAIL;
+  std::lock_guard<std::mutex> guard(xTaskToNotify->lock);
+  xTaskToNotify->notifyCount++;
+  xTaskToNotify->cond.notify_all();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  HostTask* task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  waitTicks(task->cond, guard, xTicksToWait, [task] { return task->notifyCount > 0; });
+  uint32_t count = task->notifyCount;
+  if (count > 0) task->notifyCount = xClearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+  HostQueue* q = new HostQueue();
+  q->length = uxQueueLength;
+  q->itemSize = uxItemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+  delete xQueue;
+}
+
+static BaseType_t queueSend(QueueHandle_t q, const void* item, TickType_t ticks, bool front) {
+  std::unique_lock<std::mutex> guard(q->lock);
+  if (!waitTicks(q->notFull, guard, ticks, [q] { return q->items.size() < q->length; })) {
+    return errQUEUE_FULL;
+  }
+  const uint8_t* p = (const uint8_t*)item;
+  std::vector<uint8_t> copy(p, p + q->itemSize);
+  if (front) q->items.push_front(std::move(copy));
+  else q->items.push_back(std::move(copy));
+  q->notEmpty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+  return queueSend(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+  return queueSend(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+  return queueSend(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void* pvItemToQueue) {
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  const uint8_t* p = (const uint8_t*)pvItemToQueue;
+  xQueue->items.clear();
+  xQueue->items.push_back(std::vector<uint8_t>(p, p + xQueue->itemSize));
+  xQueue->notEmpty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> guard(xQueue->lock);
+  if (!waitTicks(xQueue->notEmpty, guard, xTicksToWait, [xQueue] { return !xQueue->items.empty(); })) {
+    return errQUEUE_EMPTY;
+  }
+  memcpy(pvBuffer, xQueue->items.front().data(), xQueue->itemSize);
+  xQueue->items.pop_front();
+  xQueue->notFull.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> guard(xQueue->lock);
+  if (!waitTicks(xQueue->notEmpty, guard, xTicksToWait, [xQueue] { return !xQueue->items.empty(); })) {
+    return errQUEUE_EMPTY;
+  }
+  memcpy(pvBuffer, xQueue->items.front().data(), xQueue->itemSize);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  return (UBaseType_t)xQueue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  return xQueue->length - (UBaseType_t)xQueue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  xQueue->items.clear();
+  xQueue->notFull.notify_all();
+  return pdPASS;
+}
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount) {
+  HostSemaphore* s = new HostSemaphore();
+  s->maxCount = maxCount;
+  s->count = initialCount;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+  return createSemaphore(uxMaxCount, uxInitialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+  delete xSemaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> guard(s->lock);
+  if (!waitTicks(s->cond, guard, xTicksToWait, [s] { return s->count > 0; })) return pdFALSE;
+  s->count--;
+  s->owner = std::this_thread::get_id();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> guard(s->lock);
+  if (s->count >= s->maxCount) return pdFALSE;
+  s->count++;
+  s->cond.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> guard(s->lock);
+  if (s->recursion > 0 && s->owner == std::this_thread::get_id()) {
+    s->recursion++;
+    return pdTRUE;
+  }
+  if (!waitTicks(s->cond, guard, xTicksToWait, [s] { return s->count > 0; })) return pdFALSE;
+  s->count--;
+  s->owner = std::this_thread::get_id();
+  s->recursion = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> guard(s->lock);
+  if (s->recursion == 0 || s->owner != std::this_thread::get_id()) return pdFALSE;
+  if (--s->recursion == 0) {
+    s->count++;
+    s->cond.notify_one();
+  }
+  return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> guard(s->lock);
+  return s->count;
+}
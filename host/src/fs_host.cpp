@@ -0,0 +1,459 @@
+// SD_MMC shim: een map op de host doet dienst als SD-kaart.
+// Directory-volgorde is alfabetisch (FAT geeft aanmaakvolgorde, wat voor de
+// bestandsnamen van de firmware binnen één dag op hetzelfde neerkomt).
+
+#include "FS.h"
+#include "SD_MMC.h"
+#include "host_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <dirent.h>
+#include <errno.h>
+#include <mutex>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+fs::SDMMCFS SD_MMC;
+
+namespace {
+
+std::string sdRoot = "./sdcard";
+std::atomic<uint32_t> openLatencyUs(0);
+std::atomic<uint32_t> writeRateKBps(0);
+std::atomic<uint32_t> readRateKBps(0);
+std::atomic<uint32_t> readCallUs(0);
+std::atomic<uint64_t> capacityBytes(16ULL * 1024 * 1024 * 1024);
+std::atomic<uint64_t> usedBytesCounter(0);
+std::atomic<bool> singleBus(false);
+std::mutex busLock;
+
+std::atomic<uint64_t> cntOpens(0);
+std::atomic<uint64_t> cntDirOpens(0);
+std::atomic<uint64_t> cntDirEntries(0);
+std::atomic<uint64_t> cntBytesRead(0);
+std::atomic<uint64_t> cntBytesWritten(0);
+std::atomic<uint64_t> cntRemoves(0);
+std::atomic<uint64_t> cntCreated(0);
+std::atomic<uint64_t> cntSectorsWritten(0);
+std::atomic<uint64_t> cntClustersAllocated(0);
+std::atomic<uint64_t> cntModifiedCloses(0);
+
+// FAT32-indeling voor het kostenmodel: sectoren van 512 bytes, clusters van
+// 32 KB (standaard voor kaarten van 8-32 GB)
+const uint64_t SECTOR_SIZE = 512;
+const uint64_t CLUSTER_SIZE = 32768;
+
+// Ruimte die een bestand inneemt: hele clusters, zoals FatFs het gebruik telt
+uint64_t clusterBytes(uint64_t size) {
+  return (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE * CLUSTER_SIZE;
+}
+
+std::string hostPath(const char* path) {
+  return sdRoot + path;
+}
+
+bool validPath(const char* path) {
+  return path && path[0] == '/';
+}
+
+// Vertraging van de kaart; met singleBus wachten taken op elkaar, zoals op
+// het volume-slot van FatFs
+void cardDelay(uint32_t us) {
+  if (singleBus.load()) {
+    std::lock_guard<std::mutex> guard(busLock);
+    delayMicroseconds(us);
+  } else {
+    delayMicroseconds(us);
+  }
+}
+
+void simulateOpLatency() {
+  uint32_t us = openLatencyUs.load();
+  if (us) cardDelay(us);
+}
+
+void simulateTransfer(size_t bytes, uint32_t kbps) {
+  if (kbps && bytes) {
+    cardDelay((uint32_t)((uint64_t)bytes * 1000000ULL / ((uint64_t)kbps * 1024)));
+  }
+}
+
+uint64_t duTree(const std::string& dir) {
+  uint64_t total = 0;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  struct dirent* e;
+  while ((e = readdir(d)) != nullptr) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+    std::string child = dir + "/" + e->d_name;
+    struct stat st;
+    if (stat(child.c_str(), &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) total += duTree(child);
+    else total += clusterBytes(st.st_size);
+  }
+  closedir(d);
+  return total;
+}
+
+} // namespace
+
+namespace fs {
+
+class FileImpl {
+public:
+  std::string path;
+  std::string name;
+  FILE* fp = nullptr;
+  bool isDir = false;
+  bool writable = false;
+  bool modified = false;
+  bool append = false;
+  std::vector<std::string> entries;
+  size_t dirPos = 0;
+
+  ~FileImpl() { close(); }
+
+  void close() {
+    if (fp) {
+      if (modified) cntModifiedCloses++;
+      fclose(fp);
+      fp = nullptr;
+    }
+    isDir = false;
+    entries.clear();
+  }
+
+  bool valid() const { return fp != nullptr || isDir; }
+
+  void loadEntries() {
+    entries.clear();
+    dirPos = 0;
+    DIR* d = opendir(hostPath(path.c_str()).c_str());
+    if (!d) return;
+    struct dirent* e;
+    while ((e = readdir(d)) != nullptr) {
+      if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+      entries.push_back(e->d_name);
+    }
+    closedir(d);
+    std::sort(entries.begin(), entries.end());
+  }
+
+  std::string childPath(const std::string& child) const {
+    return path == "/" ? "/" + child : path + "/" + child;
+  }
+};
+
+static FileImplPtr openImpl(const char* path, const char* mode) {
+  if (!validPath(path)) return FileImplPtr();
+  std::string p(path);
+  while (p.size() > 1 && p.back() == '/') p.pop_back();
+
+  simulateOpLatency();
+  std::string hp = hostPath(p.c_str());
+  struct stat st;
+  bool exists = stat(hp.c_str(), &st) == 0;
+  bool readMode = mode[0] == 'r' && strchr(mode, '+') == nullptr;
+
+  FileImplPtr impl = std::make_shared<FileImpl>();
+  impl->path = p;
+  size_t slash = p.find_last_of('/');
+  impl->name = slash == std::string::npos ? p : p.substr(slash + 1);
+
+  if (exists && S_ISDIR(st.st_mode)) {
+    if (!readMode) return FileImplPtr();
+    cntDirOpens++;
+    impl->isDir = true;
+    impl->loadEntries();
+    return impl;
+  }
+  if (!exists && readMode) return FileImplPtr();
+
+  // Bij "w" wordt een bestaand bestand afgekapt: ruimte komt weer vrij
+  if (exists && mode[0] == 'w') {
+    usedBytesCounter -= std::min<uint64_t>(usedBytesCounter.load(), clusterBytes(st.st_size));
+  }
+
+  impl->fp = fopen(hp.c_str(), mode);
+  if (!impl->fp) return FileImplPtr();
+  impl->writable = !readMode;
+  impl->append = mode[0] == 'a';
+  if (!exists) cntCreated++;
+  cntOpens++;
+  return impl;
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!_p || !_p->fp || !_p->writable) return 0;
+  uint64_t oldSize = this->size();
+  uint64_t pos = _p->append ? oldSize : position();
+  uint64_t growth = pos + size > oldSize ? clusterBytes(pos + size) - clusterBytes(oldSize) : 0;
+  if (usedBytesCounter.load() + growth > capacityBytes.load()) {
+    return 0; // Kaart vol
+  }
+  simulateTransfer(size, writeRateKBps.load());
+  size_t n = fwrite(buf, 1, size, _p->fp);
+  if (n == 0) return 0;
+  _p->modified = true;
+  cntBytesWritten += n;
+
+  // Kostenmodel: aangeraakte sectoren en nieuw toegewezen clusters. Schrijven
+  // voorbij het einde (na seek) wijst de tussenliggende clusters ook toe.
+  uint64_t end = pos + n;
+  cntSectorsWritten += (end - 1) / SECTOR_SIZE - pos / SECTOR_SIZE + 1;
+  if (end > oldSize) {
+    cntClustersAllocated += (end + CLUSTER_SIZE - 1) / CLUSTER_SIZE - (oldSize + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    usedBytesCounter += clusterBytes(end) - clusterBytes(oldSize);
+  }
+  return n;
+}
+
+int File::available() {
+  if (!_p || !_p->fp) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!_p || !_p->fp) return -1;
+  int c = fgetc(_p->fp);
+  if (c != EOF) ungetc(c, _p->fp);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (_p && _p->fp) fflush(_p->fp);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!_p || !_p->fp) return 0;
+  size_t n = fread(buf, 1, size, _p->fp);
+  uint32_t callUs = readCallUs.load();
+  if (callUs) cardDelay(callUs);
+  simulateTransfer(n, readRateKBps.load());
+  cntBytesRead += n;
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!_p || !_p->fp) return false;
+  int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+  return fseek(_p->fp, pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!_p || !_p->fp) return 0;
+  long pos = ftell(_p->fp);
+  return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+  if (!_p || !_p->fp) return 0;
+  fflush(_p->fp);
+  struct stat st;
+  if (fstat(fileno(_p->fp), &st) != 0) return 0;
+  return (size_t)st.st_size;
+}
+
+void File::close() {
+  if (_p) {
+    _p->close();
+    _p = nullptr;
+  }
+}
+
+File::operator bool() const {
+  return _p && _p->valid();
+}
+
+time_t File::getLastWrite() {
+  if (!_p) return 0;
+  struct stat st;
+  if (stat(hostPath(_p->path.c_str()).c_str(), &st) != 0) return 0;
+  return st.st_mtime;
+}
+
+const char* File::path() const {
+  return _p ? _p->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+  return _p ? _p->name.c_str() : nullptr;
+}
+
+bool File::isDirectory(void) {
+  return _p && _p->isDir;
+}
+
+File File::openNextFile(const char* mode) {
+  if (!_p || !_p->isDir) return File();
+  while (_p->dirPos < _p->entries.size()) {
+    std::string child = _p->childPath(_p->entries[_p->dirPos++]);
+    cntDirEntries++;
+    FileImplPtr impl = openImpl(child.c_str(), mode);
+    if (impl) return File(impl);
+  }
+  return File();
+}
+
+String File::getNextFileName(void) {
+  bool isDir;
+  return getNextFileName(&isDir);
+}
+
+String File::getNextFileName(bool* isDir) {
+  *isDir = false;
+  if (!_p || !_p->isDir || _p->dirPos >= _p->entries.size()) return String();
+  std::string child = _p->childPath(_p->entries[_p->dirPos++]);
+  cntDirEntries++;
+  struct stat st;
+  if (stat(hostPath(child.c_str()).c_str(), &st) == 0) *isDir = S_ISDIR(st.st_mode);
+  return String(child.c_str());
+}
+
+void File::rewindDirectory(void) {
+  if (_p && _p->isDir) _p->loadEntries();
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+  (void)create;
+  if (!mounted_) return File();
+  return File(openImpl(path, mode));
+}
+
+bool FS::exists(const char* path) {
+  if (!mounted_ || !validPath(path)) return false;
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+  if (!mounted_ || !validPath(path)) return false;
+  simulateOpLatency();
+  std::string hp = hostPath(path);
+  struct stat st;
+  if (stat(hp.c_str(), &st) != 0 || S_ISDIR(st.st_mode)) return false;
+  if (unlink(hp.c_str()) != 0) return false;
+  usedBytesCounter -= std::min<uint64_t>(usedBytesCounter.load(), clusterBytes(st.st_size));
+  cntRemoves++;
+  return true;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  if (!mounted_ || !validPath(pathFrom) || !validPath(pathTo)) return false;
+  simulateOpLatency();
+  // FAT weigert te hernoemen naar een bestaande naam
+  if (exists(pathTo)) return false;
+  return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  if (!mounted_ || !validPath(path)) return false;
+  simulateOpLatency();
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+  if (!mounted_ || !validPath(path)) return false;
+  simulateOpLatency();
+  cntRemoves++;
+  return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool SDMMCFS::begin(const char* mountpoint, bool mode1bit, bool format_if_mount_failed,
+                    int sdmmc_frequency, uint8_t maxOpenFiles) {
+  (void)mountpoint; (void)mode1bit; (void)format_if_mount_failed;
+  (void)sdmmc_frequency; (void)maxOpenFiles;
+  if (::mkdir(sdRoot.c_str(), 0755) != 0 && errno != EEXIST) return false;
+  usedBytesCounter = duTree(sdRoot);
+  mounted_ = true;
+  return true;
+}
+
+void SDMMCFS::end() {
+  mounted_ = false;
+}
+
+sdcard_type_t SDMMCFS::cardType() {
+  return mounted_ ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDMMCFS::cardSize() {
+  return mounted_ ? capacityBytes.load() : 0;
+}
+
+uint64_t SDMMCFS::totalBytes() {
+  return mounted_ ? capacityBytes.load() : 0;
+}
+
+uint64_t SDMMCFS::usedBytes() {
+  return mounted_ ? usedBytesCounter.load() : 0;
+}
+
+} // namespace fs
+
+void hostSdSetRoot(const std::string& path) {
+  sdRoot = path;
+  while (sdRoot.size() > 1 && sdRoot.back() == '/') sdRoot.pop_back();
+}
+
+const std::string& hostSdRoot() {
+  return sdRoot;
+}
+
+void hostSdSetLatency(uint32_t openUs, uint32_t writeKBps, uint32_t readKBps) {
+  openLatencyUs = openUs;
+  writeRateKBps = writeKBps;
+  readRateKBps = readKBps;
+}
+
+void hostSdSetReadCallLatency(uint32_t us) {
+  readCallUs = us;
+}
+
+void hostSdSetCapacity(uint64_t bytes) {
+  capacityBytes = bytes;
+}
+
+void hostSdSetSingleBus(bool enabled) {
+  singleBus = enabled;
+}
+
+HostSdCounters hostSdCounters() {
+  HostSdCounters c;
+  c.opens = cntOpens.load();
+  c.dirOpens = cntDirOpens.load();
+  c.dirEntries = cntDirEntries.load();
+  c.bytesRead = cntBytesRead.load();
+  c.bytesWritten = cntBytesWritten.load();
+  c.removes = cntRemoves.load();
+  c.filesCreated = cntCreated.load();
+  c.sectorsWritten = cntSectorsWritten.load();
+  c.clustersAllocated = cntClustersAllocated.load();
+  c.modifiedCloses = cntModifiedCloses.load();
+  return c;
+}
+
+void hostSdResetCounters() {
+  cntOpens = 0;
+  cntDirOpens = 0;
+  cntDirEntries = 0;
+  cntBytesRead = 0;
+  cntBytesWritten = 0;
+  cntRemoves = 0;
+  cntCreated = 0;
+  cntSectorsWritten = 0;
+  cntClustersAllocated = 0;
+  cntModifiedCloses = 0;
+}
@@ -0,0 +1,125 @@
+// libjpeg-implementatie van jpg2rgb565() en fmt2jpg() voor de host-simulatie.
+// De verkleining gebruikt scale_denom van libjpeg, net als tjpgd op de ESP32
+// in het DCT-domein schaalt.
+
+#include "img_converters.h"
+
+#include <stdio.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+struct ErrorManager {
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+};
+
+void onError(j_common_ptr cinfo) {
+  longjmp(((ErrorManager*)cinfo->err)->jump, 1);
+}
+
+} // namespace
+
+bool jpg2rgb565(const uint8_t* src, size_t src_len, uint8_t* out, jpg_scale_t scale) {
+  if (!src || !out || src_len == 0) return false;
+
+  jpeg_decompress_struct cinfo;
+  ErrorManager jerr;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = onError;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, (unsigned char*)src, (unsigned long)src_len);
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = 1u << scale;
+  jpeg_start_decompress(&cinfo);
+
+  std::vector<uint8_t> row(cinfo.output_width * 3);
+  uint8_t* o = out;
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW rowPtr = row.data();
+    jpeg_read_scanlines(&cinfo, &rowPtr, 1);
+    for (size_t x = 0; x < cinfo.output_width; x++) {
+      uint8_t r = row[x * 3], g = row[x * 3 + 1], b = row[x * 3 + 2];
+      *o++ = (r & 0xF8) | (g >> 5);
+      *o++ = ((g << 3) & 0xE0) | (b >> 3);
+    }
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+bool fmt2jpg(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format,
+             uint8_t quality, uint8_t** out, size_t* out_len) {
+  if (!src || !out || !out_len || width == 0 || height == 0) return false;
+
+  int components = format == PIXFORMAT_GRAYSCALE ? 1 : 3;
+  size_t bpp = format == PIXFORMAT_RGB565 ? 2 : (size_t)components;
+  if (format != PIXFORMAT_RGB565 && format != PIXFORMAT_RGB888 && format != PIXFORMAT_GRAYSCALE) return false;
+  if (src_len < (size_t)width * height * bpp) return false;
+
+  jpeg_compress_struct cinfo;
+  ErrorManager jerr;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = onError;
+  unsigned char* mem = nullptr;
+  unsigned long memSize = 0;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    free(mem);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &mem, &memSize);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = components;
+  cinfo.in_color_space = components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality ? quality : 1, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+
+  std::vector<uint8_t> row((size_t)width * components);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t* in = src + (size_t)cinfo.next_scanline * width * bpp;
+    if (format == PIXFORMAT_RGB565) {
+      for (size_t x = 0; x < width; x++) {
+        uint8_t hi = in[x * 2], lo = in[x * 2 + 1];
+        row[x * 3] = hi & 0xF8;
+        row[x * 3 + 1] = (uint8_t)(((hi & 0x07) << 5) | ((lo & 0xE0) >> 3));
+        row[x * 3 + 2] = (uint8_t)((lo & 0x1F) << 3);
+      }
+    } else {
+      memcpy(row.data(), in, row.size());
+    }
+    JSAMPROW rowPtr = row.data();
+    jpeg_write_scanlines(&cinfo, &rowPtr, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  // Kopie via malloc() zodat de aanroeper free() kan gebruiken, zoals op de ESP32
+  *out = (uint8_t*)malloc(memSize);
+  if (!*out) {
+    free(mem);
+    return false;
+  }
+  memcpy(*out, mem, memSize);
+  *out_len = memSize;
+  free(mem);
+  return true;
+}
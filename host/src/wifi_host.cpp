@@ -0,0 +1,249 @@
+// Loopback implementatie van WiFi, WiFiServer en WiFiClient.
+// De client heeft net als de ESP32 core een kleine ontvangstbuffer, zodat
+// byte-voor-byte lezen niet per byte een systeemaanroep kost.
+
+#include "WiFi.h"
+#include "host_sim.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+namespace {
+int portOverride = -1;
+int boundPort = 0;
+const size_t RX_BUFFER_SIZE = 1436;   // Eén TCP-segment, zoals in de ESP32 core
+const int WRITE_TIMEOUT_MS = 10000;
+const int TCP_SEND_BUFFER = 5744;   // TCP_SND_BUF van lwIP in de Arduino-core
+}
+
+void hostWiFiSetPort(int port) {
+  portOverride = port;
+}
+
+int hostWiFiBoundPort() {
+  return boundPort;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr_[0], addr_[1], addr_[2], addr_[3]);
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+  return p.print(toString());
+}
+
+class WiFiClientSocketHandle {
+public:
+  explicit WiFiClientSocketHandle(int fd) : fd(fd) {}
+  ~WiFiClientSocketHandle() { close(); }
+
+  void close() {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  // Vul de ontvangstbuffer zonder te blokkeren; geeft false bij verbroken verbinding
+  bool fill() {
+    if (fd < 0) return false;
+    if (rxPos < rxLen) return true;
+    ssize_t n = recv(fd, rx, sizeof(rx), MSG_DONTWAIT);
+    if (n > 0) {
+      rxPos = 0;
+      rxLen = (size_t)n;
+      return true;
+    }
+    if (n == 0) return false;
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+
+  int fd;
+  uint8_t rx[RX_BUFFER_SIZE];
+  size_t rxPos = 0;
+  size_t rxLen = 0;
+};
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(int fd) : handle_(std::make_shared<WiFiClientSocketHandle>(fd)), connected_(true) {}
+
+int WiFiClient::fd() const {
+  return handle_ ? handle_->fd : -1;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+  if (!connected_ || !handle_ || handle_->fd < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(handle_->fd, buf + sent, size - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      sent += (size_t)n;
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      struct pollfd pfd = {handle_->fd, POLLOUT, 0};
+      if (poll(&pfd, 1, WRITE_TIMEOUT_MS) <= 0) {
+        stop();
+        break;
+      }
+      continue;
+    }
+    stop();
+    break;
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (!handle_ || handle_->fd < 0) return 0;
+  size_t buffered = handle_->rxLen - handle_->rxPos;
+  int pending = 0;
+  if (ioctl(handle_->fd, FIONREAD, &pending) != 0) pending = 0;
+  return (int)buffered + pending;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  if (!handle_ || handle_->fd < 0) return -1;
+  size_t total = 0;
+  while (total < size) {
+    if (handle_->rxPos >= handle_->rxLen) {
+      if (!handle_->fill() || handle_->rxPos >= handle_->rxLen) break;
+    }
+    size_t chunk = std::min(size - total, handle_->rxLen - handle_->rxPos);
+    memcpy(buf + total, handle_->rx + handle_->rxPos, chunk);
+    handle_->rxPos += chunk;
+    total += chunk;
+  }
+  return total > 0 ? (int)total : -1;
+}
+
+int WiFiClient::peek() {
+  if (!handle_ || !handle_->fill() || handle_->rxPos >= handle_->rxLen) return -1;
+  return handle_->rx[handle_->rxPos];
+}
+
+void WiFiClient::stop() {
+  if (handle_) handle_->close();
+  connected_ = false;
+}
+
+uint8_t WiFiClient::connected() {
+  if (!connected_ || !handle_ || handle_->fd < 0) return 0;
+  if (handle_->rxPos < handle_->rxLen) return 1;
+  uint8_t dummy;
+  ssize_t res = recv(handle_->fd, &dummy, 1, MSG_DONTWAIT | MSG_PEEK);
+  if (res == 0) {
+    connected_ = false;
+  } else if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    connected_ = false;
+  }
+  return connected_ ? 1 : 0;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+  if (!handle_ || handle_->fd < 0) return -1;
+  int flag = nodelay ? 1 : 0;
+  return setsockopt(handle_->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+IPAddress WiFiClient::remoteIP() const {
+  return IPAddress(127, 0, 0, 1);
+}
+
+uint16_t WiFiClient::remotePort() const {
+  if (!handle_ || handle_->fd < 0) return 0;
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (getpeername(handle_->fd, (struct sockaddr*)&addr, &len) != 0) return 0;
+  return ntohs(addr.sin_port);
+}
+
+void WiFiServer::begin(uint16_t port) {
+  if (port) port_ = port;
+  int listenPort = portOverride >= 0 ? portOverride : (port_ < 1024 ? port_ + 8000 : port_);
+
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) return;
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((uint16_t)listenPort);
+  if (bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd_, 16) != 0) {
+    fprintf(stderr, "[host] WiFiServer kan niet luisteren op poort %d: %s\n", listenPort, strerror(errno));
+    ::close(listenFd_);
+    listenFd_ = -1;
+    return;
+  }
+  fcntl(listenFd_, F_SETFL, fcntl(listenFd_, F_GETFL) | O_NONBLOCK);
+
+  socklen_t len = sizeof(addr);
+  getsockname(listenFd_, (struct sockaddr*)&addr, &len);
+  boundPort = ntohs(addr.sin_port);
+}
+
+void WiFiServer::end() {
+  if (listenFd_ >= 0) {
+    ::close(listenFd_);
+    listenFd_ = -1;
+  }
+}
+
+WiFiClient WiFiServer::available() {
+  if (listenFd_ < 0) return WiFiClient();
+  int fd = ::accept(listenFd_, nullptr, nullptr);
+  if (fd < 0) return WiFiClient();
+  // Zendbuffer zo klein als bij lwIP (TCP_SND_BUF), zodat write() net als op
+  // de ESP32 pas terugkeert als de client het meeste heeft ontvangen
+  int sendBuffer = TCP_SEND_BUFFER;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+  if (noDelay_) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return WiFiClient(fd);
+}
+
+bool WiFiServer::hasClient() {
+  if (listenFd_ < 0) return false;
+  struct pollfd pfd = {listenFd_, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+  (void)ssid; (void)passphrase;
+  return WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  return WL_CONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+  return IPAddress(127, 0, 0, 1);
+}
@@ -0,0 +1,663 @@
+// Controles voor de host-simulatie (ctest).
+// Anders dan de benchmark meet dit niets, maar vergelijkt de uitvoer van de
+// parsers en schrijvers met vooraf berekende waarden: Range-headers, de
+// incrementele HTTP-parser, de ZIP-export (offsets in de centrale map, CRC's),
+// de dagvideo (idx1), de helderheid uit de JPEG-DC-coëfficiënten en het
+// herstel via het journaal. Elke mislukte controle wordt met bestand en regel
+// gemeld; de exitcode is het aantal mislukte controles (0 = alles goed).
+
+#include <Arduino.h>
+#include "host_sim.h"
+#include "config.h"
+#include "camera.h"
+#include "http_parser.h"
+#include "web_utils.h"
+#include "zip_archive.h"
+#include "avi_writer.h"
+#include "luminance.h"
+#include "photo_index.h"
+#include "photo_journal.h"
+#include "photo_store.h"
+
+#include <jpeglib.h>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+int checks = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) checkEqual((long long)(a), (long long)(b), #a, #b, __FILE__, __LINE__)
+
+void check(bool ok, const char* expression, const char* file, int line) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("MISLUKT %s:%d: %s\n", file, line, expression);
+  }
+}
+
+void checkEqual(long long a, long long b, const char* left, const char* right, const char* file, int line) {
+  checks++;
+  if (a != b) {
+    failures++;
+    printf("MISLUKT %s:%d: %s == %s (%lld != %lld)\n", file, line, left, right, a, b);
+  }
+}
+
+uint16_t get16(const std::string& s, size_t p) {
+  return (uint8_t)s[p] | ((uint8_t)s[p + 1] << 8);
+}
+
+uint32_t get32(const std::string& s, size_t p) {
+  return (uint32_t)get16(s, p) | ((uint32_t)get16(s, p + 2) << 16);
+}
+
+// CRC-32 (IEEE) bit voor bit, los van esp_rom_crc32_le
+uint32_t referenceCrc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// JPEG van een grijswaardenbeeld (als YCbCr gecodeerd, zoals de camera)
+std::vector<uint8_t> encodeJpeg(int width, int height, std::function<uint8_t(int, int)> pixel,
+                                int restartInterval = 0, bool progressive = false) {
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char* out = nullptr;
+  unsigned long outSize = 0;
+  jpeg_mem_dest(&cinfo, &out, &outSize);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  cinfo.restart_interval = restartInterval;
+  if (progressive) jpeg_simple_progression(&cinfo);
+  jpeg_start_compress(&cinfo, TRUE);
+  std::vector<uint8_t> row(width * 3);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    for (int x = 0; x < width; x++) {
+      row[x * 3] = row[x * 3 + 1] = row[x * 3 + 2] = pixel(x, cinfo.next_scanline);
+    }
+    JSAMPROW rows[1] = { row.data() };
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  std::vector<uint8_t> jpeg(out, out + outSize);
+  jpeg_destroy_compress(&cinfo);
+  free(out);
+  return jpeg;
+}
+
+// Gemiddelde helderheid na volledig decoderen, ter vergelijking
+double decodedMean(const std::vector<uint8_t>& jpeg) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_GRAYSCALE;
+  jpeg_start_decompress(&cinfo);
+  std::vector<uint8_t> row(cinfo.output_width);
+  double sum = 0;
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW rows[1] = { row.data() };
+    jpeg_read_scanlines(&cinfo, rows, 1);
+    for (uint8_t v : row) sum += v;
+  }
+  double mean = sum / ((double)cinfo.output_width * cinfo.output_height);
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return mean;
+}
+
+HttpRequest makeRequest(const char* range = nullptr, const char* ifRange = nullptr) {
+  HttpRequest request = {};
+  request.method = "GET";
+  request.target = "/";
+  request.pathLength = 1;
+  request.versionMinor = 1;
+  request.keepAliveRequested = false;
+  request.range = range;
+  request.ifRange = ifRange;
+  return request;
+}
+
+// Een antwoord van een handler: statusregel, headers en body
+struct Response {
+  int status = 0;
+  std::string headers;
+  std::string body;
+
+  std::string header(const std::string& name) const {
+    size_t p = headers.find("\r\n" + name + ": ");
+    if (p == std::string::npos) return "";
+    p += name.size() + 4;
+    return headers.substr(p, headers.find("\r\n", p) - p);
+  }
+};
+
+// Laat een handler naar een socketpaar schrijven en lees het antwoord terug
+Response runHandler(std::function<void(WiFiClient&)> handler) {
+  int fds[2];
+  Response response;
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return response;
+  std::string raw;
+  std::thread reader([&] {
+    char buf[8192];
+    ssize_t n;
+    while ((n = read(fds[1], buf, sizeof(buf))) > 0) raw.append(buf, (size_t)n);
+  });
+  {
+    WiFiClient client(fds[0]);
+    handler(client);
+    client.stop();
+  }
+  reader.join();
+  close(fds[1]);
+
+  size_t end = raw.find("\r\n\r\n");
+  if (raw.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos) return response;
+  response.status = atoi(raw.c_str() + 9);
+  response.headers = raw.substr(0, end + 2);
+  response.body = raw.substr(end + 4);
+  return response;
+}
+
+std::string readCardFile(const String& path) {
+  File file = SD_MMC.open(path, FILE_READ);
+  std::string data;
+  if (!file) return data;
+  data.resize(file.size());
+  file.read((uint8_t*)&data[0], data.size());
+  file.close();
+  return data;
+}
+
+// --- Range-header -----------------------------------------------------------
+
+void testRange() {
+  struct Case {
+    const char* range;
+    size_t total;
+    RangeResult result;
+    size_t start;
+    size_t length;
+  } cases[] = {
+    { nullptr,           1000, RANGE_NONE,          0,   0 },
+    { "bytes=0-99",      1000, RANGE_OK,            0,   100 },
+    { "bytes=900-",      1000, RANGE_OK,            900, 100 },
+    { "bytes=990-5000",  1000, RANGE_OK,            990, 10 },     // Einde voorbij het bestand: afkappen
+    { "bytes=999-999",   1000, RANGE_OK,            999, 1 },
+    { "bytes=-100",      1000, RANGE_OK,            900, 100 },
+    { "bytes=-5000",     1000, RANGE_OK,            0,   1000 },
+    { "bytes=-0",        1000, RANGE_UNSATISFIABLE, 0,   0 },
+    { "bytes=1000-",     1000, RANGE_UNSATISFIABLE, 0,   0 },      // Begint na het laatste byte
+    { "bytes=5000-6000", 1000, RANGE_UNSATISFIABLE, 0,   0 },
+    { "bytes=0-",        0,    RANGE_UNSATISFIABLE, 0,   0 },
+    { "bytes=-1",        0,    RANGE_UNSATISFIABLE, 0,   0 },
+    { "bytes=0-0,5-9",   1000, RANGE_NONE,          0,   0 },      // Meerdere bereiken: hele bestand
+    { "bytes=9-1",       1000, RANGE_NONE,          0,   0 },
+    { "bytes=abc",       1000, RANGE_NONE,          0,   0 },
+    { "bytes=-",         1000, RANGE_NONE,          0,   0 },
+    { "bytes=5-x",       1000, RANGE_NONE,          0,   0 },
+    { "items=0-9",       1000, RANGE_NONE,          0,   0 },
+  };
+  for (const Case& c : cases) {
+    HttpRequest request = makeRequest(c.range);
+    size_t start = 12345, length = 67890;
+    RangeResult result = parseRangeHeader(request, c.total, "\"e1\"", "Tue, 01 Jan 2030 00:00:00 GMT", start, length);
+    if (result != c.result) printf("  Range '%s' van %zu bytes\n", c.range ? c.range : "(geen)", c.total);
+    CHECK_EQ(result, c.result);
+    if (result == RANGE_OK && c.result == RANGE_OK) {
+      CHECK_EQ(start, c.start);
+      CHECK_EQ(length, c.length);
+    }
+  }
+
+  // If-Range: alleen een bereik als ETag of datum nog klopt
+  size_t start, length;
+  HttpRequest request = makeRequest("bytes=10-19", "\"e1\"");
+  CHECK_EQ(parseRangeHeader(request, 1000, "\"e1\"", "", start, length), RANGE_OK);
+  request = makeRequest("bytes=10-19", "\"oud\"");
+  CHECK_EQ(parseRangeHeader(request, 1000, "\"e1\"", "", start, length), RANGE_NONE);
+  request = makeRequest("bytes=10-19", "Tue, 01 Jan 2030 00:00:00 GMT");
+  CHECK_EQ(parseRangeHeader(request, 1000, "\"e1\"", "Tue, 01 Jan 2030 00:00:00 GMT", start, length), RANGE_OK);
+}
+
+// --- Incrementele HTTP-parser -----------------------------------------------
+
+// Schrijf de delen met een pauze ertussen, zodat de parser ze los ontvangt
+struct ParserPeer {
+  int fds[2];
+  HttpConnection* connection;
+
+  ParserPeer() {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    connection = new HttpConnection();
+    WiFiClient client(fds[0]);
+    beginHttpConnection(*connection, client);
+  }
+  ~ParserPeer() {
+    connection->client.stop();
+    delete connection;
+    if (fds[1] >= 0) close(fds[1]);
+  }
+  void send(const std::vector<std::string>& parts) {
+    for (const std::string& part : parts) {
+      ::write(fds[1], part.data(), part.size());
+      usleep(5000);
+    }
+  }
+  void closePeer() {
+    close(fds[1]);
+    fds[1] = -1;
+  }
+};
+
+void testHttpParser() {
+  HttpRequest request;
+
+  // Verzoek in stukken, ook midden in het einde van de headers
+  {
+    ParserPeer peer;
+    std::thread writer([&] {
+      peer.send({ "GET /view/a.jpg?x=1 HT", "TP/1.1\r\nHost: cam\r\nRange:  bytes=0-9 \r\nIf-Range: \"e1\"\r\n\r",
+                  "\n" });
+    });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    writer.join();
+    CHECK(strcmp(request.method, "GET") == 0);
+    CHECK(strcmp(request.target, "/view/a.jpg?x=1") == 0);
+    CHECK_EQ(request.pathLength, strlen("/view/a.jpg"));
+    CHECK(requestPathEquals(request, "/view/a.jpg"));
+    CHECK(requestPathStartsWith(request, "/view/"));
+    CHECK(!requestPathEquals(request, "/view"));
+    CHECK(request.range && strcmp(request.range, "bytes=0-9") == 0);
+    CHECK(request.ifRange && strcmp(request.ifRange, "\"e1\"") == 0);
+    CHECK(request.keepAliveRequested);
+    CHECK_EQ(request.versionMinor, 1);
+  }
+
+  // Twee gepipelinede verzoeken in één blok, het eerste met een body
+  {
+    ParserPeer peer;
+    peer.send({ "POST /savesettings HTTP/1.1\r\nContent-Length: 7\r\n\r\na=1&b=2"
+                "GET /next HTTP/1.0\r\nConnection: keep-alive\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    CHECK(strcmp(request.method, "POST") == 0);
+    CHECK(request.body == "a=1&b=2");
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    CHECK(requestPathEquals(request, "/next"));
+    CHECK_EQ(request.versionMinor, 0);
+    CHECK(request.keepAliveRequested);
+    CHECK(request.range == NULL);
+    CHECK(request.body == "");
+  }
+
+  // Body die later binnenkomt dan de headers
+  {
+    ParserPeer peer;
+    std::thread writer([&] { peer.send({ "POST /x HTTP/1.1\r\nContent-Length: 5\r\n\r\nab", "cde" }); });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    writer.join();
+    CHECK(request.body == "abcde");
+  }
+
+  // HTTP/1.1 met Connection: close, HTTP/1.0 zonder keep-alive
+  {
+    ParserPeer peer;
+    peer.send({ "GET / HTTP/1.1\r\nConnection: close\r\n\r\nGET / HTTP/1.0\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    CHECK(!request.keepAliveRequested);
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_OK);
+    CHECK(!request.keepAliveRequested);
+  }
+
+  // Grenzen en fouten
+  {
+    ParserPeer peer;
+    peer.send({ "GET / HTTP/1.1\r\nX-Pad: " + std::string(HTTP_BUFFER_SIZE, 'a') + "\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_TOO_LARGE);
+  }
+  {
+    ParserPeer peer;
+    peer.send({ "POST / HTTP/1.1\r\nContent-Length: " + std::to_string(HTTP_MAX_BODY + 1) + "\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_BODY_TOO_LARGE);
+  }
+  {
+    ParserPeer peer;
+    peer.send({ "GET noslash HTTP/1.1\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_BAD_REQUEST);
+  }
+  {
+    ParserPeer peer;
+    peer.send({ "GET / HTTP/1.1\r\nGeenDubbelePunt\r\n\r\n" });
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_BAD_REQUEST);
+  }
+  {
+    ParserPeer peer;
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 20), HTTP_READ_IDLE);
+    peer.closePeer();
+    CHECK_EQ(readHttpRequest(*peer.connection, request, 2000), HTTP_READ_CLOSED);
+  }
+}
+
+// --- ZIP-export ---------------------------------------------------------------
+
+void testZipArchive(const char* day, const std::vector<std::string>& names,
+                    const std::vector<std::vector<uint8_t> >& photos) {
+  HttpRequest request = makeRequest();
+  Response full = runHandler([&](WiFiClient& client) { sendDayArchive(client, request, day, day); });
+  CHECK_EQ(full.status, 200);
+  CHECK_EQ(atol(full.header("Content-Length").c_str()), full.body.size());
+  const std::string& zip = full.body;
+
+  // Verwachte indeling: per foto lokale header + naam + data + descriptor
+  size_t nameLength = strlen(day) + 1 + names[0].size();
+  std::vector<size_t> localOffsets;
+  size_t offset = 0;
+  for (size_t i = 0; i < photos.size(); i++) {
+    localOffsets.push_back(offset);
+    offset += 30 + nameLength + photos[i].size() + 16;
+  }
+  size_t centralOffset = offset;
+  size_t centralSize = photos.size() * (46 + nameLength);
+  CHECK_EQ(zip.size(), centralOffset + centralSize + 22);
+  if (zip.size() != centralOffset + centralSize + 22) return;
+
+  // Einde van het archief
+  size_t end = zip.size() - 22;
+  CHECK_EQ(get32(zip, end), 0x06054b50);
+  CHECK_EQ(get16(zip, end + 8), photos.size());
+  CHECK_EQ(get16(zip, end + 10), photos.size());
+  CHECK_EQ(get32(zip, end + 12), centralSize);
+  CHECK_EQ(get32(zip, end + 16), centralOffset);
+
+  size_t central = centralOffset;
+  for (size_t i = 0; i < photos.size(); i++) {
+    std::string name = std::string(day) + "/" + names[i];
+    uint32_t crc = referenceCrc32(photos[i].data(), photos[i].size());
+    size_t local = localOffsets[i];
+
+    // Lokale header, data en data descriptor
+    CHECK_EQ(get32(zip, local), 0x04034b50);
+    CHECK_EQ(get16(zip, local + 6), 0x0008);
+    CHECK_EQ(get16(zip, local + 8), 0);
+    CHECK_EQ(get16(zip, local + 26), name.size());
+    CHECK(zip.compare(local + 30, name.size(), name) == 0);
+    size_t data = local + 30 + name.size();
+    CHECK(zip.compare(data, photos[i].size(), std::string(photos[i].begin(), photos[i].end())) == 0);
+    size_t descriptor = data + photos[i].size();
+    CHECK_EQ(get32(zip, descriptor), 0x08074b50);
+    CHECK_EQ(get32(zip, descriptor + 4), crc);
+    CHECK_EQ(get32(zip, descriptor + 8), photos[i].size());
+    CHECK_EQ(get32(zip, descriptor + 12), photos[i].size());
+
+    // Centrale map
+    CHECK_EQ(get32(zip, central), 0x02014b50);
+    CHECK_EQ(get32(zip, central + 16), crc);
+    CHECK_EQ(get32(zip, central + 20), photos[i].size());
+    CHECK_EQ(get32(zip, central + 24), photos[i].size());
+    CHECK_EQ(get16(zip, central + 28), name.size());
+    CHECK_EQ(get32(zip, central + 42), local);
+    CHECK(zip.compare(central + 46, name.size(), name) == 0);
+    central += 46 + name.size();
+  }
+
+  // Hervatten midden in de tweede foto en midden in de centrale map
+  size_t resumes[] = { localOffsets[1] + 40, centralOffset + 3, zip.size() - 1 };
+  for (size_t from : resumes) {
+    std::string range = "bytes=" + std::to_string(from) + "-";
+    HttpRequest ranged = makeRequest(range.c_str());
+    Response part = runHandler([&](WiFiClient& client) { sendDayArchive(client, ranged, day, day); });
+    CHECK_EQ(part.status, 206);
+    CHECK(part.body == zip.substr(from));
+    CHECK(part.header("Content-Range") ==
+          "bytes " + std::to_string(from) + "-" + std::to_string(zip.size() - 1) + "/" + std::to_string(zip.size()));
+  }
+
+  // Andere ETag bij If-Range: hele archief; voorbij het einde: 416
+  HttpRequest stale = makeRequest("bytes=10-", "\"zip-oud\"");
+  CHECK_EQ(runHandler([&](WiFiClient& client) { sendDayArchive(client, stale, day, day); }).status, 200);
+  std::string past = "bytes=" + std::to_string(zip.size()) + "-";
+  HttpRequest beyond = makeRequest(past.c_str());
+  Response unsatisfiable = runHandler([&](WiFiClient& client) { sendDayArchive(client, beyond, day, day); });
+  CHECK_EQ(unsatisfiable.status, 416);
+  CHECK(unsatisfiable.header("Content-Range") == "bytes */" + std::to_string(zip.size()));
+}
+
+// --- Dagvideo ------------------------------------------------------------------
+
+void testAviWriter() {
+  const char* day = "02-01-2030";
+  SD_MMC.mkdir("/timelapse/" + String(day));
+
+  // Frames van verschillende lengte, ook een oneven (opvulbyte in de AVI)
+  std::vector<std::vector<uint8_t> > frames;
+  for (int i = 0; i < 3; i++) {
+    frames.push_back(encodeJpeg(64 + 16 * i, 48, [i](int x, int y) { return (uint8_t)(x * 3 + y + i * 40); }));
+  }
+  if (frames[1].size() % 2 == 0) frames[1].push_back(0);
+  if (frames[2].size() % 2 == 1) frames[2].push_back(0);
+  for (const std::vector<uint8_t>& frame : frames) {
+    CHECK(aviAppendFrame(day, frame.data(), frame.size()));
+  }
+
+  HttpRequest request = makeRequest();
+  Response open = runHandler([&](WiFiClient& client) { sendDayVideo(client, request, day, 10); });
+  CHECK_EQ(open.status, 200);
+  const std::string& avi = open.body;
+  if (avi.size() < 224) {
+    CHECK(avi.size() >= 224);
+    return;
+  }
+
+  uint32_t moviSize = 4;
+  for (const std::vector<uint8_t>& frame : frames) moviSize += 8 + frame.size() + (frame.size() & 1);
+  CHECK(avi.compare(0, 4, "RIFF") == 0);
+  CHECK_EQ(get32(avi, 4), avi.size() - 8);
+  CHECK(avi.compare(8, 4, "AVI ") == 0);
+  CHECK_EQ(get32(avi, 32), 100000);                // Microseconden per frame bij 10 fps
+  CHECK_EQ(get32(avi, 44), 0x10);                  // AVIF_HASINDEX
+  CHECK_EQ(get32(avi, 48), frames.size());
+  CHECK_EQ(get32(avi, 64), 64);                    // Breedte van het eerste frame
+  CHECK_EQ(get32(avi, 68), 48);
+  CHECK_EQ(get32(avi, 132), 10);
+  CHECK_EQ(get32(avi, 140), frames.size());
+  CHECK(avi.compare(212, 4, "LIST") == 0);
+  CHECK_EQ(get32(avi, 216), moviSize);
+  CHECK(avi.compare(220, 4, "movi") == 0);
+
+  // idx1 direct achter de frames, offsets relatief aan 'movi'
+  size_t idx1 = 220 + moviSize;
+  CHECK_EQ(avi.size(), idx1 + 8 + frames.size() * 16);
+  if (avi.size() != idx1 + 8 + frames.size() * 16) return;
+  CHECK(avi.compare(idx1, 4, "idx1") == 0);
+  CHECK_EQ(get32(avi, idx1 + 4), frames.size() * 16);
+  size_t expectedChunk = 224;
+  for (size_t i = 0; i < frames.size(); i++) {
+    size_t entry = idx1 + 8 + i * 16;
+    CHECK(avi.compare(entry, 4, "00dc") == 0);
+    CHECK_EQ(get32(avi, entry + 4), 0x10);         // AVIIF_KEYFRAME
+    CHECK_EQ(get32(avi, entry + 8) + 220, expectedChunk);
+    CHECK_EQ(get32(avi, entry + 12), frames[i].size());
+    size_t chunk = 220 + get32(avi, entry + 8);
+    CHECK(avi.compare(chunk, 4, "00dc") == 0);
+    CHECK_EQ(get32(avi, chunk + 4), frames[i].size());
+    CHECK(avi.compare(chunk + 8, frames[i].size(), std::string(frames[i].begin(), frames[i].end())) == 0);
+    expectedChunk += 8 + frames[i].size() + (frames[i].size() & 1);
+  }
+
+  // Na het afsluiten staat idx1 in het bestand zelf; de download is gelijk
+  CHECK(aviFinalizeDay(day));
+  std::string stored = readCardFile("/timelapse/" + String(day) + "/" + AVI_FILE);
+  CHECK(stored.size() == avi.size() && stored.compare(220, std::string::npos, avi, 220, std::string::npos) == 0);
+  Response finalized = runHandler([&](WiFiClient& client) { sendDayVideo(client, request, day, 10); });
+  CHECK(finalized.body == avi);
+
+  // Andere afspeelsnelheid: alleen de header verandert
+  Response fast = runHandler([&](WiFiClient& client) { sendDayVideo(client, request, day, 25); });
+  CHECK_EQ(get32(fast.body, 32), 40000);
+  CHECK(fast.body.compare(224, std::string::npos, avi, 224, std::string::npos) == 0);
+}
+
+// --- Helderheid uit de DC-coëfficiënten ---------------------------------------
+
+void testLuminance() {
+  LuminanceStats stats;
+
+  // Egaal grijs: één band, geen spreiding, dus "afgedekt"
+  std::vector<uint8_t> gray = encodeJpeg(64, 64, [](int, int) { return (uint8_t)128; });
+  CHECK(jpegLuminance(gray.data(), gray.size(), stats));
+  CHECK(abs(stats.mean - 128) <= 1);
+  CHECK_EQ(stats.stdDev, 0);
+  CHECK_EQ(stats.bins[8], 1000);
+  CHECK_EQ(stats.flags, LUMA_FLAG_BLOCKED);
+  CHECK_EQ(stats.valid, 1);
+
+  std::vector<uint8_t> dark = encodeJpeg(64, 64, [](int, int) { return (uint8_t)20; });
+  CHECK(jpegLuminance(dark.data(), dark.size(), stats));
+  CHECK(abs(stats.mean - 20) <= 1);
+  CHECK_EQ(stats.bins[1], 1000);
+  CHECK_EQ(stats.flags, LUMA_FLAG_DARK | LUMA_FLAG_BLOCKED);
+
+  // Links zwart, rechts wit op een grens van 16 pixels (MCU): twee banden
+  std::vector<uint8_t> split = encodeJpeg(64, 64, [](int x, int) { return (uint8_t)(x < 32 ? 0 : 255); });
+  CHECK(jpegLuminance(split.data(), split.size(), stats));
+  CHECK(abs(stats.mean - 127) <= 2);
+  CHECK_EQ(stats.bins[0], 500);
+  CHECK_EQ(stats.bins[15], 500);
+  CHECK(abs(stats.stdDev - 127) <= 2);
+  CHECK_EQ(stats.flags, LUMA_FLAG_OVEREXPOSED);
+
+  // Verloop, met en zonder restart-markeringen: gelijk aan volledig decoderen
+  auto gradient = [](int x, int y) { return (uint8_t)((x * 2 + y) % 256); };
+  std::vector<uint8_t> plain = encodeJpeg(320, 240, gradient);
+  std::vector<uint8_t> restarts = encodeJpeg(320, 240, gradient, 3);
+  LuminanceStats restartStats;
+  CHECK(jpegLuminance(plain.data(), plain.size(), stats));
+  CHECK(jpegLuminance(restarts.data(), restarts.size(), restartStats));
+  CHECK(fabs(stats.mean - decodedMean(plain)) <= 1.5);
+  CHECK_EQ(restartStats.mean, stats.mean);
+  CHECK_EQ(restartStats.stdDev, stats.stdDev);
+  CHECK(memcmp(restartStats.bins, stats.bins, sizeof(stats.bins)) == 0);
+
+  // Raster (twee blokken per vak): linkerhelft donker, rechterhelft licht
+  std::vector<uint8_t> wide = encodeJpeg(256, 192, [](int x, int) { return (uint8_t)(x < 128 ? 0 : 255); });
+  uint8_t grid[LUMA_GRID_CELLS];
+  CHECK(jpegLuminanceGrid(wide.data(), wide.size(), grid));
+  CHECK(grid[0] <= 2 && grid[LUMA_GRID_COLS / 2 - 1] <= 2);
+  CHECK(grid[LUMA_GRID_COLS / 2] >= 253 && grid[LUMA_GRID_CELLS - 1] >= 253);
+  CHECK_EQ(luminanceGridDifference(grid, grid), 0);
+
+  // Progressief, zonder scan of leeg: niet te bepalen
+  std::vector<uint8_t> progressive = encodeJpeg(64, 64, gradient, 0, true);
+  CHECK(!jpegLuminance(progressive.data(), progressive.size(), stats));
+  CHECK_EQ(stats.valid, 0);
+  CHECK(!jpegLuminance(plain.data(), 200, stats));
+  CHECK(!jpegLuminance(plain.data(), 0, stats));
+}
+
+// --- Herstel via het journaal ---------------------------------------------------
+
+void testJournalRecovery(const char* day, const std::vector<std::string>& names,
+                         const std::vector<std::vector<uint8_t> >& photos) {
+  String dir = "/timelapse/" + String(day) + "/";
+  PhotoIndexEntry entry;
+
+  // Stroomuitval nabootsen:
+  // 0: onderbroken opslag (alleen .tmp), 1: afgekapte foto, 2: foto niet in de index
+  File temp = SD_MMC.open(dir + names[0].c_str() + JOURNAL_TEMP_SUFFIX, FILE_WRITE);
+  temp.write(photos[0].data(), photos[0].size() / 2);
+  temp.close();
+  File truncated = SD_MMC.open(dir + names[1].c_str(), FILE_WRITE);
+  truncated.write(photos[1].data(), photos[1].size() - 100);
+  truncated.close();
+  CHECK(indexRemovePhoto(day, names[2].c_str()));
+  CHECK(!indexFindPhoto(day, names[2].c_str(), entry));
+
+  CHECK(recoverPhotoJournal());
+  JournalStats stats = getJournalStats();
+  CHECK(stats.complete);
+  CHECK_EQ(stats.tempRemoved, 1);
+  CHECK_EQ(stats.corrupt, 1);
+  CHECK_EQ(stats.reindexed, 1);
+  CHECK(stats.checked >= photos.size());
+  CHECK(!SD_MMC.exists(dir + names[0].c_str() + JOURNAL_TEMP_SUFFIX));
+  CHECK(SD_MMC.exists(dir + names[0].c_str()));
+  CHECK(!SD_MMC.exists(dir + names[1].c_str()));
+  CHECK(!indexFindPhoto(day, names[1].c_str(), entry));
+  CHECK(indexFindPhoto(day, names[2].c_str(), entry));
+  CHECK_EQ(entry.size, photos[2].size());
+
+  // Tweede keer: niets meer te herstellen
+  CHECK(recoverPhotoJournal());
+  stats = getJournalStats();
+  CHECK_EQ(stats.tempRemoved + stats.corrupt + stats.reindexed, 0);
+}
+
+}  // namespace
+
+int main() {
+  char tmpl[] = "/tmp/timelapse-tests-XXXXXX";
+  if (!mkdtemp(tmpl)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  hostSdSetRoot(tmpl);
+  hostSerialSetEnabled(false);
+  SD_MMC.begin();
+  sdCardAvailable = true;
+  SD_MMC.mkdir("/timelapse");
+  initPhotoIndex();
+  recoverPhotoJournal();
+
+  // Drie foto's van één dag, opgeslagen zoals de SD-schrijver dat doet
+  const char* day = "01-01-2030";
+  SD_MMC.mkdir("/timelapse/" + String(day));
+  struct tm timeinfo = {};
+  timeinfo.tm_year = 130;
+  timeinfo.tm_mday = 1;
+  timeinfo.tm_hour = 12;
+  timeinfo.tm_isdst = -1;
+  time_t first = mktime(&timeinfo);
+  std::vector<std::vector<uint8_t> > photos;
+  std::vector<std::string> names;
+  for (int i = 0; i < 3; i++) {
+    photos.push_back(encodeJpeg(160, 120, [i](int x, int y) { return (uint8_t)(x + y * 2 + i * 30); }));
+    char path[64];
+    CHECK(savePhotoBuffer(photos[i].data(), photos[i].size(), first + i * 60, path, sizeof(path)));
+    names.push_back(strrchr(path, '/') + 1);
+  }
+  CHECK(names[0] == "01-01-2030_12-00-00.jpg");
+
+  testRange();
+  testHttpParser();
+  testZipArchive(day, names, photos);
+  testAviWriter();
+  testLuminance();
+  if (!segmentStorage) testJournalRecovery(day, names, photos);  // Het journaal geldt alleen voor losse bestanden
+
+  std::string cleanup = std::string("rm -rf ") + tmpl;
+  system(cleanup.c_str());
+  printf("%d controles, %d mislukt\n", checks, failures);
+  return failures == 0 ? 0 : 1;
+}